@@ -0,0 +1,74 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+import random
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+DTYPES = [np.float32, np.float64, np.complex64, np.complex128]
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def bench_binary(shape=(60, 60_000)):
+    # Latency of the binary operations with xa = [60, 60000] and xb either a tensor of the same shape, a scalar,
+    # a row ([1, 60000]) or a column ([60, 1]), the last two are computed one row at a time.
+    ops = {
+        'add': (np.add, dsc.add),
+        'sub': (np.subtract, dsc.sub),
+        'mul': (np.multiply, dsc.mul),
+        'true_div': (np.true_divide, dsc.true_div),
+    }
+    operands = ['tensor', 'scalar', 'row', 'column']
+
+    for dtype in DTYPES:
+        a = random_nd(list(shape), dtype)
+        out = np.empty_like(a)
+        a_dsc = dsc.from_numpy(a)
+        out_dsc = dsc.from_numpy(out)
+
+        table_data = []
+        for op_name, (np_op, dsc_op) in ops.items():
+            for kind in operands:
+                if kind == 'scalar':
+                    b = complex(random.random(), random.random()) if np.iscomplexobj(a) else random.random()
+                    b_dsc = b
+                else:
+                    b_shape = {'tensor': shape, 'row': (1, shape[1]), 'column': (shape[0], 1)}[kind]
+                    b = random_nd(list(b_shape), dtype)
+                    b_dsc = dsc.from_numpy(b)
+
+                np_ms = bench(np_op, a, b, out=out) * 1e3
+                dsc_ms = bench(dsc_op, a_dsc, b_dsc, out=out_dsc) * 1e3
+                table_data.append([f'{op_name} ({kind})', np_ms, dsc_ms, dsc_ms / np_ms])
+
+        print(f'X={list(shape)} dtype={dtype.__name__}')
+        headers = ['Operation', 'NumPy Latency (ms)', 'DSC Latency (ms)', 'Ratio (DSC/NumPy)']
+        print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+        print()
+
+
+if __name__ == '__main__':
+    bench_binary()
@@ -0,0 +1,87 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def traffic_mb(expr: dsc.Tensor) -> tuple[float, float]:
+    # Bytes moved to and from main memory by the eager operations (every operation reads its operands and writes
+    # a new tensor) and by the fused expression (the inputs are read once and only the output is written)
+    def _walk(x: dsc.Tensor, inputs: dict) -> int:
+        if not dsc.tensor._is_pending(x):
+            inputs[id(x)] = x.ne
+            return 0
+        return x.ne + sum(o.ne + _walk(o, inputs) for o in x._operands)
+
+    inputs = {}
+    eager = _walk(expr, inputs)
+    fused = sum(inputs.values()) + expr.ne
+    size = expr.numpy().itemsize
+    return eager * size / 2**20, fused * size / 2**20
+
+
+def bench_fusion(shape=(60, 60_000), dtype=np.float32):
+    # Latency of chains of 3 to 6 elementwise operations computed one operation at a time and fused in a single pass
+    # by dsc.lazy(), w is a row broadcast along the first dimension
+    exprs = {
+        '(a + b) * c - 1': lambda m, a, b, c, w: (a + b) * c - 1,
+        'sqrt(a*a + b*b)': lambda m, a, b, c, w: m.sqrt(a * a + b * b),
+        'sqrt(a*a + b*b) * w': lambda m, a, b, c, w: m.sqrt(a * a + b * b) * w,
+        'exp((a*a + b*b) * -0.5) * w': lambda m, a, b, c, w: m.exp((a * a + b * b) * -0.5) * w,
+    }
+
+    a, b, c = (random_nd(list(shape), dtype) for _ in range(3))
+    w = random_nd([1, shape[1]], dtype)
+    a_dsc, b_dsc, c_dsc, w_dsc = (dsc.from_numpy(x) for x in (a, b, c, w))
+
+    def _lazy(expr):
+        with dsc.lazy():
+            y = expr(dsc, a_dsc, b_dsc, c_dsc, w_dsc)
+        return y.numpy()
+
+    table_data = []
+    for name, expr in exprs.items():
+        with dsc.lazy():
+            y = expr(dsc, a_dsc, b_dsc, c_dsc, w_dsc)
+            eager_mb, fused_mb = traffic_mb(y)
+
+        np_ms = bench(expr, np, a, b, c, w) * 1e3
+        eager_ms = bench(expr, dsc, a_dsc, b_dsc, c_dsc, w_dsc) * 1e3
+        fused_ms = bench(_lazy, expr) * 1e3
+        table_data.append([name, np_ms, eager_ms, fused_ms, eager_ms / fused_ms, eager_mb, fused_mb])
+
+    print(f'X={list(shape)} dtype={dtype.__name__}')
+    headers = ['Expression', 'NumPy Latency (ms)', 'DSC Eager (ms)', 'DSC Fused (ms)', 'Speedup (Eager/Fused)',
+               'Eager Traffic (MB)', 'Fused Traffic (MB)']
+    print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+    print()
+
+
+if __name__ == '__main__':
+    for dtype in [np.float32, np.complex64]:
+        bench_fusion(dtype=dtype)
@@ -0,0 +1,55 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def bench_goertzel(n: int = 4096, lines: int = 64):
+    # Latency of computing n_bins bins with Goertzel vs the full RFFT, the crossover is the
+    # first n_bins where Goertzel is slower
+    for dtype in [np.float32, np.float64]:
+        x = dsc.from_numpy(random_nd([lines, n], dtype=dtype))
+        rfft_us = bench(dsc.rfft, x) * 1e6
+
+        table_data = []
+        crossover = None
+        for n_bins in [1, 2, 4, 8, 12, 16, 24, 32, 48, 64, 128]:
+            bins = tuple(np.random.randint(0, n // 2 + 1, n_bins).tolist())
+            goertzel_us = bench(dsc.goertzel, x, bins) * 1e6
+            if crossover is None and goertzel_us > rfft_us:
+                crossover = n_bins
+            table_data.append([n_bins, goertzel_us, rfft_us, goertzel_us / rfft_us])
+
+        print(f'N={n} lines={lines} dtype={dtype.__name__}')
+        headers = ['Bins', 'Goertzel (us)', 'RFFT (us)', 'Ratio (Goertzel/RFFT)']
+        print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+        print(f'Crossover at {crossover} bins\n')
+
+
+if __name__ == '__main__':
+    bench_goertzel()
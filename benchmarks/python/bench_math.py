@@ -0,0 +1,72 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+DTYPES = [np.float32, np.float64, np.complex64, np.complex128]
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def bench_math(shape=(60, 60_000)):
+    # Latency of the elementary functions computed with libm (accurate) and with the SIMD kernels (fast)
+    ops = {
+        'sin': (np.sin, dsc.sin),
+        'cos': (np.cos, dsc.cos),
+        # np.sinc doesn't take out
+        'sinc': (lambda x, out: np.sinc(x), dsc.sinc),
+        'exp': (np.exp, dsc.exp),
+        'logn': (np.log, dsc.logn),
+        'log2': (np.log2, dsc.log2),
+        'log10': (np.log10, dsc.log10),
+    }
+
+    for dtype in DTYPES:
+        # Positive so that the real logarithms are defined
+        x = np.abs(random_nd(list(shape), dtype)) if dtype in (np.float32, np.float64) else random_nd(list(shape), dtype)
+        out = np.empty_like(x)
+        x_dsc = dsc.from_numpy(x)
+        out_dsc = dsc.from_numpy(out)
+
+        table_data = []
+        for op_name, (np_op, dsc_op) in ops.items():
+            np_ms = bench(np_op, x, out=out) * 1e3
+            dsc.set_math_precision('accurate')
+            accurate_ms = bench(dsc_op, x_dsc, out=out_dsc) * 1e3
+            dsc.set_math_precision('fast')
+            fast_ms = bench(dsc_op, x_dsc, out=out_dsc) * 1e3
+            table_data.append([op_name, np_ms, accurate_ms, fast_ms, fast_ms / np_ms])
+
+        dsc.set_math_precision('accurate')
+
+        print(f'X={list(shape)} dtype={dtype.__name__}')
+        headers = ['Operation', 'NumPy Latency (ms)', 'DSC Accurate (ms)', 'DSC Fast (ms)', 'Ratio (Fast/NumPy)']
+        print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+        print()
+
+
+if __name__ == '__main__':
+    bench_math()
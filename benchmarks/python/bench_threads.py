@@ -0,0 +1,71 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def bench_threads(shape=(60, 60_000), dtype=np.float32):
+    # Scaling of elementwise operations, reductions and copies from 1 thread up to the number of cores
+    x = dsc.from_numpy(random_nd(list(shape), dtype))
+    y = dsc.from_numpy(random_nd(list(shape), dtype))
+    row = dsc.from_numpy(random_nd([1, shape[1]], dtype))
+    out = dsc.from_numpy(np.empty(shape, dtype=dtype))
+
+    ops = {
+        'add (tensor)': lambda: dsc.add(x, y, out=out),
+        'add (row)': lambda: dsc.add(x, row, out=out),
+        'exp': lambda: dsc.exp(x, out=out),
+        'sum (axis=0)': lambda: dsc.sum(x, axis=0),
+        'sum (axis=1)': lambda: dsc.sum(x, axis=1),
+        'transpose': lambda: dsc.transpose(x),
+        'cast': lambda: x.cast(dsc.Dtype.F64),
+        'concat': lambda: dsc.concat([x, y], axis=1),
+    }
+
+    cores = os.cpu_count()
+    threads = sorted({1, 2, 4, cores} & set(range(1, cores + 1)))
+
+    table_data = []
+    for op_name, op in ops.items():
+        latency = []
+        for n_threads in threads:
+            dsc.set_threads(n_threads)
+            latency.append(bench(op) * 1e3)
+        table_data.append([op_name, *latency, latency[0] / latency[-1]])
+
+    dsc.set_threads(1)
+
+    print(f'X={list(shape)} dtype={dtype.__name__}')
+    headers = ['Operation', *[f'{n} Thread(s) (ms)' for n in threads], f'Speedup ({threads[-1]} vs 1)']
+    print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+    print()
+
+
+if __name__ == '__main__':
+    for dtype in [np.float32, np.complex64]:
+        bench_threads(dtype=dtype)
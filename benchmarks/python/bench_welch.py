@@ -0,0 +1,60 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+import os
+os.environ['OMP_NUM_THREADS'] = '1'
+os.environ['GOTO_NUM_THREADS'] = '1'
+os.environ['MKL_NUM_THREADS'] = '1'
+
+import dsc
+import numpy as np
+import time
+from utils import WARMUP, BENCH_STEPS, random_nd
+from tabulate import tabulate
+
+
+def bench(op, *args, **kwargs) -> float:
+    for _ in range(WARMUP):
+        op(*args, **kwargs)
+
+    op_time = float('+inf')
+    for _ in range(BENCH_STEPS):
+        start_ = time.perf_counter()
+        op(*args, **kwargs)
+        this_time = time.perf_counter() - start_
+        op_time = this_time if this_time < op_time else op_time
+    return op_time
+
+
+def composed_welch(x: np.ndarray, window: dsc.Tensor, nperseg: int, step: int):
+    # Frame, window, transform and average with the generic ops (without detrending)
+    frames = dsc.from_numpy(np.ascontiguousarray(np.lib.stride_tricks.sliding_window_view(x, nperseg)[::step]))
+    spectrum = dsc.absolute(dsc.rfft(frames * window))
+    return dsc.mean(spectrum * spectrum, axis=0, keepdims=False)
+
+
+def bench_welch(n: int = 1_000_000):
+    # Latency of dsc.welch vs the same PSD composed from framing, dsc.mul, dsc.rfft, dsc.absolute and dsc.mean
+    for dtype in [np.float32, np.float64]:
+        x_np = random_nd([n], dtype=dtype)
+        x = dsc.from_numpy(x_np)
+
+        table_data = []
+        for nperseg in [64, 255, 256, 1024, 4096]:
+            step = nperseg // 2
+            window = dsc.from_numpy(np.hanning(nperseg).astype(dtype))
+            welch_us = bench(dsc.welch, x, window=window, nperseg=nperseg, detrend=False) * 1e6
+            composed_us = bench(composed_welch, x_np, window, nperseg, step) * 1e6
+            table_data.append([nperseg, welch_us, composed_us, composed_us / welch_us])
+
+        print(f'N={n} dtype={dtype.__name__}')
+        headers = ['nperseg', 'welch (us)', 'Composed (us)', 'Speedup']
+        print(tabulate(table_data, headers=headers, floatfmt='.2f', tablefmt='grid'))
+        print()
+
+
+if __name__ == '__main__':
+    bench_welch()
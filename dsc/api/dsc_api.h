@@ -10,6 +10,7 @@
 #include <cstring>
 #include <initializer_list>
 #include <algorithm> // std::copy
+#include <memory>    // std::shared_ptr
 
 
 #define DSC_SLICE_ALL()                 (dsc_slice{.start = DSC_VALUE_NONE, .stop = DSC_VALUE_NONE, .step = 1})
@@ -24,6 +25,8 @@
 namespace dsc {
 
 static dsc_ctx *ctx = nullptr;
+// Number of lazy_scope alive
+static int lazy_depth = 0;
 
 static DSC_INLINE void init(u64 main_mem, u64 scratch_mem = 0) noexcept {
     if (scratch_mem == 0) {
@@ -33,6 +36,31 @@ static DSC_INLINE void init(u64 main_mem, u64 scratch_mem = 0) noexcept {
     ctx = dsc_ctx_init(main_mem, scratch_mem);
 }
 
+// While a lazy_scope is alive the operators +, -, * and /, pow, sqrt and sinc don't compute anything, they return
+// a tensor that records the operation. The expression is computed with a single dsc_fused call the first time the
+// data of the result is used so the intermediate results are never allocated. The inputs must not be modified
+// until then.
+struct lazy_scope {
+    lazy_scope() noexcept { lazy_depth++; }
+    ~lazy_scope() noexcept { lazy_depth--; }
+};
+
+// A node of an expression recorded in lazy mode: either an input (x is a view of the input tensor) or
+// the operation op of the nodes a and b (b is null if op is unary)
+template<typename T>
+struct lazy_node {
+    dsc_fused_op_type op;
+    std::shared_ptr<const lazy_node> a, b;
+    dsc_tensor *x;
+    int shape[DSC_MAX_DIMS], n_dim;
+    // Upper bounds of the number of operations and inputs of the expression
+    int n_ops, n_inputs;
+
+    ~lazy_node() noexcept {
+        if (x != nullptr) dsc_tensor_free(ctx, x);
+    }
+};
+
 template<typename T>
 class tensor {
 
@@ -62,20 +90,27 @@ public:
         memcpy(x_->data, data, ne * sizeof(T));
     }
 
-    tensor(const tensor &other) noexcept {
-        x_ = dsc_new_tensor(ctx, other.x_->n_dim, other.x_->shape, other.x_->dtype);
-        memcpy(x_->data, other.x_->data, other.x_->ne * DSC_DTYPE_SIZE[other.x_->dtype]);
+    // Copying a lazy tensor shares its expression, it will be computed once per copy
+    tensor(const tensor &other) noexcept : x_(nullptr), expr_(other.expr_) {
+        if (other.x_ != nullptr) {
+            x_ = dsc_new_like(ctx, other.x_);
+            memcpy(x_->data, other.x_->data, other.x_->ne * DSC_DTYPE_SIZE[other.x_->dtype]);
+        }
     }
 
-    tensor(tensor &&other) noexcept : x_(other.x_) {
+    tensor(tensor &&other) noexcept : x_(other.x_), expr_(std::move(other.expr_)) {
         other.x_ = nullptr;
     }
 
     tensor &operator=(const tensor &other) noexcept {
         if (this != &other) {
             if (x_ != nullptr) dsc_tensor_free(ctx, x_);
-            x_ = dsc_new_tensor(ctx, other.x_->n_dim, other.x_->shape, other.x_->dtype);
-            memcpy(x_->data, other.x_->data, other.x_->ne * DSC_DTYPE_SIZE[other.x_->dtype]);
+            x_ = nullptr;
+            expr_ = other.expr_;
+            if (other.x_ != nullptr) {
+                x_ = dsc_new_like(ctx, other.x_);
+                memcpy(x_->data, other.x_->data, other.x_->ne * DSC_DTYPE_SIZE[other.x_->dtype]);
+            }
         }
         return *this;
     }
@@ -84,6 +119,7 @@ public:
         if (this != &other) {
             if (x_ != nullptr) dsc_tensor_free(ctx, x_);
             x_ = other.x_;
+            expr_ = std::move(other.expr_);
             other.x_ = nullptr;
         }
         return *this;
@@ -97,7 +133,8 @@ public:
     // Utilities
 
     DSC_INLINE int dim(const int idx) const noexcept {
-        return x_->shape[dsc_tensor_dim(x_, idx)];
+        const dsc_tensor *x = ptr();
+        return x->shape[dsc_tensor_dim(x, idx)];
     }
 
     DSC_INLINE int size() const noexcept {
@@ -105,11 +142,11 @@ public:
     }
 
     DSC_INLINE int ndim() const noexcept {
-        return x_->n_dim;
+        return ptr()->n_dim;
     }
 
     DSC_INLINE T *data() const noexcept {
-        return (T *) x_->data;
+        return (T *) ptr()->data;
     }
     // ============================================================
     // Indexing/Slicing
@@ -120,7 +157,7 @@ public:
         constexpr usize n_args = sizeof...(Args);
         static_assert(n_args > 0);
 
-        return dsc_tensor_get_idx(ctx, x_, n_args, indexes...);
+        return dsc_tensor_get_idx(ctx, ptr(), n_args, indexes...);
     }
 
     template<typename ...Args>
@@ -129,7 +166,7 @@ public:
         constexpr usize n_args = sizeof...(Args);
         static_assert(n_args > 0);
 
-        return dsc_tensor_get_slice(ctx, x_, n_args, slices...);
+        return dsc_tensor_get_slice(ctx, ptr(), n_args, slices...);
     }
 
     template<typename ...Args>
@@ -138,7 +175,7 @@ public:
         constexpr usize n_args = sizeof...(Args);
         static_assert(n_args > 0);
 
-        dsc_tensor_set_slice(ctx, x_, other.x_, n_args, slices...);
+        dsc_tensor_set_slice(ctx, ptr(), other.ptr(), n_args, slices...);
         return *this;
     }
 
@@ -146,46 +183,59 @@ public:
     // Operators
 
     DSC_INLINE tensor operator+(const tensor &other) const noexcept {
-        return dsc_add(ctx, x_, other.x_);
+        if (lazy_depth > 0) return record(DSC_FUSED_ADD, *this, &other);
+        return dsc_add(ctx, ptr(), other.ptr());
     }
     DSC_INLINE tensor operator+(const T other) const noexcept {
-        return dsc_add(ctx, x_, wrap(other).x_);
+        return *this + wrap(other);
     }
 
     DSC_INLINE tensor operator-(const tensor &other) const noexcept {
-        return dsc_sub(ctx, x_, other.x_);
+        if (lazy_depth > 0) return record(DSC_FUSED_SUB, *this, &other);
+        return dsc_sub(ctx, ptr(), other.ptr());
     }
     DSC_INLINE tensor operator-(const T other) const noexcept {
-        return dsc_sub(ctx, x_, wrap(other).x_);
+        return *this - wrap(other);
     }
     DSC_INLINE friend tensor operator-(T scalar, const tensor& other) noexcept {
         return wrap(scalar) - other;
     }
 
     DSC_INLINE tensor operator*(const tensor &other) const noexcept {
-        return dsc_mul(ctx, x_, other.x_);
+        if (lazy_depth > 0) return record(DSC_FUSED_MUL, *this, &other);
+        return dsc_mul(ctx, ptr(), other.ptr());
     }
     DSC_INLINE tensor operator*(const T other) const noexcept {
-        return dsc_mul(ctx, x_, wrap(other).x_);
+        return *this * wrap(other);
     }
     friend DSC_INLINE tensor operator*(T scalar, const tensor& other) noexcept {
         return wrap(scalar) * other;
     }
 
     DSC_INLINE tensor operator/(const tensor &other) const noexcept {
-        return dsc_div(ctx, x_, other.x_);
+        if (lazy_depth > 0) return record(DSC_FUSED_DIV, *this, &other);
+        return dsc_div(ctx, ptr(), other.ptr());
     }
     DSC_INLINE tensor operator/(const T other) const noexcept {
-        return dsc_div(ctx, x_, wrap(other).x_);
+        return *this / wrap(other);
     }
     DSC_INLINE tensor &operator/=(const tensor &other) noexcept {
-        dsc_div(ctx, x_, other.x_, x_);
+        dsc_tensor *x = ptr();
+        dsc_div(ctx, x, other.ptr(), x);
         return *this;
     }
 
     // Todo: should be outside
     DSC_INLINE tensor pow(const real<T> exp) const noexcept {
-        return dsc_pow(ctx, x_, wrap(exp).x_);
+        T exp_ = {};
+        if constexpr (dsc_is_complex<T>()) {
+            exp_ = dsc_complex(T, exp, 0);
+        } else {
+            exp_ = exp;
+        }
+        const tensor exp_tensor = wrap(exp_);
+        if (lazy_depth > 0) return record(DSC_FUSED_POW, *this, &exp_tensor);
+        return dsc_pow(ctx, ptr(), exp_tensor.ptr());
     }
 
     // ============================================================
@@ -238,6 +288,107 @@ public:
                                       int n, int axis) noexcept;
 
 private:
+    DSC_INLINE bool pending() const noexcept {
+        return x_ == nullptr && expr_ != nullptr;
+    }
+
+    // The tensor of the result, if it's an expression that hasn't been computed yet compute it now
+    DSC_INLINE dsc_tensor *ptr() const noexcept {
+        if (pending()) {
+            x_ = eval(expr_.get());
+            expr_.reset();
+        }
+        return x_;
+    }
+
+    static std::shared_ptr<const lazy_node<T>> node_of(const tensor &t) noexcept {
+        if (t.pending()) return t.expr_;
+
+        const dsc_tensor *x = t.ptr();
+        std::shared_ptr<lazy_node<T>> node = std::make_shared<lazy_node<T>>();
+        node->x = dsc_view(ctx, x);
+        memcpy(node->shape, x->shape, DSC_MAX_DIMS * sizeof(*node->shape));
+        node->n_dim = x->n_dim;
+        node->n_ops = 0;
+        node->n_inputs = 1;
+        return node;
+    }
+
+    static tensor record(const dsc_fused_op_type op, const tensor &a, const tensor *b = nullptr) noexcept {
+        const int n_ops = 1 + (a.pending() ? a.expr_->n_ops : 0) + (b != nullptr && b->pending() ? b->expr_->n_ops : 0);
+        const int n_inputs = (a.pending() ? a.expr_->n_inputs : 1) +
+                             (b == nullptr ? 0 : (b->pending() ? b->expr_->n_inputs : 1));
+        if (n_ops > DSC_MAX_FUSED_OPS || n_inputs > DSC_MAX_FUSED_INPUTS) {
+            // Too big for a single dsc_fused call, compute the operands first
+            a.ptr();
+            if (b != nullptr) b->ptr();
+        }
+
+        std::shared_ptr<lazy_node<T>> node = std::make_shared<lazy_node<T>>();
+        node->op = op;
+        node->a = node_of(a);
+        node->b = b != nullptr ? node_of(*b) : nullptr;
+        node->x = nullptr;
+        node->n_dim = node->a->n_dim;
+        node->n_ops = 1 + node->a->n_ops;
+        node->n_inputs = node->a->n_inputs;
+        memcpy(node->shape, node->a->shape, DSC_MAX_DIMS * sizeof(*node->shape));
+        if (node->b != nullptr) {
+            for (int i = 0; i < DSC_MAX_DIMS; ++i) {
+                DSC_ASSERT(node->shape[i] == node->b->shape[i] || node->shape[i] == 1 || node->b->shape[i] == 1);
+                node->shape[i] = DSC_MAX(node->shape[i], node->b->shape[i]);
+            }
+            node->n_dim = DSC_MAX(node->n_dim, node->b->n_dim);
+            node->n_ops += node->b->n_ops;
+            node->n_inputs += node->b->n_inputs;
+        }
+
+        tensor out;
+        out.expr_ = std::move(node);
+        return out;
+    }
+
+    // Number the values of the expression in topological order like dsc_fused wants them, a shared node is
+    // computed once and the same tensor used more than once (eg. x * x) is a single input. Until their number
+    // is known the inputs are numbered -1, -2...
+    static int number(const lazy_node<T> *node,
+                      dsc_tensor **inputs, int &n_inputs,
+                      const lazy_node<T> **nodes, dsc_fused_op *ops, int &n_ops) noexcept {
+        if (node->x != nullptr) {
+            for (int i = 0; i < n_inputs; ++i) {
+                if (inputs[i]->data == node->x->data &&
+                    memcmp(inputs[i]->shape, node->x->shape, DSC_MAX_DIMS * sizeof(*node->x->shape)) == 0)
+                    return -(i + 1);
+            }
+            inputs[n_inputs++] = node->x;
+            return -n_inputs;
+        }
+
+        for (int i = 0; i < n_ops; ++i) {
+            if (nodes[i] == node) return i;
+        }
+
+        const int a = number(node->a.get(), inputs, n_inputs, nodes, ops, n_ops);
+        const int b = node->b != nullptr ? number(node->b.get(), inputs, n_inputs, nodes, ops, n_ops) : a;
+        nodes[n_ops] = node;
+        ops[n_ops] = dsc_fused_op{node->op, a, b};
+        return n_ops++;
+    }
+
+    static dsc_tensor *eval(const lazy_node<T> *expr) noexcept {
+        dsc_tensor *inputs[DSC_MAX_FUSED_INPUTS];
+        const lazy_node<T> *nodes[DSC_MAX_FUSED_OPS];
+        dsc_fused_op ops[DSC_MAX_FUSED_OPS];
+        int n_inputs = 0, n_ops = 0;
+        number(expr, inputs, n_inputs, nodes, ops, n_ops);
+
+        for (int i = 0; i < n_ops; ++i) {
+            ops[i].a = ops[i].a < 0 ? -ops[i].a - 1 : n_inputs + ops[i].a;
+            ops[i].b = ops[i].b < 0 ? -ops[i].b - 1 : n_inputs + ops[i].b;
+        }
+        return dsc_fused(ctx, n_inputs, inputs, n_ops, ops);
+    }
+
     static DSC_INLINE tensor wrap(const T scalar) noexcept {
         // Todo: evaluate the possibility of wrapping everything on the stack
         if constexpr (dsc_is_type<T, f32>()) {
@@ -253,7 +404,9 @@ private:
         }
     }
 
-    dsc_tensor *x_;
+    mutable dsc_tensor *x_;
+    // The expression of a tensor created in lazy mode until it's computed
+    mutable std::shared_ptr<const lazy_node<T>> expr_;
 };
 
 template<typename T>
@@ -263,30 +416,32 @@ static DSC_INLINE tensor<T> arange(const int n) noexcept {
 
 template<typename T>
 static DSC_INLINE tensor<T> i0(const tensor<T>& x) noexcept {
-    return dsc_i0(ctx, x.x_);
+    return dsc_i0(ctx, x.ptr());
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> sqrt(const tensor<T>& x) noexcept {
-    return dsc_sqrt(ctx, x.x_);
+    if (lazy_depth > 0) return tensor<T>::record(DSC_FUSED_SQRT, x);
+    return dsc_sqrt(ctx, x.ptr());
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> sinc(const tensor<T>& x) noexcept {
-    return dsc_sinc(ctx, x.x_);
+    if (lazy_depth > 0) return tensor<T>::record(DSC_FUSED_SINC, x);
+    return dsc_sinc(ctx, x.ptr());
 }
 
 template<typename U>
 static DSC_INLINE tensor<U> clip(const tensor<U>& x,
                                  const U min, const U max) noexcept {
-    return dsc_clip(ctx, x.x_, nullptr, (f64) min, (f64) max);
+    return dsc_clip(ctx, x.ptr(), nullptr, (f64) min, (f64) max);
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> sum(const tensor<T>& x,
                                 const int axis = -1,
                                 const bool keep_dims = true) noexcept {
-    return dsc_sum(ctx, x.x_, nullptr, axis, keep_dims);
+    return dsc_sum(ctx, x.ptr(), nullptr, axis, keep_dims);
 }
 
 template<typename T, typename... Args>
@@ -295,8 +450,8 @@ static DSC_INLINE tensor<T> transpose(const tensor<T>& x,
                                       Args... axes) noexcept {
     constexpr size n_args = sizeof...(Args);
 
-    if constexpr (n_args == 0) return dsc_transpose(ctx, x.x_, 0);
-    return dsc_transpose(ctx, x.x_, n_args, axes...);
+    if constexpr (n_args == 0) return dsc_transpose(ctx, x.ptr(), 0);
+    return dsc_transpose(ctx, x.ptr(), n_args, axes...);
 }
 
 template<typename T, typename... Args>
@@ -306,7 +461,7 @@ static DSC_INLINE tensor<T> reshape(const tensor<T>& x,
     constexpr size n_args = sizeof...(Args);
     static_assert(n_args > 0);
 
-    return dsc_reshape(ctx, x.x_, n_args, dimensions...);
+    return dsc_reshape(ctx, x.ptr(), n_args, dimensions...);
 }
 
 template<typename T, typename... Args>
@@ -315,30 +470,33 @@ static DSC_INLINE tensor<T> concat(const int axis = 0, Args... tensors) noexcept
     constexpr size n_args = sizeof...(Args);
     static_assert(n_args > 1);
 
-    return dsc_concat(ctx, axis, n_args, tensors.x_...);
+    return dsc_concat(ctx, axis, n_args, tensors.ptr()...);
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> fft(const tensor<T>& x,
-                                const int n = -1, const int axis = -1) noexcept {
-    return dsc_fft(ctx, x.x_, nullptr, n, axis);
+                                const int n = -1, const int axis = -1,
+                                const int bin_start = 0, const int bin_stop = -1) noexcept {
+    return dsc_fft(ctx, x.ptr(), nullptr, n, axis, bin_start, bin_stop);
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> ifft(const tensor<T>& x,
-                                 const int n = -1, const int axis = -1) noexcept {
-    return dsc_ifft(ctx, x.x_, nullptr, n, axis);
+                                 const int n = -1, const int axis = -1,
+                                 const int bin_start = 0, const int bin_stop = -1) noexcept {
+    return dsc_ifft(ctx, x.ptr(), nullptr, n, axis, bin_start, bin_stop);
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> rfft(const tensor<T>& x,
-                                 const int n = -1, const int axis = -1) noexcept {
-    return dsc_rfft(ctx, x.x_, nullptr, n, axis);
+                                 const int n = -1, const int axis = -1,
+                                 const int bin_start = 0, const int bin_stop = -1) noexcept {
+    return dsc_rfft(ctx, x.ptr(), nullptr, n, axis, bin_start, bin_stop);
 }
 
 template<typename T>
 static DSC_INLINE tensor<T> irfft(const tensor<T>& x,
                                   const int n = -1, const int axis = -1) noexcept {
-    return dsc_irfft(ctx, x.x_, nullptr, n, axis);
+    return dsc_irfft(ctx, x.ptr(), nullptr, n, axis);
 }
 }
\ No newline at end of file
@@ -88,6 +88,10 @@ extern "C" {
 
 struct dsc_ctx;
 struct dsc_fft_plan;
+struct dsc_stft;
+struct dsc_conv_stream;
+struct dsc_sdft;
+struct dsc_channelizer;
 enum dsc_fft_type : u8;
 enum dsc_backend_type : u8;
 enum dsc_allocator_type : u8;
@@ -107,6 +111,25 @@ struct dsc_tensor {
     dsc_backend_type backend;
 };
 
+// How dsc_plan_fft chooses the algorithm of a new plan
+enum dsc_plan_mode : u8 {
+    // Use the cost model, this is what the FFT operations do
+    DSC_PLAN_ESTIMATE,
+    // Time the candidate algorithms, SIMD kernels and radix orders on this machine and keep the fastest.
+    // This takes from a few ms to a few seconds for very large N but the result is cached like any other plan
+    // and can be saved with dsc_export_wisdom. The timing table is recorded with the traces.
+    DSC_PLAN_MEASURE,
+};
+
+// Which implementation of the elementary functions (cos, sin, sinc, exp, logn, log2 and log10) is used
+enum dsc_math_precision : u8 {
+    // libm, this is the default
+    DSC_MATH_ACCURATE,
+    // The SIMD implementations of dsc_math_kernels.h, within 2.5 ULP of the correctly rounded result.
+    // The complex logarithms and the sin/cos of large arguments still use libm.
+    DSC_MATH_FAST,
+};
+
 struct dsc_slice {
     union {
         int d[3];
@@ -116,6 +139,15 @@ struct dsc_slice {
     };
 };
 
+struct dsc_fft_cache_stats {
+    u64 hits, misses, evictions;
+    // Number of plans currently cached and max number of plans that can be cached
+    int size, capacity;
+    // Number of sets of twiddles shared by the cached plans and their size in bytes
+    int twiddle_sets;
+    usize twiddle_bytes;
+};
+
 // ============================================================
 // Helper Functions
 
@@ -134,17 +166,41 @@ static DSC_INLINE DSC_STRICTLY_PURE int dsc_pow2_n(const int n) noexcept {
 // ============================================================
 // Initialization
 
-extern dsc_ctx *dsc_ctx_init(usize main_mem, usize scratch_mem) noexcept;
-
+// max_fft_plans is the number of FFT plans that can be cached, if max_fft_plans <= 0
+// DSC_MAX_FFT_PLANS is used. It must be at least DSC_MAX_DIMS.
+// n_threads is the number of threads used by the context, see dsc_set_threads.
+extern dsc_ctx *dsc_ctx_init(usize main_mem, usize scratch_mem,
+                             int max_fft_plans = -1, int n_threads = 1) noexcept;
+
+// Return the plan used by the FFT operations for a transform of order N, creating it if it's not cached.
+// With DSC_PLAN_MEASURE the candidates are timed on batch contiguous lines and the winner replaces the cached
+// plan, if it was not measured already, so the following FFTs of order N use it.
+// Note: the batch is not part of the cache key nor of the wisdom, there is a single plan for each N, type and
+// dtype. A plan measured with one batch size is used for any number of lines and measuring it again with a
+// different batch is a cache hit. To tune for another batch size use a new context.
 extern dsc_fft_plan *dsc_plan_fft(dsc_ctx *ctx, int n,
                                   dsc_fft_type fft_type,
-                                  dsc_dtype dtype = dsc_dtype::F64) noexcept;
+                                  dsc_dtype dtype = dsc_dtype::F64,
+                                  dsc_plan_mode mode = DSC_PLAN_ESTIMATE,
+                                  int batch = 1) noexcept;
+
+// Save all the cached FFT plans to filename. The file can be imported with dsc_import_wisdom
+// to skip the computation of the twiddles when the same plans are needed again. Measured plans
+// keep the choices made when they were measured.
+extern bool dsc_export_wisdom(dsc_ctx *ctx, const char *filename) noexcept;
+
+// Add the FFT plans saved in filename to the cache. The file is mapped in memory and the plans
+// use the twiddles directly from there. The plans that were not measured and don't match what this build
+// of DSC would create (eg. a different algorithm) are skipped. Returns false if the file can't be loaded.
+extern bool dsc_import_wisdom(dsc_ctx *ctx, const char *filename) noexcept;
 
 // ============================================================
 // Cleanup/Teardown
 
 extern void dsc_ctx_free(dsc_ctx *ctx) noexcept;
 
+// Free the cached FFT and chirp-z plans, with their twiddles, and reset the statistics of the FFT cache.
+// The plans imported with dsc_import_wisdom are dropped as well.
 extern void dsc_ctx_clear(dsc_ctx *ctx) noexcept;
 
 extern void dsc_tensor_free(dsc_ctx *ctx, dsc_tensor *x) noexcept;
@@ -156,6 +212,19 @@ extern usize dsc_used_mem(dsc_ctx *ctx) noexcept;
 
 extern void dsc_print_mem_usage(dsc_ctx *ctx) noexcept;
 
+// Set the max number of threads used by the operations that support multithreading (FFTs, elementwise operations,
+// reductions and copies). Small operations use fewer threads. If n_threads <= 0 use all the available CPUs.
+// By default, a context uses a single thread.
+extern void dsc_set_threads(dsc_ctx *ctx, int n_threads) noexcept;
+
+extern int dsc_get_threads(dsc_ctx *ctx) noexcept;
+
+extern void dsc_set_math_precision(dsc_ctx *ctx, dsc_math_precision precision) noexcept;
+
+extern dsc_math_precision dsc_get_math_precision(dsc_ctx *ctx) noexcept;
+
+extern dsc_fft_cache_stats dsc_get_fft_cache_stats(dsc_ctx *ctx) noexcept;
+
 // ============================================================
 // Tracing
 
@@ -352,6 +421,51 @@ extern dsc_tensor *dsc_clip(dsc_ctx *ctx,
                             f64 x_min = dsc_inf<f64, false>(),
                             f64 x_max = dsc_inf<f64, true>()) noexcept;
 
+// ============================================================
+// Fused Elementwise Operations
+//
+// An expression made of the binary and unary operations above evaluated in a single pass: every thread
+// computes the whole expression one small tile of the output at a time so the intermediate results never
+// leave the cache and are never allocated as tensors.
+
+#define DSC_MAX_FUSED_INPUTS    ((int) 8)
+#define DSC_MAX_FUSED_OPS       ((int) 16)
+
+enum dsc_fused_op_type : u8 {
+    // Binary
+    DSC_FUSED_ADD,
+    DSC_FUSED_SUB,
+    DSC_FUSED_MUL,
+    DSC_FUSED_DIV,
+    DSC_FUSED_POW,
+    // Unary
+    DSC_FUSED_COS,
+    DSC_FUSED_SIN,
+    DSC_FUSED_SINC,
+    DSC_FUSED_LOGN,
+    DSC_FUSED_LOG2,
+    DSC_FUSED_LOG10,
+    DSC_FUSED_EXP,
+    DSC_FUSED_SQRT,
+};
+
+// The operands are values: 0 to n_inputs - 1 are the inputs, n_inputs + i is the result of the i-th
+// operation. An operation can only use the results of the operations that come before it, b is ignored
+// if the operation is unary.
+struct dsc_fused_op {
+    dsc_fused_op_type type;
+    int a, b;
+};
+
+// The inputs are broadcast together and cast to their common dtype like the operands of the binary
+// operations, all the operations are computed in this dtype. The output is the result of the last operation.
+extern dsc_tensor *dsc_fused(dsc_ctx *ctx,
+                             int n_inputs,
+                             dsc_tensor **inputs,
+                             int n_ops,
+                             const dsc_fused_op *ops,
+                             dsc_tensor *out = nullptr) noexcept;
+
 // ============================================================
 // Unary Operations Along Axis
 
@@ -389,23 +503,36 @@ extern dsc_tensor *dsc_min(dsc_ctx *ctx,
 // If n is not specified then the FFT will be assumed to have the same size as the
 // selected dimension of x otherwise that dimension will be padded/cropped to the value of n
 // before performing the FFT.
+// If only some of the output bins are needed they can be selected with [bin_start, bin_stop),
+// if bin_stop is not specified all the bins from bin_start onwards are returned. The output
+// will have bin_stop - bin_start elements over axis.
+// When x is zero-padded (n > size of the selected dimension) or only a few bins are requested
+// the FFT is pruned: the butterflies that would only combine zeros or that only contribute to
+// the bins that are not needed are skipped.
 extern dsc_tensor *dsc_fft(dsc_ctx *ctx,
                            const dsc_tensor *DSC_RESTRICT x,
                            dsc_tensor *DSC_RESTRICT out = nullptr,
                            int n = -1,
-                           int axis = -1) noexcept;
+                           int axis = -1,
+                           int bin_start = 0,
+                           int bin_stop = -1) noexcept;
 
 extern dsc_tensor *dsc_ifft(dsc_ctx *ctx,
                             const dsc_tensor *DSC_RESTRICT x,
                             dsc_tensor *DSC_RESTRICT out = nullptr,
                             int n = -1,
-                            int axis = -1) noexcept;
+                            int axis = -1,
+                            int bin_start = 0,
+                            int bin_stop = -1) noexcept;
 
+// For RFFT the bins are in [0, (n / 2) + 1)
 extern dsc_tensor *dsc_rfft(dsc_ctx *ctx,
                             const dsc_tensor *DSC_RESTRICT x,
                             dsc_tensor *DSC_RESTRICT out = nullptr,
                             int n = -1,
-                            int axis = -1) noexcept;
+                            int axis = -1,
+                            int bin_start = 0,
+                            int bin_stop = -1) noexcept;
 
 extern dsc_tensor *dsc_irfft(dsc_ctx *ctx,
                              const dsc_tensor *DSC_RESTRICT x,
@@ -413,6 +540,39 @@ extern dsc_tensor *dsc_irfft(dsc_ctx *ctx,
                              int n = -1,
                              int axis = -1) noexcept;
 
+// N-dimensional FFTs over n_axes axes of x. The axes are listed in axes, if axes is not specified
+// then the last n_axes dimensions are used (all of them if n_axes is not specified).
+// n[i] is the length of the transform over axes[i], like in the 1D case if n is not specified (or n[i] <= 0)
+// the size of the corresponding dimension of x is used.
+// For RFFTN and IRFFTN the real transform is over the last of the axes.
+extern dsc_tensor *dsc_fftn(dsc_ctx *ctx,
+                            const dsc_tensor *DSC_RESTRICT x,
+                            dsc_tensor *DSC_RESTRICT out = nullptr,
+                            int n_axes = -1,
+                            const int *n = nullptr,
+                            const int *axes = nullptr) noexcept;
+
+extern dsc_tensor *dsc_ifftn(dsc_ctx *ctx,
+                             const dsc_tensor *DSC_RESTRICT x,
+                             dsc_tensor *DSC_RESTRICT out = nullptr,
+                             int n_axes = -1,
+                             const int *n = nullptr,
+                             const int *axes = nullptr) noexcept;
+
+extern dsc_tensor *dsc_rfftn(dsc_ctx *ctx,
+                             const dsc_tensor *DSC_RESTRICT x,
+                             dsc_tensor *DSC_RESTRICT out = nullptr,
+                             int n_axes = -1,
+                             const int *n = nullptr,
+                             const int *axes = nullptr) noexcept;
+
+extern dsc_tensor *dsc_irfftn(dsc_ctx *ctx,
+                              const dsc_tensor *DSC_RESTRICT x,
+                              dsc_tensor *DSC_RESTRICT out = nullptr,
+                              int n_axes = -1,
+                              const int *n = nullptr,
+                              const int *axes = nullptr) noexcept;
+
 extern dsc_tensor *dsc_fftfreq(dsc_ctx *ctx,
                                int n,
                                f64 d = 1.,
@@ -423,6 +583,250 @@ extern dsc_tensor *dsc_rfftfreq(dsc_ctx *ctx,
                                 f64 d = 1.,
                                 dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
 
+// ============================================================
+// Streaming STFT
+//
+// A dsc_stft holds everything needed to transform a continuous stream: its own FFT plan (that is
+// never evicted from the cache), the window, the samples that are shared with the next frames and
+// a ring where the results are written. All the memory is allocated when the object is created so
+// pushing new data never allocates. Frames are n_fft samples long and start hop samples apart
+// (0 < hop <= n_fft), if window is not specified a periodic Hann window of n_fft samples is used.
+// dtype is the real dtype of the samples (F32 or F64).
+
+// STFT: the input is pushed as 1-dimensional real tensors of any length, each complete frame is
+// multiplied by the window and its RFFT is written to the next row of a [ring_n, (n_fft / 2) + 1]
+// complex tensor. Frame i (counting from the first frame) is in row i % ring_n.
+extern dsc_stft *dsc_stft_init(dsc_ctx *ctx,
+                               int n_fft,
+                               int hop,
+                               int ring_n,
+                               const dsc_tensor *DSC_RESTRICT window = nullptr,
+                               dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+
+// ISTFT: the input is pushed as tensors of one or more frames of (n_fft / 2) + 1 bins, each
+// frame is transformed back, multiplied by the window and added to the frames that overlap it.
+// Once a frame has been pushed its first hop samples are complete, they are normalized by
+// the sum of the squared windows that overlap them and written to a 1-dimensional ring of ring_n
+// real samples: sample i (counting from the first sample) is element i % ring_n.
+extern dsc_stft *dsc_istft_init(dsc_ctx *ctx,
+                                int n_fft,
+                                int hop,
+                                int ring_n,
+                                const dsc_tensor *DSC_RESTRICT window = nullptr,
+                                dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+
+// Returns the number of frames (STFT) or samples (ISTFT) written to the ring. If this is more
+// than the size of the ring the oldest results are overwritten.
+extern int dsc_stft_push(dsc_ctx *ctx,
+                         dsc_stft *stft,
+                         const dsc_tensor *DSC_RESTRICT x) noexcept;
+
+// The ring is owned by stft, it must not be freed
+extern dsc_tensor *dsc_stft_ring(dsc_stft *stft) noexcept;
+
+// Total number of frames (STFT) or samples (ISTFT) written to the ring
+extern u64 dsc_stft_count(const dsc_stft *stft) noexcept;
+
+// Drop the samples of the incomplete frames, the next push will start a new stream
+extern void dsc_stft_reset(dsc_stft *stft) noexcept;
+
+extern void dsc_stft_free(dsc_ctx *ctx, dsc_stft *stft) noexcept;
+
+// ============================================================
+// Convolution
+//
+// Convolution and correlation of the lines of x (its last axis) with a 1-dimensional kernel h.
+// Long kernels are computed with overlap-save FFTs, short ones with a direct SIMD kernel.
+// Like numpy, given x of N samples and h of M samples, the output has:
+// - FULL: N + M - 1 samples, all the points where x and h overlap
+// - SAME: max(N, M) samples centered with respect to FULL
+// - VALID: max(N, M) - min(N, M) + 1 samples, only the points where they overlap completely
+enum dsc_conv_mode : u8 {
+    FULL,
+    SAME,
+    VALID,
+};
+
+extern dsc_tensor *dsc_convolve(dsc_ctx *ctx,
+                                const dsc_tensor *DSC_RESTRICT x,
+                                const dsc_tensor *DSC_RESTRICT h,
+                                dsc_tensor *DSC_RESTRICT out = nullptr,
+                                dsc_conv_mode mode = FULL) noexcept;
+
+// out[k] = sum_n x[n + k] * conj(h[n]), same as numpy.correlate
+extern dsc_tensor *dsc_correlate(dsc_ctx *ctx,
+                                 const dsc_tensor *DSC_RESTRICT x,
+                                 const dsc_tensor *DSC_RESTRICT h,
+                                 dsc_tensor *DSC_RESTRICT out = nullptr,
+                                 dsc_conv_mode mode = VALID) noexcept;
+
+// A dsc_conv_stream filters a continuous stream with h (or correlates it if correlate is true).
+// It keeps the last M - 1 samples of the previous push so the outputs are the same as those of a
+// FULL convolution of the whole stream, truncated to its length. The samples are pushed as
+// 1-dimensional tensors of any length with the same dtype of h, each push returns as many outputs.
+extern dsc_conv_stream *dsc_conv_stream_init(dsc_ctx *ctx,
+                                             const dsc_tensor *DSC_RESTRICT h,
+                                             bool correlate = false) noexcept;
+
+extern dsc_tensor *dsc_conv_stream_push(dsc_ctx *ctx,
+                                        dsc_conv_stream *stream,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+
+// Forget the samples of the previous pushes, the next push will start a new stream
+extern void dsc_conv_stream_reset(dsc_conv_stream *stream) noexcept;
+
+extern void dsc_conv_stream_free(dsc_ctx *ctx, dsc_conv_stream *stream) noexcept;
+
+// ============================================================
+// Sparse DFT
+//
+// Bins of the DFT computed one at a time, cheaper than a full FFT when only a few bins are needed.
+// dsc_goertzel computes the given bins (integers in [0, n)) of the n-points DFT of x over axis with the
+// same conventions of dsc_fft: x is truncated or zero-padded to n samples and the output is complex with
+// n_bins elements along axis. Each bin costs O(n) while an FFT costs O(n log n) for all of them: with
+// N=4096 on AVX512 Goertzel is faster than dsc_rfft up to about 8 bins for F32 and 32 for F64
+// (see benchmarks/python/bench_goertzel.py). The recurrence is always computed in double precision.
+extern dsc_tensor *dsc_goertzel(dsc_ctx *ctx,
+                                const dsc_tensor *DSC_RESTRICT x,
+                                const int *bins,
+                                int n_bins,
+                                dsc_tensor *DSC_RESTRICT out = nullptr,
+                                int n = -1,
+                                int axis = -1) noexcept;
+
+// A dsc_sdft tracks the given bins of the DFT of the last n samples of a stream, updating each bin in O(1)
+// per sample. The samples are pushed as 1-dimensional tensors of L samples with the given dtype, each push
+// returns a complex [L, n_bins] tensor with the bins of the window that ends with each sample.
+// The stream starts with n zeros, every n samples the bins are recomputed from scratch to stop rounding errors
+// from accumulating.
+extern dsc_sdft *dsc_sdft_init(dsc_ctx *ctx,
+                               int n,
+                               const int *bins,
+                               int n_bins,
+                               dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+
+extern dsc_tensor *dsc_sdft_push(dsc_ctx *ctx,
+                                 dsc_sdft *sdft,
+                                 const dsc_tensor *DSC_RESTRICT x,
+                                 dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+
+// Forget the samples of the previous pushes, the next push will start a new stream
+extern void dsc_sdft_reset(dsc_sdft *sdft) noexcept;
+
+extern void dsc_sdft_free(dsc_ctx *ctx, dsc_sdft *sdft) noexcept;
+
+// ============================================================
+// Chirp-Z Transform
+//
+// dsc_czt computes X[k] = sum_j x[j] * a^-j * w^(jk) for k in [0, m) over axis, that is the z-transform of x
+// on the m points a * w^-k of a spiral (of an arc of the unit circle if |a| = |w| = 1). If m <= 0 the output has
+// the same length of the input. With w = e^(-2πi/N) and a = 1 this is the DFT. It's computed with Bluestein's
+// algorithm, the chirps and the spectrum of the filter are cached in the context (DSC_MAX_CZT_PLANS plans)
+// so repeated calls with the same parameters only cost two FFTs per line. The output is complex.
+extern dsc_tensor *dsc_czt(dsc_ctx *ctx,
+                           const dsc_tensor *DSC_RESTRICT x,
+                           int m,
+                           c64 w,
+                           c64 a,
+                           dsc_tensor *DSC_RESTRICT out = nullptr,
+                           int axis = -1) noexcept;
+
+// m bins of the DFT of x evenly spaced in [f0, f1) where fs is the sampling frequency, equivalent to dsc_czt
+// with w = e^(-2πi(f1 - f0)/(m * fs)) and a = e^(2πi * f0/fs). With the default fs=2 frequencies are normalized
+// to the Nyquist frequency.
+extern dsc_tensor *dsc_zoom_fft(dsc_ctx *ctx,
+                                const dsc_tensor *DSC_RESTRICT x,
+                                int m,
+                                f64 f0,
+                                f64 f1,
+                                f64 fs = 2.,
+                                dsc_tensor *DSC_RESTRICT out = nullptr,
+                                int axis = -1) noexcept;
+
+// ============================================================
+// Spectral Density
+//
+// dsc_welch estimates the power spectral density of the real signal x over axis with Welch's method: x is split
+// in segments of nperseg samples that overlap by noverlap samples (nperseg / 2 if negative), each segment is
+// detrended (if detrend is true its mean is removed), multiplied by window (a periodic Hann window if nullptr)
+// and transformed with an RFFT. The output has nperseg / 2 + 1 real bins along axis with the mean of |X|^2
+// over all the segments, one-sided and scaled like scipy.signal.welch: DENSITY is in V^2/Hz where fs is the
+// sampling frequency, SPECTRUM in V^2. The segments are read straight from x and only the final spectrum is
+// written to out, there are no temporaries other than the FFT buffers.
+enum dsc_psd_scaling : u8 {
+    DENSITY,
+    SPECTRUM,
+};
+
+extern dsc_tensor *dsc_welch(dsc_ctx *ctx,
+                             const dsc_tensor *DSC_RESTRICT x,
+                             int nperseg,
+                             int noverlap = -1,
+                             const dsc_tensor *DSC_RESTRICT window = nullptr,
+                             f64 fs = 1.,
+                             dsc_psd_scaling scaling = DENSITY,
+                             bool detrend = true,
+                             dsc_tensor *DSC_RESTRICT out = nullptr,
+                             int axis = -1) noexcept;
+
+// Cross spectral density of x and y (same shape and dtype), same as dsc_welch with conj(X) * Y in place
+// of |X|^2. The output is complex.
+extern dsc_tensor *dsc_csd(dsc_ctx *ctx,
+                           const dsc_tensor *DSC_RESTRICT x,
+                           const dsc_tensor *DSC_RESTRICT y,
+                           int nperseg,
+                           int noverlap = -1,
+                           const dsc_tensor *DSC_RESTRICT window = nullptr,
+                           f64 fs = 1.,
+                           dsc_psd_scaling scaling = DENSITY,
+                           bool detrend = true,
+                           dsc_tensor *DSC_RESTRICT out = nullptr,
+                           int axis = -1) noexcept;
+
+// ============================================================
+// Hilbert Transform
+//
+// dsc_hilbert computes the analytic signal of the real signal x over axis like scipy.signal.hilbert: x is truncated
+// or zero-padded to n samples (if n <= 0 n is the size of axis), transformed with an FFT of order n, the negative
+// frequencies are zeroed and the positive ones doubled in place, then the inverse FFT runs with the same plan on the
+// same buffer. The output is complex, its imaginary part is the Hilbert transform of x.
+// If envelope and phase are not nullptr the instantaneous amplitude |out| and phase angle(out) are written to them
+// in the same pass over the output. They must be real tensors with the same shape of out and the dtype of x.
+extern dsc_tensor *dsc_hilbert(dsc_ctx *ctx,
+                               const dsc_tensor *DSC_RESTRICT x,
+                               dsc_tensor *DSC_RESTRICT out = nullptr,
+                               int n = -1,
+                               int axis = -1,
+                               dsc_tensor *DSC_RESTRICT envelope = nullptr,
+                               dsc_tensor *DSC_RESTRICT phase = nullptr) noexcept;
+
+// ============================================================
+// Channelizer
+//
+// A dsc_channelizer splits a stream in M uniformly spaced channels with a critically sampled polyphase
+// filter bank: channel k is the stream filtered with h * e^(i2πkn/M), shifted to baseband and decimated by M.
+// h is the real prototype lowpass filter (F32 or F64, converted to the precision of dtype) and its L taps are
+// split in M branches of ceil(L / M) taps each. The stream is pushed as 1-dimensional tensors of dtype (real or
+// complex) with a multiple of M samples, each block of M samples goes through the commutator and the branch
+// outputs of all the blocks are transformed with a batched FFT of order M. The output is a complex
+// [M, samples / M] tensor, column m holds the channels at the last sample of block m. The last ceil(L / M) - 1
+// blocks are kept between pushes so the outputs are the same as those of the whole stream, which starts with zeros.
+extern dsc_channelizer *dsc_channelizer_init(dsc_ctx *ctx,
+                                             int channels,
+                                             const dsc_tensor *DSC_RESTRICT h,
+                                             dsc_dtype dtype = C32) noexcept;
+
+extern dsc_tensor *dsc_channelizer_push(dsc_ctx *ctx,
+                                        dsc_channelizer *channelizer,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+
+// Forget the samples of the previous pushes, the next push will start a new stream
+extern void dsc_channelizer_reset(dsc_channelizer *channelizer) noexcept;
+
+extern void dsc_channelizer_free(dsc_ctx *ctx, dsc_channelizer *channelizer) noexcept;
+
 #if defined(__cplusplus)
 }
 #endif
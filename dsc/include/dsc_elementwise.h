@@ -0,0 +1,166 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#pragma once
+
+#include "dsc.h"
+#include "dsc_ops.h"
+#include "dsc_simd.h"
+
+// Number of binary operations with a dedicated set of kernels
+#define DSC_BINARY_KINDS    ((int) 5)
+// Number of unary operations with a dedicated set of kernels
+#define DSC_UNARY_KINDS     ((int) 7)
+// Number of ways the operands of a binary kernel can be read, see dsc_operands
+#define DSC_OPERANDS        ((int) 3)
+
+enum dsc_binary_kind : u8 {
+    BINARY_ADD,
+    BINARY_SUB,
+    BINARY_MUL,
+    BINARY_DIV,
+    BINARY_POW,
+};
+
+// Elementary functions with a vectorized implementation, see dsc_math_kernels.h
+enum dsc_unary_kind : u8 {
+    UNARY_COS,
+    UNARY_SIN,
+    UNARY_SINC,
+    UNARY_LOGN,
+    UNARY_LOG2,
+    UNARY_LOG10,
+    UNARY_EXP,
+};
+
+// How the operands of a binary kernel are read
+enum dsc_operands : u8 {
+    // out[i] = xa[i] <op> xb[i]
+    BOTH_VECTORS,
+    // out[i] = xa[0] <op> xb[i]
+    XA_SCALAR,
+    // out[i] = xa[i] <op> xb[0]
+    XB_SCALAR,
+};
+
+// The arguments are xa, xb, out and the number of elements of out. out can be the same as xa or xb.
+template<typename T>
+using dsc_binary_kernel = void (*)(const T *, const T *, T *, int) noexcept;
+
+// The arguments are x, out and the number of elements of out. out can be the same as x.
+template<typename T>
+using dsc_unary_kernel = void (*)(const T *, T *, int) noexcept;
+
+struct dsc_elementwise_kernels {
+    dsc_simd_isa isa;
+    // Binary operations indexed by dsc_binary_kind and dsc_operands
+    dsc_binary_kernel<f32> binary_f32[DSC_BINARY_KINDS][DSC_OPERANDS];
+    dsc_binary_kernel<f64> binary_f64[DSC_BINARY_KINDS][DSC_OPERANDS];
+    dsc_binary_kernel<c32> binary_c32[DSC_BINARY_KINDS][DSC_OPERANDS];
+    dsc_binary_kernel<c64> binary_c64[DSC_BINARY_KINDS][DSC_OPERANDS];
+    // Unary operations indexed by dsc_unary_kind
+    dsc_unary_kernel<f32> unary_f32[DSC_UNARY_KINDS];
+    dsc_unary_kernel<f64> unary_f64[DSC_UNARY_KINDS];
+    dsc_unary_kernel<c32> unary_c32[DSC_UNARY_KINDS];
+    dsc_unary_kernel<c64> unary_c64[DSC_UNARY_KINDS];
+};
+
+// Return the kernels for the given instruction set or, if the CPU doesn't support it,
+// the kernels for the best instruction set available.
+extern const dsc_elementwise_kernels *dsc_elementwise_get_kernels(dsc_simd_isa isa = AVX512) noexcept;
+
+// ============================================================
+// Internal Private Interface
+
+namespace {
+template<typename Op>
+consteval dsc_binary_kind dsc_binary_kind_of() noexcept {
+    static_assert(dsc_is_type<Op, add_op>() || dsc_is_type<Op, sub_op>() ||
+                  dsc_is_type<Op, mul_op>() || dsc_is_type<Op, div_op>() ||
+                  dsc_is_type<Op, pow_op>(), "dsc_binary_kind_of - Op must be add, sub, mul, div or pow");
+
+    if constexpr (dsc_is_type<Op, add_op>()) {
+        return BINARY_ADD;
+    } else if constexpr (dsc_is_type<Op, sub_op>()) {
+        return BINARY_SUB;
+    } else if constexpr (dsc_is_type<Op, mul_op>()) {
+        return BINARY_MUL;
+    } else if constexpr (dsc_is_type<Op, div_op>()) {
+        return BINARY_DIV;
+    } else {
+        return BINARY_POW;
+    }
+}
+
+template<typename T>
+DSC_INLINE dsc_binary_kernel<T> dsc_get_binary_kernel(const dsc_elementwise_kernels *kernels,
+                                                      const dsc_binary_kind kind,
+                                                      const dsc_operands operands) noexcept {
+    if constexpr (dsc_is_type<T, f32>()) {
+        return kernels->binary_f32[kind][operands];
+    } else if constexpr (dsc_is_type<T, f64>()) {
+        return kernels->binary_f64[kind][operands];
+    } else if constexpr (dsc_is_type<T, c32>()) {
+        return kernels->binary_c32[kind][operands];
+    } else {
+        return kernels->binary_c64[kind][operands];
+    }
+}
+
+template<typename T, typename Op>
+DSC_INLINE dsc_binary_kernel<T> dsc_get_binary_kernel(const dsc_elementwise_kernels *kernels,
+                                                      const dsc_operands operands) noexcept {
+    return dsc_get_binary_kernel<T>(kernels, dsc_binary_kind_of<Op>(), operands);
+}
+
+template<typename Op>
+consteval bool dsc_has_unary_kernel() noexcept {
+    return dsc_is_type<Op, cos_op>() || dsc_is_type<Op, sin_op>() || dsc_is_type<Op, sinc_op>() ||
+           dsc_is_type<Op, logn_op>() || dsc_is_type<Op, log2_op>() || dsc_is_type<Op, log10_op>() ||
+           dsc_is_type<Op, exp_op>();
+}
+
+template<typename Op>
+consteval dsc_unary_kind dsc_unary_kind_of() noexcept {
+    static_assert(dsc_has_unary_kernel<Op>(),
+                  "dsc_unary_kind_of - Op must be cos, sin, sinc, logn, log2, log10 or exp");
+
+    if constexpr (dsc_is_type<Op, cos_op>()) {
+        return UNARY_COS;
+    } else if constexpr (dsc_is_type<Op, sin_op>()) {
+        return UNARY_SIN;
+    } else if constexpr (dsc_is_type<Op, sinc_op>()) {
+        return UNARY_SINC;
+    } else if constexpr (dsc_is_type<Op, logn_op>()) {
+        return UNARY_LOGN;
+    } else if constexpr (dsc_is_type<Op, log2_op>()) {
+        return UNARY_LOG2;
+    } else if constexpr (dsc_is_type<Op, log10_op>()) {
+        return UNARY_LOG10;
+    } else {
+        return UNARY_EXP;
+    }
+}
+
+template<typename T>
+DSC_INLINE dsc_unary_kernel<T> dsc_get_unary_kernel(const dsc_elementwise_kernels *kernels,
+                                                    const dsc_unary_kind kind) noexcept {
+    if constexpr (dsc_is_type<T, f32>()) {
+        return kernels->unary_f32[kind];
+    } else if constexpr (dsc_is_type<T, f64>()) {
+        return kernels->unary_f64[kind];
+    } else if constexpr (dsc_is_type<T, c32>()) {
+        return kernels->unary_c32[kind];
+    } else {
+        return kernels->unary_c64[kind];
+    }
+}
+
+template<typename T, typename Op>
+DSC_INLINE dsc_unary_kernel<T> dsc_get_unary_kernel(const dsc_elementwise_kernels *kernels) noexcept {
+    return dsc_get_unary_kernel<T>(kernels, dsc_unary_kind_of<Op>());
+}
+}
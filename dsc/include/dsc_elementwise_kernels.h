@@ -0,0 +1,244 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+// Elementwise kernels written in terms of a generic set of real vector operations (ops<f32> and ops<f64>).
+// Like dsc_fft_kernels.h this file is meant to be included multiple times by dsc_elementwise.cpp, once for each
+// instruction set, inside a namespace that defines ops and DSC_ELEMENTWISE_KERNELS_ISA, so there is no include guard.
+// Complex values are processed as interleaved pairs of reals so ops<R>::width is the number of reals in a vector,
+// a width of 1 means there are no vector operations and the kernels are plain loops.
+
+#include "dsc_math_kernels.h"
+
+template<typename T, typename Op>
+static consteval bool has_vector_op() noexcept {
+    // There is no vector pow, it would need a vectorized exp and log
+    return ops<real<T>>::width > 1 && !dsc_is_type<Op, pow_op>();
+}
+
+template<typename T>
+DSC_INLINE typename ops<real<T>>::vec broadcast(const T x) noexcept {
+    if constexpr (dsc_is_complex<T>()) {
+        return ops<real<T>>::set2(x.real, x.imag);
+    } else {
+        return ops<real<T>>::set1(x);
+    }
+}
+
+template<typename T, typename Op, typename V>
+DSC_INLINE V vector_op(const V a, const V b) noexcept {
+    using O = ops<real<T>>;
+
+    if constexpr (dsc_is_type<Op, add_op>()) {
+        return O::add(a, b);
+    } else if constexpr (dsc_is_type<Op, sub_op>()) {
+        return O::sub(a, b);
+    } else if constexpr (dsc_is_type<Op, mul_op>()) {
+        if constexpr (dsc_is_complex<T>()) {
+            // (ar * br - ai * bi, ai * br + ar * bi)
+            return O::add(O::mul(a, O::dup_real(b)), O::neg_real(O::mul(O::swap(a), O::dup_imag(b))));
+        } else {
+            return O::mul(a, b);
+        }
+    } else {
+        static_assert(dsc_is_type<Op, div_op>(), "vector_op - Op must be add, sub, mul or div");
+
+        if constexpr (dsc_is_complex<T>()) {
+            // a * conj(b) / |b|^2 = (ar * br + ai * bi, ai * br - ar * bi) / (br^2 + bi^2)
+            const V num = O::add(O::mul(a, O::dup_real(b)), O::neg_imag(O::mul(O::swap(a), O::dup_imag(b))));
+            const V b2 = O::mul(b, b);
+            return O::div(num, O::add(b2, O::swap(b2)));
+        } else {
+            return O::div(a, b);
+        }
+    }
+}
+
+template<typename T, typename Op, dsc_operands operands>
+void binary(const T *xa, const T *xb, T *out, const int n) noexcept {
+    int i = 0;
+
+    if constexpr (has_vector_op<T, Op>()) {
+        using O = ops<real<T>>;
+        using vec = typename O::vec;
+        // Number of reals in each element and number of elements in each vector
+        constexpr int lanes = dsc_is_complex<T>() ? 2 : 1;
+        constexpr int width = O::width / lanes;
+
+        const real<T> *a = (const real<T> *) xa;
+        const real<T> *b = (const real<T> *) xb;
+        real<T> *o = (real<T> *) out;
+
+        if (n >= width) {
+            const vec sa = broadcast(xa[0]), sb = broadcast(xb[0]);
+            for (; i + width <= n; i += width) {
+                const vec va = operands == XA_SCALAR ? sa : O::load(&a[i * lanes]);
+                const vec vb = operands == XB_SCALAR ? sb : O::load(&b[i * lanes]);
+                O::store(&o[i * lanes], vector_op<T, Op>(va, vb));
+            }
+        }
+    }
+
+    Op op;
+    for (; i < n; ++i) {
+        out[i] = op(xa[operands == XA_SCALAR ? 0 : i], xb[operands == XB_SCALAR ? 0 : i]);
+    }
+}
+
+template<typename T, typename Op>
+static consteval bool has_vector_math() noexcept {
+    // The complex logarithms need atan2, they are always computed with libm
+    constexpr bool is_log = dsc_is_type<Op, logn_op>() || dsc_is_type<Op, log2_op>() || dsc_is_type<Op, log10_op>();
+    return ops<real<T>>::width > 1 && !(dsc_is_complex<T>() && is_log);
+}
+
+// Complex values are processed as interleaved pairs with the same value in both lanes of a pair
+// (eg. dup_real(x)), this wastes half of the work but keeps the layout of the input.
+// in_range is set to false if Op can't be computed for some of the elements of x.
+template<typename T, typename Op, typename V>
+DSC_INLINE V vector_math(const V x, bool &in_range) noexcept {
+    using R = real<T>;
+    using O = ops<R>;
+
+    if constexpr (dsc_is_real<T>()) {
+        if constexpr (dsc_is_type<Op, exp_op>()) {
+            return vexp<R>(x);
+        } else if constexpr (dsc_is_type<Op, logn_op>()) {
+            return vlogn<R>(x);
+        } else if constexpr (dsc_is_type<Op, log2_op>()) {
+            return vlog2<R>(x);
+        } else if constexpr (dsc_is_type<Op, log10_op>()) {
+            return vlog10<R>(x);
+        } else {
+            const V arg = dsc_is_type<Op, sinc_op>() ? O::mul(x, O::set1(dsc_pi<R>())) : x;
+            in_range = !sincos_out_of_range<R>(arg);
+
+            V s, c;
+            vsincos<R>(arg, s, c);
+            if constexpr (dsc_is_type<Op, cos_op>()) {
+                return c;
+            } else if constexpr (dsc_is_type<Op, sin_op>()) {
+                return s;
+            } else {
+                static_assert(dsc_is_type<Op, sinc_op>(), "vector_math - Op must be cos, sin, sinc, exp or log");
+                return O::select(O::eq(x, O::set1(0)), O::set1(1), O::div(s, arg));
+            }
+        }
+    } else {
+        if constexpr (dsc_is_type<Op, exp_op>()) {
+            // (exp(re) * cos(im), exp(re) * sin(im))
+            const V im = O::dup_imag(x);
+            in_range = !sincos_out_of_range<R>(im);
+
+            V s, c;
+            vsincos<R>(im, s, c);
+            return O::mul(vexp<R>(O::dup_real(x)), O::select(O::real_lanes(), c, s));
+        } else {
+            const V arg = dsc_is_type<Op, sinc_op>() ? O::mul(x, O::set1(dsc_pi<R>())) : x;
+            const V re = O::dup_real(arg);
+            in_range = !sincos_out_of_range<R>(re);
+
+            V s, c, sh, ch;
+            vsincos<R>(re, s, c);
+            vsinhcosh<R>(O::dup_imag(arg), sh, ch);
+            if constexpr (dsc_is_type<Op, cos_op>()) {
+                // (cos(re) * cosh(im), -sin(re) * sinh(im))
+                return O::select(O::real_lanes(), O::mul(c, ch), O::neg_imag(O::mul(s, sh)));
+            } else {
+                // (sin(re) * cosh(im), cos(re) * sinh(im))
+                const V y = O::select(O::real_lanes(), O::mul(s, ch), O::mul(c, sh));
+                if constexpr (dsc_is_type<Op, sin_op>()) {
+                    return y;
+                } else {
+                    static_assert(dsc_is_type<Op, sinc_op>(), "vector_math - Op must be cos, sin, sinc or exp");
+                    // Both lanes of a pair are 0 only if |re| + |im| is 0
+                    const V abs_x = vabs<R>(x);
+                    return O::select(O::eq(O::add(abs_x, O::swap(abs_x)), O::set1(0)), broadcast(dsc_complex(T, 1, 0)),
+                                     vector_op<T, div_op>(y, arg));
+                }
+            }
+        }
+    }
+}
+
+template<typename T, typename Op>
+void unary(const T *x, T *out, const int n) noexcept {
+    Op op;
+    int i = 0;
+
+    if constexpr (has_vector_math<T, Op>()) {
+        using O = ops<real<T>>;
+        using vec = typename O::vec;
+        constexpr int lanes = dsc_is_complex<T>() ? 2 : 1;
+        constexpr int width = O::width / lanes;
+
+        const real<T> *xr = (const real<T> *) x;
+        real<T> *o = (real<T> *) out;
+
+        for (; i + width <= n; i += width) {
+            bool in_range = true;
+            const vec y = vector_math<T, Op>(O::load(&xr[i * lanes]), in_range);
+            if (in_range) {
+                O::store(&o[i * lanes], y);
+            } else {
+                for (int j = i; j < i + width; ++j) out[j] = op(x[j]);
+            }
+        }
+
+        if (i < n) {
+            // Pad the tail to a full vector so that the result of an element doesn't depend on its position
+            T buf[width]{};
+            for (int j = i; j < n; ++j) buf[j - i] = x[j];
+
+            bool in_range = true;
+            O::store((real<T> *) buf, vector_math<T, Op>(O::load((const real<T> *) buf), in_range));
+            if (in_range) {
+                for (int j = i; j < n; ++j) out[j] = buf[j - i];
+                i = n;
+            }
+        }
+    }
+
+    for (; i < n; ++i) {
+        out[i] = op(x[i]);
+    }
+}
+
+#define DSC_UNARY_KERNELS_ALL(T)    \
+    {                               \
+        unary<T, cos_op>,           \
+        unary<T, sin_op>,           \
+        unary<T, sinc_op>,          \
+        unary<T, logn_op>,          \
+        unary<T, log2_op>,          \
+        unary<T, log10_op>,         \
+        unary<T, exp_op>,           \
+    }
+
+#define DSC_BINARY_KERNELS(T, Op) {binary<T, Op, BOTH_VECTORS>, binary<T, Op, XA_SCALAR>, binary<T, Op, XB_SCALAR>}
+#define DSC_BINARY_KERNELS_ALL(T)       \
+    {                                   \
+        DSC_BINARY_KERNELS(T, add_op),  \
+        DSC_BINARY_KERNELS(T, sub_op),  \
+        DSC_BINARY_KERNELS(T, mul_op),  \
+        DSC_BINARY_KERNELS(T, div_op),  \
+        DSC_BINARY_KERNELS(T, pow_op),  \
+    }
+
+const dsc_elementwise_kernels kernels = {
+        DSC_ELEMENTWISE_KERNELS_ISA,
+        DSC_BINARY_KERNELS_ALL(f32),
+        DSC_BINARY_KERNELS_ALL(f64),
+        DSC_BINARY_KERNELS_ALL(c32),
+        DSC_BINARY_KERNELS_ALL(c64),
+        DSC_UNARY_KERNELS_ALL(f32),
+        DSC_UNARY_KERNELS_ALL(f64),
+        DSC_UNARY_KERNELS_ALL(c32),
+        DSC_UNARY_KERNELS_ALL(c64),
+};
+
+#undef DSC_UNARY_KERNELS_ALL
+#undef DSC_BINARY_KERNELS_ALL
+#undef DSC_BINARY_KERNELS
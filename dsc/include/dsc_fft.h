@@ -8,50 +8,523 @@
 
 #include "dsc.h"
 #include "dsc_ops.h"
+#include "dsc_simd.h"
 #include <cmath>
+#include <cstring>
+
+// Max number of passes of a Stockham FFT (radix-2 passes for N=2^31 in the worst case)
+#define DSC_FFT_MAX_FACTORS ((int) 32)
+// Prime factors bigger than this are not handled directly by a Stockham pass, Bluestein is used instead
+#define DSC_FFT_MAX_RADIX   ((int) 64)
+// Max number of lines transformed at once by the batched kernels
+#define DSC_FFT_MAX_BATCH   ((int) 16)
+// Max size of the buffer that holds a batch of lines, bigger batches fall out of the cache
+#define DSC_FFT_BATCH_BYTES DSC_KB(256)
+// If the lines are contiguous in memory, above this size the batched kernels are slower than transforming
+// one line at a time (the batched kernels work best when N is too small to vectorize a single line)
+#define DSC_FFT_BATCH_MAX_N ((int) 128)
+// Min number of elements each thread should transform, below this waking up more threads costs more than it saves
+#define DSC_FFT_MIN_WORK_PER_THREAD ((int) 32768)
+// Above this size a single Stockham FFT doesn't fit in the cache anymore and the four-step algorithm is used instead.
+// The four-step FFT only works on buffers that fit in L2 so its speed doesn't depend on N, the best threshold
+// depends on the size of the last-level cache: a good starting point is N such that N complex values are 2-4x the LLC.
+#if !defined(DSC_FFT_FOUR_STEP_MIN_N)
+#   define DSC_FFT_FOUR_STEP_MIN_N  ((int) 1 << 25)
+#endif
+// Number of columns (rows) copied at once by each step of the four-step algorithm, they are then
+// transformed DSC_FFT_MAX_BATCH at a time
+#define DSC_FFT_FOUR_STEP_BATCH     ((int) 32)
+// Min number of sub-transforms of a pruned FFT for them to be computed with the batched kernels,
+// with fewer lines most of the SIMD lanes of the batched kernels would be wasted
+#define DSC_FFT_PRUNED_MIN_BATCH    ((int) 8)
+// Estimated overhead of each call to a single line kernel, in the same units as dsc_fft_cost
+#define DSC_FFT_CALL_COST           ((f64) 1000)
+// Estimated cost of computing one of the twiddles of a pruned FFT, these are not cached
+// because they depend on how the FFT is split
+#define DSC_FFT_TWIDDLE_COST        ((f64) 100)
 
 enum dsc_fft_type : u8 {
     REAL,
     COMPLEX
 };
 
+enum dsc_fft_algorithm : u8 {
+    // Recursive radix-2 decimation in time, kept mostly as a reference
+    RECURSIVE_RADIX2,
+    // Iterative, self-sorting FFT made of radix-8, 4, 2, 3, 5, 7 and generic odd-radix passes
+    STOCKHAM,
+    // Chirp-z transform computed as a convolution using a Stockham FFT of size M >= 2N - 1,
+    // used when N has large prime factors.
+    BLUESTEIN,
+    // Bailey's four-step FFT: N = N1 * N2 is computed as N2 FFTs of order N1, a twiddle multiplication
+    // and N1 FFTs of order N2, used when N is too big to fit in the cache.
+    FOUR_STEP,
+};
+
+static constexpr const char *DSC_FFT_ALGORITHM_NAMES[4] = {
+        "recursive",
+        "stockham",
+        "bluestein",
+        "four-step"
+};
+
+enum dsc_fft_pruning_type : u8 {
+    // Full FFT, if only some of the bins are needed they are copied out of the result
+    NO_PRUNING,
+    // Only the first L inputs are non-zero (e.g. zero-padding): N = P * M with M >= L is computed
+    // as P FFTs of order M of the first L inputs multiplied by W_N^(i * p) (decimation in frequency)
+    INPUT_PRUNING,
+    // Only K bins are needed: N = P * M is computed as P FFTs of order M of the decimated inputs
+    // x[i * P + p], each bin is then the combination of P values (decimation in time)
+    OUTPUT_PRUNING,
+};
+
+// How a pruned FFT is split into P FFTs of order M, see dsc_fft_choose_pruning.
+// Short sub-transforms are interleaved and computed together with the batched kernels,
+// long ones are stored one after the other and computed one at a time.
+struct dsc_fft_pruning {
+    dsc_fft_pruning_type type;
+    int m, p;
+    bool batched;
+};
+
+enum dsc_twiddle_kind : u8 {
+    // Twiddles of a Stockham pass, identified by its radix and by the order of its sub-transforms
+    PASS_TWIDDLES,
+    // Twiddles used to go from the N/2 complex FFT to the N points real FFT, identified by N/2
+    RFFT_TWIDDLES,
+    // Bluestein chirp followed by the FFT of its conjugate, identified by N
+    CHIRP_TWIDDLES,
+    // Twiddles applied between the two steps of a four-step FFT, identified by (N1, N2)
+    FOUR_STEP_TWIDDLES,
+};
+
+// Storage for the twiddles of a plan. If get is nullptr the twiddles are private to the plan and
+// are placed one after the other in storage, otherwise get returns a buffer of the given size for
+// the set of twiddles identified by (kind, dtype, a, b) and sets fill to false if the buffer
+// already contains them (e.g. because they are shared with another plan).
+struct dsc_twiddle_source {
+    void *(*get)(dsc_twiddle_source *src, dsc_twiddle_kind kind, dsc_dtype dtype,
+                 int a, int b, usize bytes, bool *fill) noexcept;
+    // Storage for the parts of the plan that are never shared, like the Bluestein sub-plan
+    byte *storage;
+};
+
+struct dsc_fft_kernels;
+
 struct dsc_fft_plan {
+    // Recursive radix-2: all the twiddles. Bluestein: the chirp followed by the FFT of its conjugate.
+    // Four-step: W_N1^q for q in [0, N1), W_N^r for r in [0, N2) and W_N^(k1 * b) for k1 in [0, N1)
+    // and b in [0, DSC_FFT_FOUR_STEP_BATCH).
     void *twiddles;
+    // Extra set of twiddles used to go from the N/2 complex FFT to the N points real FFT
+    void *rfft_twiddles;
+    // Stockham only: the twiddles of each pass
+    const void *pass_twiddles[DSC_FFT_MAX_FACTORS];
+    // Links used by the plan cache: the next plan in the same hash bucket and the previous
+    // and next plan in the LRU list (most recently used first)
+    dsc_fft_plan *hash_next, *lru_prev, *lru_next;
     int n;
-    // Set to 0 when the plan is used, increment by one each time we go through the plans
-    int last_used;
+    // Bluestein: the plan of the FFT used to compute the convolution. Four-step: the plan of the
+    // column FFTs of order N1 and the plan of the row FFTs of order N2.
+    // The sub-plans are always part of the same allocation as the plan.
+    dsc_fft_plan *sub_plan, *row_plan;
+    // SIMD kernels used to execute the plan, selected at init time based on the CPU
+    const dsc_fft_kernels *kernels;
+    // Radix of each Stockham pass, in the order they are executed
+    int factors[DSC_FFT_MAX_FACTORS];
+    int n_factors;
     dsc_dtype dtype;
     // An RFFT plan is equal to an FFT plan with N = N/2 but with an extra set
-    // of twiddles (hence the storage requirement is the same of an order N FFT).
+    // of twiddles used to combine the result of the N/2 FFT.
     dsc_fft_type fft_type;
+    dsc_fft_algorithm algorithm;
+    // The algorithm, the kernels and the order of the passes were chosen by timing them, see DSC_PLAN_MEASURE
+    bool measured;
+};
+
+// Choices made by the measuring planner on top of the algorithm: the instruction set of the kernels
+// and the radix of each Stockham pass. If n_factors is 0 the passes are the ones of dsc_fft_factorize.
+// The sub-plans of Bluestein and four-step FFTs always use the default passes.
+struct dsc_fft_tuning {
+    dsc_simd_isa isa;
+    int n_factors;
+    int factors[DSC_FFT_MAX_FACTORS];
+};
+
+struct dsc_fft_kernels {
+    dsc_simd_isa isa;
+    // Number of complex values processed at once by the c32 and c64 kernels
+    int width_c32, width_c64;
+    // For all the kernels index 0 is the backward transform and index 1 is the forward transform.
+    // Complete Stockham FFT of order plan->n, work must have space for at least plan->n elements.
+    void (*stockham_c32[2])(const dsc_fft_plan *, c32 *, c32 *) noexcept;
+    void (*stockham_c64[2])(const dsc_fft_plan *, c64 *, c64 *) noexcept;
+    // Post-processing (forward) and pre-processing (backward) step of a real FFT that combines
+    // the FFT of order plan->n into the RFFT of order 2 * plan->n.
+    void (*rfft_c32[2])(const dsc_fft_plan *, c32 *) noexcept;
+    void (*rfft_c64[2])(const dsc_fft_plan *, c64 *) noexcept;
+    // Batched versions of the kernels above: x contains batch FFTs interleaved as x[plan->n][batch]
+    // and work must have space for at least plan->n * batch elements.
+    void (*stockham_batch_c32[2])(const dsc_fft_plan *, c32 *, c32 *, int) noexcept;
+    void (*stockham_batch_c64[2])(const dsc_fft_plan *, c64 *, c64 *, int) noexcept;
+    void (*rfft_batch_c32[2])(const dsc_fft_plan *, c32 *, int) noexcept;
+    void (*rfft_batch_c64[2])(const dsc_fft_plan *, c64 *, int) noexcept;
+    // Two-for-one real FFTs of odd order plan->n: split the complex FFT of two real lines packed as
+    // x + iy into their spectra (forward) or merge them back (backward). z holds batch interleaved lines
+    // as z[plan->n + 1][batch], X[k] is stored at k and Y[k] at plan->n - k.
+    void (*rfft_pair_c32[2])(const dsc_fft_plan *, c32 *, int) noexcept;
+    void (*rfft_pair_c64[2])(const dsc_fft_plan *, c64 *, int) noexcept;
+    // Direct convolution y[k] = sum_j h[j] * x[k + m - 1 - j] for k in [0, y_n), it shares the vector
+    // operations of the FFT kernels. The arguments are x (y_n + m - 1 elements), h, y, y_n and m.
+    void (*conv_f32)(const f32 *, const f32 *, f32 *, int, int) noexcept;
+    void (*conv_f64)(const f64 *, const f64 *, f64 *, int, int) noexcept;
+    void (*conv_c32)(const c32 *, const c32 *, c32 *, int, int) noexcept;
+    void (*conv_c64)(const c64 *, const c64 *, c64 *, int, int) noexcept;
+    // Goertzel recurrence of several bins over a block of samples in the form of Reinsch. The arguments are x, the number
+    // of samples of each segment, the distance between segments, the number of segments, lambda and sigma (for complex
+    // signals both parts hold the value of the bin), s, d and the number of bins. s and d hold the state of each
+    // segment and bin and are updated in-place, the recurrence is always computed in double precision.
+    void (*goertzel_f32)(const f32 *, int, int, int, const f64 *, const f64 *, f64 *, f64 *, int) noexcept;
+    void (*goertzel_f64)(const f64 *, int, int, int, const f64 *, const f64 *, f64 *, f64 *, int) noexcept;
+    void (*goertzel_c32)(const c32 *, int, int, int, const c64 *, const c64 *, c64 *, c64 *, int) noexcept;
+    void (*goertzel_c64)(const c64 *, int, int, int, const c64 *, const c64 *, c64 *, c64 *, int) noexcept;
+    // Sliding DFT update X[k] = (X[k] + d[j]) * w[k] of several bins for each sample of a block, the result
+    // after each sample is written to a row of y. The arguments are d, the number of samples, w, X, y and the number of bins.
+    void (*sdft_c32)(const c32 *, int, const c32 *, c32 *, c32 *, int) noexcept;
+    void (*sdft_c64)(const c64 *, int, const c64 *, c64 *, c64 *, int) noexcept;
 };
 
+// Return the kernels for the given instruction set or, if the CPU doesn't support it,
+// the kernels for the best instruction set available.
+extern const dsc_fft_kernels *dsc_fft_get_kernels(dsc_simd_isa isa = AVX512) noexcept;
+
 // ============================================================
 // Internal Private Interface
 
 namespace {
+DSC_INLINE int dsc_fft_factorize(int n, int *factors) noexcept {
+    // Use as many radix-8 passes as possible for the power-of-2 part of N then, if needed,
+    // a single radix-4 or radix-2 pass. The odd prime factors follow in increasing order.
+    int n_factors = 0;
+    while ((n & 7) == 0) {
+        factors[n_factors++] = 8;
+        n >>= 3;
+    }
+    if ((n & 3) == 0) {
+        factors[n_factors++] = 4;
+        n >>= 2;
+    } else if ((n & 1) == 0) {
+        factors[n_factors++] = 2;
+        n >>= 1;
+    }
+    for (int p = 3; p * p <= n; p += 2) {
+        while ((n % p) == 0) {
+            factors[n_factors++] = p;
+            n /= p;
+        }
+    }
+    if (n > 1) factors[n_factors++] = n;
+
+    return n_factors;
+}
+
+DSC_INLINE DSC_STRICTLY_PURE f64 dsc_fft_cost(const int n) noexcept {
+    // Rough estimate of the cost of a Stockham FFT of order N, larger radices are penalized
+    // because they don't have a specialized butterfly.
+    int factors[DSC_FFT_MAX_FACTORS];
+    const int n_factors = dsc_fft_factorize(n, factors);
+    f64 cost = 0;
+    for (int i = 0; i < n_factors; ++i) {
+        const int ip = factors[i];
+        if ((ip & 1) == 0) cost += 2 * std::log2((f64) ip);
+        else if (ip <= 5) cost += ip;
+        else cost += 1.1 * ip;
+    }
+    return cost * n;
+}
+
+DSC_INLINE DSC_STRICTLY_PURE int dsc_fft_smooth_n(const int n) noexcept {
+    // Smallest M >= N that can be factorized using only radix 2, 3, 5 and 7
+    for (int m = n;; ++m) {
+        static constexpr int radices[] = {2, 3, 5, 7};
+        int rem = m;
+        for (const int p : radices) {
+            while ((rem % p) == 0) rem /= p;
+        }
+        if (rem == 1) return m;
+    }
+}
+
+DSC_INLINE DSC_STRICTLY_PURE int dsc_fft_bluestein_n(const int n) noexcept {
+    return dsc_fft_smooth_n((n << 1) - 1);
+}
+
+DSC_INLINE DSC_STRICTLY_PURE int dsc_fft_four_step_n1(const int n) noexcept {
+    // Order of the column FFTs of a four-step FFT: the largest divisor of N not bigger than sqrt(N)
+    int n1 = (int) std::sqrt((f64) n);
+    while ((n % n1) != 0) n1--;
+    return n1;
+}
+
+DSC_INLINE DSC_STRICTLY_PURE bool dsc_fft_four_step_balanced(const int n) noexcept {
+    // The four-step FFT is worth it only if N can be split in two FFTs of similar size
+    const int n1 = dsc_fft_four_step_n1(n);
+    return n1 > 1 && n1 >= (n / n1) / 16;
+}
+
+DSC_INLINE DSC_STRICTLY_PURE int dsc_fft_pass_twiddles(const int ip, const int ido) noexcept {
+    // Twiddles of a single Stockham pass, odd-radix passes also need the ip-th roots of unity
+    return (ip - 1) * ido + ((ip & 1) ? ip : 0);
+}
+
+DSC_INLINE usize dsc_fft_twiddles(const int n, const dsc_fft_type fft_type,
+                                  const dsc_fft_algorithm algorithm) noexcept {
+    // Number of complex twiddle factors required by the plan
+    usize twiddles = 0;
+    if (algorithm == RECURSIVE_RADIX2) {
+        const int sets = fft_type == REAL ? (n << 1) : n;
+        for (int twiddle_n = 2; twiddle_n <= sets; twiddle_n <<= 1) {
+            // Given N we need N/2 twiddle factors
+            twiddles += twiddle_n >> 1;
+        }
+        return twiddles;
+    }
+
+    if (algorithm == STOCKHAM) {
+        int factors[DSC_FFT_MAX_FACTORS];
+        const int n_factors = dsc_fft_factorize(n, factors);
+        int l1 = 1;
+        for (int i = 0; i < n_factors; ++i) {
+            const int ip = factors[i];
+            const int ido = n / (l1 * ip);
+            twiddles += dsc_fft_pass_twiddles(ip, ido);
+            l1 *= ip;
+        }
+    } else if (algorithm == BLUESTEIN) {
+        // The chirp and the FFT of its conjugate zero-padded to M
+        twiddles += n + dsc_fft_bluestein_n(n);
+    } else {
+        const int n1 = dsc_fft_four_step_n1(n);
+        twiddles += (usize) n1 * (DSC_FFT_FOUR_STEP_BATCH + 1) + n / n1;
+    }
+    if (fft_type == REAL) twiddles += (n + 1) >> 1;
+
+    return twiddles;
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_stockham(const dsc_fft_plan *plan,
+                                 T *DSC_RESTRICT x,
+                                 T *DSC_RESTRICT work) noexcept {
+    if constexpr (dsc_is_type<T, c32>()) {
+        plan->kernels->stockham_c32[forward](plan, x, work);
+    } else {
+        plan->kernels->stockham_c64[forward](plan, x, work);
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_stockham_batch(const dsc_fft_plan *plan,
+                                       T *DSC_RESTRICT x,
+                                       T *DSC_RESTRICT work,
+                                       const int batch) noexcept {
+    if constexpr (dsc_is_type<T, c32>()) {
+        plan->kernels->stockham_batch_c32[forward](plan, x, work, batch);
+    } else {
+        plan->kernels->stockham_batch_c64[forward](plan, x, work, batch);
+    }
+}
+
+template<typename T>
+DSC_INLINE T *dsc_twiddles_get(dsc_twiddle_source *src, const dsc_twiddle_kind kind,
+                               const dsc_dtype dtype, const int a, const int b,
+                               const usize n_twiddles, bool *fill) noexcept {
+    // Each twiddle factor has a real and an imaginary part
+    const usize bytes = n_twiddles * 2 * sizeof(T);
+    if (src->get != nullptr) return (T *) src->get(src, kind, dtype, a, b, bytes, fill);
+
+    T *twiddles = (T *) src->storage;
+    src->storage += bytes;
+    *fill = true;
+    return twiddles;
+}
+
 template<typename T>
 void dsc_init_plan(dsc_fft_plan *plan, const int n,
-                   const dsc_dtype dtype, const dsc_fft_type fft_type) {
+                   const dsc_dtype dtype, const dsc_fft_type fft_type,
+                   const dsc_fft_algorithm algorithm, void *work,
+                   dsc_twiddle_source *src, const dsc_fft_tuning *tuning) {
     static_assert(dsc_is_real<T>(), "Twiddles dtype must be real");
 
-    T *twiddles = (T *) plan->twiddles;
+    plan->twiddles = nullptr;
+    plan->n_factors = 0;
+    plan->rfft_twiddles = nullptr;
+    plan->sub_plan = nullptr;
+    plan->row_plan = nullptr;
+    plan->kernels = tuning != nullptr ? dsc_fft_get_kernels(tuning->isa) : dsc_fft_get_kernels();
+    plan->measured = false;
+
+    const dsc_fft_tuning sub_tuning{plan->kernels->isa, 0, {}};
+
+    bool fill;
+    if (algorithm == RECURSIVE_RADIX2) {
+        // The recursive algorithm uses the twiddles of every stage in a single block
+        DSC_ASSERT(src->get == nullptr);
+        T *twiddles = (T *) src->storage;
+        plan->twiddles = twiddles;
+
+        const int sets = fft_type == REAL ? (n << 1) : n;
+
+        for (int twiddle_n = 2; twiddle_n <= sets; twiddle_n <<= 1) {
+            const int twiddle_n2 = twiddle_n >> 1;
+            for (int k = 0; k < twiddle_n2; ++k) {
+                const T theta = ((T) (-2.) * dsc_pi<T>() * k) / (T) (twiddle_n);
+                twiddles[(2 * (twiddle_n2 - 1)) + (2 * k)] = cos_op()(theta);
+                twiddles[(2 * (twiddle_n2 - 1)) + (2 * k) + 1] = sin_op()(theta);
+            }
+        }
+
+        if (fft_type == REAL) plan->rfft_twiddles = &twiddles[(n - 1) << 1];
+    } else if (algorithm == STOCKHAM) {
+        if (tuning != nullptr && tuning->n_factors > 0) {
+            plan->n_factors = tuning->n_factors;
+            memcpy(plan->factors, tuning->factors, tuning->n_factors * sizeof(*tuning->factors));
+        } else {
+            plan->n_factors = dsc_fft_factorize(n, plan->factors);
+        }
+
+        // Each pass has its own set of (ip - 1) * ido twiddles: W(i, j) = exp(-2*pi*i*j / (ip * ido))
+        // stored as [j][i] with j in [1, ip) and i in [0, ido) so that the SIMD kernels can load
+        // them together with the data. Odd-radix passes are followed by the ip-th roots of unity
+        // used by the butterfly. The twiddles of a pass only depend on (ip, ido) so the same set
+        // can be used by plans of different orders.
+        // Note: the twiddles are always computed in double precision to minimize the error.
+        int l1 = 1;
+        for (int f = 0; f < plan->n_factors; ++f) {
+            const int ip = plan->factors[f];
+            const int ido = n / (l1 * ip);
+            T *twiddles = dsc_twiddles_get<T>(src, PASS_TWIDDLES, dtype, ip, ido,
+                                              dsc_fft_pass_twiddles(ip, ido), &fill);
+            plan->pass_twiddles[f] = twiddles;
+            l1 *= ip;
+            if (!fill) continue;
+
+            for (int j = 1; j < ip; ++j) {
+                for (int i = 0; i < ido; ++i) {
+                    const f64 theta = (-2. * dsc_pi<f64>() * (i * j)) / (f64) (ip * ido);
+                    twiddles[0] = (T) cos_op()(theta);
+                    twiddles[1] = (T) sin_op()(theta);
+                    twiddles += 2;
+                }
+            }
+            if (ip & 1) {
+                for (int j = 0; j < ip; ++j) {
+                    const f64 theta = (-2. * dsc_pi<f64>() * j) / (f64) ip;
+                    twiddles[0] = (T) cos_op()(theta);
+                    twiddles[1] = (T) sin_op()(theta);
+                    twiddles += 2;
+                }
+            }
+        }
+    } else if (algorithm == FOUR_STEP) {
+        // The twiddles W_N^(k1 * n2) with k1 in [0, N1) and n2 in [0, N2) would take as much space
+        // as the input. The columns are processed in blocks of DSC_FFT_FOUR_STEP_BATCH so, for the
+        // column c + b, they are computed as W_N^(k1 * c) * W_N^(k1 * b) with W_N^(k1 * c) = W_N1^q * W_N^r
+        // and k1 * c = q * N2 + r.
+        constexpr int batch = DSC_FFT_FOUR_STEP_BATCH;
+        const int n1 = dsc_fft_four_step_n1(n), n2 = n / n1;
+        T *twiddles = dsc_twiddles_get<T>(src, FOUR_STEP_TWIDDLES, dtype, n1, n2,
+                                          (usize) n1 * (batch + 1) + n2, &fill);
+        plan->twiddles = twiddles;
+
+        if (fill) {
+            for (int q = 0; q < n1; ++q) {
+                const f64 theta = (-2. * dsc_pi<f64>() * q) / (f64) n1;
+                twiddles[0] = (T) cos_op()(theta);
+                twiddles[1] = (T) sin_op()(theta);
+                twiddles += 2;
+            }
+            for (int r = 0; r < n2; ++r) {
+                const f64 theta = (-2. * dsc_pi<f64>() * r) / (f64) n;
+                twiddles[0] = (T) cos_op()(theta);
+                twiddles[1] = (T) sin_op()(theta);
+                twiddles += 2;
+            }
+            for (int k1 = 0; k1 < n1; ++k1) {
+                for (int b = 0; b < batch; ++b) {
+                    const f64 theta = (-2. * dsc_pi<f64>() * (f64) (k1 * b)) / (f64) n;
+                    twiddles[0] = (T) cos_op()(theta);
+                    twiddles[1] = (T) sin_op()(theta);
+                    twiddles += 2;
+                }
+            }
+        }
+
+        plan->sub_plan = (dsc_fft_plan *) src->storage;
+        src->storage += sizeof(dsc_fft_plan);
+        dsc_init_plan<T>(plan->sub_plan, n1, dtype, COMPLEX, STOCKHAM, nullptr, src, &sub_tuning);
+
+        plan->row_plan = (dsc_fft_plan *) src->storage;
+        src->storage += sizeof(dsc_fft_plan);
+        dsc_init_plan<T>(plan->row_plan, n2, dtype, COMPLEX, STOCKHAM, nullptr, src, &sub_tuning);
+    } else {
+        // X[k] = c[k] * sum(x[j] * c[j] * conj(c[k - j])) with c[j] = exp(-pi*i*j^2 / N).
+        // The convolution is done with an FFT of order M so store the FFT of conj(c) zero-padded
+        // to M, this is scaled by 1/M so the inverse FFT doesn't need any extra scaling.
+        const int m = dsc_fft_bluestein_n(n);
+        T *chirp = dsc_twiddles_get<T>(src, CHIRP_TWIDDLES, dtype, n, 0, n + m, &fill);
+        T *chirp_fft = &chirp[n << 1];
+        plan->twiddles = chirp;
+
+        if (fill) {
+            for (int j = 0; j < n; ++j) {
+                // Reduce j^2 modulo 2N to keep the argument small
+                const f64 theta = (-dsc_pi<f64>() * (f64) (((i64) j * j) % ((i64) n << 1))) / (f64) n;
+                chirp[2 * j] = (T) cos_op()(theta);
+                chirp[2 * j + 1] = (T) sin_op()(theta);
+            }
 
-    const int sets = fft_type == REAL ? (n << 1) : n;
+            for (int j = 0; j < (m << 1); ++j) chirp_fft[j] = 0;
+            chirp_fft[0] = chirp[0];
+            chirp_fft[1] = -chirp[1];
+            for (int j = 1; j < n; ++j) {
+                chirp_fft[2 * j] = chirp_fft[2 * (m - j)] = chirp[2 * j];
+                chirp_fft[2 * j + 1] = chirp_fft[2 * (m - j) + 1] = -chirp[2 * j + 1];
+            }
+        }
+
+        plan->sub_plan = (dsc_fft_plan *) src->storage;
+        src->storage += sizeof(dsc_fft_plan);
+        dsc_init_plan<T>(plan->sub_plan, m, dtype, COMPLEX, STOCKHAM, nullptr, src, &sub_tuning);
+
+        if (fill) {
+            using Tc = internal::complex_<T>;
+            dsc_fft_stockham<Tc, true>(plan->sub_plan, (Tc *) chirp_fft, (Tc *) work);
+            const T scale = (T) 1 / (T) m;
+            for (int j = 0; j < (m << 1); ++j) chirp_fft[j] *= scale;
+        }
+    }
 
-    for (int twiddle_n = 2; twiddle_n <= sets; twiddle_n <<= 1) {
-        const int twiddle_n2 = twiddle_n >> 1;
-        for (int k = 0; k < twiddle_n2; ++k) {
-            const T theta = ((T) (-2.) * dsc_pi<T>() * k) / (T) (twiddle_n);
-            twiddles[(2 * (twiddle_n2 - 1)) + (2 * k)] = cos_op()(theta);
-            twiddles[(2 * (twiddle_n2 - 1)) + (2 * k) + 1] = sin_op()(theta);
+    if (fft_type == REAL && algorithm != RECURSIVE_RADIX2) {
+        T *rfft_twiddles = dsc_twiddles_get<T>(src, RFFT_TWIDDLES, dtype, n, 0, (n + 1) >> 1, &fill);
+        plan->rfft_twiddles = rfft_twiddles;
+        if (fill) {
+            for (int k = 0; k < ((n + 1) >> 1); ++k) {
+                const f64 theta = (-2. * dsc_pi<f64>() * k) / (f64) (n << 1);
+                rfft_twiddles[2 * k] = (T) cos_op()(theta);
+                rfft_twiddles[2 * k + 1] = (T) sin_op()(theta);
+            }
         }
     }
 
     plan->n = n;
     plan->dtype = dtype;
     plan->fft_type = fft_type;
-    plan->last_used = 0;
+    plan->algorithm = algorithm;
+    plan->hash_next = nullptr;
+    plan->lru_prev = nullptr;
+    plan->lru_next = nullptr;
 }
 
 template<typename T, real<T> sign>
@@ -101,24 +574,550 @@ DSC_NOINLINE void dsc_fft_pass2(T *DSC_RESTRICT x,
         x[k + n2].imag = x_even_k.imag - tmp.imag;
     }
 }
+
+// x * w for forward FFTs, x * conj(w) for backward FFTs
+template<typename T, bool forward>
+DSC_INLINE T dsc_fft_twiddle(const T x, const T w) noexcept {
+    if constexpr (forward) {
+        return dsc_complex(T, x.real * w.real - x.imag * w.imag,
+                           x.real * w.imag + x.imag * w.real);
+    } else {
+        return dsc_complex(T, x.real * w.real + x.imag * w.imag,
+                           x.imag * w.real - x.real * w.imag);
+    }
+}
+
+// x * -i for forward FFTs, x * i for backward FFTs
+template<typename T, bool forward>
+DSC_INLINE T dsc_fft_rot90(const T x) noexcept {
+    if constexpr (forward) {
+        return dsc_complex(T, x.imag, -x.real);
+    } else {
+        return dsc_complex(T, -x.imag, x.real);
+    }
+}
+
+// Scalar implementation of the operations used by the FFT kernels, the SIMD implementations in
+// dsc_fft.cpp expose the same interface but operate on ops::width complex numbers at once.
+template<typename T>
+struct dsc_fft_scalar_ops {
+    using type = T;
+    using vec = T;
+    static constexpr int width = 1;
+
+    static DSC_INLINE vec load(const T *x) noexcept { return *x; }
+    static DSC_INLINE vec load_strided(const T *x, const int) noexcept { return *x; }
+    static DSC_INLINE void store(T *x, const vec v) noexcept { *x = v; }
+    static DSC_INLINE void store_strided(T *x, const int, const vec v) noexcept { *x = v; }
+    static DSC_INLINE vec broadcast(const T x) noexcept { return x; }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return add_op()(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return sub_op()(a, b); }
+    static DSC_INLINE vec scale(const vec a, const real<T> s) noexcept {
+        return dsc_complex(T, a.real * s, a.imag * s);
+    }
+    // acc + a * s
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const real<T> s) noexcept {
+        return dsc_complex(T, acc.real + a.real * s, acc.imag + a.imag * s);
+    }
+    // acc + a * b element-wise, the real and imaginary parts are treated as independent values
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept {
+        return dsc_complex(T, acc.real + a.real * b.real, acc.imag + a.imag * b.imag);
+    }
+    static DSC_INLINE vec conj(const vec a) noexcept { return dsc_complex(T, a.real, -a.imag); }
+    static DSC_INLINE vec reverse(const vec a) noexcept { return a; }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept { return dsc_fft_rot90<T, forward>(a); }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept { return dsc_fft_twiddle<T, forward>(a, w); }
+};
+
+// Maximum number of segments processed at once by the Goertzel kernels
+static constexpr int DSC_GOERTZEL_MAX_SEGMENTS = 8;
+
+// Type of the state of the Goertzel kernels of ops O over a signal of type Tx: real signals have a real state
+template<typename O, typename Tx>
+using dsc_goertzel_type = std::conditional_t<dsc_is_complex<Tx>(), typename O::type, real<typename O::type>>;
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_rfft_kernel(const dsc_fft_plan *plan, T *DSC_RESTRICT x) noexcept {
+    if constexpr (dsc_is_type<T, c32>()) {
+        plan->kernels->rfft_c32[forward](plan, x);
+    } else {
+        plan->kernels->rfft_c64[forward](plan, x);
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_rfft_batch_kernel(const dsc_fft_plan *plan, T *DSC_RESTRICT x,
+                                          const int batch) noexcept {
+    if constexpr (dsc_is_type<T, c32>()) {
+        plan->kernels->rfft_batch_c32[forward](plan, x, batch);
+    } else {
+        plan->kernels->rfft_batch_c64[forward](plan, x, batch);
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_rfft_pair_kernel(const dsc_fft_plan *plan, T *DSC_RESTRICT x,
+                                         const int batch) noexcept {
+    if constexpr (dsc_is_type<T, c32>()) {
+        plan->kernels->rfft_pair_c32[forward](plan, x, batch);
+    } else {
+        plan->kernels->rfft_pair_c64[forward](plan, x, batch);
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_bluestein(const dsc_fft_plan *plan,
+                                  T *DSC_RESTRICT x,
+                                  T *DSC_RESTRICT work) noexcept {
+    // Work must have space for 2*M elements: the first M are used for the convolution
+    // and the other M are the work buffer of the sub-plan.
+    const dsc_fft_plan *sub_plan = plan->sub_plan;
+    const int n = plan->n;
+    const int m = sub_plan->n;
+    const T *DSC_RESTRICT chirp = (const T *) plan->twiddles;
+    const T *DSC_RESTRICT chirp_fft = &chirp[n];
+
+    T *DSC_RESTRICT conv = work;
+    T *DSC_RESTRICT sub_work = &work[m];
+
+    for (int j = 0; j < n; ++j) conv[j] = dsc_fft_twiddle<T, forward>(x[j], chirp[j]);
+    for (int j = n; j < m; ++j) conv[j] = dsc_zero<T>();
+
+    dsc_fft_stockham<T, true>(sub_plan, conv, sub_work);
+    // The FFT of the chirp is symmetric so, for the backward transform, FFT(c) = conj(FFT(conj(c)))
+    for (int j = 0; j < m; ++j) conv[j] = dsc_fft_twiddle<T, forward>(conv[j], chirp_fft[j]);
+    dsc_fft_stockham<T, false>(sub_plan, conv, sub_work);
+
+    for (int k = 0; k < n; ++k) x[k] = dsc_fft_twiddle<T, forward>(conv[k], chirp[k]);
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_four_step(const dsc_fft_plan *plan,
+                                  T *DSC_RESTRICT x,
+                                  T *DSC_RESTRICT work) noexcept {
+    // x is seen as a N1 x N2 matrix x[n1][n2] = x[n1 * N2 + n2]:
+    // 1. FFT of order N1 of each column and multiplication by W_N^(k1 * n2), the result goes in work
+    // 2. FFT of order N2 of each row, the result goes back in x transposed: X[k1 + k2 * N1] = Y[k1][k2]
+    // Both steps copy DSC_FFT_FOUR_STEP_BATCH columns (rows) at a time in a buffer that fits in the
+    // cache and transform them with the batched kernels so the whole array is only read and written
+    // twice. In work the result of the first step is stored in tiles of batch x batch elements so
+    // that both steps access it contiguously.
+    // Work must have space for N + (DSC_FFT_FOUR_STEP_BATCH + DSC_FFT_MAX_BATCH) * N2 elements.
+    constexpr int batch = DSC_FFT_FOUR_STEP_BATCH;
+    constexpr int sub_batch = DSC_FFT_MAX_BATCH;
+
+    const dsc_fft_plan *col_plan = plan->sub_plan, *row_plan = plan->row_plan;
+    const int n1 = col_plan->n, n2 = row_plan->n;
+    const T *DSC_RESTRICT twiddles_q = (const T *) plan->twiddles;
+    const T *DSC_RESTRICT twiddles_r = &twiddles_q[n1];
+    const T *DSC_RESTRICT twiddles_b = &twiddles_r[n2];
+
+    T *DSC_RESTRICT y = work;
+    // The buffer is split in sub-buffers of sub_batch lines each, interleaved as the batched kernels expect
+    T *DSC_RESTRICT buf = &work[(usize) n1 * n2];
+    T *DSC_RESTRICT buf_work = &buf[(usize) batch * n2];
+
+    for (int c = 0; c < n2; c += batch) {
+        const int cols = DSC_MIN(batch, n2 - c);
+        for (int i = 0; i < n1; ++i) {
+            const T *DSC_RESTRICT x_i = &x[(usize) i * n2 + c];
+            for (int s = 0; s < cols; s += sub_batch) {
+                const int lines = DSC_MIN(sub_batch, cols - s);
+                T *DSC_RESTRICT buf_i = &buf[s * n1 + i * lines];
+                for (int b = 0; b < lines; ++b) buf_i[b] = x_i[s + b];
+            }
+        }
+
+        for (int s = 0; s < cols; s += sub_batch) {
+            dsc_fft_stockham_batch<T, forward>(col_plan, &buf[s * n1], buf_work, DSC_MIN(sub_batch, cols - s));
+        }
+
+        // k1 * c = q * N2 + r, since c < N2 r wraps around at most once per row
+        T *DSC_RESTRICT y_c = &y[(usize) c * n1];
+        int q = 0, r = 0;
+        for (int k1 = 0; k1 < n1; ++k1) {
+            const T w = dsc_fft_twiddle<T, true>(twiddles_q[q], twiddles_r[r]);
+            const T *DSC_RESTRICT w_k1 = &twiddles_b[k1 * batch];
+            T *DSC_RESTRICT y_k1 = &y_c[k1 * cols];
+            for (int s = 0; s < cols; s += sub_batch) {
+                const int lines = DSC_MIN(sub_batch, cols - s);
+                const T *DSC_RESTRICT buf_k1 = &buf[s * n1 + k1 * lines];
+                for (int b = 0; b < lines; ++b) {
+                    y_k1[s + b] = dsc_fft_twiddle<T, forward>(buf_k1[b], dsc_fft_twiddle<T, true>(w_k1[s + b], w));
+                }
+            }
+            r += c;
+            if (r >= n2) {
+                r -= n2;
+                q++;
+            }
+        }
+    }
+
+    for (int c = 0; c < n1; c += batch) {
+        const int rows = DSC_MIN(batch, n1 - c);
+        for (int t = 0; t < n2; t += batch) {
+            const int cols = DSC_MIN(batch, n2 - t);
+            const T *DSC_RESTRICT tile = &y[(usize) t * n1 + c * cols];
+            for (int k1 = 0; k1 < rows; ++k1) {
+                const int s = k1 - (k1 % sub_batch);
+                const int lines = DSC_MIN(sub_batch, rows - s);
+                T *DSC_RESTRICT buf_k1 = &buf[s * n2 + (k1 - s)];
+                for (int b = 0; b < cols; ++b) buf_k1[(t + b) * lines] = tile[k1 * cols + b];
+            }
+        }
+
+        for (int s = 0; s < rows; s += sub_batch) {
+            dsc_fft_stockham_batch<T, forward>(row_plan, &buf[s * n2], buf_work, DSC_MIN(sub_batch, rows - s));
+        }
+
+        for (int k2 = 0; k2 < n2; ++k2) {
+            T *DSC_RESTRICT x_k2 = &x[(usize) k2 * n1 + c];
+            for (int s = 0; s < rows; s += sub_batch) {
+                const int lines = DSC_MIN(sub_batch, rows - s);
+                const T *DSC_RESTRICT buf_k2 = &buf[s * n2 + k2 * lines];
+                for (int b = 0; b < lines; ++b) x_k2[s + b] = buf_k2[b];
+            }
+        }
+    }
+}
+
+// Pruned FFTs of order N = P * M. The twiddles W_N^j are needed for any j in [0, N) so they are
+// computed as W_P^q * W_N^r with j = q * M + r: twiddles_q has the P values W_P^q and twiddles_r
+// has the M values W_N^r.
+template<typename T>
+DSC_INLINE T dsc_fft_pruned_twiddle(const T *DSC_RESTRICT twiddles_q,
+                                    const T *DSC_RESTRICT twiddles_r,
+                                    const int q, const int r) noexcept {
+    return dsc_fft_twiddle<T, true>(twiddles_q[q], twiddles_r[r]);
+}
+
+// Element i of the sub-transform b of a pruned FFT is stored at i * P + b if the sub-transforms are
+// batched and at b * M + i otherwise
+DSC_INLINE DSC_PURE int dsc_fft_pruned_index(const dsc_fft_pruning &pruning, const int i, const int b) noexcept {
+    return pruning.batched ? i * pruning.p + b : b * pruning.m + i;
+}
+
+// Compute the P sub-transforms of order M of a pruned FFT, x and work must have space for N elements
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_pruned_sub_ffts(const dsc_fft_plan *sub_plan, const dsc_fft_pruning &pruning,
+                                        T *DSC_RESTRICT x, T *DSC_RESTRICT work) noexcept {
+    if (pruning.batched) {
+        dsc_fft_stockham_batch<T, forward>(sub_plan, x, work, pruning.p);
+    } else {
+        for (int b = 0; b < pruning.p; ++b) dsc_fft_stockham<T, forward>(sub_plan, &x[b * pruning.m], work);
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_pruned_input(const dsc_fft_plan *sub_plan, const dsc_fft_pruning &pruning,
+                                     const int l,
+                                     const T *DSC_RESTRICT x,
+                                     T *DSC_RESTRICT out,
+                                     T *DSC_RESTRICT work,
+                                     const T *DSC_RESTRICT twiddles_q,
+                                     const T *DSC_RESTRICT twiddles_r) noexcept {
+    // Only x[i] with i < L <= M is non-zero so X[m * P + b] = sum_i (x[i] * W_N^(i * b)) * W_M^(i * m):
+    // each b is an FFT of order M of the first L inputs multiplied by W_N^(i * b). The butterflies of the
+    // first log(P) stages of the full FFT, that would only combine zeros, are skipped.
+    // On return X[k] is at out[dsc_fft_pruned_index(pruning, k / P, k % P)]. Out and work must have
+    // space for N elements.
+    const int m = pruning.m, p = pruning.p;
+    if (pruning.batched) {
+        for (int i = 0; i < l; ++i) {
+            // i * b = q * M + r, since i < M r wraps around at most once per step
+            const T x_i = x[i];
+            T *DSC_RESTRICT out_i = &out[i * p];
+            int q = 0, r = 0;
+            for (int b = 0; b < p; ++b) {
+                out_i[b] = dsc_fft_twiddle<T, forward>(x_i, dsc_fft_pruned_twiddle(twiddles_q, twiddles_r, q, r));
+                r += i;
+                if (r >= m) {
+                    r -= m;
+                    q++;
+                }
+            }
+        }
+        for (int i = l * p; i < m * p; ++i) out[i] = dsc_zero<T>();
+    } else {
+        for (int b = 0; b < p; ++b) {
+            // Each step adds b = b_q * M + b_r
+            const int b_q = b / m, b_r = b - b_q * m;
+            T *DSC_RESTRICT out_b = &out[b * m];
+            int q = 0, r = 0;
+            for (int i = 0; i < l; ++i) {
+                out_b[i] = dsc_fft_twiddle<T, forward>(x[i], dsc_fft_pruned_twiddle(twiddles_q, twiddles_r, q, r));
+                r += b_r;
+                q += b_q;
+                if (r >= m) {
+                    r -= m;
+                    q++;
+                }
+            }
+            for (int i = l; i < m; ++i) out_b[i] = dsc_zero<T>();
+        }
+    }
+
+    dsc_fft_pruned_sub_ffts<T, forward>(sub_plan, pruning, out, work);
+}
+
+template<typename T, bool forward, bool real_input>
+DSC_INLINE void dsc_fft_pruned_output(const dsc_fft_pruning &pruning,
+                                      const int stride_j, const int stride_b,
+                                      const int k_start, const int k_stop,
+                                      const T *DSC_RESTRICT y,
+                                      T *DSC_RESTRICT out,
+                                      const T *DSC_RESTRICT twiddles_q,
+                                      const T *DSC_RESTRICT twiddles_r) noexcept {
+    // y[j * stride_j + b * stride_b] is bin j of the FFT of order M of the decimated input x[i * P + b]
+    // so X[k] = sum_b W_N^(b * k) * y_b[k mod M]. Only the K bins in [k_start, k_stop) are computed,
+    // this costs K * P operations instead of the last log(P) stages of the full FFT. If the input is
+    // real only the first M / 2 + 1 bins of y are stored, the others are given by the Hermitian symmetry.
+    // The bins are computed kb at a time so the sums are independent of each other.
+    // The result goes in out[k - k_start].
+    constexpr int kb = 4;
+    const int m = pruning.m, p = pruning.p;
+    for (int k0 = k_start; k0 < k_stop; k0 += kb) {
+        const int k_n = DSC_MIN(kb, k_stop - k0);
+        // k * b mod N = q * M + r, each step adds k = k_q * M + k_r
+        int k_q[kb], k_r[kb], q[kb], r[kb];
+        const T *DSC_RESTRICT y_k[kb];
+        real<T> sign[kb];
+        T acc[kb];
+        for (int i = 0; i < kb; ++i) {
+            // The unused slots repeat the last bin
+            const int k = k0 + DSC_MIN(i, k_n - 1);
+            k_q[i] = k / m;
+            k_r[i] = k - k_q[i] * m;
+            q[i] = 0;
+            r[i] = 0;
+            int j = k_r[i];
+            sign[i] = 1;
+            if constexpr (real_input) {
+                if (j > (m >> 1)) {
+                    j = m - j;
+                    sign[i] = -1;
+                }
+            }
+            y_k[i] = &y[j * stride_j];
+            acc[i] = dsc_zero<T>();
+        }
+
+        for (int b = 0; b < p; ++b) {
+            for (int i = 0; i < kb; ++i) {
+                T y_b = y_k[i][b * stride_b];
+                if constexpr (real_input) y_b.imag *= sign[i];
+                const T val = dsc_fft_twiddle<T, forward>(y_b, dsc_fft_pruned_twiddle(twiddles_q, twiddles_r, q[i], r[i]));
+                acc[i].real += val.real;
+                acc[i].imag += val.imag;
+
+                r[i] += k_r[i];
+                q[i] += k_q[i];
+                if (r[i] >= m) {
+                    r[i] -= m;
+                    q[i]++;
+                }
+                if (q[i] >= p) q[i] -= p;
+            }
+        }
+
+        for (int i = 0; i < k_n; ++i) out[k0 + i - k_start] = acc[i];
+    }
+}
+
+template<typename T, bool forward>
+DSC_INLINE void dsc_fft_exec(const dsc_fft_plan *plan,
+                             T *DSC_RESTRICT x,
+                             T *DSC_RESTRICT work) noexcept {
+    switch (plan->algorithm) {
+        case RECURSIVE_RADIX2:
+            dsc_fft_pass2<T, forward ? (real<T>) 1 : (real<T>) -1>(x,
+                                                                   work,
+                                                                   (real<T> *) plan->twiddles,
+                                                                   plan->n
+            );
+            break;
+        case STOCKHAM:
+            dsc_fft_stockham<T, forward>(plan, x, work);
+            break;
+        case BLUESTEIN:
+            dsc_fft_bluestein<T, forward>(plan, x, work);
+            break;
+        case FOUR_STEP:
+            dsc_fft_four_step<T, forward>(plan, x, work);
+            break;
+        DSC_INVALID_CASE("unknown FFT algorithm=%d", plan->algorithm);
+    }
+}
 }
 
 // ============================================================
 // Public Interface
 
-static DSC_STRICTLY_PURE usize dsc_fft_storage(const int n, const dsc_dtype dtype,
-                                               const dsc_fft_type fft_type) noexcept {
-    // Compute how much storage is needed for the plan (twiddles * dtype).
+static inline DSC_STRICTLY_PURE dsc_fft_algorithm dsc_fft_choose_algorithm(const int n) noexcept {
+    // Use Bluestein only if N has a prime factor that is too large for a Stockham pass or
+    // if doing two FFTs of order M >= 2N - 1 is cheaper than a single FFT of order N.
     DSC_ASSERT(n > 0);
-    // N must be a power-of-2
-    DSC_ASSERT((n & (n - 1)) == 0);
 
-    usize twiddle_storage = 0;
-    const int sets = fft_type == REAL ? (n << 1) : n;
-    for (int twiddle_n = 2; twiddle_n <= sets; twiddle_n <<= 1) {
-        // Given N we need N/2 twiddle factors but each twiddle factor has a real and an imaginary part so that's N
-        twiddle_storage += twiddle_n;
+    int factors[DSC_FFT_MAX_FACTORS];
+    const int n_factors = dsc_fft_factorize(n, factors);
+    const int max_factor = n_factors > 0 ? factors[n_factors - 1] : 1;
+    if (max_factor > DSC_FFT_MAX_RADIX) return BLUESTEIN;
+
+    if (max_factor > 7) {
+        const f64 stockham_cost = dsc_fft_cost(n);
+        const f64 bluestein_cost = 1.5 * 2 * dsc_fft_cost(dsc_fft_bluestein_n(n));
+        if (bluestein_cost < stockham_cost) return BLUESTEIN;
+    }
+
+    if (n >= DSC_FFT_FOUR_STEP_MIN_N && dsc_fft_four_step_balanced(n)) return FOUR_STEP;
+    return STOCKHAM;
+}
+
+static inline DSC_STRICTLY_PURE f64 dsc_fft_plan_cost(const int n) noexcept {
+    // Cost of a complex FFT of order N computed with the algorithm chosen by the planner
+    if (dsc_fft_choose_algorithm(n) == BLUESTEIN) return 1.5 * 2 * dsc_fft_cost(dsc_fft_bluestein_n(n));
+    return dsc_fft_cost(n);
+}
+
+static inline DSC_STRICTLY_PURE dsc_fft_pruning dsc_fft_pruning_init(const dsc_fft_pruning_type type,
+                                                                     const int m, const int p) noexcept {
+    // Same rule as dsc_fft_batch_size: the batched kernels are only faster for short transforms
+    return {type, m, p, m <= DSC_FFT_BATCH_MAX_N && p >= DSC_FFT_PRUNED_MIN_BATCH};
+}
+
+static inline DSC_STRICTLY_PURE f64 dsc_fft_pruned_sub_cost(const dsc_fft_pruning &pruning, const f64 sub_cost,
+                                                            const f64 scalar_cost) noexcept {
+    return pruning.p * (sub_cost + (pruning.batched ? 0. : DSC_FFT_CALL_COST)) +
+           (pruning.p + pruning.m) * DSC_FFT_TWIDDLE_COST * scalar_cost;
+}
+
+// Choose how to compute an FFT of order N when only the first x_n inputs are non-zero and only k_n
+// bins of the output are needed. If real is true the input is real and N is the number of samples:
+// a regular RFFT is a complex FFT of order N/2 so input pruning is applied to that FFT (the first
+// (x_n + 1) / 2 packed inputs are non-zero) while output pruning uses P real FFTs of order M.
+// The sub-transforms are always Stockham FFTs. Pruning is used only if the estimated cost is well
+// below the cost of the full FFT since it also needs an extra pass over the data to apply the twiddles.
+// The twiddles are applied one value at a time while the FFT kernels process a full SIMD register
+// so, relative to the FFT, this extra work costs twice as much for C32 than for C64.
+static inline DSC_STRICTLY_PURE dsc_fft_pruning dsc_fft_choose_pruning(const int n, const int x_n,
+                                                                       const int k_n, const bool real,
+                                                                       const dsc_dtype dtype) noexcept {
+    DSC_ASSERT(n > 0 && x_n > 0 && k_n > 0);
+
+    dsc_fft_pruning best{NO_PRUNING, n, 1, false};
+    // Odd real FFTs are computed as complex FFTs of order N, they are rare enough not to bother
+    if (real && (n & 1) != 0) return best;
+
+    const int fft_n = real ? (n >> 1) : n;
+    const int l = real ? ((x_n + 1) >> 1) : x_n;
+    const f64 full_cost = real ? dsc_fft_plan_cost(fft_n) + 2. * fft_n : dsc_fft_plan_cost(n);
+    f64 best_cost = 0.8 * full_cost;
+    const f64 scalar_cost = dtype == C32 ? 2. : 1.;
+
+    // Input pruning: M is a divisor of fft_n with L <= M < fft_n
+    for (int d = 1; l < fft_n && d * d <= fft_n; ++d) {
+        if ((fft_n % d) != 0) continue;
+        const int divisors[2] = {d, fft_n / d};
+        for (const int m : divisors) {
+            const int p = fft_n / m;
+            if (m < l || p < 2 || dsc_fft_choose_algorithm(m) != STOCKHAM) continue;
+            const dsc_fft_pruning pruning = dsc_fft_pruning_init(INPUT_PRUNING, m, p);
+            // The twiddles are only applied to the L non-zero inputs. The RFFT post-processing needs
+            // the result in natural order so, if the sub-transforms are not batched, it must be transposed.
+            f64 cost = dsc_fft_pruned_sub_cost(pruning, dsc_fft_cost(m), scalar_cost) + 2. * l * p * scalar_cost;
+            if (real) cost += (pruning.batched ? 2. : 4.) * fft_n * scalar_cost;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = pruning;
+            }
+        }
+    }
+
+    // Output pruning: M is a divisor of N, for real inputs M must be even and the sub-transforms
+    // are RFFTs computed as complex FFTs of order M/2
+    const int n_bins = real ? (n >> 1) + 1 : n;
+    for (int d = 1; k_n < n_bins && d * d <= n; ++d) {
+        if ((n % d) != 0) continue;
+        const int divisors[2] = {d, n / d};
+        for (const int m : divisors) {
+            const int p = n / m;
+            if (p < 2 || (real && (m & 1) != 0)) continue;
+            const int sub_n = real ? (m >> 1) : m;
+            if (dsc_fft_choose_algorithm(sub_n) != STOCKHAM) continue;
+            const dsc_fft_pruning pruning = dsc_fft_pruning_init(OUTPUT_PRUNING, m, p);
+            // Each bin is the sum of P terms, each is a twiddle and a complex multiplication. For real
+            // inputs half of the terms are also conjugated to recover the bins of y above M/2.
+            const f64 sub_cost = real ? dsc_fft_cost(sub_n) + 2. * sub_n : dsc_fft_cost(m);
+            const f64 term_cost = (real ? 16. : 8.) * scalar_cost;
+            const f64 cost = dsc_fft_pruned_sub_cost(pruning, sub_cost, scalar_cost) + term_cost * k_n * p;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best = pruning;
+            }
+        }
+    }
+
+    return best;
+}
+
+// Twiddles W_P^q and W_N^r used by a pruned FFT of order N = P * M, twiddles must have space for P + M elements
+template<typename T>
+static DSC_INLINE void dsc_fft_pruning_twiddles(const int n, const dsc_fft_pruning &pruning,
+                                                T *DSC_RESTRICT twiddles) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be complex");
+    for (int q = 0; q < pruning.p; ++q) {
+        const f64 theta = (-2. * dsc_pi<f64>() * q) / (f64) pruning.p;
+        twiddles[q] = dsc_complex(T, (real<T>) cos_op()(theta), (real<T>) sin_op()(theta));
     }
+    for (int r = 0; r < pruning.m; ++r) {
+        const f64 theta = (-2. * dsc_pi<f64>() * r) / (f64) n;
+        twiddles[pruning.p + r] = dsc_complex(T, (real<T>) cos_op()(theta), (real<T>) sin_op()(theta));
+    }
+}
+
+static inline DSC_STRICTLY_PURE int dsc_fft_work_size(const int n, const dsc_fft_algorithm algorithm) noexcept {
+    // Number of complex elements needed by the work buffer of an FFT of order N
+    if (algorithm == BLUESTEIN) return dsc_fft_bluestein_n(n) << 1;
+    if (algorithm == FOUR_STEP) {
+        return n + (DSC_FFT_FOUR_STEP_BATCH + DSC_FFT_MAX_BATCH) * (n / dsc_fft_four_step_n1(n));
+    }
+    return n;
+}
+
+// Number of lines of length plan->n that should be transformed at once, 1 means that the lines
+// should be transformed one at a time. The batch size is always a multiple of the SIMD width of the
+// kernels, the lines left over are meant to be transformed one at a time.
+// If the lines are not contiguous the batched kernels are always worth it since they make the copy
+// in and out of the tensor much cheaper.
+static inline DSC_PURE int dsc_fft_batch_size(const dsc_fft_plan *plan, const int lines,
+                                              const bool contiguous) noexcept {
+    const bool is_c32 = plan->dtype == F32 || plan->dtype == C32;
+    const int width = is_c32 ? plan->kernels->width_c32 : plan->kernels->width_c64;
+
+    if (plan->algorithm != STOCKHAM || lines < DSC_MAX(width, 2)) return 1;
+    if (contiguous && plan->n > DSC_FFT_BATCH_MAX_N) return 1;
+
+    const usize line_bytes = plan->n * (is_c32 ? sizeof(c32) : sizeof(c64));
+    int batch = DSC_FFT_MAX_BATCH;
+    while (batch > width && batch * line_bytes > DSC_FFT_BATCH_BYTES) batch >>= 1;
+
+    return DSC_MIN(batch, (lines / width) * width);
+}
+
+static inline DSC_STRICTLY_PURE usize dsc_fft_storage(const int n, const dsc_dtype dtype,
+                                               const dsc_fft_type fft_type,
+                                               const dsc_fft_algorithm algorithm) noexcept {
+    // Compute how much storage is needed for the plan (twiddles * dtype).
+    DSC_ASSERT(n > 0);
+    // The recursive algorithm only supports power-of-2 N
+    DSC_ASSERT(algorithm != RECURSIVE_RADIX2 || (n & (n - 1)) == 0);
+
+    // Each twiddle factor has a real and an imaginary part
+    const usize twiddle_storage = dsc_fft_twiddles(n, fft_type, algorithm) * 2;
+
     usize dtype_size;
     switch (dtype) {
         case C32:
@@ -131,23 +1130,49 @@ static DSC_STRICTLY_PURE usize dsc_fft_storage(const int n, const dsc_dtype dtyp
             break;
         DSC_INVALID_CASE("unknown dtype=%d", dtype);
     }
-    return twiddle_storage * dtype_size;
+
+    usize sub_plan_storage = 0;
+    if (algorithm == BLUESTEIN) {
+        sub_plan_storage = sizeof(dsc_fft_plan) +
+                           dsc_fft_storage(dsc_fft_bluestein_n(n), dtype, COMPLEX, STOCKHAM);
+    } else if (algorithm == FOUR_STEP) {
+        const int n1 = dsc_fft_four_step_n1(n);
+        sub_plan_storage = 2 * sizeof(dsc_fft_plan) +
+                           dsc_fft_storage(n1, dtype, COMPLEX, STOCKHAM) +
+                           dsc_fft_storage(n / n1, dtype, COMPLEX, STOCKHAM);
+    }
+
+    return twiddle_storage * dtype_size + sub_plan_storage;
 }
 
-static void dsc_init_plan(dsc_fft_plan *plan, int n,
+// Work must point to a buffer big enough to hold dsc_fft_work_size(n, algorithm) complex
+// elements of the given dtype. It's only needed by Bluestein and can be nullptr otherwise.
+// If src is nullptr the twiddles are private to the plan and plan->twiddles must point to
+// dsc_fft_storage(n, dtype, fft_type, algorithm) bytes of storage.
+// A plan with a tuning other than the default passes must use shared twiddles.
+static inline void dsc_init_plan(dsc_fft_plan *plan, int n,
                           const dsc_dtype dtype,
-                          const dsc_fft_type fft_type) noexcept {
+                          const dsc_fft_type fft_type,
+                          const dsc_fft_algorithm algorithm,
+                          void *work = nullptr,
+                          dsc_twiddle_source *src = nullptr,
+                          const dsc_fft_tuning *tuning = nullptr) noexcept {
     DSC_ASSERT(n > 0);
-    DSC_ASSERT((n & (n - 1)) == 0);
+    DSC_ASSERT(algorithm != RECURSIVE_RADIX2 || (n & (n - 1)) == 0);
+    DSC_ASSERT(algorithm != BLUESTEIN || work != nullptr);
+    DSC_ASSERT(tuning == nullptr || tuning->n_factors == 0 || src != nullptr);
+
+    dsc_twiddle_source private_src{nullptr, (byte *) plan->twiddles};
+    if (src == nullptr) src = &private_src;
 
     switch (dtype) {
         case C32:
         case F32:
-            dsc_init_plan<f32>(plan, n, F32, fft_type);
+            dsc_init_plan<f32>(plan, n, F32, fft_type, algorithm, work, src, tuning);
             break;
         case C64:
         case F64:
-            dsc_init_plan<f64>(plan, n, F64, fft_type);
+            dsc_init_plan<f64>(plan, n, F64, fft_type, algorithm, work, src, tuning);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", dtype);
     }
@@ -159,11 +1184,7 @@ static DSC_INLINE void dsc_complex_fft(dsc_fft_plan *plan,
                                        T *DSC_RESTRICT work) noexcept {
     static_assert(dsc_is_complex<T>(), "T must be a complex type, use rfft for real-valued FFTs");
 
-    dsc_fft_pass2<T, forward ? (real<T>) 1 : (real<T>) -1>(x,
-                                                           work,
-                                                           (real<T> *) plan->twiddles,
-                                                           plan->n
-    );
+    dsc_fft_exec<T, forward>(plan, x, work);
 
     if constexpr (!forward) {
         // Divide all the elements by N
@@ -175,64 +1196,146 @@ static DSC_INLINE void dsc_complex_fft(dsc_fft_plan *plan,
     }
 }
 
+// Last step of a forward real FFT: x contains the complex FFT of order plan->n of the real samples
+// packed as x[i] = s[2i] + i * s[2i + 1] and must have space for plan->n + 1 elements, on return
+// it contains the plan->n + 1 bins of the RFFT.
+template<typename T>
+static DSC_INLINE void dsc_real_fft_finish(dsc_fft_plan *plan, T *DSC_RESTRICT x) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be a complex type, use rfft for real-valued FFTs");
+
+    const int n = plan->n;
+    const int n2 = n >> 1;
+
+    dsc_fft_rfft_kernel<T, true>(plan, x);
+
+    const T x0 = x[0];
+
+    if ((n & 1) == 0) x[n2].imag = -x[n2].imag;
+
+    x[0].real = x0.real + x0.imag;
+    x[0].imag = 0;
+
+    x[n].real = x0.real - x0.imag;
+    x[n].imag = 0;
+}
+
 template<typename T, bool forward>
 static DSC_INLINE void dsc_real_fft(dsc_fft_plan *plan,
                                     T *DSC_RESTRICT x,
                                     T *DSC_RESTRICT work) noexcept {
     static_assert(dsc_is_complex<T>(), "T must be a complex type, use rfft for real-valued FFTs");
 
-    const real<T> *twiddles = (real<T> *) plan->twiddles;
-
-    const int n = plan->n;
-    const int n2 = n >> 1;
-
-    real<T> c, twd_sign;
     if constexpr (forward) {
-        c = -0.5;
-        twd_sign = 1;
-        dsc_fft_pass2<T, (real<T>) 1>(x, work, twiddles, n);
+        dsc_fft_exec<T, true>(plan, x, work);
+        dsc_real_fft_finish<T>(plan, x);
     } else {
-        c = 0.5;
-        twd_sign = -1;
-    }
+        const int n = plan->n;
+        const int n2 = n >> 1;
+
+        dsc_fft_rfft_kernel<T, false>(plan, x);
+
+        const T x0 = x[0];
 
-    const int t_base = (n - 1) << 1;
-    for (int k = 1; k < n2; ++k) {
-        const real<T> h1r = (real<T>) (0.5) * (x[k].real + x[n - k].real);
-        const real<T> h1i = (real<T>) (0.5) * (x[k].imag - x[n - k].imag);
+        if ((n & 1) == 0) x[n2].imag = -x[n2].imag;
 
-        const real<T> h2r = -c * (x[k].imag + x[n - k].imag);
-        const real<T> h2i = c * (x[k].real - x[n - k].real);
+        x[0].real = (real<T>) (0.5) * (x0.real + x[n].real);
+        x[0].imag = (real<T>) (0.5) * (x0.real - x[n].real);
 
-        const real<T> wkr = twiddles[t_base + (2 * k)];
-        const real<T> wki = twd_sign * twiddles[t_base + (2 * k) + 1];
+        dsc_fft_exec<T, false>(plan, x, work);
 
-        x[k].real = h1r + (wkr * h2r) - (wki * h2i);
-        x[k].imag = h1i + (wkr * h2i) + (wki * h2r);
-        x[n - k].real = h1r - (wkr * h2r) + (wki * h2i);
-        x[n - k].imag = -h1i + (wkr * h2i) + (wki * h2r);
+        real<T> scale = (real<T>) (2) / (real<T>) (n << 1);
+        for (int i = 0; i < n; ++i) {
+            x[i].real *= scale;
+            x[i].imag *= scale;
+        }
     }
+}
 
-    const T x0 = x[0];
+// Batched FFTs: x contains batch independent lines interleaved as x[i * batch + b] where i is the
+// index of the element and b the index of the line. Work must have space for
+// plan->n * batch elements, only Stockham plans can be batched.
+template<typename T, bool forward>
+static DSC_INLINE void dsc_complex_fft_batch(dsc_fft_plan *plan,
+                                             T *DSC_RESTRICT x,
+                                             T *DSC_RESTRICT work,
+                                             const int batch) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be a complex type, use rfft for real-valued FFTs");
+    DSC_ASSERT(plan->algorithm == STOCKHAM);
+
+    dsc_fft_stockham_batch<T, forward>(plan, x, work, batch);
+
+    if constexpr (!forward) {
+        const real<T> scale = (real<T>) 1 / (real<T>) plan->n;
+        for (int i = 0; i < plan->n * batch; ++i) {
+            x[i].real *= scale;
+            x[i].imag *= scale;
+        }
+    }
+}
 
-    x[n2].imag = -x[n2].imag;
+// Same as dsc_real_fft, x must have space for (plan->n + 1) * batch elements
+template<typename T, bool forward>
+static DSC_INLINE void dsc_real_fft_batch(dsc_fft_plan *plan,
+                                          T *DSC_RESTRICT x,
+                                          T *DSC_RESTRICT work,
+                                          const int batch) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be a complex type, use rfft for real-valued FFTs");
+    DSC_ASSERT(plan->algorithm == STOCKHAM);
+
+    const int n = plan->n;
+    const int n2 = n >> 1;
+    T *DSC_RESTRICT x_n = &x[n * batch];
 
     if constexpr (forward) {
-        x[0].real = x0.real + x0.imag;
-        x[0].imag = 0;
+        dsc_fft_stockham_batch<T, true>(plan, x, work, batch);
+    }
+
+    dsc_fft_rfft_batch_kernel<T, forward>(plan, x, batch);
+
+    if ((n & 1) == 0) {
+        for (int b = 0; b < batch; ++b) x[n2 * batch + b].imag = -x[n2 * batch + b].imag;
+    }
 
-        x[n].real = x0.real - x0.imag;
-        x[n].imag = 0;
+    if constexpr (forward) {
+        for (int b = 0; b < batch; ++b) {
+            const T x0 = x[b];
+            x[b] = dsc_complex(T, x0.real + x0.imag, 0);
+            x_n[b] = dsc_complex(T, x0.real - x0.imag, 0);
+        }
     } else {
-        x[0].real = (real<T>) (0.5) * (x0.real + x[n].real);
-        x[0].imag = (real<T>) (0.5) * (x0.real - x[n].real);
+        for (int b = 0; b < batch; ++b) {
+            const T x0 = x[b];
+            x[b].real = (real<T>) (0.5) * (x0.real + x_n[b].real);
+            x[b].imag = (real<T>) (0.5) * (x0.real - x_n[b].real);
+        }
 
-        dsc_fft_pass2<T, (real<T>) -1>(x, work, twiddles, n);
+        dsc_fft_stockham_batch<T, false>(plan, x, work, batch);
 
         real<T> scale = (real<T>) (2) / (real<T>) (n << 1);
-        for (int i = 0; i < n; ++i) {
+        for (int i = 0; i < n * batch; ++i) {
             x[i].real *= scale;
             x[i].imag *= scale;
         }
     }
 }
+
+// Two-for-one real FFTs of odd order N = plan->n: x contains batch pairs of real lines interleaved as
+// x[N + 1][batch], the first line of each pair is in the real part and the second in the imaginary part
+// of x[0, N). The forward transform leaves the N/2 + 1 bins X[k] of the first line at k and Y[k] of
+// the second at N - k, the backward transform starts from the same layout. Batches of more than one
+// pair need a Stockham plan.
+template<typename T, bool forward>
+static DSC_INLINE void dsc_real_fft_pair(dsc_fft_plan *plan,
+                                         T *DSC_RESTRICT x,
+                                         T *DSC_RESTRICT work,
+                                         const int batch) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be a complex type");
+    DSC_ASSERT((plan->n & 1) == 1);
+
+    if constexpr (!forward) dsc_fft_rfft_pair_kernel<T, false>(plan, x, batch);
+
+    if (batch == 1) dsc_complex_fft<T, forward>(plan, x, work);
+    else dsc_complex_fft_batch<T, forward>(plan, x, work, batch);
+
+    if constexpr (forward) dsc_fft_rfft_pair_kernel<T, true>(plan, x, batch);
+}
@@ -0,0 +1,835 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+// FFT kernels written in terms of a generic set of complex vector operations (see dsc_fft_scalar_ops).
+// This file is meant to be included multiple times by dsc_fft.cpp, once for each instruction set,
+// inside a namespace that defines ops_c32 and ops_c64 and DSC_FFT_KERNELS_ISA, so there is no include guard.
+// This way the same code is compiled with different target options and the best version can
+// be selected at runtime.
+
+template<typename O, bool forward, int radix>
+DSC_INLINE void butterfly(const typename O::vec *DSC_RESTRICT x,
+                          typename O::vec *DSC_RESTRICT y,
+                          const int ip,
+                          const typename O::type *DSC_RESTRICT roots) noexcept {
+    using vec = typename O::vec;
+    using real_t = real<typename O::type>;
+
+    if constexpr (radix == 2) {
+        y[0] = O::add(x[0], x[1]);
+        y[1] = O::sub(x[0], x[1]);
+    } else if constexpr (radix == 4) {
+        const vec t0 = O::add(x[0], x[2]);
+        const vec t1 = O::sub(x[0], x[2]);
+        const vec t2 = O::add(x[1], x[3]);
+        const vec t3 = O::template rot90<forward>(O::sub(x[1], x[3]));
+        y[0] = O::add(t0, t2);
+        y[1] = O::add(t1, t3);
+        y[2] = O::sub(t0, t2);
+        y[3] = O::sub(t1, t3);
+    } else if constexpr (radix == 8) {
+        // Split in two radix-4 on the even and odd points then combine them using W8:
+        // x * W8 = (x + rot90(x)) / sqrt(2) and x * W8^3 = rot90(x * W8)
+        constexpr real_t sqrt1_2 = (real_t) 0.707106781186547524400844362104849039;
+
+        const vec even_in[4] = {x[0], x[2], x[4], x[6]};
+        const vec odd_in[4] = {x[1], x[3], x[5], x[7]};
+        vec even[4], odd[4];
+        butterfly<O, forward, 4>(even_in, even, 4, roots);
+        butterfly<O, forward, 4>(odd_in, odd, 4, roots);
+
+        odd[1] = O::scale(O::add(odd[1], O::template rot90<forward>(odd[1])), sqrt1_2);
+        odd[2] = O::template rot90<forward>(odd[2]);
+        odd[3] = O::template rot90<forward>(O::scale(O::add(odd[3], O::template rot90<forward>(odd[3])), sqrt1_2));
+
+        for (int j = 0; j < 4; ++j) {
+            y[j] = O::add(even[j], odd[j]);
+            y[j + 4] = O::sub(even[j], odd[j]);
+        }
+    } else {
+        // Odd radix: y[j] and y[ip - j] share the same products, only the sign of the imaginary part changes.
+        // With W^m = wr + i*wi: y[j] = t + i*u and y[ip - j] = t - i*u where
+        // t = x[0] + sum(wr * (x[m] + x[ip - m])) and u = sum(wi * (x[m] - x[ip - m])).
+        // For backward transforms the roots are conjugated so i*u becomes -i*u.
+        const int p = radix > 0 ? radix : ip;
+        const int half = (p - 1) >> 1;
+
+        vec sum[DSC_FFT_MAX_RADIX / 2 + 1], diff[DSC_FFT_MAX_RADIX / 2 + 1];
+        vec y0 = x[0];
+        for (int m = 1; m <= half; ++m) {
+            sum[m] = O::add(x[m], x[p - m]);
+            diff[m] = O::sub(x[m], x[p - m]);
+            y0 = O::add(y0, sum[m]);
+        }
+        y[0] = y0;
+
+        for (int j = 1; j <= half; ++j) {
+            vec t = O::fmadd(x[0], sum[1], roots[j].real);
+            vec u = O::scale(diff[1], roots[j].imag);
+            int jm = j;
+            for (int m = 2; m <= half; ++m) {
+                jm += j;
+                if (jm >= p) jm -= p;
+                t = O::fmadd(t, sum[m], roots[jm].real);
+                u = O::fmadd(u, diff[m], roots[jm].imag);
+            }
+            const vec iu = O::template rot90<!forward>(u);
+            y[j] = O::add(t, iu);
+            y[p - j] = O::sub(t, iu);
+        }
+    }
+}
+
+// A single Stockham pass of the given radix. The input is viewed as cc[l1][ip][ido] and
+// the output as ch[ip][l1][ido], this way each pass reorders the data and there is no
+// need for a bit-reversal at the end.
+// When radix is 0 the pass is a generic odd-radix pass of order ip.
+template<typename O, bool forward, int radix>
+DSC_NOINLINE void stockham_pass(const int ip_, const int ido, const int l1,
+                                const typename O::type *DSC_RESTRICT cc,
+                                typename O::type *DSC_RESTRICT ch,
+                                const typename O::type *DSC_RESTRICT wa) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    constexpr int width = O::width;
+    constexpr int max_radix = radix > 0 ? radix : DSC_FFT_MAX_RADIX;
+
+    const int ip = radix > 0 ? radix : ip_;
+    const int ch_stride = ido * l1;
+    const T *DSC_RESTRICT roots = &wa[(ip - 1) * ido];
+
+    if (ido < width) {
+        // Not enough contiguous elements to fill a vector, vectorize over k instead
+        for (int i = 0; i < ido; ++i) {
+            int k = 0;
+            for (; k + width <= l1; k += width) {
+                typename O::vec x[max_radix], y[max_radix];
+                for (int m = 0; m < ip; ++m) x[m] = O::load_strided(&cc[i + ido * (m + ip * k)], ido * ip);
+
+                butterfly<O, forward, radix>(x, y, ip, roots);
+
+                for (int j = 0; j < ip; ++j) {
+                    const typename O::vec y_j = (i == 0 || j == 0) ?
+                            y[j] : O::template cmul<forward>(y[j], O::broadcast(wa[(j - 1) * ido + i]));
+                    if (ido == 1) O::store(&ch[k + l1 * j], y_j);
+                    else O::store_strided(&ch[i + ido * (k + l1 * j)], ido, y_j);
+                }
+            }
+            for (; k < l1; ++k) {
+                T x[max_radix], y[max_radix];
+                for (int m = 0; m < ip; ++m) x[m] = cc[i + ido * (m + ip * k)];
+
+                butterfly<S, forward, radix>(x, y, ip, roots);
+
+                ch[i + ido * k] = y[0];
+                for (int j = 1; j < ip; ++j)
+                    ch[i + ido * (k + l1 * j)] = S::template cmul<forward>(y[j], wa[(j - 1) * ido + i]);
+            }
+        }
+        return;
+    }
+
+    for (int k = 0; k < l1; ++k) {
+        const T *DSC_RESTRICT cc_k = &cc[ido * ip * k];
+        T *DSC_RESTRICT ch_k = &ch[ido * k];
+
+        int i = 0;
+        for (; i + width <= ido; i += width) {
+            typename O::vec x[max_radix], y[max_radix];
+            for (int m = 0; m < ip; ++m) x[m] = O::load(&cc_k[i + m * ido]);
+
+            butterfly<O, forward, radix>(x, y, ip, roots);
+
+            O::store(&ch_k[i], y[0]);
+            for (int j = 1; j < ip; ++j)
+                O::store(&ch_k[j * ch_stride + i], O::template cmul<forward>(y[j], O::load(&wa[(j - 1) * ido + i])));
+        }
+        for (; i < ido; ++i) {
+            T x[max_radix], y[max_radix];
+            for (int m = 0; m < ip; ++m) x[m] = cc_k[i + m * ido];
+
+            butterfly<S, forward, radix>(x, y, ip, roots);
+
+            ch_k[i] = y[0];
+            for (int j = 1; j < ip; ++j)
+                ch_k[j * ch_stride + i] = S::template cmul<forward>(y[j], wa[(j - 1) * ido + i]);
+        }
+    }
+}
+
+template<typename O, bool forward>
+void stockham(const dsc_fft_plan *plan,
+              typename O::type *DSC_RESTRICT x,
+              typename O::type *DSC_RESTRICT work) noexcept {
+    using T = typename O::type;
+
+    const int n = plan->n;
+
+    T *in = x, *out = work;
+    int l1 = 1;
+    for (int f = 0; f < plan->n_factors; ++f) {
+        const int ip = plan->factors[f];
+        const int ido = n / (l1 * ip);
+        const T *twiddles = (const T *) plan->pass_twiddles[f];
+
+        switch (ip) {
+            case 2:
+                stockham_pass<O, forward, 2>(ip, ido, l1, in, out, twiddles);
+                break;
+            case 3:
+                stockham_pass<O, forward, 3>(ip, ido, l1, in, out, twiddles);
+                break;
+            case 4:
+                stockham_pass<O, forward, 4>(ip, ido, l1, in, out, twiddles);
+                break;
+            case 5:
+                stockham_pass<O, forward, 5>(ip, ido, l1, in, out, twiddles);
+                break;
+            case 7:
+                stockham_pass<O, forward, 7>(ip, ido, l1, in, out, twiddles);
+                break;
+            case 8:
+                stockham_pass<O, forward, 8>(ip, ido, l1, in, out, twiddles);
+                break;
+            default:
+                stockham_pass<O, forward, 0>(ip, ido, l1, in, out, twiddles);
+                break;
+        }
+
+        l1 *= ip;
+
+        T *tmp = in;
+        in = out;
+        out = tmp;
+    }
+
+    // With an odd number of passes the result is in the work buffer
+    if (in != x) memcpy(x, in, n * sizeof(T));
+}
+
+// Combine X[k] and X[N - k] for k in [1, (N + 1) / 2):
+// h1 = (X[k] + conj(X[N - k])) / 2, h2 = rot90(X[k] - conj(X[N - k])) / 2, t = h2 * W[k]
+// X[k] = h1 + t, X[N - k] = conj(h1 - t)
+template<typename O, bool forward>
+void rfft(const dsc_fft_plan *plan, typename O::type *DSC_RESTRICT x) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    using vec = typename O::vec;
+    using real_t = real<T>;
+    constexpr int width = O::width;
+
+    const int n = plan->n;
+    const int half = (n + 1) >> 1;
+    const T *DSC_RESTRICT twiddles = (const T *) plan->rfft_twiddles;
+
+    int k = 1;
+    for (; k + width <= half; k += width) {
+        // The elements at N - k are loaded in reverse order so that they line up with the elements at k
+        const vec a = O::load(&x[k]);
+        const vec b = O::conj(O::reverse(O::load(&x[n - k - width + 1])));
+
+        const vec h1 = O::scale(O::add(a, b), (real_t) 0.5);
+        const vec h2 = O::scale(O::template rot90<forward>(O::sub(a, b)), (real_t) 0.5);
+        const vec t = O::template cmul<forward>(h2, O::load(&twiddles[k]));
+
+        O::store(&x[k], O::add(h1, t));
+        O::store(&x[n - k - width + 1], O::reverse(O::conj(O::sub(h1, t))));
+    }
+    for (; k < half; ++k) {
+        const T a = x[k];
+        const T b = S::conj(x[n - k]);
+
+        const T h1 = S::scale(S::add(a, b), (real_t) 0.5);
+        const T h2 = S::scale(S::template rot90<forward>(S::sub(a, b)), (real_t) 0.5);
+        const T t = S::template cmul<forward>(h2, twiddles[k]);
+
+        x[k] = S::add(h1, t);
+        x[n - k] = S::conj(S::sub(h1, t));
+    }
+}
+
+// Batched version of stockham_pass: the input contains batch independent FFTs interleaved
+// element by element as cc[l1][ip][ido][batch] so the butterflies are vectorized across the
+// lines of the batch and all the loads and stores are contiguous, regardless of ido.
+template<typename O, bool forward, int radix>
+DSC_NOINLINE void stockham_batch_pass(const int ip_, const int ido, const int l1, const int batch,
+                                      const typename O::type *DSC_RESTRICT cc,
+                                      typename O::type *DSC_RESTRICT ch,
+                                      const typename O::type *DSC_RESTRICT wa) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    constexpr int width = O::width;
+    constexpr int max_radix = radix > 0 ? radix : DSC_FFT_MAX_RADIX;
+
+    const int ip = radix > 0 ? radix : ip_;
+    const int cc_stride = ido * batch;
+    const int ch_stride = ido * l1 * batch;
+    const T *DSC_RESTRICT roots = &wa[(ip - 1) * ido];
+
+    for (int k = 0; k < l1; ++k) {
+        for (int i = 0; i < ido; ++i) {
+            const T *DSC_RESTRICT cc_ki = &cc[(i + ido * ip * k) * batch];
+            T *DSC_RESTRICT ch_ki = &ch[(i + ido * k) * batch];
+
+            // The twiddles are the same for all the lines
+            typename O::vec w[max_radix];
+            for (int j = 1; j < ip; ++j) w[j] = O::broadcast(wa[(j - 1) * ido + i]);
+
+            int b = 0;
+            for (; b + width <= batch; b += width) {
+                typename O::vec x[max_radix], y[max_radix];
+                for (int m = 0; m < ip; ++m) x[m] = O::load(&cc_ki[m * cc_stride + b]);
+
+                butterfly<O, forward, radix>(x, y, ip, roots);
+
+                O::store(&ch_ki[b], y[0]);
+                for (int j = 1; j < ip; ++j)
+                    O::store(&ch_ki[j * ch_stride + b], i == 0 ? y[j] : O::template cmul<forward>(y[j], w[j]));
+            }
+            for (; b < batch; ++b) {
+                T x[max_radix], y[max_radix];
+                for (int m = 0; m < ip; ++m) x[m] = cc_ki[m * cc_stride + b];
+
+                butterfly<S, forward, radix>(x, y, ip, roots);
+
+                ch_ki[b] = y[0];
+                for (int j = 1; j < ip; ++j)
+                    ch_ki[j * ch_stride + b] = S::template cmul<forward>(y[j], wa[(j - 1) * ido + i]);
+            }
+        }
+    }
+}
+
+template<typename O, bool forward>
+void stockham_batch(const dsc_fft_plan *plan,
+                    typename O::type *DSC_RESTRICT x,
+                    typename O::type *DSC_RESTRICT work,
+                    const int batch) noexcept {
+    using T = typename O::type;
+
+    const int n = plan->n;
+
+    T *in = x, *out = work;
+    int l1 = 1;
+    for (int f = 0; f < plan->n_factors; ++f) {
+        const int ip = plan->factors[f];
+        const int ido = n / (l1 * ip);
+        const T *twiddles = (const T *) plan->pass_twiddles[f];
+
+        switch (ip) {
+            case 2:
+                stockham_batch_pass<O, forward, 2>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            case 3:
+                stockham_batch_pass<O, forward, 3>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            case 4:
+                stockham_batch_pass<O, forward, 4>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            case 5:
+                stockham_batch_pass<O, forward, 5>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            case 7:
+                stockham_batch_pass<O, forward, 7>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            case 8:
+                stockham_batch_pass<O, forward, 8>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+            default:
+                stockham_batch_pass<O, forward, 0>(ip, ido, l1, batch, in, out, twiddles);
+                break;
+        }
+
+        l1 *= ip;
+
+        T *tmp = in;
+        in = out;
+        out = tmp;
+    }
+
+    if (in != x) memcpy(x, in, n * batch * sizeof(T));
+}
+
+// Same as rfft but for batch interleaved lines, here X[k] and X[N - k] of all the lines
+// are already lined up so there is no need to reverse anything.
+template<typename O, bool forward>
+void rfft_batch(const dsc_fft_plan *plan, typename O::type *DSC_RESTRICT x, const int batch) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    using vec = typename O::vec;
+    using real_t = real<T>;
+    constexpr int width = O::width;
+
+    const int n = plan->n;
+    const int half = (n + 1) >> 1;
+    const T *DSC_RESTRICT twiddles = (const T *) plan->rfft_twiddles;
+
+    for (int k = 1; k < half; ++k) {
+        T *DSC_RESTRICT x_k = &x[k * batch];
+        T *DSC_RESTRICT x_nk = &x[(n - k) * batch];
+        const vec w = O::broadcast(twiddles[k]);
+
+        int b = 0;
+        for (; b + width <= batch; b += width) {
+            const vec a = O::load(&x_k[b]);
+            const vec c = O::conj(O::load(&x_nk[b]));
+
+            const vec h1 = O::scale(O::add(a, c), (real_t) 0.5);
+            const vec h2 = O::scale(O::template rot90<forward>(O::sub(a, c)), (real_t) 0.5);
+            const vec t = O::template cmul<forward>(h2, w);
+
+            O::store(&x_k[b], O::add(h1, t));
+            O::store(&x_nk[b], O::conj(O::sub(h1, t)));
+        }
+        for (; b < batch; ++b) {
+            const T a = x_k[b];
+            const T c = S::conj(x_nk[b]);
+
+            const T h1 = S::scale(S::add(a, c), (real_t) 0.5);
+            const T h2 = S::scale(S::template rot90<forward>(S::sub(a, c)), (real_t) 0.5);
+            const T t = S::template cmul<forward>(h2, twiddles[k]);
+
+            x_k[b] = S::add(h1, t);
+            x_nk[b] = S::conj(S::sub(h1, t));
+        }
+    }
+}
+
+// One step of rfft_pair on the elements at k (a) and N - k (c), both updated in-place
+template<typename O, bool forward>
+DSC_INLINE void rfft_pair_step(typename O::vec &a, typename O::vec &c) noexcept {
+    using real_t = real<typename O::type>;
+    if constexpr (forward) {
+        const typename O::vec c_conj = O::conj(c);
+        const typename O::vec x = O::scale(O::add(a, c_conj), (real_t) 0.5);
+        c = O::scale(O::template rot90<true>(O::sub(a, c_conj)), (real_t) 0.5);
+        a = x;
+    } else {
+        const typename O::vec iy = O::template rot90<false>(c);
+        c = O::conj(O::sub(a, iy));
+        a = O::add(a, iy);
+    }
+}
+
+// Two-for-one RFFTs of odd order N: the FFT of z = x + iy is split into the spectra of x and y,
+// X[k] = (Z[k] + conj(Z[N - k])) / 2 and Y[k] = -i(Z[k] - conj(Z[N - k])) / 2 for k in [0, (N + 1) / 2).
+// X[k] is stored at k and Y[k] at N - k (Y[0] at N) so z must have N + 1 elements. The backward transform
+// does the opposite: Z[k] = X[k] + iY[k] and Z[N - k] = conj(X[k] - iY[k]).
+// z contains batch interleaved lines, if there is more than one line the vectors are across the lines
+// like in rfft_batch otherwise the elements at N - k are reversed like in rfft.
+template<typename O, bool forward>
+void rfft_pair(const dsc_fft_plan *plan, typename O::type *DSC_RESTRICT z, const int batch) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    using vec = typename O::vec;
+    constexpr int width = O::width;
+
+    const int n = plan->n;
+    const int half = (n + 1) >> 1;
+    T *DSC_RESTRICT z_n = &z[n * batch];
+
+    for (int b = 0; b < batch; ++b) {
+        const T z0 = z[b];
+        if constexpr (forward) {
+            z[b] = dsc_complex(T, z0.real, 0);
+            z_n[b] = dsc_complex(T, z0.imag, 0);
+        } else {
+            z[b] = dsc_complex(T, z0.real, z_n[b].real);
+        }
+    }
+
+    if (batch == 1) {
+        int k = 1;
+        for (; k + width <= half; k += width) {
+            vec a = O::load(&z[k]);
+            vec c = O::reverse(O::load(&z[n - k - width + 1]));
+            rfft_pair_step<O, forward>(a, c);
+            O::store(&z[k], a);
+            O::store(&z[n - k - width + 1], O::reverse(c));
+        }
+        for (; k < half; ++k) rfft_pair_step<S, forward>(z[k], z[n - k]);
+        return;
+    }
+
+    for (int k = 1; k < half; ++k) {
+        T *DSC_RESTRICT z_k = &z[k * batch];
+        T *DSC_RESTRICT z_nk = &z[(n - k) * batch];
+
+        int b = 0;
+        for (; b + width <= batch; b += width) {
+            vec a = O::load(&z_k[b]);
+            vec c = O::load(&z_nk[b]);
+            rfft_pair_step<O, forward>(a, c);
+            O::store(&z_k[b], a);
+            O::store(&z_nk[b], c);
+        }
+        for (; b < batch; ++b) rfft_pair_step<S, forward>(z_k[b], z_nk[b]);
+    }
+}
+
+// Direct convolution y[k] = sum_j h[j] * x[k + m - 1 - j] for k in [0, y_n), x has y_n + m - 1 elements.
+// Groups of unroll vectors of outputs are accumulated in registers over the whole kernel.
+// Real signals are loaded as complex vectors of half the length, the product with h[j] is then just a scale.
+template<typename O, typename T>
+void conv(const T *DSC_RESTRICT x, const T *DSC_RESTRICT h, T *DSC_RESTRICT y,
+          const int y_n, const int m) noexcept {
+    using C = typename O::type;
+    using S = dsc_fft_scalar_ops<C>;
+    using vec = typename O::vec;
+    constexpr bool real_data = !dsc_is_complex<T>();
+    // Elements of T in a vector
+    constexpr int width = real_data ? 2 * O::width : O::width;
+    constexpr int unroll = 4;
+
+    int k = 0;
+    for (; k + unroll * width <= y_n; k += unroll * width) {
+        vec acc[unroll];
+        for (int u = 0; u < unroll; ++u) acc[u] = O::broadcast(dsc_zero<C>());
+
+        for (int j = 0; j < m; ++j) {
+            const T *DSC_RESTRICT x_j = &x[k + m - 1 - j];
+            if constexpr (real_data) {
+                for (int u = 0; u < unroll; ++u)
+                    acc[u] = O::fmadd(acc[u], O::load((const C *) &x_j[u * width]), h[j]);
+            } else {
+                const vec h_j = O::broadcast(h[j]);
+                for (int u = 0; u < unroll; ++u)
+                    acc[u] = O::add(acc[u], O::template cmul<true>(O::load(&x_j[u * width]), h_j));
+            }
+        }
+
+        for (int u = 0; u < unroll; ++u) O::store((C *) &y[k + u * width], acc[u]);
+    }
+    for (; k + width <= y_n; k += width) {
+        vec acc = O::broadcast(dsc_zero<C>());
+        for (int j = 0; j < m; ++j) {
+            const T *DSC_RESTRICT x_j = &x[k + m - 1 - j];
+            if constexpr (real_data) acc = O::fmadd(acc, O::load((const C *) x_j), h[j]);
+            else acc = O::add(acc, O::template cmul<true>(O::load(x_j), O::broadcast(h[j])));
+        }
+        O::store((C *) &y[k], acc);
+    }
+    for (; k < y_n; ++k) {
+        T acc = dsc_zero<T>();
+        for (int j = 0; j < m; ++j) {
+            if constexpr (real_data) acc += h[j] * x[k + m - 1 - j];
+            else acc = S::add(acc, S::template cmul<true>(x[k + m - 1 - j], h[j]));
+        }
+        y[k] = acc;
+    }
+}
+
+// Goertzel recurrence s[j] = x[j] + 2cos(w) * s[j - 1] - s[j - 2] in the form of Reinsch: with sigma = sign(cos(w))
+// the recurrence is carried as s[j] and d[j] = s[j] - sigma * s[j - 1]
+//   d[j] = x[j] + sigma * d[j - 1] + lambda * s[j - 1], lambda = 2cos(w) - 2sigma
+//   s[j] = sigma * s[j - 1] + d[j]
+// which, unlike the plain recurrence, doesn't lose precision for bins near 0 and n/2.
+// Each of the V lanes is a vector of bins over its own x, the lanes are independent so that the latency of
+// each update is hidden by the others. The recurrence is computed with the precision of O whatever the type of x.
+// Real signals are processed as complex vectors of twice as many bins like in conv, for complex signals both parts
+// of lambda[k] and sigma[k] are those of bin k.
+template<typename O, typename Tx, int V>
+DSC_INLINE void goertzel_lanes(const Tx *const *x, const int x_n,
+                               const dsc_goertzel_type<O, Tx> *const *lambda,
+                               const dsc_goertzel_type<O, Tx> *const *sigma,
+                               dsc_goertzel_type<O, Tx> *const *s,
+                               dsc_goertzel_type<O, Tx> *const *d) noexcept {
+    using C = typename O::type;
+    using R = real<C>;
+    using vec = typename O::vec;
+    constexpr bool real_data = !dsc_is_complex<Tx>();
+
+    vec lambda_v[V], sigma_v[V], s_v[V], d_v[V];
+    for (int u = 0; u < V; ++u) {
+        lambda_v[u] = O::load((const C *) lambda[u]);
+        sigma_v[u] = O::load((const C *) sigma[u]);
+        s_v[u] = O::load((const C *) s[u]);
+        d_v[u] = O::load((const C *) d[u]);
+    }
+
+    for (int j = 0; j < x_n; ++j) {
+        for (int u = 0; u < V; ++u) {
+            vec x_j;
+            if constexpr (real_data) x_j = O::broadcast(dsc_complex(C, (R) x[u][j], (R) x[u][j]));
+            else x_j = O::broadcast(dsc_complex(C, (R) x[u][j].real, (R) x[u][j].imag));
+
+            d_v[u] = O::madd(O::madd(x_j, sigma_v[u], d_v[u]), lambda_v[u], s_v[u]);
+            s_v[u] = O::madd(d_v[u], sigma_v[u], s_v[u]);
+        }
+    }
+
+    for (int u = 0; u < V; ++u) {
+        O::store((C *) s[u], s_v[u]);
+        O::store((C *) d[u], d_v[u]);
+    }
+}
+
+// Goertzel recurrence of n_bins bins over n_seg segments of x_n samples, segment p starts at x[p * seg_stride]
+// and its state is s[p * n_bins], d[p * n_bins]. Splitting a signal into segments gives more independent lanes
+// when there are only a few bins. The last bins are padded to a full vector. The lanes are split evenly in groups
+// of at most max_lanes so that no group is left with too few lanes to hide the latency.
+template<typename O, typename Tx>
+void goertzel(const Tx *DSC_RESTRICT x, const int x_n, const int seg_stride, const int n_seg,
+              const dsc_goertzel_type<O, Tx> *DSC_RESTRICT lambda,
+              const dsc_goertzel_type<O, Tx> *DSC_RESTRICT sigma,
+              dsc_goertzel_type<O, Tx> *DSC_RESTRICT s,
+              dsc_goertzel_type<O, Tx> *DSC_RESTRICT d, const int n_bins) noexcept {
+    using T = dsc_goertzel_type<O, Tx>;
+    constexpr bool real_data = !dsc_is_complex<Tx>();
+    constexpr int width = real_data ? 2 * O::width : O::width;
+    constexpr int max_lanes = 8;
+
+    DSC_ASSERT(n_seg <= DSC_GOERTZEL_MAX_SEGMENTS);
+
+    const int total_lanes = ((n_bins + width - 1) / width) * n_seg;
+    const int groups = (total_lanes + max_lanes - 1) / max_lanes;
+
+    const Tx *x_l[max_lanes];
+    const T *lambda_l[max_lanes], *sigma_l[max_lanes];
+    T *s_l[max_lanes], *d_l[max_lanes];
+    int lanes = 0, group = 0;
+
+    const auto flush = [&]() noexcept {
+        switch (lanes) {
+            case 8: goertzel_lanes<O, Tx, 8>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 7: goertzel_lanes<O, Tx, 7>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 6: goertzel_lanes<O, Tx, 6>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 5: goertzel_lanes<O, Tx, 5>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 4: goertzel_lanes<O, Tx, 4>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 3: goertzel_lanes<O, Tx, 3>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 2: goertzel_lanes<O, Tx, 2>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            case 1: goertzel_lanes<O, Tx, 1>(x_l, x_n, lambda_l, sigma_l, s_l, d_l); break;
+            default: break;
+        }
+        lanes = 0;
+        group += 1;
+    };
+    const auto add_lane = [&](const int p, const T *lambda_p, const T *sigma_p, T *s_p, T *d_p) noexcept {
+        x_l[lanes] = &x[p * seg_stride];
+        lambda_l[lanes] = lambda_p;
+        sigma_l[lanes] = sigma_p;
+        s_l[lanes] = s_p;
+        d_l[lanes] = d_p;
+        if (++lanes == (total_lanes * (group + 1)) / groups - (total_lanes * group) / groups) flush();
+    };
+
+    int k = 0;
+    for (; k + width <= n_bins; k += width) {
+        for (int p = 0; p < n_seg; ++p)
+            add_lane(p, &lambda[k], &sigma[k], &s[p * n_bins + k], &d[p * n_bins + k]);
+    }
+
+    const int tail = n_bins - k;
+    T lambda_t[width]{}, sigma_t[width]{}, s_t[DSC_GOERTZEL_MAX_SEGMENTS * width]{}, d_t[DSC_GOERTZEL_MAX_SEGMENTS * width]{};
+    if (tail > 0) {
+        for (int i = 0; i < tail; ++i) {
+            lambda_t[i] = lambda[k + i];
+            sigma_t[i] = sigma[k + i];
+        }
+        for (int p = 0; p < n_seg; ++p) {
+            for (int i = 0; i < tail; ++i) {
+                s_t[p * width + i] = s[p * n_bins + k + i];
+                d_t[p * width + i] = d[p * n_bins + k + i];
+            }
+            add_lane(p, lambda_t, sigma_t, &s_t[p * width], &d_t[p * width]);
+        }
+    }
+
+    for (int p = 0; p < n_seg && tail > 0; ++p) {
+        for (int i = 0; i < tail; ++i) {
+            s[p * n_bins + k + i] = s_t[p * width + i];
+            d[p * n_bins + k + i] = d_t[p * width + i];
+        }
+    }
+}
+
+// Sliding DFT of V vectors of bins: for each sample j the bins are updated as X[k] = (X[k] + d[j]) * w[k]
+// and written to y[j * y_stride + k], d[j] is the new sample minus the one that left the window.
+template<typename O, int V>
+DSC_INLINE void sdft_block(const typename O::type *DSC_RESTRICT d, const int d_n,
+                           const typename O::type *DSC_RESTRICT w,
+                           typename O::type *DSC_RESTRICT state,
+                           typename O::type *DSC_RESTRICT y, const int y_stride) noexcept {
+    using vec = typename O::vec;
+    constexpr int width = O::width;
+
+    vec w_v[V], x_v[V];
+    for (int u = 0; u < V; ++u) {
+        w_v[u] = O::load(&w[u * width]);
+        x_v[u] = O::load(&state[u * width]);
+    }
+
+    for (int j = 0; j < d_n; ++j) {
+        const vec d_j = O::broadcast(d[j]);
+        for (int u = 0; u < V; ++u) {
+            x_v[u] = O::template cmul<true>(O::add(x_v[u], d_j), w_v[u]);
+            O::store(&y[j * y_stride + u * width], x_v[u]);
+        }
+    }
+
+    for (int u = 0; u < V; ++u) O::store(&state[u * width], x_v[u]);
+}
+
+template<typename O>
+void sdft(const typename O::type *DSC_RESTRICT d, const int d_n,
+          const typename O::type *DSC_RESTRICT w,
+          typename O::type *DSC_RESTRICT state,
+          typename O::type *DSC_RESTRICT y, const int n_bins) noexcept {
+    using T = typename O::type;
+    using S = dsc_fft_scalar_ops<T>;
+    constexpr int width = O::width;
+    constexpr int unroll = 4;
+
+    int k = 0;
+    for (; k + unroll * width <= n_bins; k += unroll * width)
+        sdft_block<O, unroll>(d, d_n, &w[k], &state[k], &y[k], n_bins);
+
+    switch ((n_bins - k) / width) {
+        case 3:
+            sdft_block<O, 3>(d, d_n, &w[k], &state[k], &y[k], n_bins);
+            k += 3 * width;
+            break;
+        case 2:
+            sdft_block<O, 2>(d, d_n, &w[k], &state[k], &y[k], n_bins);
+            k += 2 * width;
+            break;
+        case 1:
+            sdft_block<O, 1>(d, d_n, &w[k], &state[k], &y[k], n_bins);
+            k += width;
+            break;
+        default:
+            break;
+    }
+
+    for (; k < n_bins; ++k) {
+        T x_k = state[k];
+        for (int j = 0; j < d_n; ++j) {
+            x_k = S::template cmul<true>(S::add(x_k, d[j]), w[k]);
+            y[j * n_bins + k] = x_k;
+        }
+        state[k] = x_k;
+    }
+}
+
+template<bool forward>
+void stockham_c32(const dsc_fft_plan *plan, c32 *x, c32 *work) noexcept {
+    stockham<ops_c32, forward>(plan, x, work);
+}
+
+template<bool forward>
+void stockham_c64(const dsc_fft_plan *plan, c64 *x, c64 *work) noexcept {
+    stockham<ops_c64, forward>(plan, x, work);
+}
+
+template<bool forward>
+void rfft_c32(const dsc_fft_plan *plan, c32 *x) noexcept {
+    rfft<ops_c32, forward>(plan, x);
+}
+
+template<bool forward>
+void rfft_c64(const dsc_fft_plan *plan, c64 *x) noexcept {
+    rfft<ops_c64, forward>(plan, x);
+}
+
+template<bool forward>
+void stockham_batch_c32(const dsc_fft_plan *plan, c32 *x, c32 *work, const int batch) noexcept {
+    stockham_batch<ops_c32, forward>(plan, x, work, batch);
+}
+
+template<bool forward>
+void stockham_batch_c64(const dsc_fft_plan *plan, c64 *x, c64 *work, const int batch) noexcept {
+    stockham_batch<ops_c64, forward>(plan, x, work, batch);
+}
+
+template<bool forward>
+void rfft_batch_c32(const dsc_fft_plan *plan, c32 *x, const int batch) noexcept {
+    rfft_batch<ops_c32, forward>(plan, x, batch);
+}
+
+template<bool forward>
+void rfft_batch_c64(const dsc_fft_plan *plan, c64 *x, const int batch) noexcept {
+    rfft_batch<ops_c64, forward>(plan, x, batch);
+}
+
+template<bool forward>
+void rfft_pair_c32(const dsc_fft_plan *plan, c32 *z, const int batch) noexcept {
+    rfft_pair<ops_c32, forward>(plan, z, batch);
+}
+
+template<bool forward>
+void rfft_pair_c64(const dsc_fft_plan *plan, c64 *z, const int batch) noexcept {
+    rfft_pair<ops_c64, forward>(plan, z, batch);
+}
+
+void conv_f32(const f32 *x, const f32 *h, f32 *y, const int y_n, const int m) noexcept {
+    conv<ops_c32>(x, h, y, y_n, m);
+}
+
+void conv_f64(const f64 *x, const f64 *h, f64 *y, const int y_n, const int m) noexcept {
+    conv<ops_c64>(x, h, y, y_n, m);
+}
+
+void conv_c32(const c32 *x, const c32 *h, c32 *y, const int y_n, const int m) noexcept {
+    conv<ops_c32>(x, h, y, y_n, m);
+}
+
+void conv_c64(const c64 *x, const c64 *h, c64 *y, const int y_n, const int m) noexcept {
+    conv<ops_c64>(x, h, y, y_n, m);
+}
+
+void goertzel_f32(const f32 *x, const int x_n, const int seg_stride, const int n_seg,
+                  const f64 *lambda, const f64 *sigma, f64 *s, f64 *d, const int n_bins) noexcept {
+    goertzel<ops_c64>(x, x_n, seg_stride, n_seg, lambda, sigma, s, d, n_bins);
+}
+
+void goertzel_f64(const f64 *x, const int x_n, const int seg_stride, const int n_seg,
+                  const f64 *lambda, const f64 *sigma, f64 *s, f64 *d, const int n_bins) noexcept {
+    goertzel<ops_c64>(x, x_n, seg_stride, n_seg, lambda, sigma, s, d, n_bins);
+}
+
+void goertzel_c32(const c32 *x, const int x_n, const int seg_stride, const int n_seg,
+                  const c64 *lambda, const c64 *sigma, c64 *s, c64 *d, const int n_bins) noexcept {
+    goertzel<ops_c64>(x, x_n, seg_stride, n_seg, lambda, sigma, s, d, n_bins);
+}
+
+void goertzel_c64(const c64 *x, const int x_n, const int seg_stride, const int n_seg,
+                  const c64 *lambda, const c64 *sigma, c64 *s, c64 *d, const int n_bins) noexcept {
+    goertzel<ops_c64>(x, x_n, seg_stride, n_seg, lambda, sigma, s, d, n_bins);
+}
+
+void sdft_c32(const c32 *d, const int d_n, const c32 *w, c32 *state, c32 *y, const int n_bins) noexcept {
+    sdft<ops_c32>(d, d_n, w, state, y, n_bins);
+}
+
+void sdft_c64(const c64 *d, const int d_n, const c64 *w, c64 *state, c64 *y, const int n_bins) noexcept {
+    sdft<ops_c64>(d, d_n, w, state, y, n_bins);
+}
+
+const dsc_fft_kernels kernels = {
+        DSC_FFT_KERNELS_ISA,
+        ops_c32::width,
+        ops_c64::width,
+        {stockham_c32<false>, stockham_c32<true>},
+        {stockham_c64<false>, stockham_c64<true>},
+        {rfft_c32<false>, rfft_c32<true>},
+        {rfft_c64<false>, rfft_c64<true>},
+        {stockham_batch_c32<false>, stockham_batch_c32<true>},
+        {stockham_batch_c64<false>, stockham_batch_c64<true>},
+        {rfft_batch_c32<false>, rfft_batch_c32<true>},
+        {rfft_batch_c64<false>, rfft_batch_c64<true>},
+        {rfft_pair_c32<false>, rfft_pair_c32<true>},
+        {rfft_pair_c64<false>, rfft_pair_c64<true>},
+        conv_f32,
+        conv_f64,
+        conv_c32,
+        conv_c64,
+        goertzel_f32,
+        goertzel_f64,
+        goertzel_c32,
+        goertzel_c64,
+        sdft_c32,
+        sdft_c64,
+};
@@ -64,64 +64,155 @@ private:
     bool end_ = false;
 };
 
-struct dsc_broadcast_iterator {
-    dsc_broadcast_iterator(const dsc_tensor *x, const int *out_shape) noexcept :
-            x_shape_(x->shape), x_stride_(x->stride), out_shape_(out_shape) {
-        for (int i = 0; i < DSC_MAX_DIMS; ++i) {
-            x_broadcast_stride_[i] = x_shape_[i] < out_shape_[i] ? 0 : x_stride_[i];
+// Iterate over the first element of each line of x along the given axis. The elements of a line
+// are at index() + i * stride[axis], this is much cheaper than dsc_axis_iterator when the
+// whole line has to be copied somewhere else.
+struct dsc_line_iterator {
+    // Start from the given line, lines are numbered in row-major order
+    dsc_line_iterator(const dsc_tensor *x, const int axis, int line = 0) noexcept :
+            shape_(x->shape), stride_(x->stride), axis_(axis) {
+        for (int i = DSC_MAX_DIMS - 1; i >= 0; --i) {
+            if (i == axis_)
+                continue;
+
+            idx_[i] = line % shape_[i];
+            line /= shape_[i];
+            index_ += idx_[i] * stride_[i];
         }
+        end_ = line > 0;
     }
 
     DSC_INLINE void next() noexcept {
         for (int i = DSC_MAX_DIMS - 1; i >= 0; --i) {
-            if (++x_idx_[i] < out_shape_[i]) [[likely]] {
-                index_ += x_broadcast_stride_[i];
+            if (i == axis_)
+                continue;
+
+            if (++idx_[i] < shape_[i]) [[likely]] {
+                index_ += stride_[i];
                 return;
             }
             // Rollover this dimension
-            index_ -= (x_idx_[i] - 1) * x_broadcast_stride_[i];
-            x_idx_[i] = 0;
+            index_ -= (idx_[i] - 1) * stride_[i];
+            idx_[i] = 0;
         }
+        end_ = true;
     }
 
     DSC_INLINE int index() const noexcept {
         return index_;
     }
 
+    DSC_INLINE bool has_next() const noexcept {
+        return !end_;
+    }
+
 private:
     int index_ = 0;
-    const int *x_shape_, *x_stride_, *out_shape_;
-    int x_broadcast_stride_[DSC_MAX_DIMS]{}, x_idx_[DSC_MAX_DIMS]{};
+    int idx_[DSC_MAX_DIMS]{};
+    const int *shape_;
+    const int *stride_;
+    int axis_;
+    bool end_ = false;
 };
 
-// Todo: unify the stride iterator with the broadcast iterator?
-struct dsc_stride_iterator {
-    dsc_stride_iterator(const int *shape, const int *stride) noexcept :
-            shape_(shape), stride_(stride) {
+// Iterate over N operands that share the same shape, each one with its own strides (0 along the dimensions
+// where it's broadcast). Adjacent dimensions that are contiguous for all the operands are merged and the innermost
+// one is never iterated: next() moves from one run of run() elements to the next, within a run the elements
+// of operand k are at index(k) + j * stride(k). If strides[k] is nullptr operand k is contiguous over shape.
+// Iteration can begin from any element (in row-major order), in that case the first run is shorter.
+template<int N>
+struct dsc_nd_iterator {
+    dsc_nd_iterator(const int *shape, const int *const *strides, int start = 0) noexcept {
+        int contiguous[DSC_MAX_DIMS];
+        for (int i = DSC_MAX_DIMS - 1, s = 1; i >= 0; --i) {
+            contiguous[i] = s;
+            s *= shape[i];
+        }
+
+        for (int i = 0; i < DSC_MAX_DIMS; ++i) {
+            if (shape[i] == 1) continue;
+            end_ |= shape[i] == 0;
+
+            // Dimension i can be merged into the previous one if, for every operand, moving one step
+            // along the previous dimension is the same as moving shape[i] steps along i
+            bool merge = n_dim_ > 0;
+            for (int k = 0; k < N && merge; ++k) {
+                const int *x_stride = strides[k] == nullptr ? contiguous : strides[k];
+                merge = stride_[k][n_dim_ - 1] == x_stride[i] * shape[i];
+            }
+
+            if (!merge) shape_[n_dim_++] = 1;
+            shape_[n_dim_ - 1] *= shape[i];
+            for (int k = 0; k < N; ++k)
+                stride_[k][n_dim_ - 1] = (strides[k] == nullptr ? contiguous : strides[k])[i];
+        }
+
+        if (n_dim_ == 0) {
+            // All the dimensions are 1: a single run of one element
+            shape_[0] = 1;
+            n_dim_ = 1;
+        }
+
+        for (int i = n_dim_ - 1; i >= 0 && !end_; --i) {
+            idx_[i] = start % shape_[i];
+            start /= shape_[i];
+            for (int k = 0; k < N; ++k) index_[k] += idx_[i] * stride_[k][i];
+        }
+        end_ |= start > 0;
     }
 
     DSC_INLINE void next() noexcept {
-        for (int i = DSC_MAX_DIMS - 1; i >= 0; --i) {
-            if (++x_idx_[i] < shape_[i]) [[likely]] {
-                index_ += stride_[i];
+        const int inner = n_dim_ - 1;
+        if (idx_[inner] != 0) [[unlikely]] {
+            // Back to the beginning of the run
+            for (int k = 0; k < N; ++k) index_[k] -= idx_[inner] * stride_[k][inner];
+            idx_[inner] = 0;
+        }
+
+        for (int i = n_dim_ - 2; i >= 0; --i) {
+            if (++idx_[i] < shape_[i]) [[likely]] {
+                for (int k = 0; k < N; ++k) index_[k] += stride_[k][i];
                 return;
             }
             // Rollover this dimension
-            index_ -= (x_idx_[i] - 1) * stride_[i];
-            x_idx_[i] = 0;
+            for (int k = 0; k < N; ++k) index_[k] -= (idx_[i] - 1) * stride_[k][i];
+            idx_[i] = 0;
         }
+        end_ = true;
     }
 
-    DSC_INLINE int index() const noexcept {
-        return index_;
+    DSC_INLINE bool has_next() const noexcept {
+        return !end_;
+    }
+
+    DSC_INLINE int index(const int k) const noexcept {
+        return index_[k];
+    }
+
+    DSC_INLINE int stride(const int k) const noexcept {
+        return stride_[k][n_dim_ - 1];
+    }
+
+    DSC_INLINE int run() const noexcept {
+        return shape_[n_dim_ - 1] - idx_[n_dim_ - 1];
     }
 
 private:
-    int index_ = 0;
-    const int *shape_, *stride_;
-    int x_idx_[DSC_MAX_DIMS]{};
+    int index_[N]{};
+    int idx_[DSC_MAX_DIMS]{};
+    int shape_[DSC_MAX_DIMS]{};
+    int stride_[N][DSC_MAX_DIMS]{};
+    int n_dim_ = 0;
+    bool end_ = false;
 };
 
+// Strides of x when broadcast to out_shape: 0 along the dimensions where x has size 1
+static DSC_INLINE void dsc_broadcast_strides(const dsc_tensor *x, const int *out_shape, int *strides) noexcept {
+    for (int i = 0; i < DSC_MAX_DIMS; ++i) {
+        strides[i] = x->shape[i] < out_shape[i] ? 0 : x->stride[i];
+    }
+}
+
 struct dsc_slice_iterator {
     dsc_slice_iterator(const dsc_tensor *x, const int n_slices, const dsc_slice *slices) noexcept :
             shape_(x->shape), stride_(x->stride), n_dim_(x->n_dim) {
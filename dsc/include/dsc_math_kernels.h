@@ -0,0 +1,305 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+// Vectorized elementary functions written in terms of the real vector operations of dsc_elementwise.cpp.
+// This file is included by dsc_elementwise_kernels.h so, like it, once for each instruction set and without
+// include guard.
+//
+// The usual range reduction + polynomial approach is used (see Cephes and fdlibm): the polynomials are
+// truncated Taylor series, except for sin and cos that use the Cephes minimax coefficients.
+// Max error measured on 2M random inputs per range against libm in long double, the SSE2 kernels (no FMA)
+// and the AVX2/AVX-512 ones differ by less than 0.2 ULP:
+//
+//                          f32         f64
+//  exp                     1.1 ULP     1.0 ULP
+//  logn                    0.9 ULP     1.2 ULP
+//  log2                    1.9 ULP     1.9 ULP
+//  log10                   2.2 ULP     1.9 ULP
+//  sin/cos |x| <= 4        1.5 ULP     1.5 ULP
+//  sin/cos up to limit     2.4 ULP     2.4 ULP     sincos_limit is 8192 for f32 and 1e5 for f64, the kernels
+//                                                  use libm for the vectors with larger inputs
+//
+// sinc and the complex functions are built on top of these with the same formulas as dsc_ops.h so they
+// inherit the same (small) differences from libm. exp also covers subnormal results and the logarithms
+// subnormal inputs, special values (NaN, +-inf, 0, negative logarithms) are the same as libm.
+
+template<typename R>
+struct math_consts;
+
+template<>
+struct math_consts<f32> {
+    using bits = u32;
+    static constexpr int mantissa_bits = 23;
+    static constexpr int exponent_bias = 127;
+    static constexpr bits sign_mask = 0x80000000U;
+    static constexpr bits mantissa_mask = 0x007FFFFFU;
+    static constexpr f32 min_normal = 1.17549435e-38f;
+    static constexpr f32 sqrt2 = 1.41421356237309504880f;
+    static constexpr f32 log2e = 1.44269504088896340736f, log10e = 0.434294481903251827651f;
+    static constexpr f32 log10_2 = 0.301029995663981195214f;
+    // Scale applied to subnormal inputs of log
+    static constexpr int subnormal_shift = 25;
+    // Beyond these limits exp is 0 or +inf, clamping keeps the exponents in range
+    static constexpr f32 exp_lo = -104.f, exp_hi = 89.f;
+    static constexpr f32 sincos_limit = 8192.f;
+    static constexpr f32 ln2_hi = 0.693359375f, ln2_lo = -2.12194440e-4f;
+    // pi/2 = pio2_1 + pio2_2 + pio2_3 + pio2_4, the first three have few enough bits for q * pio2_x to be exact
+    static constexpr f32 pio2_1 = 1.5703125f, pio2_2 = 4.837512969970703125e-4f, pio2_3 = 7.549533620476723e-8f,
+            pio2_4 = 2.5633440682570896e-12f;
+    // Taylor series of exp(r) - 1 - r and of (log(1 + f) - 2s) / s with s = f / (2 + f), highest degree first
+    static constexpr f32 exp_poly[] = {
+            1.f / 5040.f, 1.f / 720.f, 1.f / 120.f, 1.f / 24.f, 1.f / 6.f, 0.5f,
+    };
+    static constexpr f32 log_poly[] = {
+            2.f / 9.f, 2.f / 7.f, 2.f / 5.f, 2.f / 3.f,
+    };
+    // Minimax polynomials for sin(r) = r + r^3 * P(r^2) and cos(r) = 1 - r^2 / 2 + r^4 * Q(r^2) in [-pi/4, pi/4]
+    static constexpr f32 sin_poly[] = {
+            -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f,
+    };
+    static constexpr f32 cos_poly[] = {
+            2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f,
+    };
+    // Taylor series of (sinh(x) - x) / x^3 for |x| < 1
+    static constexpr f32 sinh_poly[] = {
+            1.f / 6227020800.f, 1.f / 39916800.f, 1.f / 362880.f, 1.f / 5040.f, 1.f / 120.f, 1.f / 6.f,
+    };
+};
+
+template<>
+struct math_consts<f64> {
+    using bits = u64;
+    static constexpr int mantissa_bits = 52;
+    static constexpr int exponent_bias = 1023;
+    static constexpr bits sign_mask = 0x8000000000000000ULL;
+    static constexpr bits mantissa_mask = 0x000FFFFFFFFFFFFFULL;
+    static constexpr f64 min_normal = 2.2250738585072014e-308;
+    static constexpr f64 sqrt2 = 1.41421356237309504880;
+    static constexpr f64 log2e = 1.44269504088896340736, log10e = 0.434294481903251827651;
+    static constexpr f64 log10_2 = 0.301029995663981195214;
+    static constexpr int subnormal_shift = 54;
+    static constexpr f64 exp_lo = -746., exp_hi = 710.;
+    static constexpr f64 sincos_limit = 1e5;
+    static constexpr f64 ln2_hi = 6.93147180369123816490e-01, ln2_lo = 1.90821492927058770002e-10;
+    static constexpr f64 pio2_1 = 1.57079632673412561417e+00, pio2_2 = 6.07710050630396597660e-11,
+            pio2_3 = 2.02226624871116645580e-21, pio2_4 = 8.47842766036889956997e-32;
+    static constexpr f64 exp_poly[] = {
+            1. / 6227020800., 1. / 479001600., 1. / 39916800., 1. / 3628800., 1. / 362880., 1. / 40320.,
+            1. / 5040., 1. / 720., 1. / 120., 1. / 24., 1. / 6., 0.5,
+    };
+    static constexpr f64 log_poly[] = {
+            2. / 19., 2. / 17., 2. / 15., 2. / 13., 2. / 11., 2. / 9., 2. / 7., 2. / 5., 2. / 3.,
+    };
+    static constexpr f64 sin_poly[] = {
+            1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+            -1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1,
+    };
+    static constexpr f64 cos_poly[] = {
+            -1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+            2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2,
+    };
+    static constexpr f64 sinh_poly[] = {
+            1. / 355687428096000., 1. / 1307674368000., 1. / 6227020800., 1. / 39916800., 1. / 362880.,
+            1. / 5040., 1. / 120., 1. / 6.,
+    };
+};
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec set_bits(const typename math_consts<R>::bits x) noexcept {
+    return ops<R>::set1(std::bit_cast<R>(x));
+}
+
+template<typename R, int N>
+DSC_INLINE typename ops<R>::vec horner(const typename ops<R>::vec x, const R (&coeffs)[N]) noexcept {
+    using O = ops<R>;
+
+    typename O::vec y = O::set1(coeffs[0]);
+    for (int i = 1; i < N; ++i) {
+        y = O::fma(y, x, O::set1(coeffs[i]));
+    }
+    return y;
+}
+
+// Adding and subtracting 1.5 * 2^mantissa_bits rounds x to the nearest integer (ties to even), |x| must be
+// less than 2^(mantissa_bits - 1). Before the subtraction the integer is in the low bits of the mantissa.
+template<typename R>
+static constexpr R round_magic = (R) 1.5 * (R) (1ULL << math_consts<R>::mantissa_bits);
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vround(const typename ops<R>::vec x) noexcept {
+    using O = ops<R>;
+
+    return O::sub(O::add(x, O::set1(round_magic<R>)), O::set1(round_magic<R>));
+}
+
+// x - round(x), in [-0.5, 0.5]
+template<typename R>
+DSC_INLINE typename ops<R>::vec vfrac(const typename ops<R>::vec x) noexcept {
+    return ops<R>::sub(x, vround<R>(x));
+}
+
+// 2^k for an integer k that is a valid exponent for R
+template<typename R>
+DSC_INLINE typename ops<R>::vec pow2i(const typename ops<R>::vec k) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+
+    // The low bits of the mantissa of k + magic + bias are the biased exponent, shift them in place
+    return O::shl(O::add(k, O::set1(round_magic<R> + (R) C::exponent_bias)), C::mantissa_bits);
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vabs(const typename ops<R>::vec x) noexcept {
+    return ops<R>::bit_and(x, set_bits<R>(~math_consts<R>::sign_mask));
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vexp(typename ops<R>::vec x) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+    using vec = typename O::vec;
+
+    // min and max return the second operand if one is NaN so NaNs are preserved
+    x = O::min(O::set1(C::exp_hi), O::max(O::set1(C::exp_lo), x));
+
+    // exp(x) = 2^n * exp(r) with |r| <= ln(2) / 2
+    const vec n = vround<R>(O::mul(x, O::set1(C::log2e)));
+    vec r = O::fma(n, O::set1(-C::ln2_hi), x);
+    r = O::fma(n, O::set1(-C::ln2_lo), r);
+
+    const vec p = O::add(O::fma(O::mul(r, r), horner<R>(r, C::exp_poly), r), O::set1(1));
+
+    // 2^n is not representable at the ends of the range, split it in two factors so that
+    // overflows and subnormal results are rounded only once, by the last multiplication
+    const vec n1 = vround<R>(O::mul(n, O::set1(0.5)));
+    const vec n2 = O::sub(n, n1);
+    return O::mul(O::mul(p, pow2i<R>(n1)), pow2i<R>(n2));
+}
+
+// Compute x = 2^e * (1 + f) with 1 + f in [sqrt(2)/2, sqrt(2)) and return log(1 + f)
+template<typename R>
+DSC_INLINE typename ops<R>::vec vlog_reduce(typename ops<R>::vec x, typename ops<R>::vec &e) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+    using vec = typename O::vec;
+
+    // Subnormals are scaled to normal numbers first
+    const auto subnormal = O::lt(x, O::set1(C::min_normal));
+    x = O::select(subnormal, O::mul(x, O::set1((R) (1ULL << C::subnormal_shift))), x);
+
+    // The biased exponent is moved to the low bits of the mantissa of 2^mantissa_bits
+    constexpr R two_m = (R) (1ULL << C::mantissa_bits);
+    e = O::sub(O::bit_or(O::shr(x, C::mantissa_bits), O::set1(two_m)), O::set1(two_m + (R) C::exponent_bias));
+    e = O::sub(e, O::select(subnormal, O::set1((R) C::subnormal_shift), O::set1(0)));
+
+    vec m = O::bit_or(O::bit_and(x, set_bits<R>(C::mantissa_mask)), O::set1(1));
+    const auto big = O::lt(O::set1(C::sqrt2), m);
+    m = O::select(big, O::mul(m, O::set1(0.5)), m);
+    e = O::add(e, O::select(big, O::set1(1), O::set1(0)));
+
+    // log(1 + f) = f - (f^2 / 2 - s * (f^2 / 2 + R(s^2))), see fdlibm e_log.c
+    const vec f = O::sub(m, O::set1(1));
+    const vec s = O::div(f, O::add(f, O::set1(2)));
+    const vec z = O::mul(s, s);
+    const vec hfsq = O::mul(O::set1(0.5), O::mul(f, f));
+    const vec r = O::mul(z, horner<R>(z, C::log_poly));
+    return O::sub(f, O::sub(hfsq, O::mul(s, O::add(hfsq, r))));
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vlog_special(const typename ops<R>::vec x, typename ops<R>::vec y) noexcept {
+    using O = ops<R>;
+
+    // NaNs propagate, infinity becomes NaN here but is fixed right after
+    y = O::add(y, O::sub(x, x));
+    y = O::select(O::lt(x, O::set1(0)), O::set1(std::numeric_limits<R>::quiet_NaN()), y);
+    y = O::select(O::eq(x, O::set1(0)), O::set1(-dsc_inf<R>()), y);
+    return O::select(O::eq(x, O::set1(dsc_inf<R>())), O::set1(dsc_inf<R>()), y);
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vlogn(const typename ops<R>::vec x) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+
+    typename O::vec e;
+    const typename O::vec log_m = vlog_reduce<R>(x, e);
+    const typename O::vec y = O::fma(e, O::set1(C::ln2_hi), O::fma(e, O::set1(C::ln2_lo), log_m));
+    return vlog_special<R>(x, y);
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vlog2(const typename ops<R>::vec x) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+
+    typename O::vec e;
+    const typename O::vec log_m = vlog_reduce<R>(x, e);
+    return vlog_special<R>(x, O::fma(log_m, O::set1(C::log2e), e));
+}
+
+template<typename R>
+DSC_INLINE typename ops<R>::vec vlog10(const typename ops<R>::vec x) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+
+    typename O::vec e;
+    const typename O::vec log_m = vlog_reduce<R>(x, e);
+    const typename O::vec y = O::fma(e, O::set1(C::log10_2), O::mul(log_m, O::set1(C::log10e)));
+    return vlog_special<R>(x, y);
+}
+
+// True if sincos can't be used for some element of x
+template<typename R>
+DSC_INLINE bool sincos_out_of_range(const typename ops<R>::vec x) noexcept {
+    return ops<R>::any(ops<R>::lt(ops<R>::set1(math_consts<R>::sincos_limit), vabs<R>(x)));
+}
+
+// sin(x) and cos(x) for |x| <= sincos_limit
+template<typename R>
+DSC_INLINE void vsincos(const typename ops<R>::vec x, typename ops<R>::vec &s, typename ops<R>::vec &c) noexcept {
+    using O = ops<R>;
+    using C = math_consts<R>;
+    using vec = typename O::vec;
+
+    // x = q * pi/2 + r with |r| <= pi/4
+    const vec q = vround<R>(O::mul(x, O::set1(2 / dsc_pi<R>())));
+    vec r = O::fma(q, O::set1(-C::pio2_1), x);
+    r = O::fma(q, O::set1(-C::pio2_2), r);
+    r = O::fma(q, O::set1(-C::pio2_3), r);
+    r = O::fma(q, O::set1(-C::pio2_4), r);
+
+    const vec z = O::mul(r, r);
+    const vec sin_r = O::fma(O::mul(r, z), horner<R>(z, C::sin_poly), r);
+    const vec cos_r = O::add(O::fma(O::mul(z, z), horner<R>(z, C::cos_poly), O::mul(z, O::set1(-0.5))), O::set1(1));
+
+    // With k = q mod 4: sin(x) = [sin(r), cos(r), -sin(r), -cos(r)][k] and cos(x) = [cos(r), -sin(r), -cos(r), sin(r)][k].
+    // The quadrant is found with frac so the sign of the result is the sign of frac and no integer operation
+    // is needed: frac((q + 0.5) / 2) < 0 if k is odd, frac((q + 0.5) / 4) < 0 if k is 2 or 3 and
+    // frac((q + 1.5) / 4) < 0 if k is 1 or 2.
+    const vec half = O::set1(0.5), quarter = O::set1(0.25);
+    const auto odd = O::lt(vfrac<R>(O::mul(O::add(q, half), half)), O::set1(0));
+    const vec sin_sign = O::bit_and(vfrac<R>(O::mul(O::add(q, half), quarter)), set_bits<R>(C::sign_mask));
+    const vec cos_sign = O::bit_and(vfrac<R>(O::mul(O::add(q, O::set1(1.5)), quarter)), set_bits<R>(C::sign_mask));
+
+    s = O::bit_xor(O::select(odd, cos_r, sin_r), sin_sign);
+    c = O::bit_xor(O::select(odd, sin_r, cos_r), cos_sign);
+}
+
+template<typename R>
+DSC_INLINE void vsinhcosh(const typename ops<R>::vec x, typename ops<R>::vec &sh, typename ops<R>::vec &ch) noexcept {
+    using O = ops<R>;
+    using vec = typename O::vec;
+
+    const vec half = O::set1(0.5);
+    const vec e = vexp<R>(x);
+    const vec e_inv = O::div(O::set1(1), e);
+    ch = O::mul(half, O::add(e, e_inv));
+
+    // e - 1/e cancels for small x, use the series instead
+    const vec small = O::fma(O::mul(x, O::mul(x, x)), horner<R>(O::mul(x, x), math_consts<R>::sinh_poly), x);
+    sh = O::select(O::lt(vabs<R>(x), O::set1(1)), small, O::mul(half, O::sub(e, e_inv)));
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#pragma once
+
+#include "dsc.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#   define DSC_SIMD_X86
+#endif
+
+// Instruction sets for which we have hand-written kernels, ordered from the least to the most capable.
+// The kernels are always compiled, the best one supported by the CPU is selected at runtime so
+// the library doesn't need to be built with -march=native.
+enum dsc_simd_isa : u8 {
+    SCALAR,
+    SSE2,
+    // AVX2 + FMA
+    AVX2,
+    // AVX-512 Foundation
+    AVX512,
+};
+
+static constexpr const char *DSC_SIMD_ISA_NAMES[4] = {
+        "scalar",
+        "SSE2",
+        "AVX2",
+        "AVX512"
+};
+
+static DSC_INLINE dsc_simd_isa dsc_simd_detect() noexcept {
+#if defined(DSC_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return AVX2;
+    if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+    return SCALAR;
+}
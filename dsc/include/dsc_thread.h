@@ -0,0 +1,76 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#pragma once
+
+#include "dsc.h"
+#include <atomic>
+#include <type_traits>
+
+struct dsc_thread_pool;
+
+// Function executed by each worker of a parallel job. worker is in [0, n_workers) and
+// worker 0 is always the thread that submitted the job.
+using dsc_thread_fn = void (*)(void *args, int worker, int n_workers) noexcept;
+
+// ============================================================
+// Thread Pool
+
+// Create a pool that can run jobs on up to n_threads threads, including the caller.
+// The pool spawns n_threads - 1 threads that sleep until a new job is submitted.
+extern dsc_thread_pool *dsc_thread_pool_init(int n_threads) noexcept;
+
+extern void dsc_thread_pool_free(dsc_thread_pool *pool) noexcept;
+
+extern int dsc_thread_pool_size(const dsc_thread_pool *pool) noexcept;
+
+// Run fn on n_workers threads and wait for all of them to finish. n_workers must be
+// less or equal than the size of the pool. Jobs must not be submitted concurrently, a job
+// submitted by a worker of a running job is executed by that worker alone (n_workers = 1).
+extern void dsc_thread_pool_run(dsc_thread_pool *pool, int n_workers,
+                                dsc_thread_fn fn, void *args) noexcept;
+
+// ============================================================
+// Utilities
+
+// Number of CPUs currently available
+extern int dsc_cpu_count() noexcept;
+
+// Run fn(worker, n_workers) in parallel, fn can be any callable (eg. a lambda that captures by reference).
+template<typename F>
+static DSC_INLINE void dsc_parallel(dsc_thread_pool *pool, const int n_workers, F &&fn) noexcept {
+    using Fn = std::remove_reference_t<F>;
+    if (pool == nullptr || n_workers <= 1) {
+        fn(0, 1);
+        return;
+    }
+
+    dsc_thread_pool_run(pool, n_workers, [](void *args, const int worker, const int n) noexcept {
+        (*(Fn *) args)(worker, n);
+    }, (void *) &fn);
+}
+
+// Split [0, n) in chunks of chunk elements and run fn(start, stop) for each of them on up to n_workers threads.
+// The chunks are not assigned upfront: each worker claims the next one from a shared counter as soon as it's
+// done with the previous, so a worker that is slowed down (eg. by another process) doesn't stall the others.
+template<typename F>
+static DSC_INLINE void dsc_parallel_for(dsc_thread_pool *pool, const int n_workers,
+                                        const int n, const int chunk, F &&fn) noexcept {
+    const int n_chunks = (n + chunk - 1) / chunk;
+    if (pool == nullptr || n_workers <= 1 || n_chunks <= 1) {
+        if (n > 0) fn(0, n);
+        return;
+    }
+
+    std::atomic<int> next_chunk{0};
+    dsc_parallel(pool, DSC_MIN(n_workers, n_chunks), [&](const int, const int) noexcept {
+        for (int c = next_chunk.fetch_add(1, std::memory_order_relaxed); c < n_chunks;
+             c = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+            const int start = c * chunk;
+            fn(start, DSC_MIN(start + chunk, n));
+        }
+    });
+}
@@ -16,6 +16,8 @@
 
 #define DSC_TRACE_NAME_MAX  ((int) 32)
 #define DSC_TRACE_CAT_MAX   ((int) 16)
+// Must be the same as DSC_FFT_MAX_FACTORS
+#define DSC_TRACE_MAX_FACTORS   ((int) 32)
 
 #define DSC_INSERT_TYPED_TRACE(T, cat_, type_) \
     dsc_trace_tracker<T> trace__{__FUNCTION__, (cat_), (type_), &args__}
@@ -93,6 +95,20 @@
     dsc_plan_fft_args args__{(n_), (fft_n_), (fft_type_), (dtype_)};    \
     DSC_INSERT_TYPED_TRACE(dsc_plan_fft_args, "op;fft;plan", DSC_PLAN_FFT)
 
+#define DSC_TRACE_PLAN_MEASURE(n_, fft_type_, dtype_, lines_, algorithm_, isa_, factors_, n_factors_, ns_, selected_)  \
+    dsc_plan_measure_args args__{};     \
+    args__.n = (n_);                    \
+    args__.lines = (lines_);            \
+    memcpy(args__.factors, (factors_), (n_factors_) * sizeof(*(factors_)));   \
+    args__.n_factors = (n_factors_);    \
+    args__.ns = (ns_);                  \
+    args__.type = (fft_type_);          \
+    args__.dtype = (dtype_);            \
+    args__.algorithm = (algorithm_);    \
+    args__.isa = (isa_);                \
+    args__.selected = (selected_);      \
+    DSC_INSERT_TYPED_TRACE(dsc_plan_measure_args, "op;fft;plan", DSC_PLAN_FFT_MEASURE)
+
 #define DSC_TRACE_GET_IDX(X, indexes_, n_indexes_)  \
     dsc_get_idx_args args__{};                      \
     DSC_TRACE_SET_TENSOR(X, x);                     \
@@ -171,6 +187,7 @@ enum dsc_trace_type : u8 {
     DSC_BINARY_OP,
     DSC_FFT_OP,
     DSC_PLAN_FFT,
+    DSC_PLAN_FFT_MEASURE,
     DSC_GET_IDX,
     DSC_GET_SLICE,
     DSC_SET_IDX,
@@ -228,6 +245,21 @@ struct dsc_plan_fft_args {
     dsc_dtype dtype;
 };
 
+// One row of the timing table of DSC_PLAN_MEASURE
+struct dsc_plan_measure_args {
+    int n, lines;
+    // Radix of each Stockham pass, n_factors is 0 for the other algorithms
+    int factors[DSC_TRACE_MAX_FACTORS];
+    int n_factors;
+    // Time of a forward plus a backward transform of a single line
+    f64 ns;
+    dsc_fft_type type;
+    dsc_dtype dtype;
+    // dsc_fft_algorithm and dsc_simd_isa
+    u8 algorithm, isa;
+    bool selected;
+};
+
 struct dsc_get_idx_args {
     dsc_tensor_args x;
     int indexes[DSC_MAX_DIMS];
@@ -294,6 +326,7 @@ struct dsc_trace {
         dsc_tensor_alloc_args tensor_alloc;
         dsc_fft_args fft;
         dsc_plan_fft_args plan_fft;
+        dsc_plan_measure_args plan_measure;
         dsc_unary_args unary;
         dsc_unary_no_out_args unary_no_out;
         dsc_unary_axis_args unary_axis;
@@ -380,6 +413,9 @@ private:
         } else if constexpr (dsc_is_type<T, dsc_plan_fft_args>()) {
             const dsc_plan_fft_args *args = (const dsc_plan_fft_args *) data_;
             memcpy(&t->plan_fft, args, sizeof(*args));
+        } else if constexpr (dsc_is_type<T, dsc_plan_measure_args>()) {
+            const dsc_plan_measure_args *args = (const dsc_plan_measure_args *) data_;
+            memcpy(&t->plan_measure, args, sizeof(*args));
         } else if constexpr (dsc_is_type<T, dsc_fft_args>()) {
             const dsc_fft_args *args = (const dsc_fft_args *) data_;
             memcpy(&t->fft, args, sizeof(*args));
@@ -435,6 +471,7 @@ private:
 #define DSC_TRACE_UNARY_AXIS_OP(X, OUT, axis_, keep_dims_)      ((void) 0)
 #define DSC_TRACE_FFT_OP(X, OUT, n_, axis_, type_, fwd_)        ((void) 0)
 #define DSC_TRACE_PLAN_FFT(n_, fft_n_, fft_type_, dtype_)       ((void) 0)
+#define DSC_TRACE_PLAN_MEASURE(n_, fft_type_, dtype_, lines_, algorithm_, isa_, factors_, n_factors_, ns_, selected_)  ((void) 0)
 #define DSC_TRACE_GET_IDX(X, indexes_, n_indexes_)              ((void) 0)
 #define DSC_TRACE_GET_SLICE(X, slices_, n_slices_)              ((void) 0)
 #define DSC_TRACE_SET_IDX(XA, XB, indexes_, n_indexes_)         ((void) 0)
@@ -7,26 +7,49 @@
 #include "dsc.h"
 #include "dsc_ops.h"
 #include "dsc_fft.h"
+#include "dsc_elementwise.h"
 #include "dsc_iter.h"
+#include "dsc_thread.h"
 #include "dsc_backend.h"
 #include "dsc_allocator.h"
 #include "dsc_tracing.h"
 #include <cstring>
 #include <random>
 #include <cstdarg>      // va_xxx
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
 
-// How many independent FFT plans we support. This is completely arbitrary
+// Default number of FFT plans that can be cached, it can be changed when creating the context.
+// This is completely arbitrary
 #if !defined(DSC_MAX_FFT_PLANS)
 #   define DSC_MAX_FFT_PLANS ((int) 16)
 #endif
 
+// Number of chirp-z plans cached by a context, see dsc_czt
+#if !defined(DSC_MAX_CZT_PLANS)
+#   define DSC_MAX_CZT_PLANS ((int) 8)
+#endif
+
 // Max number of traces that can be recorded. Changing this will result in more memory
 // allocated during context initialization.
 #if !defined(DSC_MAX_TRACES)
 #   define DSC_MAX_TRACES ((u64) 1'000)
 #endif
 
-#define DSC_SIMD_ALIGN ((int) 32)
+// Alignment of the data of a tensor, this is also the size of a cache line so when an operation is split
+// in chunks that are a multiple of it the threads never write to the same line
+#define DSC_SIMD_ALIGN ((int) 64)
+
+// Min number of elements each thread of an elementwise, copy or reduction operation should process,
+// below this waking up more threads costs more than it saves
+#define DSC_MIN_WORK_PER_THREAD ((int) 1 << 16)
+// Size of the chunks of elements the workers of these operations claim one at a time
+#define DSC_PARALLEL_CHUNK_BYTES DSC_KB(64)
+// Size of the per-thread buffer of each value of a fused expression, small enough that all of them
+// stay in L1/L2 while the expression is computed one tile at a time
+#define DSC_FUSED_TILE_BYTES DSC_KB(2)
 
 #define DSC_CTX_PUSH(CTX) \
     (CTX)->default_allocator = (CTX)->scratch_allocator;    \
@@ -137,20 +160,84 @@ struct dsc_tensor_buffer {
     int refs;
 };
 
+// LRU cache of FFT plans. The plans are stored in a hash table with chaining, keyed by
+// (N, FFT type, twiddles dtype), and in a doubly linked list ordered from the most to the
+// least recently used plan so both the lookup and the eviction are O(1).
+struct dsc_fft_cache {
+    // The number of buckets is a power of 2 greater or equal than the capacity
+    dsc_fft_plan **buckets;
+    dsc_fft_plan *lru_head, *lru_tail;
+    int n_buckets, capacity, size;
+    u64 hits, misses, evictions;
+};
+
+// Twiddles shared by all the plans of a context. The twiddles of a Stockham pass only depend on
+// its radix and on the order of its sub-transforms so, for example, the plan of order N uses all
+// but the first pass of the plan of order 8N and the RFFT of order 2N uses the same passes as the
+// FFT of order N. Each set is reference counted by the plans that use it and is freed when the
+// last of them is evicted.
+struct dsc_twiddle_set {
+    dsc_twiddle_set *next;
+    void *data;
+    usize bytes;
+    int a, b;
+    int refs;
+    dsc_twiddle_kind kind;
+    dsc_dtype dtype;
+    // Sets imported from a wisdom file point directly to the mapping, they are never freed
+    bool external;
+};
+
+struct dsc_twiddle_pool {
+    dsc_twiddle_set **buckets;
+    int n_buckets, n_sets;
+    usize bytes;
+};
+
+// Wisdom file mapped in memory, it must stay mapped as long as the context is alive
+// because the imported twiddles are used directly from the mapping
+struct dsc_wisdom_map {
+    void *addr;
+    usize size;
+    dsc_wisdom_map *next;
+};
+
+// Chirp-z plans ordered from the most to the least recently used
+struct dsc_czt_plan;
+
+struct dsc_czt_cache {
+    dsc_czt_plan *head;
+    int size;
+};
+
+static void dsc_czt_cache_clear(dsc_ctx *ctx) noexcept;
+
 struct dsc_ctx {
     dsc_backend *default_backend;
     dsc_buffer *main_buf, *scratch_buf;
     dsc_allocator *main_allocator, *scratch_allocator, *default_allocator;
-    dsc_fft_plan *fft_plans[DSC_MAX_FFT_PLANS];
+    dsc_fft_cache fft_cache;
+    dsc_twiddle_pool twiddle_pool;
+    dsc_czt_cache czt_cache;
+    dsc_wisdom_map *wisdom;
+    // Only created if the context uses more than one thread
+    dsc_thread_pool *thread_pool;
+    int n_threads;
+    dsc_math_precision math_precision;
 };
 
 // ============================================================
 // Initialization
 
-dsc_ctx *dsc_ctx_init(const usize main_mem, const usize scratch_mem) noexcept {
+dsc_ctx *dsc_ctx_init(const usize main_mem, const usize scratch_mem,
+                      int max_fft_plans, const int n_threads) noexcept {
     DSC_ASSERT(main_mem > 0);
     DSC_ASSERT(scratch_mem > 0);
 
+    if (max_fft_plans <= 0) max_fft_plans = DSC_MAX_FFT_PLANS;
+    // The plans used by an N-dimensional FFT must all be in the cache at the same time
+    DSC_ASSERT(max_fft_plans >= DSC_MAX_DIMS);
+
     dsc_ctx *ctx = (dsc_ctx *) calloc(1, sizeof(dsc_ctx));
     DSC_ASSERT(ctx != nullptr);
 
@@ -169,6 +256,22 @@ dsc_ctx *dsc_ctx_init(const usize main_mem, const usize scratch_mem) noexcept {
     ctx->scratch_allocator = dsc_linear_allocator(ctx->scratch_buf);
     ctx->default_allocator = ctx->main_allocator;
 
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    cache->capacity = max_fft_plans;
+    cache->n_buckets = 1;
+    while (cache->n_buckets < max_fft_plans) cache->n_buckets <<= 1;
+    cache->buckets = (dsc_fft_plan **) calloc(cache->n_buckets, sizeof(dsc_fft_plan *));
+    DSC_ASSERT(cache->buckets != nullptr);
+
+    // Each plan uses a few sets of twiddles but most of them are shared
+    dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+    pool->n_buckets = cache->n_buckets << 2;
+    pool->buckets = (dsc_twiddle_set **) calloc(pool->n_buckets, sizeof(dsc_twiddle_set *));
+    DSC_ASSERT(pool->buckets != nullptr);
+
+    ctx->n_threads = 1;
+    dsc_set_threads(ctx, n_threads);
+
     DSC_LOG_INFO("created new context %p with %ldMB for main and %ldMB for scratch memory on %s",
                  (void *) ctx,
                  (usize) DSC_B_TO_MB(ctx->main_buf->size),
@@ -179,9 +282,489 @@ dsc_ctx *dsc_ctx_init(const usize main_mem, const usize scratch_mem) noexcept {
     return ctx;
 }
 
+static DSC_INLINE DSC_STRICTLY_PURE int dsc_fft_cache_bucket(const dsc_fft_cache *cache, const int n,
+                                                             const dsc_fft_type fft_type,
+                                                             const dsc_dtype twd_dtype) noexcept {
+    // Fibonacci hashing of N mixed with the other fields of the key
+    const u32 key = (u32) n ^ ((u32) fft_type << 24) ^ ((u32) twd_dtype << 26);
+    return (int) ((key * 2654435769U) >> 7) & (cache->n_buckets - 1);
+}
+
+static DSC_INLINE void dsc_fft_cache_lru_unlink(dsc_fft_cache *cache, dsc_fft_plan *plan) noexcept {
+    if (plan->lru_prev != nullptr) plan->lru_prev->lru_next = plan->lru_next;
+    else cache->lru_head = plan->lru_next;
+
+    if (plan->lru_next != nullptr) plan->lru_next->lru_prev = plan->lru_prev;
+    else cache->lru_tail = plan->lru_prev;
+
+    plan->lru_prev = nullptr;
+    plan->lru_next = nullptr;
+}
+
+static DSC_INLINE void dsc_fft_cache_lru_push(dsc_fft_cache *cache, dsc_fft_plan *plan) noexcept {
+    plan->lru_prev = nullptr;
+    plan->lru_next = cache->lru_head;
+    if (cache->lru_head != nullptr) cache->lru_head->lru_prev = plan;
+    cache->lru_head = plan;
+    if (cache->lru_tail == nullptr) cache->lru_tail = plan;
+}
+
+// Look up a plan without updating the LRU list. There is at most one plan for each (N, type, dtype):
+// either the one chosen by the cost model or, if it was measured, the fastest one.
+static dsc_fft_plan *dsc_find_plan(const dsc_fft_cache *cache, const int n,
+                                   const dsc_fft_type fft_type,
+                                   const dsc_dtype twd_dtype) noexcept {
+    const int bucket = dsc_fft_cache_bucket(cache, n, fft_type, twd_dtype);
+
+    for (dsc_fft_plan *plan = cache->buckets[bucket]; plan != nullptr; plan = plan->hash_next) {
+        // Note: technically we could support complex FFTs of order N from real FFTs plans
+        // but not the other way around because we need an extra set of twiddles in the RFFT.
+        if (plan->n == n && plan->fft_type == fft_type && plan->dtype == twd_dtype) {
+            return plan;
+        }
+    }
+
+    return nullptr;
+}
+
 static dsc_fft_plan *dsc_get_plan(dsc_ctx *ctx, const int n,
                                   const dsc_fft_type fft_type,
-                                  const dsc_dtype dtype) noexcept {
+                                  const dsc_dtype twd_dtype) noexcept {
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    dsc_fft_plan *plan = dsc_find_plan(cache, n, fft_type, twd_dtype);
+
+    // Move the plan to the front of the LRU list
+    if (plan != nullptr && cache->lru_head != plan) {
+        dsc_fft_cache_lru_unlink(cache, plan);
+        dsc_fft_cache_lru_push(cache, plan);
+    }
+
+    return plan;
+}
+
+static DSC_INLINE DSC_STRICTLY_PURE int dsc_twiddle_pool_bucket(const dsc_twiddle_pool *pool,
+                                                                const dsc_twiddle_kind kind,
+                                                                const dsc_dtype dtype,
+                                                                const int a, const int b) noexcept {
+    const u32 key = ((u32) a * 2654435769U) ^ ((u32) b * 2246822519U) ^
+                    ((u32) kind << 24) ^ ((u32) dtype << 28);
+    return (int) ((key * 2654435769U) >> 7) & (pool->n_buckets - 1);
+}
+
+static dsc_twiddle_set *dsc_twiddle_pool_find(dsc_twiddle_pool *pool,
+                                              const dsc_twiddle_kind kind,
+                                              const dsc_dtype dtype,
+                                              const int a, const int b) noexcept {
+    const int bucket = dsc_twiddle_pool_bucket(pool, kind, dtype, a, b);
+    for (dsc_twiddle_set *set = pool->buckets[bucket]; set != nullptr; set = set->next) {
+        if (set->kind == kind && set->dtype == dtype && set->a == a && set->b == b) return set;
+    }
+    return nullptr;
+}
+
+static dsc_twiddle_set *dsc_twiddle_pool_add(dsc_ctx *ctx, const dsc_twiddle_kind kind,
+                                             const dsc_dtype dtype, const int a, const int b,
+                                             const usize bytes, void *external_data) noexcept {
+    dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+    const bool external = external_data != nullptr;
+    // Owned sets keep the twiddles in the same allocation
+    dsc_twiddle_set *set = (dsc_twiddle_set *) dsc_obj_alloc(ctx->main_allocator,
+                                                             sizeof(dsc_twiddle_set) + (external ? 0 : bytes));
+    set->data = external ? external_data : (void *) (set + 1);
+    set->bytes = bytes;
+    set->a = a;
+    set->b = b;
+    set->refs = 0;
+    set->kind = kind;
+    set->dtype = dtype;
+    set->external = external;
+
+    const int bucket = dsc_twiddle_pool_bucket(pool, kind, dtype, a, b);
+    set->next = pool->buckets[bucket];
+    pool->buckets[bucket] = set;
+    pool->n_sets++;
+    pool->bytes += bytes;
+    return set;
+}
+
+static void dsc_twiddle_pool_release(dsc_ctx *ctx, const dsc_twiddle_kind kind,
+                                     const dsc_dtype dtype, const int a, const int b) noexcept {
+    dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+    dsc_twiddle_set *set = dsc_twiddle_pool_find(pool, kind, dtype, a, b);
+    DSC_ASSERT(set != nullptr && set->refs > 0);
+
+    set->refs--;
+    // External sets are kept so the plans can be created again for free
+    if (set->refs > 0 || set->external) return;
+
+    const int bucket = dsc_twiddle_pool_bucket(pool, kind, dtype, a, b);
+    dsc_twiddle_set **link = &pool->buckets[bucket];
+    while (*link != set) link = &(*link)->next;
+    *link = set->next;
+
+    pool->n_sets--;
+    pool->bytes -= set->bytes;
+    dsc_obj_free(ctx->main_allocator, set);
+}
+
+// Twiddle source used by the plans of a context: every set of twiddles comes from the pool
+struct dsc_twiddle_pool_source : dsc_twiddle_source {
+    dsc_ctx *ctx;
+};
+
+static void *dsc_twiddle_pool_get(dsc_twiddle_source *src, const dsc_twiddle_kind kind,
+                                  const dsc_dtype dtype, const int a, const int b,
+                                  const usize bytes, bool *fill) noexcept {
+    dsc_ctx *ctx = ((dsc_twiddle_pool_source *) src)->ctx;
+    dsc_twiddle_set *set = dsc_twiddle_pool_find(&ctx->twiddle_pool, kind, dtype, a, b);
+    *fill = set == nullptr;
+    if (set == nullptr) set = dsc_twiddle_pool_add(ctx, kind, dtype, a, b, bytes, nullptr);
+
+    DSC_ASSERT(set->bytes == bytes);
+    set->refs++;
+    return set->data;
+}
+
+// Release all the sets of twiddles used by the plan, this must mirror dsc_init_plan
+static void dsc_release_twiddles(dsc_ctx *ctx, const dsc_fft_plan *plan) noexcept {
+    int l1 = 1;
+    for (int f = 0; f < plan->n_factors; ++f) {
+        const int ip = plan->factors[f];
+        const int ido = plan->n / (l1 * ip);
+        dsc_twiddle_pool_release(ctx, PASS_TWIDDLES, plan->dtype, ip, ido);
+        l1 *= ip;
+    }
+    if (plan->algorithm == BLUESTEIN) {
+        dsc_twiddle_pool_release(ctx, CHIRP_TWIDDLES, plan->dtype, plan->n, 0);
+        dsc_release_twiddles(ctx, plan->sub_plan);
+    } else if (plan->algorithm == FOUR_STEP) {
+        dsc_twiddle_pool_release(ctx, FOUR_STEP_TWIDDLES, plan->dtype, plan->sub_plan->n, plan->row_plan->n);
+        dsc_release_twiddles(ctx, plan->sub_plan);
+        dsc_release_twiddles(ctx, plan->row_plan);
+    }
+    if (plan->fft_type == REAL) dsc_twiddle_pool_release(ctx, RFFT_TWIDDLES, plan->dtype, plan->n, 0);
+}
+
+static void dsc_free_plan(dsc_ctx *ctx, dsc_fft_plan *plan) noexcept {
+    dsc_release_twiddles(ctx, plan);
+    dsc_obj_free(ctx->main_allocator, plan);
+}
+
+// Remove a plan from the cache and free it
+static void dsc_remove_plan(dsc_ctx *ctx, dsc_fft_plan *plan) noexcept {
+    dsc_fft_cache *cache = &ctx->fft_cache;
+
+    const int bucket = dsc_fft_cache_bucket(cache, plan->n, plan->fft_type, plan->dtype);
+    dsc_fft_plan **link = &cache->buckets[bucket];
+    while (*link != plan) link = &(*link)->hash_next;
+    *link = plan->hash_next;
+
+    dsc_fft_cache_lru_unlink(cache, plan);
+
+    dsc_free_plan(ctx, plan);
+    cache->size--;
+}
+
+static void dsc_evict_plan(dsc_ctx *ctx) noexcept {
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    dsc_fft_plan *plan = cache->lru_tail;
+    DSC_ASSERT(plan != nullptr);
+
+    DSC_LOG_DEBUG("evicting %s plan with N=%d dtype=%s",
+                  plan->fft_type == REAL ? "RFFT" : "FFT",
+                  plan->n, DSC_DTYPE_NAMES[plan->dtype]);
+
+    dsc_remove_plan(ctx, plan);
+    cache->evictions++;
+}
+
+// Add a new plan to the cache, if the cache is full the least recently used plan is evicted
+static void dsc_insert_plan(dsc_ctx *ctx, dsc_fft_plan *plan) noexcept {
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    if (cache->size == cache->capacity) dsc_evict_plan(ctx);
+
+    const int bucket = dsc_fft_cache_bucket(cache, plan->n, plan->fft_type, plan->dtype);
+    plan->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = plan;
+    dsc_fft_cache_lru_push(cache, plan);
+    cache->size++;
+}
+
+// Create a plan that is not added to the cache, it must be released with dsc_free_plan
+static dsc_fft_plan *dsc_alloc_plan(dsc_ctx *ctx, const int n,
+                                    const dsc_fft_type fft_type,
+                                    const dsc_dtype twd_dtype,
+                                    const dsc_fft_algorithm algorithm,
+                                    const dsc_fft_tuning *tuning = nullptr) noexcept {
+    // Plans always live in the main memory, even if they are created while the scratch is in use.
+    // The twiddles are in the pool so only the sub-plans are stored with the plan.
+    const int sub_plans = algorithm == BLUESTEIN ? 1 : algorithm == FOUR_STEP ? 2 : 0;
+    const usize storage = sizeof(dsc_fft_plan) * (1 + sub_plans);
+    dsc_fft_plan *plan = (dsc_fft_plan *) dsc_obj_alloc(ctx->main_allocator, storage);
+
+    // Bluestein needs to compute an FFT to initialize the plan
+    void *init_work = nullptr;
+    if (algorithm == BLUESTEIN) {
+        init_work = dsc_obj_alloc(ctx->main_allocator,
+                                  dsc_fft_work_size(n, algorithm) * DSC_DTYPE_SIZE[C64]);
+    }
+
+    dsc_twiddle_pool_source src{};
+    src.get = dsc_twiddle_pool_get;
+    src.storage = (byte *) (plan + 1);
+    src.ctx = ctx;
+    dsc_init_plan(plan, n, twd_dtype, fft_type, algorithm, init_work, &src, tuning);
+
+    if (init_work != nullptr) dsc_obj_free(ctx->main_allocator, init_work);
+
+    DSC_LOG_DEBUG("allocated new %s plan with N=%d dtype=%s algorithm=%s kernels=%s",
+                  fft_type == REAL ? "RFFT" : "FFT",
+                  n, DSC_DTYPE_NAMES[twd_dtype],
+                  DSC_FFT_ALGORITHM_NAMES[algorithm],
+                  DSC_SIMD_ISA_NAMES[plan->kernels->isa]);
+
+    return plan;
+}
+
+static dsc_fft_plan *dsc_new_plan(dsc_ctx *ctx, const int n,
+                                  const dsc_fft_type fft_type,
+                                  const dsc_dtype twd_dtype,
+                                  const dsc_fft_algorithm algorithm,
+                                  const dsc_fft_tuning *tuning = nullptr) noexcept {
+    dsc_fft_plan *plan = dsc_alloc_plan(ctx, n, fft_type, twd_dtype, algorithm, tuning);
+    dsc_insert_plan(ctx, plan);
+    return plan;
+}
+
+// ============================================================
+// FFT Measuring Planner
+//
+// DSC_PLAN_MEASURE times the plans that can compute an FFT of order N and keeps the fastest. The search
+// is done in two steps to keep the number of candidates low: first the plan chosen by the cost model is
+// timed with the kernels of every instruction set supported by the CPU (e.g. AVX-512 is not always faster
+// than AVX2 on AMD CPUs), then the other radix orders and algorithms are timed with the fastest kernels.
+
+// Max number of candidates timed for a single plan
+#define DSC_FFT_MAX_CANDIDATES      ((int) 16)
+// Each candidate is timed DSC_FFT_MEASURE_TRIALS times, every trial repeats the transforms for
+// at least DSC_FFT_MEASURE_MIN_NS and the best trial is kept
+#define DSC_FFT_MEASURE_TRIALS      ((int) 3)
+#define DSC_FFT_MEASURE_MIN_NS      ((u64) 200'000)
+// Below this size a Stockham FFT fits in the cache so the four-step FFT is never timed
+#define DSC_FFT_MEASURE_FOUR_STEP_MIN_N ((int) 1 << 16)
+
+struct dsc_fft_candidate {
+    dsc_fft_algorithm algorithm;
+    dsc_fft_tuning tuning;
+    // Time of a forward plus a backward transform of a single line in ns
+    f64 ns;
+};
+
+static DSC_INLINE u64 dsc_time_ns() noexcept {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1'000'000'000ULL + (u64) ts.tv_nsec;
+}
+
+// Time plan on lines contiguous lines transformed the same way the FFT operations would, buff must have
+// space for lines * (plan->n + 1) elements and work for lines * dsc_fft_work_size(plan->n) elements.
+template<typename T>
+static f64 dsc_fft_time_plan(dsc_fft_plan *plan, const int lines,
+                             T *DSC_RESTRICT buff, T *DSC_RESTRICT work) noexcept {
+    const bool is_real = plan->fft_type == REAL;
+    const int line_n = is_real ? plan->n + 1 : plan->n;
+    const int batch = dsc_fft_batch_size(plan, lines, true);
+
+    // Each forward transform is followed by a backward transform so the values never grow
+    for (int i = 0; i < line_n * lines; ++i) buff[i] = dsc_complex(T, (real<T>) 1 / (real<T>) ((i % 97) + 1), 0);
+
+    const auto run = [&]() noexcept {
+        int l = 0;
+        for (; batch > 1 && l + batch <= lines; l += batch) {
+            T *DSC_RESTRICT x = &buff[l * line_n];
+            if (is_real) {
+                dsc_real_fft_batch<T, true>(plan, x, work, batch);
+                dsc_real_fft_batch<T, false>(plan, x, work, batch);
+            } else {
+                dsc_complex_fft_batch<T, true>(plan, x, work, batch);
+                dsc_complex_fft_batch<T, false>(plan, x, work, batch);
+            }
+        }
+        for (; l < lines; ++l) {
+            T *DSC_RESTRICT x = &buff[l * line_n];
+            if (is_real) {
+                dsc_real_fft<T, true>(plan, x, work);
+                dsc_real_fft<T, false>(plan, x, work);
+            } else {
+                dsc_complex_fft<T, true>(plan, x, work);
+                dsc_complex_fft<T, false>(plan, x, work);
+            }
+        }
+    };
+
+    // Find how many repetitions take at least DSC_FFT_MEASURE_MIN_NS, this also warms up the cache
+    int reps = 1;
+    u64 best;
+    for (;;) {
+        const u64 start = dsc_time_ns();
+        for (int r = 0; r < reps; ++r) run();
+        best = dsc_time_ns() - start;
+        if (best >= DSC_FFT_MEASURE_MIN_NS) break;
+        reps <<= 1;
+    }
+
+    for (int trial = 0; trial < DSC_FFT_MEASURE_TRIALS; ++trial) {
+        const u64 start = dsc_time_ns();
+        for (int r = 0; r < reps; ++r) run();
+        best = DSC_MIN(best, dsc_time_ns() - start);
+    }
+
+    return (f64) best / ((f64) reps * lines);
+}
+
+// Radix orders timed for a Stockham FFT of order N: the default one, the power-of-2 part done with radix-4
+// instead of radix-8 passes and the default one reversed (the odd radices first). Returns the number of orders.
+static int dsc_fft_radix_orders(const int n, dsc_fft_tuning *orders) noexcept {
+    int n_orders = 0;
+    const auto add = [&](const int *factors, const int n_factors) noexcept {
+        for (int o = 0; o < n_orders; ++o) {
+            if (orders[o].n_factors == n_factors &&
+                memcmp(orders[o].factors, factors, n_factors * sizeof(*factors)) == 0) return;
+        }
+        orders[n_orders].n_factors = n_factors;
+        memcpy(orders[n_orders].factors, factors, n_factors * sizeof(*factors));
+        n_orders++;
+    };
+
+    int factors[DSC_FFT_MAX_FACTORS];
+    const int n_factors = dsc_fft_factorize(n, factors);
+    add(factors, n_factors);
+
+    int radix4[DSC_FFT_MAX_FACTORS];
+    int n_radix4 = 0, pow2 = n & -n;
+    for (; pow2 >= 4; pow2 >>= 2) radix4[n_radix4++] = 4;
+    if (pow2 == 2) radix4[n_radix4++] = 2;
+    for (int f = 0; f < n_factors; ++f) {
+        if ((factors[f] & 1) != 0) radix4[n_radix4++] = factors[f];
+    }
+    add(radix4, n_radix4);
+
+    int reversed[DSC_FFT_MAX_FACTORS]{};
+    for (int f = 0; f < n_factors; ++f) reversed[f] = factors[n_factors - 1 - f];
+    add(reversed, n_factors);
+
+    return n_orders;
+}
+
+// Time the candidates for an FFT of order N on lines contiguous lines and return the fastest plan.
+// The plan is not added to the cache.
+static dsc_fft_plan *dsc_measure_plan(dsc_ctx *ctx, const int n,
+                                      const dsc_fft_type fft_type,
+                                      const dsc_dtype twd_dtype,
+                                      const int lines) noexcept {
+    const dsc_fft_algorithm estimate = dsc_fft_choose_algorithm(n);
+    int factors[DSC_FFT_MAX_FACTORS];
+    const int n_factors = dsc_fft_factorize(n, factors);
+    const int max_factor = n_factors > 0 ? factors[n_factors - 1] : 1;
+
+    // Enough scratch for every algorithm that can be timed
+    const int work_n = DSC_MAX(dsc_fft_work_size(n, BLUESTEIN), dsc_fft_work_size(n, FOUR_STEP));
+    const dsc_dtype dtype = twd_dtype == F32 ? C32 : C64;
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *buff = dsc_tensor_1d(ctx, dtype, (n + 1) * lines);
+    dsc_tensor *work = dsc_tensor_1d(ctx, dtype, work_n * lines);
+
+    dsc_fft_candidate candidates[DSC_FFT_MAX_CANDIDATES];
+    int n_candidates = 0, best = -1;
+    dsc_fft_plan *best_plan = nullptr;
+
+    const auto time_candidate = [&](const dsc_fft_algorithm algorithm, const dsc_fft_tuning &tuning) noexcept {
+        dsc_fft_plan *plan = dsc_alloc_plan(ctx, n, fft_type, twd_dtype, algorithm, &tuning);
+        dsc_fft_candidate *candidate = &candidates[n_candidates];
+        candidate->algorithm = algorithm;
+        // The kernels actually used, the CPU may not support the ISA that was asked for
+        candidate->tuning = tuning;
+        candidate->tuning.isa = plan->kernels->isa;
+        if (twd_dtype == F32) candidate->ns = dsc_fft_time_plan(plan, lines, (c32 *) buff->data, (c32 *) work->data);
+        else candidate->ns = dsc_fft_time_plan(plan, lines, (c64 *) buff->data, (c64 *) work->data);
+
+        DSC_LOG_DEBUG("%s N=%d dtype=%s algorithm=%s kernels=%s passes=%d: %.1fns",
+                      fft_type == REAL ? "RFFT" : "FFT", n, DSC_DTYPE_NAMES[twd_dtype],
+                      DSC_FFT_ALGORITHM_NAMES[algorithm], DSC_SIMD_ISA_NAMES[candidate->tuning.isa],
+                      candidate->tuning.n_factors, candidate->ns);
+
+        if (best < 0 || candidate->ns < candidates[best].ns) {
+            if (best_plan != nullptr) dsc_free_plan(ctx, best_plan);
+            best = n_candidates;
+            best_plan = plan;
+        } else {
+            dsc_free_plan(ctx, plan);
+        }
+        n_candidates++;
+    };
+
+    // 1. The plan of the cost model with every set of kernels, dsc_fft_get_kernels returns the best kernels
+    // available if the CPU doesn't support an ISA so stop as soon as that happens.
+    dsc_fft_tuning orders[3];
+    const int n_orders = estimate == STOCKHAM ? dsc_fft_radix_orders(n, orders) : 1;
+    if (estimate != STOCKHAM) orders[0].n_factors = 0;
+
+    for (int isa = SCALAR; isa <= AVX512; ++isa) {
+        if (dsc_fft_get_kernels((dsc_simd_isa) isa)->isa != isa) break;
+        orders[0].isa = (dsc_simd_isa) isa;
+        time_candidate(estimate, orders[0]);
+    }
+    // This is the plan that DSC_PLAN_ESTIMATE would create
+    const int estimate_idx = n_candidates - 1;
+
+    // 2. The other radix orders and algorithms with the fastest kernels
+    dsc_fft_tuning tuning{candidates[best].tuning.isa, 0, {}};
+    for (int o = 1; o < n_orders; ++o) {
+        orders[o].isa = tuning.isa;
+        time_candidate(STOCKHAM, orders[o]);
+    }
+    if (estimate != STOCKHAM && max_factor <= DSC_FFT_MAX_RADIX) {
+        const int n_stockham = dsc_fft_radix_orders(n, orders);
+        for (int o = 0; o < n_stockham; ++o) {
+            orders[o].isa = tuning.isa;
+            time_candidate(STOCKHAM, orders[o]);
+        }
+    }
+    // Bluestein can only win if N has a prime factor without a specialized butterfly
+    if (estimate != BLUESTEIN && max_factor > 7) time_candidate(BLUESTEIN, tuning);
+    if (estimate != FOUR_STEP && n >= DSC_FFT_MEASURE_FOUR_STEP_MIN_N && dsc_fft_four_step_balanced(n)) {
+        time_candidate(FOUR_STEP, tuning);
+    }
+    DSC_CTX_POP(ctx);
+
+    for (int c = 0; c < n_candidates; ++c) {
+        DSC_TRACE_PLAN_MEASURE(n, fft_type, twd_dtype, lines, candidates[c].algorithm, candidates[c].tuning.isa,
+                               candidates[c].tuning.factors, candidates[c].tuning.n_factors, candidates[c].ns,
+                               c == best);
+    }
+
+    DSC_LOG_INFO("measured %d candidates for %s N=%d dtype=%s: %s with %s kernels in %.1fns (estimate %s: %.1fns)",
+                 n_candidates, fft_type == REAL ? "RFFT" : "FFT", n, DSC_DTYPE_NAMES[twd_dtype],
+                 DSC_FFT_ALGORITHM_NAMES[candidates[best].algorithm],
+                 DSC_SIMD_ISA_NAMES[candidates[best].tuning.isa], candidates[best].ns,
+                 DSC_FFT_ALGORITHM_NAMES[estimate], candidates[estimate_idx].ns);
+
+    best_plan->measured = true;
+    return best_plan;
+}
+
+dsc_fft_plan *dsc_plan_fft(dsc_ctx *ctx, const int n,
+                           const dsc_fft_type fft_type,
+                           const dsc_dtype dtype,
+                           const dsc_plan_mode mode,
+                           const int batch) noexcept {
+    DSC_ASSERT(n > 0);
+    DSC_ASSERT(batch > 0);
+    const int fft_n = n;
+
+    DSC_TRACE_PLAN_FFT(n, fft_n, fft_type, dtype);
+
     dsc_dtype twd_dtype;
     switch (dtype) {
         case C32:
@@ -195,75 +778,295 @@ static dsc_fft_plan *dsc_get_plan(dsc_ctx *ctx, const int n,
         DSC_INVALID_CASE("unknown dtype=%d", dtype);
     }
 
-    dsc_fft_plan *plan = nullptr;
-    for (int i = 0; i < DSC_MAX_FFT_PLANS; ++i) {
-        dsc_fft_plan *cached_plan = ctx->fft_plans[i];
-        if ((cached_plan != nullptr)) {
-            if ((cached_plan->n == n) &&
-                // Note: technically we could support complex FFTs of order N from real FFTs plans
-                // but not the other way around because we need an extra set of twiddles in the RFFT.
-                (cached_plan->fft_type == fft_type) &&
-                (cached_plan->dtype == twd_dtype)) {
-                plan = cached_plan;
-                plan->last_used = 0;
-            } else {
-                cached_plan->last_used++;
-            }
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    dsc_fft_plan *plan = dsc_get_plan(ctx, fft_n, fft_type, twd_dtype);
+
+    if (plan != nullptr && (mode == DSC_PLAN_ESTIMATE || plan->measured)) {
+        cache->hits++;
+        DSC_LOG_DEBUG("found cached %s plan with N=%d dtype=%s",
+                      fft_type == REAL ? "RFFT" : "FFT",
+                      fft_n, DSC_DTYPE_NAMES[dtype]);
+        return plan;
+    }
+
+    cache->misses++;
+    if (mode == DSC_PLAN_ESTIMATE) return dsc_new_plan(ctx, fft_n, fft_type, twd_dtype, dsc_fft_choose_algorithm(fft_n));
+
+    // The plan of the cost model is kept until the end so the candidates can share its twiddles.
+    // Measuring more than DSC_FFT_MAX_BATCH lines doesn't change how they are transformed.
+    dsc_fft_plan *measured = dsc_measure_plan(ctx, fft_n, fft_type, twd_dtype, DSC_MIN(batch, DSC_FFT_MAX_BATCH));
+    if (plan != nullptr) dsc_remove_plan(ctx, plan);
+    dsc_insert_plan(ctx, measured);
+
+    return measured;
+}
+
+// ============================================================
+// FFT Wisdom
+//
+// A wisdom file is a snapshot of the plan cache: a header, one record for each set of twiddles
+// in the pool, one record for each plan and then the twiddles exactly as they are in memory.
+// When the file is imported it's mapped in memory and the twiddles are added to the pool directly
+// from the mapping, the plans are then created as usual but, since all their twiddles are already
+// in the pool, this is O(1) regardless of N.
+
+#define DSC_WISDOM_MAGIC    "DSCWISDM"
+// Must be bumped whenever the layout of the twiddles changes
+#define DSC_WISDOM_VERSION  ((u32) 3)
+// Alignment of each set of twiddles in the file
+#define DSC_WISDOM_ALIGN    ((usize) 64)
+
+struct dsc_wisdom_header {
+    char magic[8];
+    u32 version;
+    u32 n_sets;
+    u32 n_plans;
+    u32 padding;
+};
+
+struct dsc_wisdom_set_record {
+    // Offset of the twiddles from the beginning of the file and their size in bytes
+    u64 offset, bytes;
+    int a, b;
+    u8 kind, dtype;
+};
+
+struct dsc_wisdom_plan_record {
+    int n;
+    u8 dtype, fft_type, algorithm;
+    // Measured plans also keep the kernels and the radix of each Stockham pass they were measured with
+    u8 measured, isa, n_factors;
+    u8 factors[DSC_FFT_MAX_FACTORS];
+};
+
+bool dsc_export_wisdom(dsc_ctx *ctx, const char *filename) noexcept {
+    const dsc_fft_cache *cache = &ctx->fft_cache;
+    const dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+
+    FILE *f = fopen(filename, "wb");
+    if (f == nullptr) {
+        DSC_LOG_ERR("error opening \"%s\"", filename);
+        return false;
+    }
+
+    // Only the sets used by at least one plan are exported
+    u32 n_sets = 0;
+    for (int i = 0; i < pool->n_buckets; ++i) {
+        for (const dsc_twiddle_set *set = pool->buckets[i]; set != nullptr; set = set->next) {
+            if (set->refs > 0) n_sets++;
         }
     }
 
-    return plan;
+    dsc_wisdom_header header{};
+    memcpy(header.magic, DSC_WISDOM_MAGIC, sizeof(header.magic));
+    header.version = DSC_WISDOM_VERSION;
+    header.n_sets = n_sets;
+    header.n_plans = (u32) cache->size;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+
+    usize offset = DSC_ALIGN(sizeof(header) + n_sets * sizeof(dsc_wisdom_set_record) +
+                             cache->size * sizeof(dsc_wisdom_plan_record), DSC_WISDOM_ALIGN);
+    for (int i = 0; i < pool->n_buckets && ok; ++i) {
+        for (const dsc_twiddle_set *set = pool->buckets[i]; set != nullptr && ok; set = set->next) {
+            if (set->refs == 0) continue;
+
+            dsc_wisdom_set_record record{};
+            record.offset = offset;
+            record.bytes = set->bytes;
+            record.a = set->a;
+            record.b = set->b;
+            record.kind = set->kind;
+            record.dtype = set->dtype;
+
+            ok = fwrite(&record, sizeof(record), 1, f) == 1;
+            offset = DSC_ALIGN(offset + set->bytes, DSC_WISDOM_ALIGN);
+        }
+    }
+
+    // The plans are written from the least to the most recently used so that, after
+    // the import, the LRU order is the same
+    for (const dsc_fft_plan *plan = cache->lru_tail; plan != nullptr && ok; plan = plan->lru_prev) {
+        dsc_wisdom_plan_record record{};
+        record.n = plan->n;
+        record.dtype = plan->dtype;
+        record.fft_type = plan->fft_type;
+        record.algorithm = plan->algorithm;
+        if (plan->measured) {
+            record.measured = 1;
+            record.isa = plan->kernels->isa;
+            record.n_factors = (u8) plan->n_factors;
+            for (int i = 0; i < plan->n_factors; ++i) record.factors[i] = (u8) plan->factors[i];
+        }
+
+        ok = fwrite(&record, sizeof(record), 1, f) == 1;
+    }
+
+    static constexpr byte padding[DSC_WISDOM_ALIGN]{};
+    for (int i = 0; i < pool->n_buckets && ok; ++i) {
+        for (const dsc_twiddle_set *set = pool->buckets[i]; set != nullptr && ok; set = set->next) {
+            if (set->refs == 0) continue;
+
+            const usize pos = (usize) ftell(f);
+            const usize pad = DSC_ALIGN(pos, DSC_WISDOM_ALIGN) - pos;
+            ok = (pad == 0 || fwrite(padding, pad, 1, f) == 1) &&
+                 fwrite(set->data, set->bytes, 1, f) == 1;
+        }
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        DSC_LOG_ERR("error writing wisdom to \"%s\"", filename);
+        return false;
+    }
+
+    DSC_LOG_INFO("exported %d FFT plans and %u sets of twiddles to \"%s\"", cache->size, n_sets, filename);
+    return true;
 }
 
-dsc_fft_plan *dsc_plan_fft(dsc_ctx *ctx, const int n,
-                           const dsc_fft_type fft_type,
-                           const dsc_dtype dtype) noexcept {
-    const int fft_n = dsc_pow2_n(n);
+// Check that a set of twiddles read from a wisdom file has the size this build expects
+static bool dsc_wisdom_valid(const dsc_wisdom_set_record *record, const usize file_size) noexcept {
+    if ((record->dtype != F32 && record->dtype != F64) ||
+        record->a <= 0 || record->b < 0 ||
+        (record->offset % DSC_WISDOM_ALIGN) != 0 ||
+        record->offset > file_size || record->bytes > file_size - record->offset) {
+        return false;
+    }
 
-    DSC_TRACE_PLAN_FFT(n, fft_n, fft_type, dtype);
+    usize n_twiddles;
+    switch (record->kind) {
+        case PASS_TWIDDLES:
+            if (record->a < 2 || record->b <= 0) return false;
+            n_twiddles = dsc_fft_pass_twiddles(record->a, record->b);
+            break;
+        case RFFT_TWIDDLES:
+            n_twiddles = (record->a + 1) >> 1;
+            break;
+        case CHIRP_TWIDDLES:
+            n_twiddles = record->a + dsc_fft_bluestein_n(record->a);
+            break;
+        case FOUR_STEP_TWIDDLES:
+            if (record->b <= 0) return false;
+            n_twiddles = (usize) record->a * (DSC_FFT_FOUR_STEP_BATCH + 1) + record->b;
+            break;
+        default:
+            return false;
+    }
 
-    dsc_fft_plan *plan = dsc_get_plan(ctx, fft_n, fft_type, dtype);
+    return record->bytes == n_twiddles * 2 * DSC_DTYPE_SIZE[record->dtype];
+}
 
-    if (plan == nullptr) {
-        int free_slot = -1;
-        for (int i = 0; i < DSC_MAX_FFT_PLANS; ++i) {
-            if (ctx->fft_plans[i] == nullptr) {
-                free_slot = i;
-                break;
+// Check that a plan read from a wisdom file is a plan this build would create or, if it was measured,
+// that its passes actually compute an FFT of order N
+static bool dsc_wisdom_valid(const dsc_wisdom_plan_record *record) noexcept {
+    if (record->n <= 0 ||
+        (record->dtype != F32 && record->dtype != F64) ||
+        (record->fft_type != REAL && record->fft_type != COMPLEX)) {
+        return false;
+    }
+    if (!record->measured) return record->algorithm == dsc_fft_choose_algorithm(record->n);
+
+    if (record->isa > AVX512 || record->n_factors > DSC_FFT_MAX_FACTORS) return false;
+    switch (record->algorithm) {
+        case STOCKHAM: {
+            i64 n = 1;
+            for (int f = 0; f < record->n_factors; ++f) {
+                if (record->factors[f] < 2 || record->factors[f] > DSC_FFT_MAX_RADIX) return false;
+                n *= record->factors[f];
+                if (n > record->n) return false;
             }
+            return n == record->n;
         }
+        case BLUESTEIN:
+            return record->n_factors == 0;
+        case FOUR_STEP:
+            return record->n_factors == 0 && dsc_fft_four_step_balanced(record->n);
+        default:
+            return false;
+    }
+}
 
-        if (free_slot < 0) {
-            // Find the 'oldest' FFT plan and evict it
-            int max = -1;
-            for (int i = 0; i < DSC_MAX_FFT_PLANS; ++i) {
-                dsc_fft_plan *tmp = ctx->fft_plans[i];
-                if (tmp->last_used > max) {
-                    max = tmp->last_used;
-                    free_slot = i;
-                }
-            }
-            dsc_obj_free(ctx->default_allocator, ctx->fft_plans[free_slot]);
+bool dsc_import_wisdom(dsc_ctx *ctx, const char *filename) noexcept {
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        DSC_LOG_ERR("error opening \"%s\"", filename);
+        return false;
+    }
+
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || (usize) file_stat.st_size < sizeof(dsc_wisdom_header)) {
+        DSC_LOG_ERR("\"%s\" is not a valid wisdom file", filename);
+        close(fd);
+        return false;
+    }
+
+    const usize file_size = (usize) file_stat.st_size;
+    void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        DSC_LOG_ERR("error mapping \"%s\"", filename);
+        return false;
+    }
+
+    const dsc_wisdom_header *header = (const dsc_wisdom_header *) addr;
+    if (memcmp(header->magic, DSC_WISDOM_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != DSC_WISDOM_VERSION ||
+        sizeof(dsc_wisdom_header) + (usize) header->n_sets * sizeof(dsc_wisdom_set_record) +
+        (usize) header->n_plans * sizeof(dsc_wisdom_plan_record) > file_size) {
+        DSC_LOG_ERR("\"%s\" is not a valid wisdom file or it was created by a different version of DSC", filename);
+        munmap(addr, file_size);
+        return false;
+    }
+
+    dsc_wisdom_map *map = (dsc_wisdom_map *) malloc(sizeof(dsc_wisdom_map));
+    DSC_ASSERT(map != nullptr);
+    map->addr = addr;
+    map->size = file_size;
+    map->next = ctx->wisdom;
+    ctx->wisdom = map;
+
+    const dsc_wisdom_set_record *set_records = (const dsc_wisdom_set_record *) (header + 1);
+    for (u32 i = 0; i < header->n_sets; ++i) {
+        const dsc_wisdom_set_record *record = &set_records[i];
+        if (!dsc_wisdom_valid(record, file_size)) {
+            DSC_LOG_ERR("skipping invalid set of twiddles %u in \"%s\"", i, filename);
+            continue;
         }
 
-        const usize storage = sizeof(dsc_fft_plan) + dsc_fft_storage(fft_n, dtype, fft_type);
+        const dsc_twiddle_kind kind = (dsc_twiddle_kind) record->kind;
+        const dsc_dtype dtype = (dsc_dtype) record->dtype;
+        if (dsc_twiddle_pool_find(&ctx->twiddle_pool, kind, dtype, record->a, record->b) != nullptr) continue;
 
-        DSC_LOG_DEBUG("allocating new %s plan with N=%d dtype=%s",
-                      fft_type == REAL ? "RFFT" : "FFT",
-                      fft_n, DSC_DTYPE_NAMES[dtype]);
+        dsc_twiddle_pool_add(ctx, kind, dtype, record->a, record->b, record->bytes,
+                             (byte *) addr + record->offset);
+    }
 
-        plan = (dsc_fft_plan *) dsc_obj_alloc(ctx->default_allocator, storage);
-        plan->twiddles = (plan + 1);
-        dsc_init_plan(plan, fft_n, dtype, fft_type);
+    const dsc_wisdom_plan_record *plan_records = (const dsc_wisdom_plan_record *) (set_records + header->n_sets);
+    int imported = 0;
+    for (u32 i = 0; i < header->n_plans; ++i) {
+        const dsc_wisdom_plan_record *record = &plan_records[i];
+        if (!dsc_wisdom_valid(record)) {
+            DSC_LOG_ERR("skipping invalid plan %u in \"%s\"", i, filename);
+            continue;
+        }
 
-        ctx->fft_plans[free_slot] = plan;
-    } else {
-        DSC_LOG_DEBUG("found cached %s plan with N=%d dtype=%s",
-                      fft_type == REAL ? "RFFT" : "FFT",
-                      fft_n, DSC_DTYPE_NAMES[dtype]);
+        const dsc_dtype dtype = (dsc_dtype) record->dtype;
+        const dsc_fft_type fft_type = (dsc_fft_type) record->fft_type;
+        const dsc_fft_algorithm algorithm = (dsc_fft_algorithm) record->algorithm;
+        if (dsc_get_plan(ctx, record->n, fft_type, dtype) != nullptr) continue;
+
+        if (record->measured) {
+            dsc_fft_tuning tuning{(dsc_simd_isa) record->isa, record->n_factors, {}};
+            for (int f = 0; f < record->n_factors; ++f) tuning.factors[f] = record->factors[f];
+            dsc_new_plan(ctx, record->n, fft_type, dtype, algorithm, &tuning)->measured = true;
+        } else {
+            dsc_new_plan(ctx, record->n, fft_type, dtype, algorithm);
+        }
+        imported++;
     }
 
-    return plan;
+    DSC_LOG_INFO("imported %d FFT plans from \"%s\"", imported, filename);
+    return true;
 }
 
 // ============================================================
@@ -279,12 +1082,53 @@ void dsc_ctx_free(dsc_ctx *ctx) noexcept {
     dsc_backend_buf_free(ctx->default_backend, ctx->main_buf);
     dsc_backend_buf_free(ctx->default_backend, ctx->scratch_buf);
 
+    dsc_thread_pool_free(ctx->thread_pool);
+
+    // The plans and the twiddles are in the main buffer which is already gone
+    free(ctx->fft_cache.buckets);
+    free(ctx->twiddle_pool.buckets);
+
+    for (dsc_wisdom_map *map = ctx->wisdom; map != nullptr;) {
+        dsc_wisdom_map *next = map->next;
+        munmap(map->addr, map->size);
+        free(map);
+        map = next;
+    }
+
     dsc_internal_free_traces();
 
     free(ctx);
 }
 
 void dsc_ctx_clear(dsc_ctx *ctx) noexcept {
+    // The cached plans and their twiddles are in the main buffer so they must go before it's cleared.
+    // They are freed one by one because the general purpose allocator doesn't actually clear anything.
+    dsc_fft_cache *cache = &ctx->fft_cache;
+    while (cache->lru_tail != nullptr) dsc_remove_plan(ctx, cache->lru_tail);
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+
+    dsc_czt_cache_clear(ctx);
+
+    // What is left in the pool is either imported from a wisdom file or used by a plan that is not cached
+    // (eg. the plan of an STFT), only the first can go.
+    dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+    for (int i = 0; i < pool->n_buckets; ++i) {
+        dsc_twiddle_set **link = &pool->buckets[i];
+        while (*link != nullptr) {
+            dsc_twiddle_set *set = *link;
+            if (set->refs > 0) {
+                link = &set->next;
+                continue;
+            }
+            *link = set->next;
+            pool->n_sets--;
+            pool->bytes -= set->bytes;
+            dsc_obj_free(ctx->main_allocator, set);
+        }
+    }
+
     // Todo: are we going to clear everything or just the scratch?
     dsc_clear_buffer(ctx->main_allocator);
     dsc_clear_buffer(ctx->scratch_allocator);
@@ -321,6 +1165,48 @@ void dsc_print_mem_usage(dsc_ctx *ctx) noexcept {
                  (f64) used_mem / (f64) total_mem * 1e2);
 }
 
+void dsc_set_threads(dsc_ctx *ctx, int n_threads) noexcept {
+    if (n_threads <= 0) n_threads = dsc_cpu_count();
+
+    if (n_threads == ctx->n_threads) return;
+
+    dsc_thread_pool_free(ctx->thread_pool);
+    ctx->thread_pool = n_threads > 1 ? dsc_thread_pool_init(n_threads) : nullptr;
+    ctx->n_threads = n_threads;
+
+    DSC_LOG_DEBUG("context %p will use %d threads", (void *) ctx, n_threads);
+}
+
+int dsc_get_threads(dsc_ctx *ctx) noexcept {
+    return ctx->n_threads;
+}
+
+void dsc_set_math_precision(dsc_ctx *ctx, const dsc_math_precision precision) noexcept {
+    ctx->math_precision = precision;
+}
+
+dsc_math_precision dsc_get_math_precision(dsc_ctx *ctx) noexcept {
+    return ctx->math_precision;
+}
+
+// Run fn(start, stop) over [0, n) items of type T using the threads of the context, each item
+// costs about cost elements of work. Unless an item is bigger than a chunk, the chunks are a
+// multiple of the cache line.
+template<typename T, typename F>
+static DSC_INLINE void dsc_parallel_items(dsc_ctx *ctx, const int n, F &&fn, const int cost = 1) noexcept {
+    constexpr int line = DSC_SIMD_ALIGN / (int) sizeof(T);
+    const int chunk = DSC_ALIGN(DSC_MAX((int) (DSC_PARALLEL_CHUNK_BYTES / sizeof(T)) / cost, 1), line);
+    const int n_workers = (int) DSC_MIN((i64) ctx->n_threads, ((i64) n * cost) / DSC_MIN_WORK_PER_THREAD);
+    dsc_parallel_for(ctx->thread_pool, n_workers, n, chunk, fn);
+}
+
+dsc_fft_cache_stats dsc_get_fft_cache_stats(dsc_ctx *ctx) noexcept {
+    const dsc_fft_cache *cache = &ctx->fft_cache;
+    const dsc_twiddle_pool *pool = &ctx->twiddle_pool;
+    return {cache->hits, cache->misses, cache->evictions, cache->size, cache->capacity,
+            pool->n_sets, pool->bytes};
+}
+
 // ============================================================
 // Tracing
 
@@ -534,51 +1420,55 @@ dsc_tensor *dsc_randn(dsc_ctx *ctx,
 }
 
 template<typename Tx, typename To>
-static DSC_INLINE void copy_op(const dsc_tensor *DSC_RESTRICT x,
+static DSC_INLINE void copy_op(dsc_ctx *ctx,
+                               const dsc_tensor *DSC_RESTRICT x,
                                dsc_tensor *DSC_RESTRICT out) noexcept {
     DSC_TENSOR_DATA(Tx, x);
     DSC_TENSOR_DATA(To, out);
 
-    // Todo: I can probably do better but (if it works) it's fine for now
-    dsc_for(i, out) {
-        out_data[i] = cast_op().template operator()<Tx, To>(x_data[i]);
-    }
+    dsc_parallel_items<To>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        for (int i = start; i < stop; ++i) {
+            out_data[i] = cast_op().template operator()<Tx, To>(x_data[i]);
+        }
+    });
 }
 
 template<typename Tx>
-static void copy_op(const dsc_tensor *DSC_RESTRICT x,
+static void copy_op(dsc_ctx *ctx,
+                    const dsc_tensor *DSC_RESTRICT x,
                     dsc_tensor *DSC_RESTRICT out) noexcept {
     switch (out->dtype) {
         case dsc_dtype::F32:
-            copy_op<Tx, f32>(x, out);
+            copy_op<Tx, f32>(ctx, x, out);
             break;
         case dsc_dtype::F64:
-            copy_op<Tx, f64>(x, out);
+            copy_op<Tx, f64>(ctx, x, out);
             break;
         case dsc_dtype::C32:
-            copy_op<Tx, c32>(x, out);
+            copy_op<Tx, c32>(ctx, x, out);
             break;
         case dsc_dtype::C64:
-            copy_op<Tx, c64>(x, out);
+            copy_op<Tx, c64>(ctx, x, out);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
 }
 
-static void copy(const dsc_tensor *DSC_RESTRICT x,
+static void copy(dsc_ctx *ctx,
+                 const dsc_tensor *DSC_RESTRICT x,
                  dsc_tensor *DSC_RESTRICT out) noexcept {
     switch (x->dtype) {
         case dsc_dtype::F32:
-            copy_op<f32>(x, out);
+            copy_op<f32>(ctx, x, out);
             break;
         case dsc_dtype::F64:
-            copy_op<f64>(x, out);
+            copy_op<f64>(ctx, x, out);
             break;
         case dsc_dtype::C32:
-            copy_op<c32>(x, out);
+            copy_op<c32>(ctx, x, out);
             break;
         case dsc_dtype::C64:
-            copy_op<c64>(x, out);
+            copy_op<c64>(ctx, x, out);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
@@ -591,7 +1481,18 @@ dsc_tensor *dsc_cast(dsc_ctx *ctx, dsc_tensor *DSC_RESTRICT x,
     if (x->dtype == new_dtype) return x;
 
     dsc_tensor *out = dsc_new_tensor(ctx, x->n_dim, &x->shape[dsc_tensor_dim(x, 0)], new_dtype);
-    copy(x, out);
+    copy(ctx, x, out);
+
+    return out;
+}
+
+// Same as dsc_cast for inputs that are only read
+static const dsc_tensor *dsc_cast_input(dsc_ctx *ctx, const dsc_tensor *DSC_RESTRICT x,
+                                        const dsc_dtype new_dtype) noexcept {
+    if (x->dtype == new_dtype) return x;
+
+    dsc_tensor *out = dsc_new_tensor(ctx, x->n_dim, &x->shape[dsc_tensor_dim(x, 0)], new_dtype);
+    copy(ctx, x, out);
 
     return out;
 }
@@ -636,30 +1537,44 @@ dsc_tensor *dsc_reshape(dsc_ctx *ctx,
 }
 
 template<typename T>
-static DSC_INLINE void concat(dsc_tensor **to_concat,
+static DSC_INLINE void concat(dsc_ctx *ctx,
+                              dsc_tensor **to_concat,
                               const int tensors,
                               dsc_tensor *DSC_RESTRICT out,
-                              const int axis_idx) noexcept {
+                              const int rows) noexcept {
     DSC_TENSOR_DATA(T, out);
-    // Todo: validate the perf of this implementation
-    dsc_axis_iterator *iterators = (dsc_axis_iterator *) alloca(tensors * sizeof(dsc_axis_iterator));
-    for (int i = 0; i < tensors; ++i) iterators[i] = dsc_axis_iterator(to_concat[i], axis_idx);
-
-    dsc_axis_iterator out_iterator(out, axis_idx);
 
-    while (out_iterator.has_next()) {
-        for (int i = 0; i < tensors; ++i) {
-            const int axis_n = to_concat[i]->shape[axis_idx];
-
-            T *DSC_RESTRICT src_data = (T *) to_concat[i]->data;
-            for (int el_idx = 0; el_idx < axis_n; ++el_idx) {
-                out_data[out_iterator.index()] = src_data[iterators[i].index()];
-
-                out_iterator.next();
-                iterators[i].next();
+    // Each row of out is made of a contiguous block of elements from each tensor, if the tensors are
+    // seen as [rows, axis, cols] the blocks have axis * cols elements. Any range of out can be copied
+    // by finding the block that contains its first element and then going block by block.
+    const int row_n = out->ne / rows;
+    int *block_n = (int *) alloca(tensors * sizeof(int));
+    for (int i = 0; i < tensors; ++i) block_n[i] = to_concat[i]->ne / rows;
+
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        int row = start / row_n, offset = start % row_n;
+        int i = 0, block_start = 0;
+        while (offset >= block_start + block_n[i]) block_start += block_n[i++];
+
+        for (int pos = start; pos < stop;) {
+            const int in_block = offset - block_start;
+            const int n = DSC_MIN(stop - pos, block_n[i] - in_block);
+            const T *src_data = (const T *) to_concat[i]->data;
+            memcpy(&out_data[pos], &src_data[row * block_n[i] + in_block], n * sizeof(T));
+            pos += n;
+            offset += n;
+
+            if (offset - block_start == block_n[i]) {
+                block_start += block_n[i++];
+                if (i == tensors) {
+                    i = 0;
+                    block_start = 0;
+                    offset = 0;
+                    row++;
+                }
             }
         }
-    }
+    });
 }
 
 dsc_tensor *dsc_concat(dsc_ctx *ctx, const int axis,
@@ -687,21 +1602,14 @@ dsc_tensor *dsc_concat(dsc_ctx *ctx, const int axis,
         DSC_ASSERT(to_concat[i]->n_dim == n_dim);
     }
 
+    dsc_tensor *out;
+    int rows = 1;
     if (axis == DSC_VALUE_NONE) {
-        // Flatten
+        // Flatten: a single row
         int ne = 0;
         for (int i = 0; i < tensors; ++i) ne += to_concat[i]->ne;
 
-        dsc_tensor *out = dsc_tensor_1d(ctx, dtype, ne);
-        usize offset = 0;
-        for (int i = 0; i < tensors; ++i) {
-            dsc_tensor *src = to_concat[i];
-            const usize nb = src->ne * DSC_DTYPE_SIZE[dtype];
-            memcpy((byte *) out->data + offset, src->data, nb);
-            offset += nb;
-        }
-
-        return out;
+        out = dsc_tensor_1d(ctx, dtype, ne);
     } else {
         const int axis_idx = dsc_tensor_dim(to_concat[0], axis);
         DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
@@ -721,44 +1629,52 @@ dsc_tensor *dsc_concat(dsc_ctx *ctx, const int axis,
             }
         }
 
-        dsc_tensor *out = dsc_new_tensor(ctx, n_dim,
-                                         &resulting_shape[dsc_tensor_dim(to_concat[0], 0)],
-                                         dtype);
-
-        switch (dtype) {
-            case F32:
-                concat<f32>(to_concat, tensors, out, axis_idx);
-                break;
-            case F64:
-                concat<f64>(to_concat, tensors, out, axis_idx);
-                break;
-            case C32:
-                concat<c32>(to_concat, tensors, out, axis_idx);
-                break;
-            case C64:
-                concat<c64>(to_concat, tensors, out, axis_idx);
-                break;
-            DSC_INVALID_CASE("unknown dtype=%d", dtype);
-        }
+        out = dsc_new_tensor(ctx, n_dim, &resulting_shape[dsc_tensor_dim(to_concat[0], 0)], dtype);
 
-        return out;
+        for (int i = 0; i < axis_idx; ++i) rows *= resulting_shape[i];
     }
-}
 
-template <typename T>
-static DSC_INLINE void copy_with_stride(const dsc_tensor *DSC_RESTRICT x,
-                                        dsc_tensor *DSC_RESTRICT out,
-                                        const int *shape,
-                                        const int *stride) noexcept {
-    // Todo: it's probably better to have a copy that takes care of this?
+    switch (dtype) {
+        case F32:
+            concat<f32>(ctx, to_concat, tensors, out, rows);
+            break;
+        case F64:
+            concat<f64>(ctx, to_concat, tensors, out, rows);
+            break;
+        case C32:
+            concat<c32>(ctx, to_concat, tensors, out, rows);
+            break;
+        case C64:
+            concat<c64>(ctx, to_concat, tensors, out, rows);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+
+    return out;
+}
+
+template <typename T>
+static DSC_INLINE void copy_with_stride(dsc_ctx *ctx,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        dsc_tensor *DSC_RESTRICT out,
+                                        const int *shape,
+                                        const int *stride) noexcept {
+    // Todo: it's probably better to have a copy that takes care of this?
     DSC_TENSOR_DATA(T, x);
     DSC_TENSOR_DATA(T, out);
 
-    dsc_stride_iterator x_it(shape, stride);
-    dsc_for(i, out) {
-        out_data[i] = x_data[x_it.index()];
-        x_it.next();
-    }
+    const int *strides[2] = {nullptr, stride};
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        int pos = start;
+        for (dsc_nd_iterator<2> it(shape, strides, start); pos < stop; it.next()) {
+            const int n = DSC_MIN(it.run(), stop - pos);
+            T *dst = &out_data[it.index(0)];
+            const T *src = &x_data[it.index(1)];
+            const int src_stride = it.stride(1);
+            for (int j = 0; j < n; ++j) dst[j] = src[j * src_stride];
+            pos += n;
+        }
+    });
 }
 
 dsc_tensor *dsc_transpose(dsc_ctx *ctx,
@@ -809,16 +1725,16 @@ dsc_tensor *dsc_transpose(dsc_ctx *ctx,
 
     switch (x->dtype) {
         case F32:
-            copy_with_stride<f32>(x, out, swapped_shape, swapped_stride);
+            copy_with_stride<f32>(ctx, x, out, swapped_shape, swapped_stride);
             break;
         case F64:
-            copy_with_stride<f64>(x, out, swapped_shape, swapped_stride);
+            copy_with_stride<f64>(ctx, x, out, swapped_shape, swapped_stride);
             break;
         case C32:
-            copy_with_stride<c32>(x, out, swapped_shape, swapped_stride);
+            copy_with_stride<c32>(ctx, x, out, swapped_shape, swapped_stride);
             break;
         case C64:
-            copy_with_stride<c64>(x, out, swapped_shape, swapped_stride);
+            copy_with_stride<c64>(ctx, x, out, swapped_shape, swapped_stride);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
@@ -880,19 +1796,42 @@ dsc_tensor *dsc_tensor_get_idx(dsc_ctx *ctx,
 }
 
 template <typename T>
-static DSC_INLINE void copy_slice(const dsc_tensor *DSC_RESTRICT x,
+static DSC_INLINE void copy_slice(dsc_ctx *ctx,
+                                  const dsc_tensor *DSC_RESTRICT x,
                                   dsc_tensor *DSC_RESTRICT out,
                                   const int n_slices,
                                   dsc_slice *slices) noexcept {
     DSC_TENSOR_DATA(T, out);
     DSC_TENSOR_DATA(T, x);
-    dsc_slice_iterator x_it(x, n_slices, slices);
-
-    dsc_for(i, out) {
-        out_data[i] = x_data[x_it.index()];
 
-        x_it.next();
+    // Copy x as if it was a tensor with the shape of the slice and strides stride * step
+    int shape[DSC_MAX_DIMS], stride[DSC_MAX_DIMS];
+    int offset = 0;
+    for (int i = 0; i < DSC_MAX_DIMS; ++i) {
+        shape[i] = x->shape[i];
+        stride[i] = x->stride[i];
+    }
+    for (int i = 0; i < n_slices; ++i) {
+        const int dim_idx = dsc_tensor_dim(x, i);
+        const dsc_slice slice_i = slices[i];
+        const int abs_step = abs(slice_i.step);
+        shape[dim_idx] = (abs(slice_i.stop - slice_i.start) + abs_step - 1) / abs_step;
+        stride[dim_idx] = x->stride[dim_idx] * slice_i.step;
+        offset += x->stride[dim_idx] * slice_i.start;
     }
+
+    const int *strides[2] = {nullptr, stride};
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        int pos = start;
+        for (dsc_nd_iterator<2> it(shape, strides, start); pos < stop; it.next()) {
+            const int n = DSC_MIN(it.run(), stop - pos);
+            T *dst = &out_data[it.index(0)];
+            const T *src = &x_data[offset + it.index(1)];
+            const int src_stride = it.stride(1);
+            for (int j = 0; j < n; ++j) dst[j] = src[j * src_stride];
+            pos += n;
+        }
+    });
 }
 
 static DSC_INLINE void parse_slices(const dsc_tensor *DSC_RESTRICT x,
@@ -989,16 +1928,16 @@ dsc_tensor *dsc_tensor_get_slice(dsc_ctx *ctx,
 
     switch (out->dtype) {
         case F32:
-            copy_slice<f32>(x, out, slices, el_slices);
+            copy_slice<f32>(ctx, x, out, slices, el_slices);
             break;
         case F64:
-            copy_slice<f64>(x, out, slices, el_slices);
+            copy_slice<f64>(ctx, x, out, slices, el_slices);
             break;
         case C32:
-            copy_slice<c32>(x, out, slices, el_slices);
+            copy_slice<c32>(ctx, x, out, slices, el_slices);
             break;
         case C64:
-            copy_slice<c64>(x, out, slices, el_slices);
+            copy_slice<c64>(ctx, x, out, slices, el_slices);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", out->dtype);
     }
@@ -1184,61 +2123,54 @@ static bool DSC_INLINE DSC_PURE can_broadcast(const dsc_tensor *DSC_RESTRICT xa,
 }
 
 template<typename T, typename Op>
-static DSC_INLINE void binary_op(const dsc_tensor *xa,
+static DSC_INLINE void binary_op(dsc_ctx *ctx,
+                                 const dsc_tensor *xa,
                                  const dsc_tensor *xb,
                                  dsc_tensor *out,
-                                 Op op) noexcept {
+                                 Op) noexcept {
     T *xa_data = (T *) xa->data;
     T *xb_data = (T *) xb->data;
     T *out_data = (T *) out->data;
-    const bool xa_scalar = xa->n_dim == 1 && xa->shape[dsc_tensor_dim(xa, -1)] == 1;
-    const bool xb_scalar = xb->n_dim == 1 && xb->shape[dsc_tensor_dim(xb, -1)] == 1;
-
-    if (xa_scalar) {
-        const T val = xa_data[0];
-        dsc_for(i, out) {
-            out_data[i] = op(
-                    val,
-                    xb_data[i]
-            );
-        }
-    } else if (xb_scalar) {
-        const T val = xb_data[0];
-        dsc_for(i, out) {
-            out_data[i] = op(
-                    xa_data[i],
-                    val
-            );
+    const dsc_elementwise_kernels *kernels = dsc_elementwise_get_kernels();
+
+    int xa_stride[DSC_MAX_DIMS], xb_stride[DSC_MAX_DIMS];
+    dsc_broadcast_strides(xa, out->shape, xa_stride);
+    dsc_broadcast_strides(xb, out->shape, xb_stride);
+
+    // All the tensors are contiguous so, within a run, each operand is either a vector or a single value
+    // repeated (stride 0). Same-shape and scalar operands are a single run, broadcasting one operand
+    // along the outer dimensions gives runs as long as the inner dimensions.
+    const int *strides[3] = {nullptr, xa_stride, xb_stride};
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        int pos = start;
+        for (dsc_nd_iterator<3> it(out->shape, strides, start); pos < stop; it.next()) {
+            const int n = DSC_MIN(it.run(), stop - pos);
+            const dsc_operands operands = it.stride(1) == 0 ? XA_SCALAR : (it.stride(2) == 0 ? XB_SCALAR : BOTH_VECTORS);
+            dsc_get_binary_kernel<T, Op>(kernels, operands)(&xa_data[it.index(1)], &xb_data[it.index(2)],
+                                                            &out_data[it.index(0)], n);
+            pos += n;
         }
-    } else {
-        dsc_broadcast_iterator xa_it(xa, out->shape), xb_it(xb, out->shape);
-        dsc_for(i, out) {
-            out_data[i] = op(
-                    xa_data[xa_it.index()],
-                    xb_data[xb_it.index()]
-            );
-            xa_it.next(), xb_it.next();
-        }
-    }
+    });
 }
 
 template<typename Op>
-static void binary_op(const dsc_tensor *xa,
+static void binary_op(dsc_ctx *ctx,
+                      const dsc_tensor *xa,
                       const dsc_tensor *xb,
                       dsc_tensor *out,
                       Op op) noexcept {
     switch (out->dtype) {
         case dsc_dtype::F32:
-            binary_op<f32>(xa, xb, out, op);
+            binary_op<f32>(ctx, xa, xb, out, op);
             break;
         case dsc_dtype::F64:
-            binary_op<f64>(xa, xb, out, op);
+            binary_op<f64>(ctx, xa, xb, out, op);
             break;
         case dsc_dtype::C32:
-            binary_op<c32>(xa, xb, out, op);
+            binary_op<c32>(ctx, xa, xb, out, op);
             break;
         case dsc_dtype::C64:
-            binary_op<c64>(xa, xb, out, op);
+            binary_op<c64>(ctx, xa, xb, out, op);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", out->dtype);
     }
@@ -1252,7 +2184,7 @@ dsc_tensor *dsc_add(dsc_ctx *ctx,
 
     validate_binary_params();
 
-    binary_op(xa, xb, out, add_op());
+    binary_op(ctx, xa, xb, out, add_op());
 
     return out;
 }
@@ -1265,7 +2197,7 @@ dsc_tensor *dsc_sub(dsc_ctx *ctx,
 
     validate_binary_params();
 
-    binary_op(xa, xb, out, sub_op());
+    binary_op(ctx, xa, xb, out, sub_op());
 
     return out;
 }
@@ -1278,7 +2210,7 @@ dsc_tensor *dsc_mul(dsc_ctx *ctx,
 
     validate_binary_params();
 
-    binary_op(xa, xb, out, mul_op());
+    binary_op(ctx, xa, xb, out, mul_op());
 
     return out;
 }
@@ -1291,7 +2223,7 @@ dsc_tensor *dsc_div(dsc_ctx *ctx,
 
     validate_binary_params();
 
-    binary_op(xa, xb, out, div_op());
+    binary_op(ctx, xa, xb, out, div_op());
 
     return out;
 }
@@ -1304,7 +2236,7 @@ dsc_tensor *dsc_pow(dsc_ctx *ctx,
 
     validate_binary_params();
 
-    binary_op(xa, xb, out, pow_op());
+    binary_op(ctx, xa, xb, out, pow_op());
 
     return out;
 }
@@ -1313,33 +2245,47 @@ dsc_tensor *dsc_pow(dsc_ctx *ctx,
 // Unary Operations
 
 template<typename T, typename Op>
-static DSC_INLINE void unary_op(const dsc_tensor *DSC_RESTRICT x,
+static DSC_INLINE void unary_op(dsc_ctx *ctx,
+                                const dsc_tensor *DSC_RESTRICT x,
                                 dsc_tensor *DSC_RESTRICT out,
                                 Op op) noexcept {
     DSC_TENSOR_DATA(T, x);
     DSC_TENSOR_DATA(T, out);
 
-    dsc_for(i, out) {
-        out_data[i] = op(x_data[i]);
+    if constexpr (dsc_has_unary_kernel<Op>()) {
+        if (ctx->math_precision == DSC_MATH_FAST) {
+            const dsc_unary_kernel<T> kernel = dsc_get_unary_kernel<T, Op>(dsc_elementwise_get_kernels());
+            dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+                kernel(&x_data[start], &out_data[start], stop - start);
+            });
+            return;
+        }
     }
+
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        for (int i = start; i < stop; ++i) {
+            out_data[i] = op(x_data[i]);
+        }
+    });
 }
 
 template<typename Op>
-static void unary_op(const dsc_tensor *DSC_RESTRICT x,
+static void unary_op(dsc_ctx *ctx,
+                     const dsc_tensor *DSC_RESTRICT x,
                      dsc_tensor *DSC_RESTRICT out,
                      Op op) noexcept {
     switch (x->dtype) {
         case dsc_dtype::F32:
-            unary_op<f32>(x, out, op);
+            unary_op<f32>(ctx, x, out, op);
             break;
         case dsc_dtype::F64:
-            unary_op<f64>(x, out, op);
+            unary_op<f64>(ctx, x, out, op);
             break;
         case dsc_dtype::C32:
-            unary_op<c32>(x, out, op);
+            unary_op<c32>(ctx, x, out, op);
             break;
         case dsc_dtype::C64:
-            unary_op<c64>(x, out, op);
+            unary_op<c64>(ctx, x, out, op);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
@@ -1352,7 +2298,7 @@ dsc_tensor *dsc_cos(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, cos_op());
+    unary_op(ctx, x, out, cos_op());
 
     return out;
 }
@@ -1364,7 +2310,7 @@ dsc_tensor *dsc_sin(dsc_ctx *ctx,
 
     validate_unary_params();
     
-    unary_op(x, out, sin_op());
+    unary_op(ctx, x, out, sin_op());
 
     return out;
 }
@@ -1376,7 +2322,7 @@ dsc_tensor *dsc_sinc(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, sinc_op());
+    unary_op(ctx, x, out, sinc_op());
 
     return out;
 }
@@ -1388,7 +2334,7 @@ dsc_tensor *dsc_logn(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, logn_op());
+    unary_op(ctx, x, out, logn_op());
 
     return out;
 }
@@ -1400,7 +2346,7 @@ dsc_tensor *dsc_log2(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, log2_op());
+    unary_op(ctx, x, out, log2_op());
 
     return out;
 }
@@ -1412,7 +2358,7 @@ dsc_tensor *dsc_log10(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, log10_op());
+    unary_op(ctx, x, out, log10_op());
 
     return out;
 }
@@ -1424,7 +2370,7 @@ dsc_tensor *dsc_exp(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, exp_op());
+    unary_op(ctx, x, out, exp_op());
 
     return out;
 }
@@ -1436,7 +2382,7 @@ dsc_tensor *dsc_sqrt(dsc_ctx *ctx,
 
     validate_unary_params();
 
-    unary_op(x, out, sqrt_op());
+    unary_op(ctx, x, out, sqrt_op());
 
     return out;
 }
@@ -1768,26 +2714,270 @@ dsc_tensor *dsc_clip(dsc_ctx *ctx, const dsc_tensor *DSC_RESTRICT x,
     return out;
 }
 
+// ============================================================
+// Fused Elementwise Operations
+
+#define DSC_MAX_FUSED_VALUES (DSC_MAX_FUSED_INPUTS + DSC_MAX_FUSED_OPS)
+
+static_assert((int) DSC_FUSED_POW == (int) BINARY_POW, "dsc_fused_op_type - binary ops must match dsc_binary_kind");
+static_assert((int) (DSC_FUSED_EXP - DSC_FUSED_COS) == (int) UNARY_EXP,
+              "dsc_fused_op_type - unary ops must match dsc_unary_kind");
+
+static DSC_INLINE DSC_STRICTLY_PURE bool dsc_fused_is_binary(const dsc_fused_op_type type) noexcept {
+    return type <= DSC_FUSED_POW;
+}
+
+// Where each value of a fused expression lives while a tile is computed
+struct dsc_fused_plan {
+    // Tile buffer of the value or -1 if the value is read (or written, for the output) directly from its tensor
+    int slot[DSC_MAX_FUSED_VALUES];
+    // The value is the same for every element of the output: inputs with a single element and operations
+    // that only depend on them, these are computed once per tile.
+    bool scalar[DSC_MAX_FUSED_VALUES];
+};
+
+static void dsc_fused_make_plan(const int n_inputs,
+                                dsc_tensor *const *inputs,
+                                const int n_ops,
+                                const dsc_fused_op *ops,
+                                const dsc_tensor *out,
+                                dsc_fused_plan *plan) noexcept {
+    // Index of the last operation that reads each value, after that its buffer can be reused
+    int last_use[DSC_MAX_FUSED_VALUES];
+    for (int v = 0; v < n_inputs + n_ops; ++v) last_use[v] = -1;
+    for (int i = 0; i < n_ops; ++i) {
+        last_use[ops[i].a] = i;
+        if (dsc_fused_is_binary(ops[i].type)) last_use[ops[i].b] = i;
+    }
+
+    bool busy[DSC_MAX_FUSED_VALUES]{};
+    const auto alloc_slot = [&busy]() noexcept {
+        int slot = 0;
+        while (busy[slot]) ++slot;
+        busy[slot] = true;
+        return slot;
+    };
+
+    // Same-shape and single-element inputs are read in place, the others are gathered in a buffer
+    for (int i = 0; i < n_inputs; ++i) {
+        const int ne = inputs[i]->ne;
+        plan->scalar[i] = ne == 1 && out->ne != 1;
+        plan->slot[i] = (ne == out->ne || ne == 1 || last_use[i] < 0) ? -1 : alloc_slot();
+    }
+
+    for (int i = 0; i < n_ops; ++i) {
+        const dsc_fused_op op = ops[i];
+        const int v = n_inputs + i;
+        const bool binary = dsc_fused_is_binary(op.type);
+
+        // Release the operands before taking a buffer for the result: the kernels can work in place
+        if (last_use[op.a] == i && plan->slot[op.a] >= 0) busy[plan->slot[op.a]] = false;
+        if (binary && last_use[op.b] == i && plan->slot[op.b] >= 0) busy[plan->slot[op.b]] = false;
+
+        plan->scalar[v] = plan->scalar[op.a] && (!binary || plan->scalar[op.b]);
+        plan->slot[v] = (i == n_ops - 1 && !plan->scalar[v]) ? -1 : alloc_slot();
+    }
+}
+
+template<typename T>
+static DSC_INLINE void fused_op(dsc_ctx *ctx,
+                                const int n_inputs,
+                                dsc_tensor *const *inputs,
+                                const int n_ops,
+                                const dsc_fused_op *ops,
+                                const dsc_fused_plan *plan,
+                                dsc_tensor *out) noexcept {
+    constexpr int tile = DSC_FUSED_TILE_BYTES / sizeof(T);
+
+    T *out_data = (T *) out->data;
+    const dsc_elementwise_kernels *kernels = dsc_elementwise_get_kernels();
+    // The scalar kernels of the elementary functions are the libm loops of the accurate precision
+    const dsc_elementwise_kernels *math_kernels = ctx->math_precision == DSC_MATH_FAST ?
+                                                  kernels : dsc_elementwise_get_kernels(SCALAR);
+
+    int strides[DSC_MAX_FUSED_INPUTS][DSC_MAX_DIMS];
+    for (int i = 0; i < n_inputs; ++i) {
+        if (plan->slot[i] >= 0) dsc_broadcast_strides(inputs[i], out->shape, strides[i]);
+    }
+
+    const int last = n_inputs + n_ops - 1;
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        alignas(DSC_SIMD_ALIGN) T buffers[DSC_MAX_FUSED_VALUES][tile];
+        const T *values[DSC_MAX_FUSED_VALUES];
+
+        for (int tile_start = start; tile_start < stop; tile_start += tile) {
+            const int n = DSC_MIN(tile, stop - tile_start);
+
+            for (int i = 0; i < n_inputs; ++i) {
+                const T *x_data = (const T *) inputs[i]->data;
+                if (plan->slot[i] < 0) {
+                    values[i] = plan->scalar[i] ? x_data : &x_data[tile_start];
+                    continue;
+                }
+
+                // Broadcast input: copy the elements of this tile, within a run they are either contiguous
+                // or the same element repeated
+                T *buf = buffers[plan->slot[i]];
+                const int *x_strides[1] = {strides[i]};
+                int pos = 0;
+                for (dsc_nd_iterator<1> it(out->shape, x_strides, tile_start); pos < n; it.next()) {
+                    const int run = DSC_MIN(it.run(), n - pos);
+                    const int stride = it.stride(0);
+                    const T *src = &x_data[it.index(0)];
+                    for (int j = 0; j < run; ++j) buf[pos + j] = src[j * stride];
+                    pos += run;
+                }
+                values[i] = buf;
+            }
+
+            for (int i = 0; i < n_ops; ++i) {
+                const dsc_fused_op op = ops[i];
+                const int v = n_inputs + i;
+                const int ne = plan->scalar[v] ? 1 : n;
+                T *dst = plan->slot[v] < 0 ? &out_data[tile_start] : buffers[plan->slot[v]];
+
+                if (dsc_fused_is_binary(op.type)) {
+                    // If the result is a scalar both operands are and BOTH_VECTORS computes the single element
+                    const dsc_operands operands = plan->scalar[v] ? BOTH_VECTORS :
+                                                  (plan->scalar[op.a] ? XA_SCALAR :
+                                                   (plan->scalar[op.b] ? XB_SCALAR : BOTH_VECTORS));
+                    dsc_get_binary_kernel<T>(kernels, (dsc_binary_kind) op.type, operands)(values[op.a],
+                                                                                           values[op.b],
+                                                                                           dst, ne);
+                } else if (op.type == DSC_FUSED_SQRT) {
+                    const T *x = values[op.a];
+                    const sqrt_op sqrt_fn;
+                    for (int j = 0; j < ne; ++j) dst[j] = sqrt_fn(x[j]);
+                } else {
+                    dsc_get_unary_kernel<T>(math_kernels, (dsc_unary_kind) (op.type - DSC_FUSED_COS))(values[op.a],
+                                                                                                      dst, ne);
+                }
+                values[v] = dst;
+            }
+
+            if (plan->slot[last] >= 0) {
+                // The expression doesn't depend on the position (eg. a scalar input that isn't broadcast)
+                for (int j = 0; j < n; ++j) out_data[tile_start + j] = values[last][0];
+            }
+        }
+    }, n_ops);
+}
+
+dsc_tensor *dsc_fused(dsc_ctx *ctx,
+                      const int n_inputs,
+                      dsc_tensor **inputs,
+                      const int n_ops,
+                      const dsc_fused_op *ops,
+                      dsc_tensor *out) noexcept {
+    DSC_ASSERT(inputs != nullptr);
+    DSC_ASSERT(ops != nullptr);
+    DSC_ASSERT(n_inputs > 0 && n_inputs <= DSC_MAX_FUSED_INPUTS);
+    DSC_ASSERT(n_ops > 0 && n_ops <= DSC_MAX_FUSED_OPS);
+
+    int n_dim = 0;
+    int shape[DSC_MAX_DIMS] = {1, 1, 1, 1};
+    dsc_dtype out_dtype = inputs[0]->dtype;
+    for (int i = 0; i < n_inputs; ++i) {
+        const dsc_tensor *x = inputs[i];
+        DSC_ASSERT(x != nullptr);
+
+        n_dim = DSC_MAX(n_dim, x->n_dim);
+        for (int j = 0; j < DSC_MAX_DIMS; ++j) {
+            DSC_ASSERT(x->shape[j] == shape[j] || x->shape[j] == 1 || shape[j] == 1);
+            shape[j] = DSC_MAX(shape[j], x->shape[j]);
+        }
+        out_dtype = DSC_DTYPE_CONVERSION_TABLE[out_dtype][x->dtype];
+    }
+
+    for (int i = 0; i < n_ops; ++i) {
+        DSC_ASSERT(ops[i].type <= DSC_FUSED_SQRT);
+        DSC_ASSERT(ops[i].a >= 0 && ops[i].a < n_inputs + i);
+        DSC_ASSERT(!dsc_fused_is_binary(ops[i].type) || (ops[i].b >= 0 && ops[i].b < n_inputs + i));
+    }
+
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, n_dim, &shape[DSC_MAX_DIMS - n_dim], out_dtype);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == n_dim);
+        DSC_ASSERT(memcmp(out->shape, shape, DSC_MAX_DIMS * sizeof(shape[0])) == 0);
+    }
+
+    dsc_tensor *fused_inputs[DSC_MAX_FUSED_INPUTS];
+    DSC_CTX_PUSH(ctx);
+    for (int i = 0; i < n_inputs; ++i) fused_inputs[i] = dsc_cast(ctx, inputs[i], out_dtype);
+    DSC_CTX_POP(ctx);
+
+    dsc_fused_plan plan;
+    dsc_fused_make_plan(n_inputs, fused_inputs, n_ops, ops, out, &plan);
+
+    switch (out_dtype) {
+        case F32:
+            fused_op<f32>(ctx, n_inputs, fused_inputs, n_ops, ops, &plan, out);
+            break;
+        case F64:
+            fused_op<f64>(ctx, n_inputs, fused_inputs, n_ops, ops, &plan, out);
+            break;
+        case C32:
+            fused_op<c32>(ctx, n_inputs, fused_inputs, n_ops, ops, &plan, out);
+            break;
+        case C64:
+            fused_op<c64>(ctx, n_inputs, fused_inputs, n_ops, ops, &plan, out);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", out_dtype);
+    }
+
+    return out;
+}
+
 // ============================================================
 // Unary Operations Along Axis
 
-template <typename T>
-static DSC_INLINE void sum(const dsc_tensor *DSC_RESTRICT x,
-                           dsc_tensor *DSC_RESTRICT out,
-                           int axis_idx) noexcept {
+// Reduce x along the given axis. x is seen as [rows, axis_n, cols] and out as [rows, cols], when reducing
+// the last axis (cols = 1) each output is folded from a contiguous run of x otherwise a range of outputs
+// is updated at once with contiguous runs of x for each step along the axis. Either way every output is
+// folded in order along the axis so the result doesn't depend on how the outputs are split among the threads.
+template <typename T, typename Op>
+static DSC_INLINE void reduce(dsc_ctx *ctx,
+                              const dsc_tensor *DSC_RESTRICT x,
+                              dsc_tensor *DSC_RESTRICT out,
+                              const int axis_idx,
+                              const T init,
+                              Op op) noexcept {
     DSC_TENSOR_DATA(T, x);
     DSC_TENSOR_DATA(T, out);
 
     const int axis_n = x->shape[axis_idx];
-    dsc_axis_iterator x_it(x, axis_idx, axis_n);
-    dsc_for(i, out) {
-        T acc = dsc_zero<T>();
-        for (int j = 0; j < axis_n; ++j) {
-            acc = add_op()(acc, x_data[x_it.index()]);
-            x_it.next();
+    int cols = 1;
+    for (int i = axis_idx + 1; i < DSC_MAX_DIMS; ++i) cols *= x->shape[i];
+
+    dsc_parallel_items<T>(ctx, out->ne, [&](const int start, const int stop) noexcept {
+        for (int pos = start; pos < stop;) {
+            const int row = pos / cols, col = pos % cols;
+            const int n = DSC_MIN(stop - pos, cols - col);
+            const T *src = &x_data[(row * axis_n) * cols + col];
+            T *dst = &out_data[pos];
+            if (cols == 1) {
+                T acc = init;
+                for (int j = 0; j < axis_n; ++j) acc = op(acc, src[j]);
+                dst[0] = acc;
+            } else {
+                for (int k = 0; k < n; ++k) dst[k] = init;
+                for (int j = 0; j < axis_n; ++j, src += cols) {
+                    for (int k = 0; k < n; ++k) dst[k] = op(dst[k], src[k]);
+                }
+            }
+            pos += n;
         }
-        out_data[i] = acc;
-    }
+    }, axis_n);
+}
+
+template <typename T>
+static DSC_INLINE void sum(dsc_ctx *ctx,
+                           const dsc_tensor *DSC_RESTRICT x,
+                           dsc_tensor *DSC_RESTRICT out,
+                           int axis_idx) noexcept {
+    reduce(ctx, x, out, axis_idx, dsc_zero<T>(), add_op());
 }
 
 dsc_tensor *dsc_sum(dsc_ctx *ctx,
@@ -1805,16 +2995,16 @@ dsc_tensor *dsc_sum(dsc_ctx *ctx,
 
     switch (out->dtype) {
         case F32:
-            sum<f32>(x, out, axis_idx);
+            sum<f32>(ctx, x, out, axis_idx);
             break;
         case F64:
-            sum<f64>(x, out, axis_idx);
+            sum<f64>(ctx, x, out, axis_idx);
             break;
         case C32:
-            sum<c32>(x, out, axis_idx);
+            sum<c32>(ctx, x, out, axis_idx);
             break;
         case C64:
-            sum<c64>(x, out, axis_idx);
+            sum<c64>(ctx, x, out, axis_idx);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", out->dtype);
     }
@@ -1855,22 +3045,11 @@ dsc_tensor *dsc_mean(dsc_ctx *ctx,
 }
 
 template <typename T>
-static DSC_INLINE void max(const dsc_tensor *DSC_RESTRICT x,
+static DSC_INLINE void max(dsc_ctx *ctx,
+                           const dsc_tensor *DSC_RESTRICT x,
                            dsc_tensor *DSC_RESTRICT out,
                            int axis_idx) noexcept {
-    DSC_TENSOR_DATA(T, x);
-    DSC_TENSOR_DATA(T, out);
-
-    const int axis_n = x->shape[axis_idx];
-    dsc_axis_iterator x_it(x, axis_idx, axis_n);
-    dsc_for(i, out) {
-        T max = dsc_inf<T, false>();
-        for (int j = 0; j < axis_n; ++j) {
-            max = max_op()(max, x_data[x_it.index()]);
-            x_it.next();
-        }
-        out_data[i] = max;
-    }
+    reduce(ctx, x, out, axis_idx, dsc_inf<T, false>(), max_op());
 }
 
 dsc_tensor *dsc_max(dsc_ctx *ctx,
@@ -1886,16 +3065,16 @@ dsc_tensor *dsc_max(dsc_ctx *ctx,
 
     switch (out->dtype) {
         case F32:
-            max<f32>(x, out, axis_idx);
+            max<f32>(ctx, x, out, axis_idx);
             break;
         case F64:
-            max<f64>(x, out, axis_idx);
+            max<f64>(ctx, x, out, axis_idx);
             break;
         case C32:
-            max<c32>(x, out, axis_idx);
+            max<c32>(ctx, x, out, axis_idx);
             break;
         case C64:
-            max<c64>(x, out, axis_idx);
+            max<c64>(ctx, x, out, axis_idx);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", out->dtype);
     }
@@ -1904,22 +3083,11 @@ dsc_tensor *dsc_max(dsc_ctx *ctx,
 }
 
 template <typename T>
-static DSC_INLINE void min(const dsc_tensor *DSC_RESTRICT x,
+static DSC_INLINE void min(dsc_ctx *ctx,
+                           const dsc_tensor *DSC_RESTRICT x,
                            dsc_tensor *DSC_RESTRICT out,
                            int axis_idx) noexcept {
-    DSC_TENSOR_DATA(T, x);
-    DSC_TENSOR_DATA(T, out);
-
-    const int axis_n = x->shape[axis_idx];
-    dsc_axis_iterator x_it(x, axis_idx, axis_n);
-    dsc_for(i, out) {
-        T min = dsc_inf<T, true>();
-        for (int j = 0; j < axis_n; ++j) {
-            min = min_op()(min, x_data[x_it.index()]);
-            x_it.next();
-        }
-        out_data[i] = min;
-    }
+    reduce(ctx, x, out, axis_idx, dsc_inf<T, true>(), min_op());
 }
 
 dsc_tensor *dsc_min(dsc_ctx *ctx,
@@ -1935,16 +3103,16 @@ dsc_tensor *dsc_min(dsc_ctx *ctx,
 
     switch (out->dtype) {
         case F32:
-            min<f32>(x, out, axis_idx);
+            min<f32>(ctx, x, out, axis_idx);
             break;
         case F64:
-            min<f64>(x, out, axis_idx);
+            min<f64>(ctx, x, out, axis_idx);
             break;
         case C32:
-            min<c32>(x, out, axis_idx);
+            min<c32>(ctx, x, out, axis_idx);
             break;
         case C64:
-            min<c64>(x, out, axis_idx);
+            min<c64>(ctx, x, out, axis_idx);
             break;
         DSC_INVALID_CASE("unknown dtype=%d", out->dtype);
     }
@@ -1955,55 +3123,325 @@ dsc_tensor *dsc_min(dsc_ctx *ctx,
 // ============================================================
 // Fourier Transforms
 
+// The lines of an FFT are split among the threads in units of either a full batch or a single line.
+// The units are the same regardless of the number of threads so each line is always transformed by the
+// same kernel and the result doesn't depend on how many threads are used.
+struct dsc_fft_units {
+    int batch = 1, full_batches = 0, count = 0;
+
+    dsc_fft_units() noexcept = default;
+
+    dsc_fft_units(const int lines, const int batch_size) noexcept :
+            batch(batch_size), full_batches(batch_size > 1 ? lines / batch_size : 0),
+            count(full_batches + (lines - full_batches * batch_size)) {}
+
+    // Index of the first line of unit u
+    DSC_INLINE int line(const int u) const noexcept {
+        return u < full_batches ? u * batch : full_batches * batch + (u - full_batches);
+    }
+
+    // Number of lines in unit u
+    DSC_INLINE int size(const int u) const noexcept {
+        return u < full_batches ? batch : 1;
+    }
+};
+
+// How the lines of a transform over one axis are split among the workers and how much scratch
+// each worker needs. The scratch is allocated by the caller so it can be shared by several transforms.
+struct dsc_fft_job {
+    dsc_fft_plan *plan;
+    dsc_fft_units units;
+    int n_workers;
+    // Number of elements of buff and fft_work used by each worker
+    int buff_n, work_n;
+    // Real transforms of odd order pack two lines in each complex FFT, the units are made of pairs of lines
+    bool paired;
+};
+
+// line_n is the number of elements of buff needed by a single line (or pair of lines), n is the length of the transform
+static DSC_INLINE dsc_fft_job dsc_fft_job_init(const dsc_ctx *ctx, dsc_fft_plan *plan,
+                                               const dsc_tensor *x, const dsc_tensor *out,
+                                               const int axis, const int line_n,
+                                               const int n, const bool paired = false) noexcept {
+    const int lines = x->ne / x->shape[axis];
+    const int items = paired ? (lines + 1) >> 1 : lines;
+    const int batch = dsc_fft_batch_size(plan, items, x->stride[axis] == 1 && out->stride[axis] == 1);
+    const dsc_fft_units units(items, batch);
+
+    const int max_workers = DSC_MIN(ctx->n_threads, units.count);
+    const int n_workers = DSC_MAX(1, DSC_MIN(max_workers, (items * n) / DSC_FFT_MIN_WORK_PER_THREAD));
+
+    return {plan, units, n_workers, line_n * batch, dsc_fft_work_size(plan->n, plan->algorithm) * batch, paired};
+}
+
+// x and out can be the same tensor: each line is copied to buff before being written back so
+// an FFT that doesn't change the size of the axis can be done in-place.
+// Only the k_n bins starting from k_start are written to out.
 template<typename Tin, typename Tout, bool forward>
 static DSC_INLINE void exec_fft(dsc_ctx *ctx,
-                                const dsc_tensor *DSC_RESTRICT x,
-                                dsc_tensor *DSC_RESTRICT out,
+                                const dsc_fft_job &job,
+                                const dsc_tensor *x,
+                                dsc_tensor *out,
                                 const int axis, const int x_n,
-                                const int fft_n) noexcept {
-    const dsc_dtype out_dtype = out->dtype;
-    dsc_fft_plan *plan = dsc_plan_fft(ctx, fft_n, COMPLEX, out_dtype);
+                                const int fft_n,
+                                const int k_start, const int k_n,
+                                Tout *DSC_RESTRICT buff,
+                                Tout *DSC_RESTRICT fft_work) noexcept {
+    // The lines are copied in groups of batch lines into buff as buff[fft_n][batch] so they can
+    // be transformed together. If batch is 1 this is the usual one line at a time FFT.
+    dsc_fft_plan *plan = job.plan;
+    const dsc_fft_units &units = job.units;
+    const int copy_n = DSC_MIN(x_n, fft_n);
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(Tin, x);
+        DSC_TENSOR_DATA(Tout, out);
+        // Each worker gets its own slice of the scratch buffers
+        Tout *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        Tout *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
+
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, units.line(unit_start));
+        dsc_line_iterator out_it(out, axis, units.line(unit_start));
+        int x_offset[DSC_FFT_MAX_BATCH], out_offset[DSC_FFT_MAX_BATCH];
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            // The lines that don't fill a complete batch are transformed one at a time
+            const int b_n = units.size(unit);
+            for (int b = 0; b < b_n; ++b) {
+                x_offset[b] = x_it.index();
+                out_offset[b] = out_it.index();
+                x_it.next();
+                out_it.next();
+            }
 
-    DSC_CTX_PUSH(ctx);
-    // Push the arena to make these two buffers temporary
-    dsc_tensor *buff = dsc_tensor_1d(ctx, out_dtype, fft_n);
-    dsc_tensor *fft_work = dsc_tensor_1d(ctx, out_dtype, fft_n);
-
-    DSC_TENSOR_DATA(Tin, x);
-    DSC_TENSOR_DATA(Tout, buff);
-    DSC_TENSOR_DATA(Tout, out);
-    DSC_TENSOR_DATA(Tout, fft_work);
-
-    dsc_axis_iterator x_it(x, axis, fft_n);
-    dsc_axis_iterator out_it(out, axis, fft_n);
-
-    while (x_it.has_next()) {
-        for (int i = 0; i < fft_n; ++i) {
-            if (i < x_n) {
-                int idx = x_it.index();
-                if constexpr (dsc_is_type<Tin, Tout>()) {
-                    buff_data[i] = x_data[idx];
-                } else {
-                    buff_data[i] = cast_op().template operator()<Tin, Tout>(x_data[idx]);
+            if (dsc_is_type<Tin, Tout>() && b_n == 1 && x_stride == 1) {
+                memcpy(buff_data, &x_data[x_offset[0]], copy_n * sizeof(Tout));
+            } else {
+                for (int i = 0; i < copy_n; ++i) {
+                    for (int b = 0; b < b_n; ++b) {
+                        if constexpr (dsc_is_type<Tin, Tout>()) {
+                            buff_data[i * b_n + b] = x_data[x_offset[b] + i * x_stride];
+                        } else {
+                            buff_data[i * b_n + b] = cast_op().template operator()<Tin, Tout>(x_data[x_offset[b] + i * x_stride]);
+                        }
+                    }
                 }
+            }
+            for (int i = copy_n * b_n; i < fft_n * b_n; ++i) buff_data[i] = dsc_zero<Tout>();
 
-                x_it.next();
+            if (b_n == 1) dsc_complex_fft<Tout, forward>(plan, buff_data, fft_work_data);
+            else dsc_complex_fft_batch<Tout, forward>(plan, buff_data, fft_work_data, b_n);
+
+            if (b_n == 1 && out_stride == 1) {
+                memcpy(&out_data[out_offset[0]], &buff_data[k_start], k_n * sizeof(Tout));
             } else {
-                buff_data[i] = dsc_zero<Tout>();
+                for (int i = 0; i < k_n; ++i) {
+                    for (int b = 0; b < b_n; ++b)
+                        out_data[out_offset[b] + i * out_stride] = buff_data[(k_start + i) * b_n + b];
+                }
             }
         }
+    });
+}
 
-        dsc_complex_fft<Tout, forward>(plan, buff_data, fft_work_data);
-
-        for (int i = 0; i < fft_n; ++i) {
-            const int idx = out_it.index();
-            out_data[idx] = buff_data[i];
+// Pruned FFTs are transformed one line at a time since the P sub-transforms of each line are already batched.
+// plan is the plan of the sub-transforms and buff_n the number of elements of buff needed by each line.
+static DSC_INLINE dsc_fft_job dsc_fft_pruned_job_init(const dsc_ctx *ctx, dsc_fft_plan *plan,
+                                                      const dsc_tensor *x, const int axis,
+                                                      const int buff_n, const int work_n,
+                                                      const int n) noexcept {
+    const int lines = x->ne / x->shape[axis];
+    const dsc_fft_units units(lines, 1);
+    const int n_workers = DSC_MAX(1, DSC_MIN(DSC_MIN(ctx->n_threads, lines), (lines * n) / DSC_FFT_MIN_WORK_PER_THREAD));
+    return {plan, units, n_workers, buff_n, work_n, false};
+}
 
+// Same as exec_fft but each line is transformed with a pruned FFT of order fft_n = P * M,
+// see dsc_fft_choose_pruning. Each line needs fft_n + max(x_n, k_n) elements of buff and fft_n
+// elements of fft_work. Twiddles are the P + M twiddles of the pruned FFT.
+template<typename Tin, typename Tout, bool forward>
+static DSC_INLINE void exec_pruned_fft(dsc_ctx *ctx,
+                                       const dsc_fft_job &job,
+                                       const dsc_fft_pruning &pruning,
+                                       const dsc_tensor *x,
+                                       dsc_tensor *out,
+                                       const int axis, const int x_n,
+                                       const int fft_n,
+                                       const int k_start, const int k_n,
+                                       const Tout *DSC_RESTRICT twiddles,
+                                       Tout *DSC_RESTRICT buff,
+                                       Tout *DSC_RESTRICT fft_work) noexcept {
+    dsc_fft_plan *sub_plan = job.plan;
+    const int m = pruning.m, p = pruning.p;
+    const int copy_n = DSC_MIN(x_n, fft_n);
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const Tout *DSC_RESTRICT twiddles_q = twiddles;
+    const Tout *DSC_RESTRICT twiddles_r = &twiddles[p];
+    const real<Tout> scale = forward ? (real<Tout>) 1 : (real<Tout>) 1 / (real<Tout>) fft_n;
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(Tin, x);
+        DSC_TENSOR_DATA(Tout, out);
+        // The first fft_n elements hold the transform, the others the input (input pruning)
+        // or the requested bins (output pruning)
+        Tout *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        Tout *DSC_RESTRICT line_data = &buff_data[fft_n];
+        Tout *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
+
+        const int line_start = job.units.count * worker / n_threads;
+        const int line_stop = job.units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, line_start);
+        dsc_line_iterator out_it(out, axis, line_start);
+
+        for (int line = line_start; line < line_stop; ++line) {
+            const int x_offset = x_it.index();
+            const int out_offset = out_it.index();
+            x_it.next();
             out_it.next();
+
+            if (pruning.type == INPUT_PRUNING) {
+                for (int i = 0; i < copy_n; ++i) {
+                    if constexpr (dsc_is_type<Tin, Tout>()) {
+                        line_data[i] = x_data[x_offset + i * x_stride];
+                    } else {
+                        line_data[i] = cast_op().template operator()<Tin, Tout>(x_data[x_offset + i * x_stride]);
+                    }
+                }
+
+                dsc_fft_pruned_input<Tout, forward>(sub_plan, pruning, copy_n, line_data, buff_data,
+                                                    fft_work_data, twiddles_q, twiddles_r);
+
+                // X[k] is element k / P of the sub-transform k % P
+                int k_i = k_start / p, k_b = k_start - k_i * p;
+                for (int i = 0; i < k_n; ++i) {
+                    Tout val = buff_data[dsc_fft_pruned_index(pruning, k_i, k_b)];
+                    if constexpr (!forward) {
+                        val.real *= scale;
+                        val.imag *= scale;
+                    }
+                    out_data[out_offset + i * out_stride] = val;
+                    if (++k_b == p) {
+                        k_b = 0;
+                        k_i++;
+                    }
+                }
+            } else {
+                // The sub-transform b is made of the inputs x[i * P + b]
+                for (int i = 0; i < m; ++i) {
+                    for (int b = 0; b < p; ++b) {
+                        const int idx = i * p + b;
+                        Tout val = dsc_zero<Tout>();
+                        if (idx < copy_n) {
+                            if constexpr (dsc_is_type<Tin, Tout>()) {
+                                val = x_data[x_offset + idx * x_stride];
+                            } else {
+                                val = cast_op().template operator()<Tin, Tout>(x_data[x_offset + idx * x_stride]);
+                            }
+                        }
+                        buff_data[dsc_fft_pruned_index(pruning, i, b)] = val;
+                    }
+                }
+
+                dsc_fft_pruned_sub_ffts<Tout, forward>(sub_plan, pruning, buff_data, fft_work_data);
+                dsc_fft_pruned_output<Tout, forward, false>(pruning, pruning.batched ? p : 1, pruning.batched ? 1 : m,
+                                                            k_start, k_start + k_n, buff_data, line_data,
+                                                            twiddles_q, twiddles_r);
+
+                for (int i = 0; i < k_n; ++i) {
+                    Tout val = line_data[i];
+                    if constexpr (!forward) {
+                        val.real *= scale;
+                        val.imag *= scale;
+                    }
+                    out_data[out_offset + i * out_stride] = val;
+                }
+            }
         }
+    });
+}
+
+template<bool forward>
+static DSC_INLINE void dsc_fft_axis(dsc_ctx *ctx,
+                                    const dsc_fft_job &job,
+                                    const dsc_tensor *x,
+                                    dsc_tensor *out,
+                                    const int axis, const int n,
+                                    const int k_start, const int k_n,
+                                    dsc_tensor *buff,
+                                    dsc_tensor *fft_work) noexcept {
+    const int x_n = x->shape[axis];
+    switch (x->dtype) {
+        case F32:
+            exec_fft<f32, c32, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c32 *) buff->data, (c32 *) fft_work->data);
+            break;
+        case F64:
+            exec_fft<f64, c64, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c64 *) buff->data, (c64 *) fft_work->data);
+            break;
+        case C32:
+            exec_fft<c32, c32, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c32 *) buff->data, (c32 *) fft_work->data);
+            break;
+        case C64:
+            exec_fft<c64, c64, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c64 *) buff->data, (c64 *) fft_work->data);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
+}
 
-    DSC_CTX_POP(ctx);
+template<bool forward>
+static DSC_INLINE void dsc_pruned_fft_axis(dsc_ctx *ctx,
+                                           const dsc_fft_job &job,
+                                           const dsc_fft_pruning &pruning,
+                                           const dsc_tensor *x,
+                                           dsc_tensor *out,
+                                           const int axis, const int n,
+                                           const int k_start, const int k_n,
+                                           const dsc_tensor *twiddles,
+                                           dsc_tensor *buff,
+                                           dsc_tensor *fft_work) noexcept {
+    const int x_n = x->shape[axis];
+    switch (x->dtype) {
+        case F32:
+            exec_pruned_fft<f32, c32, forward>(ctx, job, pruning, x, out, axis, x_n, n, k_start, k_n,
+                                               (const c32 *) twiddles->data, (c32 *) buff->data, (c32 *) fft_work->data);
+            break;
+        case F64:
+            exec_pruned_fft<f64, c64, forward>(ctx, job, pruning, x, out, axis, x_n, n, k_start, k_n,
+                                               (const c64 *) twiddles->data, (c64 *) buff->data, (c64 *) fft_work->data);
+            break;
+        case C32:
+            exec_pruned_fft<c32, c32, forward>(ctx, job, pruning, x, out, axis, x_n, n, k_start, k_n,
+                                               (const c32 *) twiddles->data, (c32 *) buff->data, (c32 *) fft_work->data);
+            break;
+        case C64:
+            exec_pruned_fft<c64, c64, forward>(ctx, job, pruning, x, out, axis, x_n, n, k_start, k_n,
+                                               (const c64 *) twiddles->data, (c64 *) buff->data, (c64 *) fft_work->data);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    }
+}
+
+// Fill a temporary tensor with the twiddles of a pruned FFT of order n
+static DSC_INLINE dsc_tensor *dsc_new_pruning_twiddles(dsc_ctx *ctx, const int n,
+                                                        const dsc_fft_pruning &pruning,
+                                                        const dsc_dtype dtype) noexcept {
+    dsc_tensor *twiddles = dsc_tensor_1d(ctx, dtype, pruning.p + pruning.m);
+    switch (dtype) {
+        case C32:
+            dsc_fft_pruning_twiddles<c32>(n, pruning, (c32 *) twiddles->data);
+            break;
+        case C64:
+            dsc_fft_pruning_twiddles<c64>(n, pruning, (c64 *) twiddles->data);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+    return twiddles;
 }
 
 template<bool forward>
@@ -2011,7 +3449,9 @@ static DSC_INLINE dsc_tensor *dsc_internal_fft(dsc_ctx *ctx,
                                                const dsc_tensor *DSC_RESTRICT x,
                                                dsc_tensor *DSC_RESTRICT out,
                                                int n,
-                                               const int axis) noexcept {
+                                               const int axis,
+                                               const int bin_start,
+                                               int bin_stop) noexcept {
     DSC_ASSERT(x != nullptr);
 
     DSC_TRACE_FFT_OP(x, out, n, axis, dsc_fft_type::COMPLEX, forward);
@@ -2020,16 +3460,14 @@ static DSC_INLINE dsc_tensor *dsc_internal_fft(dsc_ctx *ctx,
     DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
 
     const int x_n = x->shape[axis_idx];
-    const int axis_n = dsc_pow2_n(x_n);
-    if (n > 0) {
-        n = dsc_pow2_n(n);
-    } else {
-        n = axis_n;
-    }
+    if (n <= 0) n = x_n;
+    if (bin_stop <= 0) bin_stop = n;
+    DSC_ASSERT(bin_start >= 0 && bin_start < bin_stop && bin_stop <= n);
+    const int k_n = bin_stop - bin_start;
 
     int out_shape[DSC_MAX_DIMS];
     for (int i = 0; i < DSC_MAX_DIMS; ++i)
-        out_shape[i] = i != axis_idx ? x->shape[i] : n;
+        out_shape[i] = i != axis_idx ? x->shape[i] : k_n;
 
     dsc_dtype out_dtype = x->dtype;
     if (x->dtype == F32) {
@@ -2051,22 +3489,39 @@ static DSC_INLINE dsc_tensor *dsc_internal_fft(dsc_ctx *ctx,
                   x->shape[0], x->shape[1], x->shape[2], x->shape[3],
                   axis_idx, x->shape[axis_idx]);
 
-    switch (x->dtype) {
-        case F32:
-            exec_fft<f32, c32, forward>(ctx, x, out, axis_idx, x_n, n);
-            break;
-        case F64:
-            exec_fft<f64, c64, forward>(ctx, x, out, axis_idx, x_n, n);
-            break;
-        case C32:
-            exec_fft<c32, c32, forward>(ctx, x, out, axis_idx, x_n, n);
-            break;
-        case C64:
-            exec_fft<c64, c64, forward>(ctx, x, out, axis_idx, x_n, n);
-            break;
-        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    const dsc_fft_pruning pruning = dsc_fft_choose_pruning(n, DSC_MIN(x_n, n), k_n, false, out_dtype);
+    if (pruning.type != NO_PRUNING) {
+        DSC_LOG_DEBUG("using %s pruning with P=%d M=%d",
+                      pruning.type == INPUT_PRUNING ? "input" : "output", pruning.p, pruning.m);
+
+        dsc_fft_plan *sub_plan = dsc_plan_fft(ctx, pruning.m, COMPLEX, out_dtype);
+        const dsc_fft_job job = dsc_fft_pruned_job_init(ctx, sub_plan, x, axis_idx,
+                                                        n + DSC_MAX(DSC_MIN(x_n, n), k_n), n, n);
+
+        DSC_CTX_PUSH(ctx);
+        dsc_tensor *twiddles = dsc_new_pruning_twiddles(ctx, n, pruning, out_dtype);
+        dsc_tensor *buff = dsc_tensor_1d(ctx, out_dtype, job.buff_n * job.n_workers);
+        dsc_tensor *fft_work = dsc_tensor_1d(ctx, out_dtype, job.work_n * job.n_workers);
+
+        dsc_pruned_fft_axis<forward>(ctx, job, pruning, x, out, axis_idx, n, bin_start, k_n,
+                                     twiddles, buff, fft_work);
+
+        DSC_CTX_POP(ctx);
+        return out;
     }
 
+    dsc_fft_plan *plan = dsc_plan_fft(ctx, n, COMPLEX, out_dtype);
+    const dsc_fft_job job = dsc_fft_job_init(ctx, plan, x, out, axis_idx, n, n);
+
+    DSC_CTX_PUSH(ctx);
+    // Push the arena to make these two buffers temporary
+    dsc_tensor *buff = dsc_tensor_1d(ctx, out_dtype, job.buff_n * job.n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, out_dtype, job.work_n * job.n_workers);
+
+    dsc_fft_axis<forward>(ctx, job, x, out, axis_idx, n, bin_start, k_n, buff, fft_work);
+
+    DSC_CTX_POP(ctx);
+
     return out;
 }
 
@@ -2074,113 +3529,397 @@ dsc_tensor *dsc_fft(dsc_ctx *ctx,
                     const dsc_tensor *DSC_RESTRICT x,
                     dsc_tensor *DSC_RESTRICT out,
                     const int n,
-                    const int axis) noexcept {
-    // Find N
-
-    // Get the plan
-
-    // --> Parallel START <--
-    // Copy the desired axis of X over to a temp buffer (or out if we can go in-place?)
-
-    // Perform the FFT
-
-    // Write the result back (or not if we are working in-place?)
-    // --> Parallel STOP <--
-
-    // Done!
-    return dsc_internal_fft<true>(ctx, x, out, n, axis);
+                    const int axis,
+                    const int bin_start,
+                    const int bin_stop) noexcept {
+    return dsc_internal_fft<true>(ctx, x, out, n, axis, bin_start, bin_stop);
 }
 
 dsc_tensor *dsc_ifft(dsc_ctx *ctx,
                      const dsc_tensor *DSC_RESTRICT x,
                      dsc_tensor *DSC_RESTRICT out,
                      const int n,
-                     const int axis) noexcept {
-    return dsc_internal_fft<false>(ctx, x, out, n, axis);
+                     const int axis,
+                     const int bin_start,
+                     const int bin_stop) noexcept {
+    return dsc_internal_fft<false>(ctx, x, out, n, axis, bin_start, bin_stop);
 }
 
-template<typename T, bool forward>
-static DSC_INLINE void exec_rfft(dsc_ctx *ctx,
+// N is the number of real samples. If N is even the transform is computed using a complex
+// FFT of order N/2 plus a post-processing step, otherwise we just do a complex FFT of order N.
+static DSC_INLINE dsc_fft_plan *dsc_plan_rfft(dsc_ctx *ctx, const int n,
+                                              const dsc_dtype dtype) noexcept {
+    const bool even = (n & 1) == 0;
+    return dsc_plan_fft(ctx, even ? (n >> 1) : n, even ? REAL : COMPLEX, dtype);
+}
+
+// Elements of buff needed by a single line of a real transform of N samples, if N is odd
+// this is a pair of lines
+static DSC_INLINE DSC_STRICTLY_PURE int dsc_rfft_line_n(const int n) noexcept {
+    return ((n & 1) == 0 ? (n >> 1) : n) + 1;
+}
+
+// RFFT of even order N computed with the complex FFT of order N/2 of the packed samples.
+// For the forward transform only the k_n bins starting from k_start are written to out.
+template<typename T, bool forward>
+static DSC_INLINE void exec_rfft(dsc_ctx *ctx,
+                                 const dsc_fft_job &job,
                                  const dsc_tensor *DSC_RESTRICT x,
                                  dsc_tensor *DSC_RESTRICT out,
                                  const int axis, const int x_n,
-                                 const int out_n, const int fft_order) noexcept {
+                                 const int n,
+                                 const int k_start, const int k_n,
+                                 T *DSC_RESTRICT buff,
+                                 T *DSC_RESTRICT fft_work) noexcept {
     static_assert(dsc_is_complex<T>(), "T must be the complex type of the transform");
+    DSC_ASSERT((n & 1) == 0);
 
-    const dsc_dtype out_dtype = out->dtype;
-    dsc_fft_plan *plan = dsc_plan_fft(ctx, fft_order, REAL, out_dtype);
+    const int n_bins = (n >> 1) + 1;
 
-    DSC_CTX_PUSH(ctx);
-    // Push the arena to make these two buffers temporary
-    dsc_tensor *buff = dsc_tensor_1d(ctx, out_dtype, out_n);
-    dsc_tensor *fft_work = dsc_tensor_1d(ctx, out_dtype, out_n);
+    // Same as exec_fft: the lines are transformed in groups of batch lines stored as buff[fft_n + 1][batch]
+    dsc_fft_plan *plan = job.plan;
+    const dsc_fft_units &units = job.units;
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
 
-    DSC_TENSOR_DATA(T, fft_work);
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        T *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        T *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
 
-    if constexpr (forward) {
-        dsc_axis_iterator x_it(x, axis, DSC_MIN(x_n, fft_order * 2));
-        dsc_axis_iterator out_it(out, axis, out_n);
-
-        while (x_it.has_next()) {
-            for (int i = 0; i < (fft_order << 1); ++i) {
-                if (i < x_n) {
-                    int idx = x_it.index();
-                    ((real<T> *) buff->data)[i] = ((real<T> *) x->data)[idx];
-                    x_it.next();
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, units.line(unit_start));
+        dsc_line_iterator out_it(out, axis, units.line(unit_start));
+        int x_offset[DSC_FFT_MAX_BATCH], out_offset[DSC_FFT_MAX_BATCH];
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            // The lines that don't fill a complete batch are transformed one at a time
+            const int b_n = units.size(unit);
+            for (int b = 0; b < b_n; ++b) {
+                x_offset[b] = x_it.index();
+                out_offset[b] = out_it.index();
+                x_it.next();
+                out_it.next();
+            }
+
+            if constexpr (forward) {
+                DSC_TENSOR_DATA(real<T>, x);
+                DSC_TENSOR_DATA(T, out);
+
+                const int copy_n = DSC_MIN(x_n, n);
+                // Sample i of line b goes in the real (i even) or imaginary (i odd) part of buff[i/2][b]
+                real<T> *buff_real = (real<T> *) buff_data;
+                if (b_n == 1 && x_stride == 1) {
+                    memcpy(buff_real, &x_data[x_offset[0]], copy_n * sizeof(real<T>));
                 } else {
-                    ((real<T> *) buff->data)[i] = dsc_zero<real<T>>();
+                    for (int i = 0; i < copy_n; ++i) {
+                        for (int b = 0; b < b_n; ++b)
+                            buff_real[(((i >> 1) * b_n + b) << 1) + (i & 1)] = x_data[x_offset[b] + i * x_stride];
+                    }
+                }
+                if (b_n == 1) {
+                    memset(&buff_real[copy_n], 0, (n - copy_n) * sizeof(real<T>));
+                } else {
+                    for (int i = copy_n; i < n; ++i) {
+                        for (int b = 0; b < b_n; ++b)
+                            buff_real[(((i >> 1) * b_n + b) << 1) + (i & 1)] = dsc_zero<real<T>>();
+                    }
                 }
-            }
 
-            dsc_real_fft<T, true>(plan, (T *)buff->data, fft_work_data);
+                if (b_n == 1) dsc_real_fft<T, true>(plan, buff_data, fft_work_data);
+                else dsc_real_fft_batch<T, true>(plan, buff_data, fft_work_data, b_n);
 
-            for (int i = 0; i < out_n; ++i) {
-                const int idx = out_it.index();
-                ((T *) out->data)[idx] = ((T *)buff->data)[i];
+                if (b_n == 1 && out_stride == 1) {
+                    memcpy(&out_data[out_offset[0]], &buff_data[k_start], k_n * sizeof(T));
+                } else {
+                    for (int i = 0; i < k_n; ++i) {
+                        for (int b = 0; b < b_n; ++b)
+                            out_data[out_offset[b] + i * out_stride] = buff_data[(k_start + i) * b_n + b];
+                    }
+                }
+            } else {
+                DSC_TENSOR_DATA(T, x);
+                DSC_TENSOR_DATA(real<T>, out);
 
-                out_it.next();
-            }
-        }
-    } else {
-        dsc_axis_iterator x_it(x, axis, fft_order + 1);
-        dsc_axis_iterator out_it(out, axis, out_n);
-
-        while (x_it.has_next()) {
-            for (int i = 0; i < fft_order + 1; ++i) {
-                if (i < x_n) {
-                    int idx = x_it.index();
-                    ((T *) buff->data)[i] = ((T *) x->data)[idx];
-                    x_it.next();
+                const int copy_n = DSC_MIN(x_n, n_bins);
+                if (b_n == 1 && x_stride == 1) {
+                    memcpy(buff_data, &x_data[x_offset[0]], copy_n * sizeof(T));
                 } else {
-                    ((T *) buff->data)[i] = dsc_zero<T>();
+                    for (int i = 0; i < copy_n; ++i) {
+                        for (int b = 0; b < b_n; ++b)
+                            buff_data[i * b_n + b] = x_data[x_offset[b] + i * x_stride];
+                    }
                 }
-            }
+                for (int i = copy_n * b_n; i < n_bins * b_n; ++i) buff_data[i] = dsc_zero<T>();
 
-            dsc_real_fft<T, false>(plan, (T *) buff->data, fft_work_data);
+                if (b_n == 1) dsc_real_fft<T, false>(plan, buff_data, fft_work_data);
+                else dsc_real_fft_batch<T, false>(plan, buff_data, fft_work_data, b_n);
 
-            for (int i = 0; i < out_n; ++i) {
-                const int idx = out_it.index();
-                ((real<T> *) out->data)[idx] = ((real<T> *) buff->data)[i];
+                // Sample i of line b is the real (i even) or imaginary (i odd) part of buff[i/2][b]
+                const real<T> *buff_real = (const real<T> *) buff_data;
+                if (b_n == 1 && out_stride == 1) {
+                    memcpy(&out_data[out_offset[0]], buff_real, n * sizeof(real<T>));
+                } else {
+                    for (int i = 0; i < n; ++i) {
+                        for (int b = 0; b < b_n; ++b)
+                            out_data[out_offset[b] + i * out_stride] = buff_real[(((i >> 1) * b_n + b) << 1) + (i & 1)];
+                    }
+                }
+            }
+        }
+    });
+}
 
+// RFFT of odd order N computed two lines at a time: lines 2p and 2p + 1 go in the real and imaginary
+// parts of pair p, see dsc_real_fft_pair. The units of the job are pairs of lines, the last pair
+// has a single line if the number of lines is odd.
+template<typename T, bool forward>
+static DSC_INLINE void exec_rfft_pairs(dsc_ctx *ctx,
+                                       const dsc_fft_job &job,
+                                       const dsc_tensor *DSC_RESTRICT x,
+                                       dsc_tensor *DSC_RESTRICT out,
+                                       const int axis, const int x_n,
+                                       const int n,
+                                       const int k_start, const int k_n,
+                                       T *DSC_RESTRICT buff,
+                                       T *DSC_RESTRICT fft_work) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be the complex type of the transform");
+    DSC_ASSERT((n & 1) == 1);
+
+    const int n_bins = (n >> 1) + 1;
+
+    dsc_fft_plan *plan = job.plan;
+    const dsc_fft_units &units = job.units;
+    const int lines = x->ne / x->shape[axis];
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        T *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        T *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
+
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, units.line(unit_start) << 1);
+        dsc_line_iterator out_it(out, axis, units.line(unit_start) << 1);
+        int x_offset[2 * DSC_FFT_MAX_BATCH], out_offset[2 * DSC_FFT_MAX_BATCH];
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            // Line l is part of pair l / 2 of the unit
+            const int b_n = units.size(unit);
+            const int l_n = DSC_MIN(b_n << 1, lines - (units.line(unit) << 1));
+            for (int l = 0; l < l_n; ++l) {
+                x_offset[l] = x_it.index();
+                out_offset[l] = out_it.index();
+                x_it.next();
                 out_it.next();
             }
+
+            if constexpr (forward) {
+                DSC_TENSOR_DATA(real<T>, x);
+                DSC_TENSOR_DATA(T, out);
+
+                const int copy_n = DSC_MIN(x_n, n);
+                real<T> *buff_real = (real<T> *) buff_data;
+                for (int l = 0; l < l_n; ++l) {
+                    const real<T> *DSC_RESTRICT line = &x_data[x_offset[l]];
+                    real<T> *DSC_RESTRICT dst = &buff_real[l];
+                    for (int i = 0; i < copy_n; ++i) dst[i * (b_n << 1)] = line[i * x_stride];
+                }
+                for (int l = l_n; l < (b_n << 1); ++l) {
+                    for (int i = 0; i < copy_n; ++i) buff_real[i * (b_n << 1) + l] = dsc_zero<real<T>>();
+                }
+                for (int i = copy_n * b_n; i < n * b_n; ++i) buff_data[i] = dsc_zero<T>();
+
+                dsc_real_fft_pair<T, true>(plan, buff_data, fft_work_data, b_n);
+
+                for (int l = 0; l < l_n; ++l) {
+                    const int b = l >> 1;
+                    T *DSC_RESTRICT line = &out_data[out_offset[l]];
+                    if ((l & 1) == 0) {
+                        for (int i = 0; i < k_n; ++i) line[i * out_stride] = buff_data[(k_start + i) * b_n + b];
+                    } else {
+                        for (int i = 0; i < k_n; ++i) line[i * out_stride] = buff_data[(n - k_start - i) * b_n + b];
+                    }
+                }
+            } else {
+                DSC_TENSOR_DATA(T, x);
+                DSC_TENSOR_DATA(real<T>, out);
+
+                const int copy_n = DSC_MIN(x_n, n_bins);
+                memset(buff_data, 0, (n + 1) * b_n * sizeof(T));
+                for (int l = 0; l < l_n; ++l) {
+                    const int b = l >> 1;
+                    const T *DSC_RESTRICT line = &x_data[x_offset[l]];
+                    if ((l & 1) == 0) {
+                        for (int k = 0; k < copy_n; ++k) buff_data[k * b_n + b] = line[k * x_stride];
+                    } else {
+                        for (int k = 0; k < copy_n; ++k) buff_data[(n - k) * b_n + b] = line[k * x_stride];
+                    }
+                }
+
+                dsc_real_fft_pair<T, false>(plan, buff_data, fft_work_data, b_n);
+
+                const real<T> *buff_real = (const real<T> *) buff_data;
+                for (int l = 0; l < l_n; ++l) {
+                    real<T> *DSC_RESTRICT line = &out_data[out_offset[l]];
+                    const real<T> *DSC_RESTRICT src = &buff_real[l];
+                    for (int i = 0; i < n; ++i) line[i * out_stride] = src[i * (b_n << 1)];
+                }
+            }
         }
+    });
+}
+
+template<bool forward>
+static DSC_INLINE void dsc_rfft_axis(dsc_ctx *ctx,
+                                     const dsc_fft_job &job,
+                                     const dsc_tensor *DSC_RESTRICT x,
+                                     dsc_tensor *DSC_RESTRICT out,
+                                     const int axis, const int n,
+                                     const int k_start, const int k_n,
+                                     dsc_tensor *buff,
+                                     dsc_tensor *fft_work) noexcept {
+    const int x_n = x->shape[axis];
+    switch (x->dtype) {
+        case F32:
+        case C32:
+            if (job.paired) exec_rfft_pairs<c32, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c32 *) buff->data, (c32 *) fft_work->data);
+            else exec_rfft<c32, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c32 *) buff->data, (c32 *) fft_work->data);
+            break;
+        case F64:
+        case C64:
+            if (job.paired) exec_rfft_pairs<c64, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c64 *) buff->data, (c64 *) fft_work->data);
+            else exec_rfft<c64, forward>(ctx, job, x, out, axis, x_n, n, k_start, k_n, (c64 *) buff->data, (c64 *) fft_work->data);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
     }
+}
 
-    DSC_CTX_POP(ctx);
+// Pruned forward RFFT of N real samples, N is always even:
+// - input pruning: the samples are packed in N/2 complex values like in a regular RFFT, only the first
+//   (x_n + 1) / 2 are non-zero so the complex FFT of order N/2 is pruned before the usual post-processing
+//   done with rfft_plan.
+// - output pruning: the P decimated sequences x[i * P + b] are real, their FFTs are computed as RFFTs of
+//   order M (stored in M/2 + 1 elements).
+// job.plan is the plan of the sub-transforms, the twiddles are those of a pruned FFT of order N/2 (input)
+// or N (output). Each line needs dsc_rfft_pruned_buff_n elements of buff and N/2 + 1 of fft_work.
+static DSC_INLINE DSC_STRICTLY_PURE int dsc_rfft_pruned_buff_n(const dsc_fft_pruning &pruning, const int n,
+                                                             const int x_n, const int k_n) noexcept {
+    // Input pruning: the sub-transforms, the result in natural order if the sub-transforms are not batched
+    // and the packed input. Output pruning: the sub-transforms and the requested bins.
+    if (pruning.type == INPUT_PRUNING) return ((n >> 1) + 1) * (pruning.batched ? 1 : 2) + ((x_n + 1) >> 1);
+    return ((pruning.m >> 1) + 1) * pruning.p + k_n;
+}
+
+template<typename T>
+static DSC_INLINE void exec_pruned_rfft(dsc_ctx *ctx,
+                                        const dsc_fft_job &job,
+                                        const dsc_fft_pruning &pruning,
+                                        dsc_fft_plan *rfft_plan,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        dsc_tensor *DSC_RESTRICT out,
+                                        const int axis, const int x_n,
+                                        const int n,
+                                        const int k_start, const int k_n,
+                                        const T *DSC_RESTRICT twiddles,
+                                        T *DSC_RESTRICT buff,
+                                        T *DSC_RESTRICT fft_work) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be the complex type of the transform");
+
+    dsc_fft_plan *sub_plan = job.plan;
+    const int m = pruning.m, p = pruning.p;
+    const int copy_n = DSC_MIN(x_n, n);
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const T *DSC_RESTRICT twiddles_q = twiddles;
+    const T *DSC_RESTRICT twiddles_r = &twiddles[p];
+    const int half_n = n >> 1;
+    // Number of bins of each real sub-transform
+    const int sub_bins = (m >> 1) + 1;
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(real<T>, x);
+        DSC_TENSOR_DATA(T, out);
+        T *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        T *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
+
+        const int line_start = job.units.count * worker / n_threads;
+        const int line_stop = job.units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, line_start);
+        dsc_line_iterator out_it(out, axis, line_start);
+
+        for (int line = line_start; line < line_stop; ++line) {
+            const int x_offset = x_it.index();
+            const int out_offset = out_it.index();
+            x_it.next();
+            out_it.next();
+
+            const T *DSC_RESTRICT res;
+            if (pruning.type == INPUT_PRUNING) {
+                T *DSC_RESTRICT natural = pruning.batched ? buff_data : &buff_data[half_n + 1];
+                T *DSC_RESTRICT packed = &natural[half_n + 1];
+
+                const int l = (copy_n + 1) >> 1;
+                real<T> *packed_real = (real<T> *) packed;
+                for (int i = 0; i < copy_n; ++i) packed_real[i] = x_data[x_offset + i * x_stride];
+                if (copy_n & 1) packed_real[copy_n] = dsc_zero<real<T>>();
+
+                dsc_fft_pruned_input<T, true>(sub_plan, pruning, l, packed, buff_data,
+                                              fft_work_data, twiddles_q, twiddles_r);
+                if (!pruning.batched) {
+                    for (int b = 0; b < p; ++b) {
+                        for (int i = 0; i < m; ++i) natural[i * p + b] = buff_data[b * m + i];
+                    }
+                }
+
+                dsc_real_fft_finish<T>(rfft_plan, natural);
+                res = &natural[k_start];
+            } else {
+                // Sample i of the sub-transform b is x[i * P + b], it goes in the real (i even) or
+                // imaginary (i odd) part of element i/2 of the sub-transform
+                const int stride_j = pruning.batched ? p : 1, stride_b = pruning.batched ? 1 : sub_bins;
+                real<T> *buff_real = (real<T> *) buff_data;
+                for (int i = 0; i < m; ++i) {
+                    for (int b = 0; b < p; ++b) {
+                        const int idx = i * p + b;
+                        buff_real[(((i >> 1) * stride_j + b * stride_b) << 1) + (i & 1)] =
+                                idx < copy_n ? x_data[x_offset + idx * x_stride] : dsc_zero<real<T>>();
+                    }
+                }
+
+                if (pruning.batched) {
+                    dsc_real_fft_batch<T, true>(sub_plan, buff_data, fft_work_data, p);
+                } else {
+                    for (int b = 0; b < p; ++b) dsc_real_fft<T, true>(sub_plan, &buff_data[b * sub_bins], fft_work_data);
+                }
+
+                T *DSC_RESTRICT bins = &buff_data[sub_bins * p];
+                dsc_fft_pruned_output<T, true, true>(pruning, stride_j, stride_b, k_start, k_start + k_n,
+                                                     buff_data, bins, twiddles_q, twiddles_r);
+                res = bins;
+            }
+
+            for (int i = 0; i < k_n; ++i) out_data[out_offset + i * out_stride] = res[i];
+        }
+    });
 }
 
 template<bool forward>
 static DSC_INLINE dsc_tensor *dsc_internal_rfft(dsc_ctx *ctx,
                                                 const dsc_tensor *DSC_RESTRICT x,
                                                 dsc_tensor *DSC_RESTRICT out,
-                                                const int n,
-                                                const int axis) noexcept {
-    // For an RFFT if N is not specified N = (dim / 2) + 1
-    // For an IRFFT if N is not specified N = 2 * (dim - 1)
-    // Note: for now, since we support only power of 2 FFTs, the input of IRFFT is assumed to have
-    //       the same shape as the output of RFFT. If this is not the case be careful, there can be
-    //       issues with the results of IRFFT.
+                                                int n,
+                                                const int axis,
+                                                const int bin_start,
+                                                int bin_stop) noexcept {
+    // N is always the number of real samples:
+    // - RFFT: if N is not specified N = dim, the output has (N / 2) + 1 elements
+    // - IRFFT: if N is not specified N = 2 * (dim - 1), only the first (N / 2) + 1 elements
+    //   of the input are used (zero-padded if needed) and the output has N elements
     DSC_ASSERT(x != nullptr);
 
     DSC_TRACE_FFT_OP(x, out, n, axis, dsc_fft_type::REAL, forward);
@@ -2189,16 +3928,18 @@ static DSC_INLINE dsc_tensor *dsc_internal_rfft(dsc_ctx *ctx,
     DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
 
     const int x_n = x->shape[axis_idx];
-    int out_n, fft_order;
+    int out_n;
 
     if constexpr (forward) {
-        fft_order = ((n > 0) ? dsc_pow2_n(n) : dsc_pow2_n(x_n)) >> 1;
-        out_n = fft_order + 1;
+        if (n <= 0) n = x_n;
+        if (bin_stop <= 0) bin_stop = (n >> 1) + 1;
+        DSC_ASSERT(bin_start >= 0 && bin_start < bin_stop && bin_stop <= (n >> 1) + 1);
+        out_n = bin_stop - bin_start;
     } else {
-        // Todo: verify that this makes sense
-        fft_order = (n > 0) ? dsc_pow2_n(n - 1) : dsc_pow2_n(x_n - 1);
-        out_n = fft_order << 1;
+        if (n <= 0) n = (x_n - 1) << 1;
+        out_n = n;
     }
+    DSC_ASSERT(n > 0);
 
     int out_shape[DSC_MAX_DIMS];
     for (int i = 0; i < DSC_MAX_DIMS; ++i)
@@ -2228,18 +3969,53 @@ static DSC_INLINE dsc_tensor *dsc_internal_rfft(dsc_ctx *ctx,
                   x->shape[0], x->shape[1], x->shape[2], x->shape[3],
                   axis_idx, x->shape[axis_idx]);
 
-    switch (x->dtype) {
-        case F32:
-        case C32:
-            exec_rfft<c32, forward>(ctx, x, out, axis_idx, x_n, out_n, fft_order);
-            break;
-        case F64:
-        case C64:
-            exec_rfft<c64, forward>(ctx, x, out, axis_idx, x_n, out_n, fft_order);
-            break;
-        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    const dsc_dtype fft_dtype = forward ? out_dtype : x->dtype;
+
+    if constexpr (forward) {
+        const dsc_fft_pruning pruning = dsc_fft_choose_pruning(n, DSC_MIN(x_n, n), out_n, true, fft_dtype);
+        if (pruning.type != NO_PRUNING) {
+            DSC_LOG_DEBUG("using %s pruning with P=%d M=%d",
+                          pruning.type == INPUT_PRUNING ? "input" : "output", pruning.p, pruning.m);
+
+            const bool input = pruning.type == INPUT_PRUNING;
+            // Input pruning needs the regular RFFT plan for the post-processing, its sub-transforms
+            // are complex FFTs of order M. Output pruning uses RFFTs of order M.
+            dsc_fft_plan *rfft_plan = input ? dsc_plan_rfft(ctx, n, fft_dtype) : nullptr;
+            dsc_fft_plan *sub_plan = input ? dsc_plan_fft(ctx, pruning.m, COMPLEX, fft_dtype) :
+                                             dsc_plan_fft(ctx, pruning.m >> 1, REAL, fft_dtype);
+            const int buff_n = dsc_rfft_pruned_buff_n(pruning, n, DSC_MIN(x_n, n), out_n);
+            const dsc_fft_job job = dsc_fft_pruned_job_init(ctx, sub_plan, x, axis_idx, buff_n, (n >> 1) + 1, n);
+
+            DSC_CTX_PUSH(ctx);
+            dsc_tensor *twiddles = dsc_new_pruning_twiddles(ctx, input ? (n >> 1) : n, pruning, fft_dtype);
+            dsc_tensor *buff = dsc_tensor_1d(ctx, fft_dtype, job.buff_n * job.n_workers);
+            dsc_tensor *fft_work = dsc_tensor_1d(ctx, fft_dtype, job.work_n * job.n_workers);
+
+            if (fft_dtype == C32) {
+                exec_pruned_rfft<c32>(ctx, job, pruning, rfft_plan, x, out, axis_idx, x_n, n, bin_start, out_n,
+                                      (const c32 *) twiddles->data, (c32 *) buff->data, (c32 *) fft_work->data);
+            } else {
+                exec_pruned_rfft<c64>(ctx, job, pruning, rfft_plan, x, out, axis_idx, x_n, n, bin_start, out_n,
+                                      (const c64 *) twiddles->data, (c64 *) buff->data, (c64 *) fft_work->data);
+            }
+
+            DSC_CTX_POP(ctx);
+            return out;
+        }
     }
 
+    dsc_fft_plan *plan = dsc_plan_rfft(ctx, n, fft_dtype);
+    const dsc_fft_job job = dsc_fft_job_init(ctx, plan, x, out, axis_idx, dsc_rfft_line_n(n), n, (n & 1) == 1);
+
+    DSC_CTX_PUSH(ctx);
+    // Push the arena to make these two buffers temporary
+    dsc_tensor *buff = dsc_tensor_1d(ctx, fft_dtype, job.buff_n * job.n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, fft_dtype, job.work_n * job.n_workers);
+
+    dsc_rfft_axis<forward>(ctx, job, x, out, axis_idx, n, forward ? bin_start : 0, out_n, buff, fft_work);
+
+    DSC_CTX_POP(ctx);
+
     return out;
 }
 
@@ -2247,8 +4023,10 @@ dsc_tensor *dsc_rfft(dsc_ctx *ctx,
                      const dsc_tensor *DSC_RESTRICT x,
                      dsc_tensor *DSC_RESTRICT out,
                      const int n,
-                     const int axis) noexcept {
-    return dsc_internal_rfft<true>(ctx, x, out, n, axis);
+                     const int axis,
+                     const int bin_start,
+                     const int bin_stop) noexcept {
+    return dsc_internal_rfft<true>(ctx, x, out, n, axis, bin_start, bin_stop);
 }
 
 dsc_tensor *dsc_irfft(dsc_ctx *ctx,
@@ -2256,7 +4034,183 @@ dsc_tensor *dsc_irfft(dsc_ctx *ctx,
                       dsc_tensor *DSC_RESTRICT out,
                       const int n,
                       const int axis) noexcept {
-    return dsc_internal_rfft<false>(ctx, x, out, n, axis);
+    return dsc_internal_rfft<false>(ctx, x, out, n, axis, 0, -1);
+}
+
+// One step of an N-dimensional FFT: a 1D transform of length n over a single axis
+struct dsc_fftn_step {
+    dsc_fft_plan *plan;
+    // The tensor that holds the result of this step
+    dsc_tensor *out;
+    int axis, n;
+    bool real;
+    // Shape and dtype of the result of this step
+    int shape[DSC_MAX_DIMS];
+    dsc_dtype dtype;
+};
+
+// An N-dimensional FFT is done one axis at a time, like numpy the last axis is transformed first.
+// For RFFTN the real transform is over the last axis and is the first one to be computed, for IRFFTN
+// it's done last. The strided axes are handled by the batched kernels that transform adjacent
+// columns together so there is no need for explicit transposes.
+// All the steps whose result has the same shape and dtype of the output are done in-place on out so,
+// unless some of the axes are padded or cropped, no intermediate tensor is allocated. All the steps
+// share the same scratch buffers.
+template<bool forward, bool real>
+static DSC_INLINE dsc_tensor *dsc_internal_fftn(dsc_ctx *ctx,
+                                                const dsc_tensor *DSC_RESTRICT x,
+                                                dsc_tensor *DSC_RESTRICT out,
+                                                int n_axes,
+                                                const int *n,
+                                                const int *axes) noexcept {
+    DSC_ASSERT(x != nullptr);
+
+    if (n_axes <= 0) n_axes = x->n_dim;
+    DSC_ASSERT(n_axes <= x->n_dim);
+
+    dsc_dtype fft_dtype;
+    if constexpr (real && forward) {
+        if (x->dtype == F32) fft_dtype = C32;
+        else if (x->dtype == F64) fft_dtype = C64;
+        else DSC_LOG_FATAL("RFFTN input must be real");
+    } else if constexpr (real) {
+        if (x->dtype != C32 && x->dtype != C64) DSC_LOG_FATAL("IRFFTN input must be complex");
+        fft_dtype = x->dtype;
+    } else {
+        fft_dtype = x->dtype == F32 ? C32 : (x->dtype == F64 ? C64 : x->dtype);
+    }
+
+    dsc_fftn_step steps[DSC_MAX_DIMS];
+    int shape[DSC_MAX_DIMS];
+    memcpy(shape, x->shape, DSC_MAX_DIMS * sizeof(*shape));
+
+    for (int i = 0; i < n_axes; ++i) {
+        // Complex transforms go from the last axis to the first one, the real transform is over
+        // the last axis and comes first for RFFTN and last for IRFFTN
+        int axis_i;
+        if constexpr (real && !forward) axis_i = i < n_axes - 1 ? n_axes - 2 - i : n_axes - 1;
+        else axis_i = n_axes - 1 - i;
+
+        dsc_fftn_step *step = &steps[i];
+        step->axis = dsc_tensor_dim(x, axes != nullptr ? axes[axis_i] : axis_i - n_axes);
+        DSC_ASSERT(step->axis < DSC_MAX_DIMS);
+        step->real = real && axis_i == n_axes - 1;
+
+        const int x_n = shape[step->axis];
+        step->n = n != nullptr && n[axis_i] > 0 ? n[axis_i] : x_n;
+        if (step->real && !forward && (n == nullptr || n[axis_i] <= 0)) step->n = (x_n - 1) << 1;
+        DSC_ASSERT(step->n > 0);
+
+        shape[step->axis] = step->real && forward ? (step->n >> 1) + 1 : step->n;
+        memcpy(step->shape, shape, DSC_MAX_DIMS * sizeof(*shape));
+        step->dtype = step->real && !forward ? (fft_dtype == C32 ? F32 : F64) : fft_dtype;
+
+        // All the plans are created before running the transforms, this is fine because the cache
+        // can always hold at least DSC_MAX_DIMS plans
+        step->plan = step->real ? dsc_plan_rfft(ctx, step->n, fft_dtype) :
+                                  dsc_plan_fft(ctx, step->n, COMPLEX, fft_dtype);
+    }
+
+    const dsc_fftn_step *last = &steps[n_axes - 1];
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &last->shape[DSC_MAX_DIMS - x->n_dim], last->dtype);
+    } else {
+        DSC_ASSERT(out->dtype == last->dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(last->shape, out->shape, DSC_MAX_DIMS * sizeof(out->shape[0])) == 0);
+    }
+
+    // All the steps from first_out onwards write their result directly to out
+    int first_out = n_axes - 1;
+    while (first_out > 0 && steps[first_out - 1].dtype == last->dtype &&
+           memcmp(steps[first_out - 1].shape, last->shape, DSC_MAX_DIMS * sizeof(*shape)) == 0) {
+        first_out--;
+    }
+
+    DSC_LOG_DEBUG("performing %s %s over %d axes of x=[%d %d %d %d], %d intermediate steps",
+                  forward ? "FWD" : "BWD", real ? "RFFTN" : "FFTN", n_axes,
+                  x->shape[0], x->shape[1], x->shape[2], x->shape[3], first_out);
+
+    DSC_CTX_PUSH(ctx);
+    // The intermediate results and the scratch buffers are all temporary
+
+    dsc_fft_job jobs[DSC_MAX_DIMS];
+    int buff_n = 0, work_n = 0;
+    for (int i = 0; i < n_axes; ++i) {
+        dsc_fftn_step *step = &steps[i];
+        dsc_tensor *prev = i > 0 ? steps[i - 1].out : nullptr;
+        if (i >= first_out) {
+            step->out = out;
+        } else if (prev != nullptr && prev->dtype == step->dtype &&
+                   memcmp(prev->shape, step->shape, DSC_MAX_DIMS * sizeof(*shape)) == 0) {
+            step->out = prev;
+        } else {
+            step->out = dsc_new_tensor(ctx, x->n_dim, &step->shape[DSC_MAX_DIMS - x->n_dim], step->dtype);
+        }
+
+        jobs[i] = dsc_fft_job_init(ctx, step->plan, prev != nullptr ? prev : x, step->out, step->axis,
+                                   step->real ? dsc_rfft_line_n(step->n) : step->n, step->n,
+                                   step->real && (step->n & 1) == 1);
+        buff_n = DSC_MAX(buff_n, jobs[i].buff_n * jobs[i].n_workers);
+        work_n = DSC_MAX(work_n, jobs[i].work_n * jobs[i].n_workers);
+    }
+
+    dsc_tensor *buff = dsc_tensor_1d(ctx, fft_dtype, buff_n);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, fft_dtype, work_n);
+
+    const dsc_tensor *step_x = x;
+    for (int i = 0; i < n_axes; ++i) {
+        const dsc_fftn_step *step = &steps[i];
+
+        DSC_TRACE_FFT_OP(step_x, step->out, step->n, step->axis,
+                         step->real ? dsc_fft_type::REAL : dsc_fft_type::COMPLEX, forward);
+
+        // For IRFFTN the output range is ignored
+        if (step->real) dsc_rfft_axis<forward>(ctx, jobs[i], step_x, step->out, step->axis, step->n, 0, (step->n >> 1) + 1, buff, fft_work);
+        else dsc_fft_axis<forward>(ctx, jobs[i], step_x, step->out, step->axis, step->n, 0, step->n, buff, fft_work);
+
+        step_x = step->out;
+    }
+
+    DSC_CTX_POP(ctx);
+
+    return out;
+}
+
+dsc_tensor *dsc_fftn(dsc_ctx *ctx,
+                     const dsc_tensor *DSC_RESTRICT x,
+                     dsc_tensor *DSC_RESTRICT out,
+                     const int n_axes,
+                     const int *n,
+                     const int *axes) noexcept {
+    return dsc_internal_fftn<true, false>(ctx, x, out, n_axes, n, axes);
+}
+
+dsc_tensor *dsc_ifftn(dsc_ctx *ctx,
+                      const dsc_tensor *DSC_RESTRICT x,
+                      dsc_tensor *DSC_RESTRICT out,
+                      const int n_axes,
+                      const int *n,
+                      const int *axes) noexcept {
+    return dsc_internal_fftn<false, false>(ctx, x, out, n_axes, n, axes);
+}
+
+dsc_tensor *dsc_rfftn(dsc_ctx *ctx,
+                      const dsc_tensor *DSC_RESTRICT x,
+                      dsc_tensor *DSC_RESTRICT out,
+                      const int n_axes,
+                      const int *n,
+                      const int *axes) noexcept {
+    return dsc_internal_fftn<true, true>(ctx, x, out, n_axes, n, axes);
+}
+
+dsc_tensor *dsc_irfftn(dsc_ctx *ctx,
+                       const dsc_tensor *DSC_RESTRICT x,
+                       dsc_tensor *DSC_RESTRICT out,
+                       const int n_axes,
+                       const int *n,
+                       const int *axes) noexcept {
+    return dsc_internal_fftn<false, true>(ctx, x, out, n_axes, n, axes);
 }
 
 template<typename T>
@@ -2337,4 +4291,2296 @@ dsc_tensor *dsc_rfftfreq(dsc_ctx *ctx,
     }
 
     return out;
-}
\ No newline at end of file
+}
+// ============================================================
+// Streaming STFT
+
+struct dsc_stft {
+    // Owned by the STFT, it's not in the cache so it can't be evicted while the stream is active
+    dsc_fft_plan *plan;
+    dsc_tensor *ring;
+    // The window and, for the ISTFT, 1 / sum of the squared windows that overlap each of the
+    // first hop samples of a frame
+    dsc_tensor *window, *norm;
+    // STFT: the last samples pushed, only the first pending are valid.
+    // ISTFT: overlap-add of the frames pushed so far, the first hop samples are complete.
+    dsc_tensor *frame;
+    // Scratch space for the FFTs
+    dsc_tensor *buff, *work;
+    u64 count;
+    int n_fft, hop, n_bins, ring_n;
+    int pending;
+    dsc_dtype dtype;
+    bool forward;
+};
+
+// Copy the n samples of window to dst, if window is nullptr dst is a periodic Hann window
+template<typename T>
+static DSC_INLINE void dsc_init_window(const dsc_tensor *window, const int n, T *DSC_RESTRICT dst) noexcept {
+    static_assert(dsc_is_real<T>(), "T must be real");
+
+    if (window == nullptr) {
+        for (int i = 0; i < n; ++i)
+            dst[i] = (T) (0.5 - 0.5 * cos_op()((2. * dsc_pi<f64>() * i) / (f64) n));
+    } else if (window->dtype == F32) {
+        DSC_TENSOR_DATA(f32, window);
+        for (int i = 0; i < n; ++i) dst[i] = (T) window_data[i];
+    } else {
+        DSC_TENSOR_DATA(f64, window);
+        for (int i = 0; i < n; ++i) dst[i] = (T) window_data[i];
+    }
+}
+
+template<typename T>
+static DSC_INLINE void dsc_stft_init_window(dsc_stft *stft, const dsc_tensor *window) noexcept {
+    const int n_fft = stft->n_fft, hop = stft->hop;
+    T *DSC_RESTRICT stft_window = (T *) stft->window->data;
+    dsc_init_window<T>(window, n_fft, stft_window);
+
+    if (!stft->forward) {
+        T *DSC_RESTRICT norm = (T *) stft->norm->data;
+        for (int i = 0; i < hop; ++i) {
+            f64 sum = 0;
+            for (int j = i; j < n_fft; j += hop) sum += (f64) stft_window[j] * (f64) stft_window[j];
+            // If all the windows are 0 the samples can't be recovered, they are left to 0
+            norm[i] = sum > 0 ? (T) (1. / sum) : dsc_zero<T>();
+        }
+    }
+}
+
+static dsc_stft *dsc_internal_stft_init(dsc_ctx *ctx,
+                                        const int n_fft,
+                                        const int hop,
+                                        const int ring_n,
+                                        const dsc_tensor *DSC_RESTRICT window,
+                                        const dsc_dtype dtype,
+                                        const bool forward) noexcept {
+    DSC_ASSERT(n_fft > 0);
+    DSC_ASSERT(hop > 0 && hop <= n_fft);
+    DSC_ASSERT(ring_n > 0);
+    DSC_ASSERT(dtype == F32 || dtype == F64);
+
+    const dsc_dtype fft_dtype = dtype == F32 ? C32 : C64;
+    const bool even = (n_fft & 1) == 0;
+    const int fft_n = even ? (n_fft >> 1) : n_fft;
+
+    dsc_stft *stft = (dsc_stft *) dsc_obj_alloc(ctx->main_allocator, sizeof(dsc_stft));
+    stft->plan = dsc_alloc_plan(ctx, fft_n, even ? REAL : COMPLEX, dtype, dsc_fft_choose_algorithm(fft_n));
+    stft->n_fft = n_fft;
+    stft->hop = hop;
+    stft->n_bins = (n_fft >> 1) + 1;
+    stft->ring_n = ring_n;
+    stft->count = 0;
+    stft->pending = 0;
+    stft->dtype = dtype;
+    stft->forward = forward;
+
+    stft->ring = forward ? dsc_tensor_2d(ctx, fft_dtype, ring_n, stft->n_bins) : dsc_tensor_1d(ctx, dtype, ring_n);
+    stft->window = dsc_tensor_1d(ctx, dtype, n_fft);
+    stft->norm = forward ? nullptr : dsc_tensor_1d(ctx, dtype, hop);
+    stft->frame = dsc_tensor_1d(ctx, dtype, n_fft);
+    stft->buff = dsc_tensor_1d(ctx, fft_dtype, dsc_rfft_line_n(n_fft));
+    stft->work = dsc_tensor_1d(ctx, fft_dtype, dsc_fft_work_size(fft_n, stft->plan->algorithm));
+
+    memset(stft->frame->data, 0, n_fft * DSC_DTYPE_SIZE[dtype]);
+    memset(stft->ring->data, 0, stft->ring->ne * DSC_DTYPE_SIZE[stft->ring->dtype]);
+
+    if (window != nullptr) {
+        DSC_ASSERT(window->ne == n_fft);
+        DSC_ASSERT(window->dtype == F32 || window->dtype == F64);
+    }
+
+    if (dtype == F32) dsc_stft_init_window<f32>(stft, window);
+    else dsc_stft_init_window<f64>(stft, window);
+
+    DSC_LOG_DEBUG("created %s with N=%d hop=%d ring=%d dtype=%s",
+                  forward ? "STFT" : "ISTFT", n_fft, hop, ring_n, DSC_DTYPE_NAMES[dtype]);
+
+    return stft;
+}
+
+dsc_stft *dsc_stft_init(dsc_ctx *ctx,
+                        const int n_fft,
+                        const int hop,
+                        const int ring_n,
+                        const dsc_tensor *DSC_RESTRICT window,
+                        const dsc_dtype dtype) noexcept {
+    return dsc_internal_stft_init(ctx, n_fft, hop, ring_n, window, dtype, true);
+}
+
+dsc_stft *dsc_istft_init(dsc_ctx *ctx,
+                         const int n_fft,
+                         const int hop,
+                         const int ring_n,
+                         const dsc_tensor *DSC_RESTRICT window,
+                         const dsc_dtype dtype) noexcept {
+    return dsc_internal_stft_init(ctx, n_fft, hop, ring_n, window, dtype, false);
+}
+
+template<typename T>
+static DSC_INLINE int dsc_stft_push_samples(dsc_stft *stft, const dsc_tensor *x) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be the complex type of the transform");
+
+    const int n_fft = stft->n_fft, hop = stft->hop, n_bins = stft->n_bins;
+    const bool even = (n_fft & 1) == 0;
+
+    DSC_TENSOR_DATA(real<T>, x);
+    real<T> *DSC_RESTRICT frame = (real<T> *) stft->frame->data;
+    const real<T> *DSC_RESTRICT window = (const real<T> *) stft->window->data;
+    T *DSC_RESTRICT buff = (T *) stft->buff->data;
+    T *DSC_RESTRICT work = (T *) stft->work->data;
+    T *DSC_RESTRICT ring = (T *) stft->ring->data;
+
+    int frames = 0;
+    for (int i = 0; i < x->ne;) {
+        const int copy_n = DSC_MIN(n_fft - stft->pending, x->ne - i);
+        memcpy(&frame[stft->pending], &x_data[i], copy_n * sizeof(real<T>));
+        stft->pending += copy_n;
+        i += copy_n;
+
+        if (stft->pending < n_fft) break;
+
+        if (even) {
+            // Same packing as a regular RFFT: sample j goes in the real (j even) or imaginary (j odd) part of buff[j/2]
+            real<T> *DSC_RESTRICT buff_real = (real<T> *) buff;
+            for (int j = 0; j < n_fft; ++j) buff_real[j] = frame[j] * window[j];
+            dsc_real_fft<T, true>(stft->plan, buff, work);
+        } else {
+            for (int j = 0; j < n_fft; ++j) buff[j] = dsc_complex(T, frame[j] * window[j], dsc_zero<real<T>>());
+            dsc_complex_fft<T, true>(stft->plan, buff, work);
+        }
+
+        memcpy(&ring[(stft->count % stft->ring_n) * n_bins], buff, n_bins * sizeof(T));
+        stft->count++;
+        frames++;
+
+        // The last n_fft - hop samples are the beginning of the next frame
+        memmove(frame, &frame[hop], (n_fft - hop) * sizeof(real<T>));
+        stft->pending = n_fft - hop;
+    }
+
+    return frames;
+}
+
+template<typename T>
+static DSC_INLINE int dsc_istft_push_frames(dsc_stft *stft, const dsc_tensor *x) noexcept {
+    static_assert(dsc_is_complex<T>(), "T must be the complex type of the transform");
+
+    const int n_fft = stft->n_fft, hop = stft->hop, n_bins = stft->n_bins, ring_n = stft->ring_n;
+    const bool even = (n_fft & 1) == 0;
+    const int x_frames = x->ne / n_bins;
+
+    DSC_TENSOR_DATA(T, x);
+    real<T> *DSC_RESTRICT acc = (real<T> *) stft->frame->data;
+    const real<T> *DSC_RESTRICT window = (const real<T> *) stft->window->data;
+    const real<T> *DSC_RESTRICT norm = (const real<T> *) stft->norm->data;
+    T *DSC_RESTRICT buff = (T *) stft->buff->data;
+    T *DSC_RESTRICT work = (T *) stft->work->data;
+    real<T> *DSC_RESTRICT ring = (real<T> *) stft->ring->data;
+
+    for (int f = 0; f < x_frames; ++f) {
+        memcpy(buff, &x_data[f * n_bins], n_bins * sizeof(T));
+
+        if (even) {
+            dsc_real_fft<T, false>(stft->plan, buff, work);
+            const real<T> *DSC_RESTRICT buff_real = (const real<T> *) buff;
+            for (int j = 0; j < n_fft; ++j) acc[j] += buff_real[j] * window[j];
+        } else {
+            // Rebuild the full spectrum using the Hermitian symmetry
+            for (int j = 1; j < n_bins; ++j) buff[n_fft - j] = dsc_complex(T, buff[j].real, -buff[j].imag);
+            dsc_complex_fft<T, false>(stft->plan, buff, work);
+            for (int j = 0; j < n_fft; ++j) acc[j] += buff[j].real * window[j];
+        }
+
+        // No other frame overlaps the first hop samples
+        int idx = (int) (stft->count % ring_n);
+        for (int j = 0; j < hop; ++j) {
+            ring[idx] = acc[j] * norm[j];
+            if (++idx == ring_n) idx = 0;
+        }
+        stft->count += hop;
+
+        memmove(acc, &acc[hop], (n_fft - hop) * sizeof(real<T>));
+        memset(&acc[n_fft - hop], 0, hop * sizeof(real<T>));
+    }
+
+    return x_frames * hop;
+}
+
+int dsc_stft_push(dsc_ctx *ctx,
+                  dsc_stft *stft,
+                  const dsc_tensor *DSC_RESTRICT x) noexcept {
+    DSC_UNUSED(ctx);
+    DSC_ASSERT(stft != nullptr);
+    DSC_ASSERT(x != nullptr);
+
+    DSC_TRACE_FFT_OP(x, stft->ring, stft->n_fft, -1, dsc_fft_type::REAL, stft->forward);
+
+    if (stft->forward) {
+        DSC_ASSERT(x->n_dim == 1);
+        DSC_ASSERT(x->dtype == stft->dtype);
+        if (x->dtype == F32) return dsc_stft_push_samples<c32>(stft, x);
+        else return dsc_stft_push_samples<c64>(stft, x);
+    } else {
+        DSC_ASSERT(x->shape[DSC_MAX_DIMS - 1] == stft->n_bins);
+        DSC_ASSERT(x->dtype == (stft->dtype == F32 ? C32 : C64));
+        if (x->dtype == C32) return dsc_istft_push_frames<c32>(stft, x);
+        else return dsc_istft_push_frames<c64>(stft, x);
+    }
+}
+
+dsc_tensor *dsc_stft_ring(dsc_stft *stft) noexcept {
+    return stft->ring;
+}
+
+u64 dsc_stft_count(const dsc_stft *stft) noexcept {
+    return stft->count;
+}
+
+void dsc_stft_reset(dsc_stft *stft) noexcept {
+    stft->pending = 0;
+    memset(stft->frame->data, 0, stft->n_fft * DSC_DTYPE_SIZE[stft->dtype]);
+}
+
+void dsc_stft_free(dsc_ctx *ctx, dsc_stft *stft) noexcept {
+    if (stft == nullptr) return;
+
+    dsc_free_plan(ctx, stft->plan);
+    dsc_tensor_free(ctx, stft->ring);
+    dsc_tensor_free(ctx, stft->window);
+    dsc_tensor_free(ctx, stft->norm);
+    dsc_tensor_free(ctx, stft->frame);
+    dsc_tensor_free(ctx, stft->buff);
+    dsc_tensor_free(ctx, stft->work);
+    dsc_obj_free(ctx->main_allocator, stft);
+}
+
+// ============================================================
+// Convolution
+//
+// A convolution is computed either directly, with the SIMD kernels in dsc_fft_kernels, or with
+// overlap-save: the input is split in blocks of fft_n samples that overlap by M - 1, the FFT of each
+// block is multiplied by the spectrum of the kernel and the last fft_n - M + 1 samples of the inverse
+// FFT are the outputs. Both are written in terms of a "valid" convolution of a padded copy of the input:
+// y[k] = sum_j h[j] * xp[k + M - 1 - j], the padding depends on the mode (or, for a stream, is the tail
+// of the previous push). A correlation is a convolution with the reversed and conjugated kernel.
+
+// Cost of a multiply-add of the direct convolution in the units of dsc_fft_cost
+static constexpr f64 DSC_CONV_MAC_COST[DSC_DTYPES] = {
+        0.25,
+        0.3,
+        1.1,
+        1.5,
+};
+
+// Outputs computed for each copy of the input
+#define DSC_CONV_BLOCK ((int) 4096)
+
+struct dsc_conv_engine {
+    const dsc_fft_kernels *kernels;
+    // Plan of the overlap-save FFTs, nullptr if the convolution is always computed directly.
+    // Real signals use the same plans of RFFT.
+    dsc_fft_plan *plan;
+    // The kernel, reversed and conjugated for correlations, and its spectrum: fft_n bins or
+    // fft_n / 2 + 1 if the signal is real
+    void *h, *h_fft;
+    int m, fft_n;
+    dsc_dtype dtype;
+};
+
+static DSC_INLINE DSC_STRICTLY_PURE bool dsc_conv_is_real(const dsc_dtype dtype) noexcept {
+    return dtype == F32 || dtype == F64;
+}
+
+// Cost of one overlap-save block: the forward and inverse FFTs and the product with the spectrum of the kernel
+static DSC_INLINE DSC_STRICTLY_PURE f64 dsc_conv_block_cost(const int fft_n, const bool real) noexcept {
+    if (real) {
+        const int plan_n = fft_n >> 1;
+        return 2. * (dsc_fft_plan_cost(plan_n) + 2. * plan_n) + 6. * (plan_n + 1);
+    }
+    return 2. * dsc_fft_plan_cost(fft_n) + 6. * fft_n;
+}
+
+// Order of the overlap-save FFTs for lines x y_n outputs with a kernel of M samples, 0 if the direct
+// convolution is cheaper. The candidates are the powers of 2 up to the first block that covers all the
+// outputs, blocks with odd factors are never faster than the next power of 2 even if dsc_fft_cost says so.
+// The block size is picked from the plan cache: if the plan of a candidate is not cached the cost of
+// computing its twiddles is added so orders that have already been planned are preferred. For a stream
+// y_n is 0: the cost is per output and the plan is always created.
+static int dsc_conv_choose_fft_n(const dsc_ctx *ctx, const int m,
+                                 const int y_n, const int lines,
+                                 const dsc_dtype dtype) noexcept {
+    const bool real = dsc_conv_is_real(dtype);
+    const bool stream = y_n <= 0;
+    const dsc_dtype twd_dtype = (dtype == F32 || dtype == C32) ? F32 : F64;
+
+    const f64 outputs = stream ? 1. : (f64) lines * (f64) y_n;
+    const f64 direct_cost = outputs * (f64) m * DSC_CONV_MAC_COST[dtype];
+    const i64 max_n = stream ? dsc_pow2_n(m) * 16 : dsc_pow2_n(y_n + m - 1);
+
+    int best_n = 0;
+    f64 best_cost = direct_cost;
+    for (i64 n = 2; n <= max_n; n <<= 1) {
+        const int fft_n = (int) n;
+        if (fft_n < 2 * m) continue;
+
+        const int step = fft_n - m + 1;
+        const f64 block_cost = dsc_conv_block_cost(fft_n, real);
+
+        f64 cost;
+        if (stream) {
+            cost = block_cost / step;
+        } else {
+            const f64 blocks = (f64) lines * (f64) ((y_n + step - 1) / step);
+            // Plus the spectrum of the kernel
+            cost = blocks * block_cost + block_cost * 0.5;
+
+            const int plan_n = real ? (fft_n >> 1) : fft_n;
+            if (dsc_find_plan(&ctx->fft_cache, plan_n, real ? REAL : COMPLEX, twd_dtype) == nullptr) {
+                cost += plan_n * DSC_FFT_TWIDDLE_COST;
+            }
+        }
+
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_n = fft_n;
+        }
+    }
+
+    return best_n;
+}
+
+// How the outputs are split among the workers. The units are either blocks of the overlap-save FFT
+// or DSC_CONV_BLOCK outputs of the direct convolution and never depend on the number of threads
+// so the result is always the same. Consecutive units of the same line are copied to xp together.
+struct dsc_conv_job {
+    int lines, y_n;
+    int unit_n, units_per_line, group;
+    int n_workers;
+    // Number of elements of xp, buff and fft_work used by each worker
+    int xp_n, buff_n, work_n;
+    bool direct;
+};
+
+static DSC_INLINE dsc_conv_job dsc_conv_job_init(const dsc_ctx *ctx, const dsc_conv_engine &engine,
+                                                 const int lines, const int y_n,
+                                                 const bool direct) noexcept {
+    dsc_conv_job job{};
+    job.lines = lines;
+    job.y_n = y_n;
+    job.direct = direct;
+    if (direct) {
+        job.unit_n = DSC_CONV_BLOCK;
+        job.group = 1;
+    } else {
+        job.unit_n = engine.fft_n - engine.m + 1;
+        job.group = DSC_MAX(1, DSC_CONV_BLOCK / job.unit_n);
+        job.buff_n = dsc_conv_is_real(engine.dtype) ? dsc_rfft_line_n(engine.fft_n) : engine.fft_n;
+        job.work_n = dsc_fft_work_size(engine.plan->n, engine.plan->algorithm);
+    }
+    job.units_per_line = (y_n + job.unit_n - 1) / job.unit_n;
+    job.xp_n = job.group * job.unit_n + engine.m - 1;
+
+    const i64 units = (i64) lines * job.units_per_line;
+    const i64 work = (i64) lines * y_n * (direct ? engine.m : 16);
+    job.n_workers = (int) DSC_MAX(1, DSC_MIN(DSC_MIN((i64) ctx->n_threads, units),
+                                             work / DSC_FFT_MIN_WORK_PER_THREAD));
+    return job;
+}
+
+// Fill xp with xp_n samples starting from position pos of the concatenation of a[0, a_n) and
+// b[0, b_n), everything before and after is 0
+template<typename T>
+static DSC_INLINE void dsc_conv_fill(T *DSC_RESTRICT xp, const int xp_n,
+                                     const T *DSC_RESTRICT a, const int a_n,
+                                     const T *DSC_RESTRICT b, const int b_n,
+                                     const int pos) noexcept {
+    for (int i = 0; i < xp_n;) {
+        const int p = pos + i;
+        int copy_n;
+        if (p < 0) {
+            copy_n = DSC_MIN(-p, xp_n - i);
+            memset(&xp[i], 0, copy_n * sizeof(T));
+        } else if (p < a_n) {
+            copy_n = DSC_MIN(a_n - p, xp_n - i);
+            memcpy(&xp[i], &a[p], copy_n * sizeof(T));
+        } else if (p < a_n + b_n) {
+            copy_n = DSC_MIN(a_n + b_n - p, xp_n - i);
+            memcpy(&xp[i], &b[p - a_n], copy_n * sizeof(T));
+        } else {
+            copy_n = xp_n - i;
+            memset(&xp[i], 0, copy_n * sizeof(T));
+        }
+        i += copy_n;
+    }
+}
+
+template<typename T>
+static DSC_INLINE void dsc_conv_direct(const dsc_fft_kernels *kernels,
+                                       const T *DSC_RESTRICT xp,
+                                       const T *DSC_RESTRICT h,
+                                       T *DSC_RESTRICT y,
+                                       const int y_n, const int m) noexcept {
+    if constexpr (dsc_is_type<T, f32>()) kernels->conv_f32(xp, h, y, y_n, m);
+    else if constexpr (dsc_is_type<T, f64>()) kernels->conv_f64(xp, h, y, y_n, m);
+    else if constexpr (dsc_is_type<T, c32>()) kernels->conv_c32(xp, h, y, y_n, m);
+    else kernels->conv_c64(xp, h, y, y_n, m);
+}
+
+// C is the complex type of the FFTs, the samples are real<C> if the signal is real
+template<typename C, bool real_data>
+using dsc_conv_type = std::conditional_t<real_data, real<C>, C>;
+
+// y[k] = sum_j h[j] * xp[k + M - 1 - j] for k in [0, y_n), xp has y_n + M - 1 samples
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_conv_valid(const dsc_conv_engine &engine, const bool direct,
+                                      const dsc_conv_type<C, real_data> *DSC_RESTRICT xp,
+                                      dsc_conv_type<C, real_data> *DSC_RESTRICT y,
+                                      const int y_n,
+                                      C *DSC_RESTRICT buff,
+                                      C *DSC_RESTRICT fft_work) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+
+    const int m = engine.m;
+    if (direct) {
+        dsc_conv_direct<T>(engine.kernels, xp, (const T *) engine.h, y, y_n, m);
+        return;
+    }
+
+    const int fft_n = engine.fft_n;
+    const int step = fft_n - m + 1;
+    const int xp_n = y_n + m - 1;
+    const int n_bins = real_data ? (fft_n >> 1) + 1 : fft_n;
+    const C *DSC_RESTRICT h_fft = (const C *) engine.h_fft;
+    T *DSC_RESTRICT block = (T *) buff;
+
+    for (int k = 0; k < y_n; k += step) {
+        const int copy_n = DSC_MIN(fft_n, xp_n - k);
+        memcpy(block, &xp[k], copy_n * sizeof(T));
+        memset(&block[copy_n], 0, (fft_n - copy_n) * sizeof(T));
+
+        if constexpr (real_data) dsc_real_fft<C, true>(engine.plan, buff, fft_work);
+        else dsc_complex_fft<C, true>(engine.plan, buff, fft_work);
+
+        for (int i = 0; i < n_bins; ++i) buff[i] = mul_op()(buff[i], h_fft[i]);
+
+        if constexpr (real_data) dsc_real_fft<C, false>(engine.plan, buff, fft_work);
+        else dsc_complex_fft<C, false>(engine.plan, buff, fft_work);
+
+        // The first M - 1 samples are corrupted by the circular convolution
+        memcpy(&y[k], &block[m - 1], DSC_MIN(step, y_n - k) * sizeof(T));
+    }
+}
+
+// Reverse and conjugate the kernel if needed and compute its spectrum
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_conv_init_kernel(const dsc_conv_engine &engine,
+                                            const dsc_conv_type<C, real_data> *DSC_RESTRICT h,
+                                            const bool correlate,
+                                            C *DSC_RESTRICT buff,
+                                            C *DSC_RESTRICT fft_work) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+
+    const int m = engine.m;
+    T *DSC_RESTRICT engine_h = (T *) engine.h;
+    if (correlate) {
+        for (int j = 0; j < m; ++j) {
+            if constexpr (real_data) engine_h[j] = h[m - 1 - j];
+            else engine_h[j] = dsc_complex(C, h[m - 1 - j].real, -h[m - 1 - j].imag);
+        }
+    } else {
+        memcpy(engine_h, h, m * sizeof(T));
+    }
+
+    if (engine.plan == nullptr) return;
+
+    const int fft_n = engine.fft_n;
+    T *DSC_RESTRICT block = (T *) buff;
+    memcpy(block, engine_h, m * sizeof(T));
+    memset(&block[m], 0, (fft_n - m) * sizeof(T));
+
+    if constexpr (real_data) {
+        dsc_real_fft<C, true>(engine.plan, buff, fft_work);
+        memcpy(engine.h_fft, buff, ((fft_n >> 1) + 1) * sizeof(C));
+    } else {
+        dsc_complex_fft<C, true>(engine.plan, buff, fft_work);
+        memcpy(engine.h_fft, buff, fft_n * sizeof(C));
+    }
+}
+
+// Compute job.y_n outputs for each of the job.lines lines, the input of line l is the concatenation
+// of a[l * a_stride, l * a_stride + a_n) and b[0, b_n) and the first output is at position pos.
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_conv_exec(dsc_ctx *ctx, const dsc_conv_engine &engine,
+                                     const dsc_conv_job &job,
+                                     const dsc_conv_type<C, real_data> *DSC_RESTRICT a,
+                                     const int a_n, const int a_stride,
+                                     const dsc_conv_type<C, real_data> *DSC_RESTRICT b,
+                                     const int b_n, const int pos,
+                                     dsc_conv_type<C, real_data> *DSC_RESTRICT y,
+                                     dsc_conv_type<C, real_data> *DSC_RESTRICT xp,
+                                     C *DSC_RESTRICT buff,
+                                     C *DSC_RESTRICT fft_work) noexcept {
+    const int m = engine.m;
+    const int y_n = job.y_n;
+    const int units_per_line = job.units_per_line;
+    const i64 units = (i64) job.lines * units_per_line;
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        auto *DSC_RESTRICT xp_data = &xp[job.xp_n * worker];
+        C *DSC_RESTRICT buff_data = &buff[job.buff_n * worker];
+        C *DSC_RESTRICT fft_work_data = &fft_work[job.work_n * worker];
+
+        const i64 unit_stop = units * (worker + 1) / n_threads;
+        for (i64 unit = units * worker / n_threads; unit < unit_stop;) {
+            const int line = (int) (unit / units_per_line);
+            const int line_unit = (int) (unit % units_per_line);
+            const int group = (int) DSC_MIN((i64) DSC_MIN(job.group, units_per_line - line_unit),
+                                            unit_stop - unit);
+
+            const int k_start = line_unit * job.unit_n;
+            const int k_n = DSC_MIN(group * job.unit_n, y_n - k_start);
+
+            dsc_conv_fill(xp_data, k_n + m - 1, &a[(i64) line * a_stride], a_n, b, b_n, pos + k_start);
+            dsc_conv_valid<C, real_data>(engine, job.direct, xp_data, &y[(i64) line * y_n + k_start], k_n,
+                                         buff_data, fft_work_data);
+            unit += group;
+        }
+    });
+}
+
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_internal_convolve(dsc_ctx *ctx,
+                                             dsc_conv_engine &engine,
+                                             const dsc_tensor *DSC_RESTRICT x,
+                                             const dsc_tensor *DSC_RESTRICT h,
+                                             dsc_tensor *DSC_RESTRICT out,
+                                             const int k_start,
+                                             const bool correlate) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    constexpr dsc_dtype dtype = dsc_type_mapping<T>::value;
+    constexpr dsc_dtype fft_dtype = dsc_type_mapping<C>::value;
+
+    const int n = x->shape[DSC_MAX_DIMS - 1];
+    const int y_n = out->shape[DSC_MAX_DIMS - 1];
+    const dsc_conv_job job = dsc_conv_job_init(ctx, engine, x->ne / n, y_n, engine.plan == nullptr);
+
+    dsc_tensor *kernel = dsc_tensor_1d(ctx, dtype, engine.m);
+    dsc_tensor *h_fft = engine.plan != nullptr ? dsc_tensor_1d(ctx, fft_dtype, job.buff_n) : nullptr;
+    dsc_tensor *xp = dsc_tensor_1d(ctx, dtype, job.xp_n * job.n_workers);
+    dsc_tensor *buff = engine.plan != nullptr ? dsc_tensor_1d(ctx, fft_dtype, job.buff_n * job.n_workers) : nullptr;
+    dsc_tensor *fft_work = engine.plan != nullptr ? dsc_tensor_1d(ctx, fft_dtype, job.work_n * job.n_workers) : nullptr;
+    engine.h = kernel->data;
+    engine.h_fft = h_fft != nullptr ? h_fft->data : nullptr;
+
+    C *buff_data = buff != nullptr ? (C *) buff->data : nullptr;
+    C *fft_work_data = fft_work != nullptr ? (C *) fft_work->data : nullptr;
+
+    dsc_conv_init_kernel<C, real_data>(engine, (const T *) h->data, correlate, buff_data, fft_work_data);
+
+    // Line l of the padded input starts M - 1 zeros before x[l]
+    dsc_conv_exec<C, real_data>(ctx, engine, job, (const T *) x->data, n, n, nullptr, 0, k_start - (engine.m - 1),
+                                (T *) out->data, (T *) xp->data, buff_data, fft_work_data);
+}
+
+static dsc_tensor *dsc_convolve_correlate(dsc_ctx *ctx,
+                                          const dsc_tensor *DSC_RESTRICT x,
+                                          const dsc_tensor *DSC_RESTRICT h,
+                                          dsc_tensor *DSC_RESTRICT out,
+                                          const dsc_conv_mode mode,
+                                          const bool correlate) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(h != nullptr);
+    DSC_ASSERT(h->n_dim == 1);
+
+    DSC_TRACE_BINARY_OP(x, h, out);
+
+    const int n = x->shape[DSC_MAX_DIMS - 1];
+    const int m = h->ne;
+    const int min_n = DSC_MIN(n, m), max_n = DSC_MAX(n, m);
+
+    // Index of the first output in the full convolution
+    int k_start, y_n;
+    switch (mode) {
+        case FULL:
+            k_start = 0;
+            y_n = n + m - 1;
+            break;
+        case SAME:
+            // Like numpy, when the kernel is longer than the signal correlate is computed on the swapped operands
+            // and reversed so its centre moves by one sample when the signal has an even length
+            k_start = (correlate && m > n) ? (min_n >> 1) : ((min_n - 1) >> 1);
+            y_n = max_n;
+            break;
+        case VALID:
+            k_start = min_n - 1;
+            y_n = max_n - min_n + 1;
+            break;
+        DSC_INVALID_CASE("unknown mode=%d", mode);
+    }
+
+    int out_shape[DSC_MAX_DIMS];
+    memcpy(out_shape, x->shape, DSC_MAX_DIMS * sizeof(*out_shape));
+    out_shape[DSC_MAX_DIMS - 1] = y_n;
+
+    const dsc_dtype dtype = DSC_DTYPE_CONVERSION_TABLE[x->dtype][h->dtype];
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &out_shape[DSC_MAX_DIMS - x->n_dim], dtype);
+    } else {
+        DSC_ASSERT(out->dtype == dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out->shape, out_shape, DSC_MAX_DIMS * sizeof(*out_shape)) == 0);
+    }
+
+    const bool real = dsc_conv_is_real(dtype);
+    const int fft_n = dsc_conv_choose_fft_n(ctx, m, y_n, x->ne / n, dtype);
+
+    dsc_conv_engine engine{};
+    engine.kernels = dsc_fft_get_kernels();
+    engine.m = m;
+    engine.fft_n = fft_n;
+    engine.dtype = dtype;
+    if (fft_n > 0) engine.plan = real ? dsc_plan_rfft(ctx, fft_n, dtype) : dsc_plan_fft(ctx, fft_n, COMPLEX, dtype);
+
+    DSC_LOG_DEBUG("%s of x=[%d %d %d %d] with M=%d using %s",
+                  correlate ? "correlation" : "convolution",
+                  x->shape[0], x->shape[1], x->shape[2], x->shape[3], m,
+                  fft_n > 0 ? "overlap-save" : "the direct kernel");
+
+    DSC_CTX_PUSH(ctx);
+    x = dsc_cast_input(ctx, x, dtype);
+    h = dsc_cast_input(ctx, h, dtype);
+
+    switch (dtype) {
+        case F32:
+            dsc_internal_convolve<c32, true>(ctx, engine, x, h, out, k_start, correlate);
+            break;
+        case F64:
+            dsc_internal_convolve<c64, true>(ctx, engine, x, h, out, k_start, correlate);
+            break;
+        case C32:
+            dsc_internal_convolve<c32, false>(ctx, engine, x, h, out, k_start, correlate);
+            break;
+        case C64:
+            dsc_internal_convolve<c64, false>(ctx, engine, x, h, out, k_start, correlate);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+    DSC_CTX_POP(ctx);
+
+    return out;
+}
+
+dsc_tensor *dsc_convolve(dsc_ctx *ctx,
+                         const dsc_tensor *DSC_RESTRICT x,
+                         const dsc_tensor *DSC_RESTRICT h,
+                         dsc_tensor *DSC_RESTRICT out,
+                         const dsc_conv_mode mode) noexcept {
+    return dsc_convolve_correlate(ctx, x, h, out, mode, false);
+}
+
+dsc_tensor *dsc_correlate(dsc_ctx *ctx,
+                          const dsc_tensor *DSC_RESTRICT x,
+                          const dsc_tensor *DSC_RESTRICT h,
+                          dsc_tensor *DSC_RESTRICT out,
+                          const dsc_conv_mode mode) noexcept {
+    return dsc_convolve_correlate(ctx, x, h, out, mode, true);
+}
+
+// ============================================================
+// Streaming Convolution
+
+struct dsc_conv_stream {
+    // The plan is owned by the stream like the plan of dsc_stft, h and h_fft point to the tensors below
+    dsc_conv_engine engine;
+    dsc_tensor *h, *h_fft;
+    // The last M - 1 samples pushed
+    dsc_tensor *tail;
+};
+
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_conv_stream_push_samples(dsc_ctx *ctx,
+                                                    dsc_conv_stream *stream,
+                                                    const dsc_tensor *DSC_RESTRICT x,
+                                                    dsc_tensor *DSC_RESTRICT out) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    constexpr dsc_dtype dtype = dsc_type_mapping<T>::value;
+    constexpr dsc_dtype fft_dtype = dsc_type_mapping<C>::value;
+
+    const dsc_conv_engine &engine = stream->engine;
+    const int n = x->ne, m = engine.m;
+    const int tail_n = m - 1;
+
+    // Short pushes may not be worth a full block
+    bool direct = engine.plan == nullptr;
+    if (!direct) {
+        const int step = engine.fft_n - m + 1;
+        const f64 fft_cost = ((n + step - 1) / step) * dsc_conv_block_cost(engine.fft_n, real_data);
+        direct = (f64) n * (f64) m * DSC_CONV_MAC_COST[dtype] < fft_cost;
+    }
+
+    const dsc_conv_job job = dsc_conv_job_init(ctx, engine, 1, n, direct);
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *xp = dsc_tensor_1d(ctx, dtype, job.xp_n * job.n_workers);
+    dsc_tensor *buff = direct ? nullptr : dsc_tensor_1d(ctx, fft_dtype, job.buff_n * job.n_workers);
+    dsc_tensor *fft_work = direct ? nullptr : dsc_tensor_1d(ctx, fft_dtype, job.work_n * job.n_workers);
+
+    T *DSC_RESTRICT tail = (T *) stream->tail->data;
+    const T *DSC_RESTRICT x_data = (const T *) x->data;
+    dsc_conv_exec<C, real_data>(ctx, engine, job, tail, tail_n, 0, x_data, n, 0, (T *) out->data, (T *) xp->data,
+                                buff != nullptr ? (C *) buff->data : nullptr,
+                                fft_work != nullptr ? (C *) fft_work->data : nullptr);
+    DSC_CTX_POP(ctx);
+
+    if (n >= tail_n) {
+        memcpy(tail, &x_data[n - tail_n], tail_n * sizeof(T));
+    } else {
+        memmove(tail, &tail[n], (tail_n - n) * sizeof(T));
+        memcpy(&tail[tail_n - n], x_data, n * sizeof(T));
+    }
+}
+
+dsc_conv_stream *dsc_conv_stream_init(dsc_ctx *ctx,
+                                      const dsc_tensor *DSC_RESTRICT h,
+                                      const bool correlate) noexcept {
+    DSC_ASSERT(h != nullptr);
+    DSC_ASSERT(h->n_dim == 1);
+
+    const dsc_dtype dtype = h->dtype;
+    const bool real = dsc_conv_is_real(dtype);
+    const dsc_dtype fft_dtype = real ? (dtype == F32 ? C32 : C64) : dtype;
+    const int m = h->ne;
+    const int fft_n = dsc_conv_choose_fft_n(ctx, m, 0, 1, dtype);
+
+    dsc_conv_stream *stream = (dsc_conv_stream *) dsc_obj_alloc(ctx->main_allocator, sizeof(dsc_conv_stream));
+    dsc_conv_engine &engine = stream->engine;
+    engine.kernels = dsc_fft_get_kernels();
+    engine.plan = nullptr;
+    engine.m = m;
+    engine.fft_n = fft_n;
+    engine.dtype = dtype;
+
+    stream->h = dsc_tensor_1d(ctx, dtype, m);
+    stream->h_fft = nullptr;
+    // Keep at least one element so the tail is never empty
+    stream->tail = dsc_tensor_1d(ctx, dtype, DSC_MAX(1, m - 1));
+    memset(stream->tail->data, 0, stream->tail->ne * DSC_DTYPE_SIZE[dtype]);
+    engine.h = stream->h->data;
+    engine.h_fft = nullptr;
+
+    dsc_tensor *buff = nullptr, *fft_work = nullptr;
+    if (fft_n > 0) {
+        const int plan_n = real ? (fft_n >> 1) : fft_n;
+        engine.plan = dsc_alloc_plan(ctx, plan_n, real ? REAL : COMPLEX, real ? dtype : (dtype == C32 ? F32 : F64),
+                                     dsc_fft_choose_algorithm(plan_n));
+        const int n_bins = real ? dsc_rfft_line_n(fft_n) : fft_n;
+        stream->h_fft = dsc_tensor_1d(ctx, fft_dtype, n_bins);
+        engine.h_fft = stream->h_fft->data;
+
+        DSC_CTX_PUSH(ctx);
+        buff = dsc_tensor_1d(ctx, fft_dtype, n_bins);
+        fft_work = dsc_tensor_1d(ctx, fft_dtype, dsc_fft_work_size(plan_n, engine.plan->algorithm));
+    }
+
+    switch (dtype) {
+        case F32:
+            dsc_conv_init_kernel<c32, true>(engine, (const f32 *) h->data, correlate,
+                                            buff != nullptr ? (c32 *) buff->data : nullptr,
+                                            fft_work != nullptr ? (c32 *) fft_work->data : nullptr);
+            break;
+        case F64:
+            dsc_conv_init_kernel<c64, true>(engine, (const f64 *) h->data, correlate,
+                                            buff != nullptr ? (c64 *) buff->data : nullptr,
+                                            fft_work != nullptr ? (c64 *) fft_work->data : nullptr);
+            break;
+        case C32:
+            dsc_conv_init_kernel<c32, false>(engine, (const c32 *) h->data, correlate,
+                                             buff != nullptr ? (c32 *) buff->data : nullptr,
+                                             fft_work != nullptr ? (c32 *) fft_work->data : nullptr);
+            break;
+        case C64:
+            dsc_conv_init_kernel<c64, false>(engine, (const c64 *) h->data, correlate,
+                                             buff != nullptr ? (c64 *) buff->data : nullptr,
+                                             fft_work != nullptr ? (c64 *) fft_work->data : nullptr);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+
+    if (fft_n > 0) DSC_CTX_POP(ctx);
+
+    DSC_LOG_DEBUG("created %s stream with M=%d dtype=%s using %s",
+                  correlate ? "correlation" : "convolution", m, DSC_DTYPE_NAMES[dtype],
+                  fft_n > 0 ? "overlap-save" : "the direct kernel");
+
+    return stream;
+}
+
+dsc_tensor *dsc_conv_stream_push(dsc_ctx *ctx,
+                                 dsc_conv_stream *stream,
+                                 const dsc_tensor *DSC_RESTRICT x,
+                                 dsc_tensor *DSC_RESTRICT out) noexcept {
+    DSC_ASSERT(stream != nullptr);
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(x->n_dim == 1);
+
+    const dsc_dtype dtype = stream->engine.dtype;
+    DSC_ASSERT(x->dtype == dtype);
+
+    DSC_TRACE_BINARY_OP(x, stream->h, out);
+
+    if (out == nullptr) {
+        out = dsc_tensor_1d(ctx, dtype, x->ne);
+    } else {
+        DSC_ASSERT(out->dtype == dtype);
+        DSC_ASSERT(out->n_dim == 1);
+        DSC_ASSERT(out->ne == x->ne);
+    }
+
+    switch (dtype) {
+        case F32:
+            dsc_conv_stream_push_samples<c32, true>(ctx, stream, x, out);
+            break;
+        case F64:
+            dsc_conv_stream_push_samples<c64, true>(ctx, stream, x, out);
+            break;
+        case C32:
+            dsc_conv_stream_push_samples<c32, false>(ctx, stream, x, out);
+            break;
+        case C64:
+            dsc_conv_stream_push_samples<c64, false>(ctx, stream, x, out);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+
+    return out;
+}
+
+void dsc_conv_stream_reset(dsc_conv_stream *stream) noexcept {
+    memset(stream->tail->data, 0, stream->tail->ne * DSC_DTYPE_SIZE[stream->engine.dtype]);
+}
+
+void dsc_conv_stream_free(dsc_ctx *ctx, dsc_conv_stream *stream) noexcept {
+    if (stream == nullptr) return;
+
+    if (stream->engine.plan != nullptr) dsc_free_plan(ctx, stream->engine.plan);
+    dsc_tensor_free(ctx, stream->h);
+    dsc_tensor_free(ctx, stream->h_fft);
+    dsc_tensor_free(ctx, stream->tail);
+    dsc_obj_free(ctx->main_allocator, stream);
+}
+
+// ============================================================
+// Sparse DFT
+
+// Number of samples processed by the Goertzel kernel before moving on to the next bins so
+// that the samples are still in cache when they are read again
+static constexpr int DSC_GOERTZEL_BLOCK = 4096;
+// Lines are split into segments until there are at least this many bins x segments, but
+// segments are never shorter than DSC_GOERTZEL_MIN_SEGMENT samples
+static constexpr int DSC_GOERTZEL_MIN_LANE_BINS = 64;
+static constexpr int DSC_GOERTZEL_MIN_SEGMENT = 64;
+
+// The state of the Goertzel recurrence is always in double precision, see goertzel_block
+template<bool real_data>
+using dsc_goertzel_state = dsc_conv_type<c64, real_data>;
+
+// c holds lambda followed by sigma, see goertzel_lanes
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_goertzel_kernel(const dsc_fft_kernels *kernels,
+                                           const dsc_conv_type<C, real_data> *x, const int x_n,
+                                           const int seg_stride, const int n_seg,
+                                           const dsc_goertzel_state<real_data> *c,
+                                           dsc_goertzel_state<real_data> *s,
+                                           dsc_goertzel_state<real_data> *d,
+                                           const int n_bins) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    const dsc_goertzel_state<real_data> *sigma = &c[n_bins];
+    if constexpr (dsc_is_type<T, f32>()) kernels->goertzel_f32(x, x_n, seg_stride, n_seg, c, sigma, s, d, n_bins);
+    else if constexpr (dsc_is_type<T, f64>()) kernels->goertzel_f64(x, x_n, seg_stride, n_seg, c, sigma, s, d, n_bins);
+    else if constexpr (dsc_is_type<T, c32>()) kernels->goertzel_c32(x, x_n, seg_stride, n_seg, c, sigma, s, d, n_bins);
+    else kernels->goertzel_c64(x, x_n, seg_stride, n_seg, c, sigma, s, d, n_bins);
+}
+
+// sigma = sign(cos(w)) and cos(w) - sigma computed without cancellation
+static DSC_INLINE void dsc_goertzel_sigma(const f64 w, f64 *sigma, f64 *cos_w_sigma) noexcept {
+    if (cos_op()(w) >= 0) {
+        const f64 sin_half = sin_op()(0.5 * w);
+        *sigma = 1.;
+        *cos_w_sigma = -2. * sin_half * sin_half;
+    } else {
+        const f64 cos_half = cos_op()(0.5 * w);
+        *sigma = -1.;
+        *cos_w_sigma = 2. * cos_half * cos_half;
+    }
+}
+
+// The coefficients lambda and sigma of the recurrence of each bin, lambda first. For complex
+// signals both parts hold the coefficient.
+template<bool real_data>
+static DSC_INLINE void dsc_goertzel_coeffs(const int n, const int *bins, const int n_bins,
+                                           dsc_goertzel_state<real_data> *c) noexcept {
+    for (int k = 0; k < n_bins; ++k) {
+        f64 sigma, cos_w_sigma;
+        dsc_goertzel_sigma((2. * dsc_pi<f64>() * bins[k]) / (f64) n, &sigma, &cos_w_sigma);
+        if constexpr (real_data) {
+            c[k] = 2. * cos_w_sigma;
+            c[n_bins + k] = sigma;
+        } else {
+            c[k] = dsc_complex(c64, 2. * cos_w_sigma, 2. * cos_w_sigma);
+            c[n_bins + k] = dsc_complex(c64, sigma, sigma);
+        }
+    }
+}
+
+// After seg_n samples of segment p the bin k of the n-points DFT of the whole signal gets
+// e^(-iw(p + 1)seg_n) * ((e^(iw) - sigma) * s + sigma * d) with w = 2πk/n.
+// f holds e^(iw) - sigma of each bin followed by the rotations of each segment.
+static DSC_INLINE void dsc_goertzel_factors(const int n, const int *bins, const int n_bins,
+                                            const int seg_n, const int n_seg, c64 *f) noexcept {
+    for (int k = 0; k < n_bins; ++k) {
+        const f64 w = (2. * dsc_pi<f64>() * bins[k]) / (f64) n;
+        f64 sigma, cos_w_sigma;
+        dsc_goertzel_sigma(w, &sigma, &cos_w_sigma);
+        f[k] = dsc_complex(c64, cos_w_sigma, sin_op()(w));
+        for (int p = 0; p < n_seg; ++p) {
+            // Reduce first so the phase is accurate for long signals
+            const f64 shift = (-2. * dsc_pi<f64>() * (f64) (((i64) bins[k] * (p + 1) * seg_n) % n)) / (f64) n;
+            f[(p + 1) * n_bins + k] = dsc_complex(c64, cos_op()(shift), sin_op()(shift));
+        }
+    }
+}
+
+// (e^(iw) - sigma) * s + sigma * d
+template<bool real_data>
+static DSC_INLINE c64 dsc_goertzel_bin(const c64 a, const f64 sigma,
+                                       const dsc_goertzel_state<real_data> s,
+                                       const dsc_goertzel_state<real_data> d) noexcept {
+    if constexpr (real_data) {
+        return dsc_complex(c64, a.real * s + sigma * d, a.imag * s);
+    } else {
+        return dsc_complex(c64, a.real * s.real - a.imag * s.imag + sigma * d.real,
+                           a.real * s.imag + a.imag * s.real + sigma * d.imag);
+    }
+}
+
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_internal_goertzel(dsc_ctx *ctx,
+                                             const dsc_tensor *DSC_RESTRICT x,
+                                             dsc_tensor *DSC_RESTRICT out,
+                                             const int *bins, const int n_bins,
+                                             const int n, const int axis) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    using S = dsc_goertzel_state<real_data>;
+    constexpr dsc_dtype dtype = dsc_type_mapping<T>::value;
+    constexpr dsc_dtype state_dtype = dsc_type_mapping<S>::value;
+
+    const dsc_fft_kernels *kernels = dsc_fft_get_kernels();
+    const int x_n = DSC_MIN(x->shape[axis], n);
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const int lines = x->ne / x->shape[axis];
+    const int n_workers = DSC_MAX(1, DSC_MIN(DSC_MIN(ctx->n_threads, lines),
+                                             (int) (((i64) lines * x_n * n_bins) / DSC_FFT_MIN_WORK_PER_THREAD)));
+
+    // With few bins each line is split into segments so the kernel has enough independent recurrences
+    const int n_seg = DSC_MAX(1, DSC_MIN(DSC_MIN(DSC_GOERTZEL_MAX_SEGMENTS, DSC_GOERTZEL_MIN_LANE_BINS / n_bins),
+                                         x_n / DSC_GOERTZEL_MIN_SEGMENT));
+    const int seg_n = (x_n + n_seg - 1) / n_seg;
+    // Contiguous lines are read in-place, the others are copied to a buffer and zero-padded to n_seg segments
+    const int line_n = x_stride == 1 && seg_n * n_seg == x_n ? 0 : seg_n * n_seg;
+    const int state_n = 2 * n_seg * n_bins;
+
+    DSC_LOG_DEBUG("Goertzel of %d bins with %d segments of %d samples", n_bins, n_seg, seg_n);
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *coeffs = dsc_tensor_1d(ctx, state_dtype, 2 * n_bins);
+    dsc_tensor *factors = dsc_tensor_1d(ctx, C64, (n_seg + 1) * n_bins);
+    dsc_tensor *state = dsc_tensor_1d(ctx, state_dtype, state_n * n_workers);
+    dsc_tensor *lines_buff = line_n > 0 ? dsc_tensor_1d(ctx, dtype, line_n * n_workers) : nullptr;
+    dsc_goertzel_coeffs<real_data>(n, bins, n_bins, (S *) coeffs->data);
+    dsc_goertzel_factors(n, bins, n_bins, seg_n, n_seg, (c64 *) factors->data);
+
+    dsc_parallel(ctx->thread_pool, n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(T, x);
+        DSC_TENSOR_DATA(C, out);
+        const S *DSC_RESTRICT c = (const S *) coeffs->data;
+        const c64 *DSC_RESTRICT f = (const c64 *) factors->data;
+        S *DSC_RESTRICT s = &((S *) state->data)[state_n * worker];
+        S *DSC_RESTRICT d = &s[n_seg * n_bins];
+        T *DSC_RESTRICT line_data = line_n > 0 ? &((T *) lines_buff->data)[line_n * worker] : nullptr;
+
+        const int line_start = lines * worker / n_threads;
+        const int line_stop = lines * (worker + 1) / n_threads;
+        dsc_line_iterator x_it(x, axis, line_start);
+        dsc_line_iterator out_it(out, axis, line_start);
+
+        for (int line = line_start; line < line_stop; ++line) {
+            const T *DSC_RESTRICT line_x = &x_data[x_it.index()];
+            if (line_n > 0) {
+                for (int i = 0; i < x_n; ++i) line_data[i] = line_x[i * x_stride];
+                for (int i = x_n; i < line_n; ++i) line_data[i] = dsc_zero<T>();
+                line_x = line_data;
+            }
+
+            memset(s, 0, state_n * sizeof(S));
+            for (int i = 0; i < seg_n; i += DSC_GOERTZEL_BLOCK)
+                dsc_goertzel_kernel<C, real_data>(kernels, &line_x[i], DSC_MIN(DSC_GOERTZEL_BLOCK, seg_n - i),
+                                                  seg_n, n_seg, c, s, d, n_bins);
+
+            C *DSC_RESTRICT line_out = &out_data[out_it.index()];
+            for (int k = 0; k < n_bins; ++k) {
+                f64 sigma;
+                if constexpr (real_data) sigma = c[n_bins + k];
+                else sigma = c[n_bins + k].real;
+                f64 x_real = 0, x_imag = 0;
+                for (int p = 0; p < n_seg; ++p) {
+                    const c64 y = dsc_goertzel_bin<real_data>(f[k], sigma, s[p * n_bins + k], d[p * n_bins + k]);
+                    const c64 rot = f[(p + 1) * n_bins + k];
+                    x_real += y.real * rot.real - y.imag * rot.imag;
+                    x_imag += y.real * rot.imag + y.imag * rot.real;
+                }
+                line_out[k * out_stride] = dsc_complex(C, (real<C>) x_real, (real<C>) x_imag);
+            }
+
+            x_it.next();
+            out_it.next();
+        }
+    });
+    DSC_CTX_POP(ctx);
+}
+
+dsc_tensor *dsc_goertzel(dsc_ctx *ctx,
+                         const dsc_tensor *DSC_RESTRICT x,
+                         const int *bins,
+                         const int n_bins,
+                         dsc_tensor *DSC_RESTRICT out,
+                         int n,
+                         const int axis) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(bins != nullptr);
+    DSC_ASSERT(n_bins > 0);
+
+    const int axis_idx = dsc_tensor_dim(x, axis);
+    DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
+
+    if (n <= 0) n = x->shape[axis_idx];
+    for (int k = 0; k < n_bins; ++k) DSC_ASSERT(bins[k] >= 0 && bins[k] < n);
+
+    DSC_TRACE_FFT_OP(x, out, n, axis, dsc_fft_type::COMPLEX, true);
+
+    int out_shape[DSC_MAX_DIMS];
+    for (int i = 0; i < DSC_MAX_DIMS; ++i)
+        out_shape[i] = i != axis_idx ? x->shape[i] : n_bins;
+
+    dsc_dtype out_dtype = x->dtype;
+    if (x->dtype == F32) {
+        out_dtype = C32;
+    } else if (x->dtype == F64) {
+        out_dtype = C64;
+    }
+
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &out_shape[DSC_MAX_DIMS - x->n_dim], out_dtype);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, out->shape, DSC_MAX_DIMS * sizeof(out->shape[0])) == 0);
+    }
+
+    DSC_LOG_DEBUG("computing %d bins of the DFT of length %d on x=[%d %d %d %d] over axis %d with Goertzel",
+                  n_bins, n, x->shape[0], x->shape[1], x->shape[2], x->shape[3], axis_idx);
+
+    switch (x->dtype) {
+        case F32:
+            dsc_internal_goertzel<c32, true>(ctx, x, out, bins, n_bins, n, axis_idx);
+            break;
+        case F64:
+            dsc_internal_goertzel<c64, true>(ctx, x, out, bins, n_bins, n, axis_idx);
+            break;
+        case C32:
+            dsc_internal_goertzel<c32, false>(ctx, x, out, bins, n_bins, n, axis_idx);
+            break;
+        case C64:
+            dsc_internal_goertzel<c64, false>(ctx, x, out, bins, n_bins, n, axis_idx);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    }
+
+    return out;
+}
+
+// ============================================================
+// Sliding DFT
+
+struct dsc_sdft {
+    const dsc_fft_kernels *kernels;
+    // The last n samples, ring[pos] is the oldest
+    dsc_tensor *ring;
+    // The current value of each bin and the twiddles e^(i2πk/n)
+    dsc_tensor *state, *twiddles;
+    // The Goertzel coefficients and factors used to recompute the bins from the ring
+    dsc_tensor *coeffs, *factors;
+    int n, n_bins;
+    int pos;
+    // Number of samples since the bins were last recomputed from the ring
+    int since_sync;
+    dsc_dtype dtype;
+};
+
+// The recurrence accumulates rounding errors so, every n samples, the bins are recomputed
+// from the ring with Goertzel. This costs as much as the n updates it replaces.
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_sdft_sync(dsc_sdft *sdft, dsc_goertzel_state<real_data> *s,
+                                     dsc_goertzel_state<real_data> *d) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    using S = dsc_goertzel_state<real_data>;
+
+    const int n = sdft->n, n_bins = sdft->n_bins, pos = sdft->pos;
+    const T *DSC_RESTRICT ring = (const T *) sdft->ring->data;
+    const S *DSC_RESTRICT c = (const S *) sdft->coeffs->data;
+    const c64 *DSC_RESTRICT f = (const c64 *) sdft->factors->data;
+    C *DSC_RESTRICT state = (C *) sdft->state->data;
+
+    memset(s, 0, n_bins * sizeof(S));
+    memset(d, 0, n_bins * sizeof(S));
+    dsc_goertzel_kernel<C, real_data>(sdft->kernels, &ring[pos], n - pos, 0, 1, c, s, d, n_bins);
+    dsc_goertzel_kernel<C, real_data>(sdft->kernels, ring, pos, 0, 1, c, s, d, n_bins);
+
+    // The window is exactly n samples long so there is no rotation
+    for (int k = 0; k < n_bins; ++k) {
+        f64 sigma;
+        if constexpr (real_data) sigma = c[n_bins + k];
+        else sigma = c[n_bins + k].real;
+        const c64 y = dsc_goertzel_bin<real_data>(f[k], sigma, s[k], d[k]);
+        state[k] = dsc_complex(C, (real<C>) y.real, (real<C>) y.imag);
+    }
+}
+
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_sdft_push_samples(dsc_ctx *ctx,
+                                             dsc_sdft *sdft,
+                                             const dsc_tensor *DSC_RESTRICT x,
+                                             dsc_tensor *DSC_RESTRICT out) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    constexpr dsc_dtype fft_dtype = dsc_type_mapping<C>::value;
+
+    const int n = sdft->n, n_bins = sdft->n_bins;
+    const int x_n = x->ne;
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *d = dsc_tensor_1d(ctx, fft_dtype, DSC_MIN(x_n, n));
+    dsc_tensor *sync_state = dsc_tensor_1d(ctx, sdft->coeffs->dtype, 2 * n_bins);
+
+    const T *DSC_RESTRICT x_data = (const T *) x->data;
+    T *DSC_RESTRICT ring = (T *) sdft->ring->data;
+    C *DSC_RESTRICT d_data = (C *) d->data;
+    C *DSC_RESTRICT out_data = (C *) out->data;
+    const C *DSC_RESTRICT w = (const C *) sdft->twiddles->data;
+    C *DSC_RESTRICT state = (C *) sdft->state->data;
+
+    for (int i = 0; i < x_n;) {
+        // Stop at the next sync
+        const int block_n = DSC_MIN(x_n - i, n - sdft->since_sync);
+        for (int j = 0; j < block_n; ++j) {
+            T &oldest = ring[sdft->pos];
+            const T x_j = x_data[i + j];
+            if constexpr (real_data) d_data[j] = dsc_complex(C, x_j - oldest, 0);
+            else d_data[j] = dsc_complex(C, x_j.real - oldest.real, x_j.imag - oldest.imag);
+            oldest = x_j;
+            if (++sdft->pos == n) sdft->pos = 0;
+        }
+
+        if constexpr (dsc_is_type<C, c32>()) sdft->kernels->sdft_c32(d_data, block_n, w, state, &out_data[(i64) i * n_bins], n_bins);
+        else sdft->kernels->sdft_c64(d_data, block_n, w, state, &out_data[(i64) i * n_bins], n_bins);
+
+        i += block_n;
+        sdft->since_sync += block_n;
+        if (sdft->since_sync == n) {
+            dsc_goertzel_state<real_data> *s = (dsc_goertzel_state<real_data> *) sync_state->data;
+            dsc_sdft_sync<C, real_data>(sdft, s, &s[n_bins]);
+            memcpy(&out_data[(i64) (i - 1) * n_bins], state, n_bins * sizeof(C));
+            sdft->since_sync = 0;
+        }
+    }
+    DSC_CTX_POP(ctx);
+}
+
+dsc_sdft *dsc_sdft_init(dsc_ctx *ctx,
+                        const int n,
+                        const int *bins,
+                        const int n_bins,
+                        const dsc_dtype dtype) noexcept {
+    DSC_ASSERT(n > 0);
+    DSC_ASSERT(bins != nullptr);
+    DSC_ASSERT(n_bins > 0);
+    for (int k = 0; k < n_bins; ++k) DSC_ASSERT(bins[k] >= 0 && bins[k] < n);
+
+    const bool real = dsc_conv_is_real(dtype);
+    const dsc_dtype fft_dtype = real ? (dtype == F32 ? C32 : C64) : dtype;
+
+    dsc_sdft *sdft = (dsc_sdft *) dsc_obj_alloc(ctx->main_allocator, sizeof(dsc_sdft));
+    sdft->kernels = dsc_fft_get_kernels();
+    sdft->ring = dsc_tensor_1d(ctx, dtype, n);
+    sdft->state = dsc_tensor_1d(ctx, fft_dtype, n_bins);
+    sdft->twiddles = dsc_tensor_1d(ctx, fft_dtype, n_bins);
+    sdft->coeffs = dsc_tensor_1d(ctx, real ? F64 : C64, 2 * n_bins);
+    sdft->factors = dsc_tensor_1d(ctx, C64, 2 * n_bins);
+    sdft->n = n;
+    sdft->n_bins = n_bins;
+    sdft->dtype = dtype;
+    dsc_sdft_reset(sdft);
+
+    for (int k = 0; k < n_bins; ++k) {
+        const f64 w = (2. * dsc_pi<f64>() * bins[k]) / (f64) n;
+        if (fft_dtype == C32) ((c32 *) sdft->twiddles->data)[k] = dsc_complex(c32, (f32) cos_op()(w), (f32) sin_op()(w));
+        else ((c64 *) sdft->twiddles->data)[k] = dsc_complex(c64, cos_op()(w), sin_op()(w));
+    }
+
+    if (real) dsc_goertzel_coeffs<true>(n, bins, n_bins, (f64 *) sdft->coeffs->data);
+    else dsc_goertzel_coeffs<false>(n, bins, n_bins, (c64 *) sdft->coeffs->data);
+    dsc_goertzel_factors(n, bins, n_bins, n, 1, (c64 *) sdft->factors->data);
+
+    DSC_LOG_DEBUG("created sliding DFT with N=%d bins=%d dtype=%s", n, n_bins, DSC_DTYPE_NAMES[dtype]);
+
+    return sdft;
+}
+
+dsc_tensor *dsc_sdft_push(dsc_ctx *ctx,
+                          dsc_sdft *sdft,
+                          const dsc_tensor *DSC_RESTRICT x,
+                          dsc_tensor *DSC_RESTRICT out) noexcept {
+    DSC_ASSERT(sdft != nullptr);
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(x->n_dim == 1);
+
+    const dsc_dtype dtype = sdft->dtype;
+    DSC_ASSERT(x->dtype == dtype);
+
+    DSC_TRACE_UNARY_OP(x, out);
+
+    const dsc_dtype out_dtype = sdft->state->dtype;
+    if (out == nullptr) {
+        out = dsc_tensor_2d(ctx, out_dtype, x->ne, sdft->n_bins);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == 2);
+        DSC_ASSERT(out->shape[DSC_MAX_DIMS - 2] == x->ne && out->shape[DSC_MAX_DIMS - 1] == sdft->n_bins);
+    }
+
+    switch (dtype) {
+        case F32:
+            dsc_sdft_push_samples<c32, true>(ctx, sdft, x, out);
+            break;
+        case F64:
+            dsc_sdft_push_samples<c64, true>(ctx, sdft, x, out);
+            break;
+        case C32:
+            dsc_sdft_push_samples<c32, false>(ctx, sdft, x, out);
+            break;
+        case C64:
+            dsc_sdft_push_samples<c64, false>(ctx, sdft, x, out);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+
+    return out;
+}
+
+void dsc_sdft_reset(dsc_sdft *sdft) noexcept {
+    memset(sdft->ring->data, 0, sdft->ring->ne * DSC_DTYPE_SIZE[sdft->dtype]);
+    memset(sdft->state->data, 0, sdft->state->ne * DSC_DTYPE_SIZE[sdft->state->dtype]);
+    sdft->pos = 0;
+    sdft->since_sync = 0;
+}
+
+void dsc_sdft_free(dsc_ctx *ctx, dsc_sdft *sdft) noexcept {
+    if (sdft == nullptr) return;
+
+    dsc_tensor_free(ctx, sdft->ring);
+    dsc_tensor_free(ctx, sdft->state);
+    dsc_tensor_free(ctx, sdft->twiddles);
+    dsc_tensor_free(ctx, sdft->coeffs);
+    dsc_tensor_free(ctx, sdft->factors);
+    dsc_obj_free(ctx->main_allocator, sdft);
+}
+
+// ============================================================
+// Chirp-Z Transform
+//
+// The CZT of x is X[k] = sum_j x[j] * a^-j * w^(jk) for k in [0, M), the z-transform of x on the M points
+// a * w^-k of a spiral. With jk = (j^2 + k^2 - (k - j)^2) / 2 this is Bluestein's algorithm:
+//   X[k] = w^(k^2/2) * sum_j (x[j] * a^-j * w^(j^2/2)) * w^(-(k - j)^2/2)
+// a linear convolution of N + M - 1 samples computed with two FFTs of order L >= N + M - 1. The chirps and
+// the spectrum of w^(-i^2/2) only depend on (N, M, w, a) so they are cached in the context like the FFT plans.
+
+struct dsc_czt_plan {
+    dsc_czt_plan *next;
+    // Plan of the FFTs of order L, it's not in the FFT cache so it's never evicted while the CZT plan is alive
+    dsc_fft_plan *plan;
+    // a^-j * w^(j^2/2) for j in [0, N), w^(k^2/2) for k in [0, M) and the spectrum of w^(-i^2/2)
+    // for i in (-N, M) with i < 0 stored at L + i
+    void *in_chirp, *out_chirp, *h_fft;
+    c64 w, a;
+    int n, m, fft_n;
+    dsc_dtype dtype;
+};
+
+// e^(mag + i * phase). The powers of w and a are computed from the principal branch of their
+// logarithm and, since j^2 is exact in double precision, the phase of w^(j^2/2) is rounded only once.
+static DSC_INLINE c64 dsc_czt_exp(const f64 mag, const f64 phase) noexcept {
+    const f64 r = exp_op()(mag);
+    return dsc_complex(c64, r * cos_op()(phase), r * sin_op()(phase));
+}
+
+template<typename C>
+static DSC_INLINE C dsc_czt_cast(const c64 c) noexcept {
+    return dsc_complex(C, (real<C>) c.real, (real<C>) c.imag);
+}
+
+// log|z|, points that are on the unit circle up to rounding (e.g. e^(-2πi/M)) are snapped to it otherwise
+// the error of |w| is amplified by j^2 / 2
+static DSC_INLINE f64 dsc_czt_log_abs(const c64 z) noexcept {
+    const f64 log_r = log(abs_op()(z));
+    return abs_op()(log_r) <= 4. * std::numeric_limits<f64>::epsilon() ? 0. : log_r;
+}
+
+template<typename C>
+static DSC_INLINE void dsc_czt_init_chirps(dsc_czt_plan *czt, C *DSC_RESTRICT work) noexcept {
+    const f64 log_rw = dsc_czt_log_abs(czt->w), theta_w = atan2_op()(czt->w);
+    const f64 log_ra = dsc_czt_log_abs(czt->a), theta_a = atan2_op()(czt->a);
+    C *DSC_RESTRICT in_chirp = (C *) czt->in_chirp;
+    C *DSC_RESTRICT out_chirp = (C *) czt->out_chirp;
+    C *DSC_RESTRICT h_fft = (C *) czt->h_fft;
+    const int fft_n = czt->fft_n;
+
+    for (int j = 0; j < czt->n; ++j) {
+        const f64 half_sq = 0.5 * (f64) ((i64) j * j);
+        in_chirp[j] = dsc_czt_cast<C>(dsc_czt_exp(log_rw * half_sq - log_ra * j, theta_w * half_sq - theta_a * j));
+    }
+
+    memset(h_fft, 0, fft_n * sizeof(C));
+    for (int i = 0; i < DSC_MAX(czt->n, czt->m); ++i) {
+        const f64 half_sq = 0.5 * (f64) ((i64) i * i);
+        const C h = dsc_czt_cast<C>(dsc_czt_exp(-log_rw * half_sq, -theta_w * half_sq));
+        if (i < czt->m) {
+            out_chirp[i] = dsc_czt_cast<C>(dsc_czt_exp(log_rw * half_sq, theta_w * half_sq));
+            h_fft[i] = h;
+        }
+        if (i > 0 && i < czt->n) h_fft[fft_n - i] = h;
+    }
+
+    dsc_complex_fft<C, true>(czt->plan, h_fft, work);
+}
+
+static void dsc_free_czt_plan(dsc_ctx *ctx, dsc_czt_plan *czt) noexcept {
+    dsc_free_plan(ctx, czt->plan);
+    dsc_obj_free(ctx->main_allocator, czt);
+}
+
+static void dsc_czt_cache_clear(dsc_ctx *ctx) noexcept {
+    dsc_czt_cache *cache = &ctx->czt_cache;
+    while (cache->head != nullptr) {
+        dsc_czt_plan *next = cache->head->next;
+        dsc_free_czt_plan(ctx, cache->head);
+        cache->head = next;
+    }
+    cache->size = 0;
+}
+
+// Get the plan from the cache or create a new one, if the cache is full the least recently used plan is evicted
+static dsc_czt_plan *dsc_get_czt_plan(dsc_ctx *ctx, const int n, const int m,
+                                      const c64 w, const c64 a,
+                                      const dsc_dtype dtype) noexcept {
+    dsc_czt_cache *cache = &ctx->czt_cache;
+    for (dsc_czt_plan **link = &cache->head; *link != nullptr; link = &(*link)->next) {
+        dsc_czt_plan *czt = *link;
+        if (czt->n == n && czt->m == m && czt->dtype == dtype &&
+            czt->w.real == w.real && czt->w.imag == w.imag &&
+            czt->a.real == a.real && czt->a.imag == a.imag) {
+            // Move the plan to the front
+            *link = czt->next;
+            czt->next = cache->head;
+            cache->head = czt;
+            return czt;
+        }
+    }
+
+    if (cache->size == DSC_MAX_CZT_PLANS) {
+        dsc_czt_plan **last = &cache->head;
+        while ((*last)->next != nullptr) last = &(*last)->next;
+
+        DSC_LOG_DEBUG("evicting CZT plan with N=%d M=%d dtype=%s", (*last)->n, (*last)->m, DSC_DTYPE_NAMES[(*last)->dtype]);
+
+        dsc_free_czt_plan(ctx, *last);
+        *last = nullptr;
+        cache->size--;
+    }
+
+    const int fft_n = dsc_fft_smooth_n(n + m - 1);
+    const usize elem_size = DSC_DTYPE_SIZE[dtype];
+    dsc_czt_plan *czt = (dsc_czt_plan *) dsc_obj_alloc(ctx->main_allocator,
+                                                       sizeof(dsc_czt_plan) + (n + m + fft_n) * elem_size);
+    czt->plan = dsc_alloc_plan(ctx, fft_n, COMPLEX, dtype == C32 ? F32 : F64, dsc_fft_choose_algorithm(fft_n));
+    czt->in_chirp = (void *) (czt + 1);
+    czt->out_chirp = (byte *) czt->in_chirp + n * elem_size;
+    czt->h_fft = (byte *) czt->out_chirp + m * elem_size;
+    czt->w = w;
+    czt->a = a;
+    czt->n = n;
+    czt->m = m;
+    czt->fft_n = fft_n;
+    czt->dtype = dtype;
+
+    void *work = dsc_obj_alloc(ctx->main_allocator, dsc_fft_work_size(fft_n, czt->plan->algorithm) * elem_size);
+    if (dtype == C32) dsc_czt_init_chirps<c32>(czt, (c32 *) work);
+    else dsc_czt_init_chirps<c64>(czt, (c64 *) work);
+    dsc_obj_free(ctx->main_allocator, work);
+
+    czt->next = cache->head;
+    cache->head = czt;
+    cache->size++;
+
+    DSC_LOG_DEBUG("allocated new CZT plan with N=%d M=%d L=%d dtype=%s", n, m, fft_n, DSC_DTYPE_NAMES[dtype]);
+
+    return czt;
+}
+
+// Same scheme of exec_fft: lines are multiplied by the input chirp while they are copied to buff in
+// groups of batch lines, convolved with the chirp w^(-i^2/2) and multiplied by the output chirp.
+template<typename Tin, typename C>
+static DSC_INLINE void dsc_internal_czt(dsc_ctx *ctx,
+                                        const dsc_czt_plan *czt,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        dsc_tensor *DSC_RESTRICT out,
+                                        const int axis) noexcept {
+    const int n = czt->n, m = czt->m, fft_n = czt->fft_n;
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const dsc_fft_job job = dsc_fft_job_init(ctx, czt->plan, x, out, axis, fft_n, fft_n);
+    const dsc_fft_units &units = job.units;
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *buff = dsc_tensor_1d(ctx, czt->dtype, job.buff_n * job.n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, czt->dtype, job.work_n * job.n_workers);
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(Tin, x);
+        DSC_TENSOR_DATA(C, out);
+        const C *DSC_RESTRICT in_chirp = (const C *) czt->in_chirp;
+        const C *DSC_RESTRICT out_chirp = (const C *) czt->out_chirp;
+        const C *DSC_RESTRICT h_fft = (const C *) czt->h_fft;
+        C *DSC_RESTRICT buff_data = &((C *) buff->data)[job.buff_n * worker];
+        C *DSC_RESTRICT fft_work_data = &((C *) fft_work->data)[job.work_n * worker];
+
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, units.line(unit_start));
+        dsc_line_iterator out_it(out, axis, units.line(unit_start));
+        int x_offset[DSC_FFT_MAX_BATCH], out_offset[DSC_FFT_MAX_BATCH];
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            const int b_n = units.size(unit);
+            for (int b = 0; b < b_n; ++b) {
+                x_offset[b] = x_it.index();
+                out_offset[b] = out_it.index();
+                x_it.next();
+                out_it.next();
+            }
+
+            for (int j = 0; j < n; ++j) {
+                const C c = in_chirp[j];
+                for (int b = 0; b < b_n; ++b) {
+                    const Tin v = x_data[x_offset[b] + j * x_stride];
+                    if constexpr (dsc_is_complex<Tin>()) buff_data[j * b_n + b] = mul_op()(v, c);
+                    else buff_data[j * b_n + b] = dsc_complex(C, v * c.real, v * c.imag);
+                }
+            }
+            for (int i = n * b_n; i < fft_n * b_n; ++i) buff_data[i] = dsc_zero<C>();
+
+            if (b_n == 1) dsc_complex_fft<C, true>(czt->plan, buff_data, fft_work_data);
+            else dsc_complex_fft_batch<C, true>(czt->plan, buff_data, fft_work_data, b_n);
+
+            for (int i = 0; i < fft_n; ++i) {
+                const C h = h_fft[i];
+                for (int b = 0; b < b_n; ++b) buff_data[i * b_n + b] = mul_op()(buff_data[i * b_n + b], h);
+            }
+
+            if (b_n == 1) dsc_complex_fft<C, false>(czt->plan, buff_data, fft_work_data);
+            else dsc_complex_fft_batch<C, false>(czt->plan, buff_data, fft_work_data, b_n);
+
+            for (int k = 0; k < m; ++k) {
+                const C c = out_chirp[k];
+                for (int b = 0; b < b_n; ++b)
+                    out_data[out_offset[b] + k * out_stride] = mul_op()(buff_data[k * b_n + b], c);
+            }
+        }
+    });
+    DSC_CTX_POP(ctx);
+}
+
+dsc_tensor *dsc_czt(dsc_ctx *ctx,
+                    const dsc_tensor *DSC_RESTRICT x,
+                    int m,
+                    const c64 w,
+                    const c64 a,
+                    dsc_tensor *DSC_RESTRICT out,
+                    const int axis) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(w.real != 0 || w.imag != 0);
+    DSC_ASSERT(a.real != 0 || a.imag != 0);
+
+    const int axis_idx = dsc_tensor_dim(x, axis);
+    DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
+
+    const int n = x->shape[axis_idx];
+    if (m <= 0) m = n;
+
+    DSC_TRACE_FFT_OP(x, out, m, axis, dsc_fft_type::COMPLEX, true);
+
+    int out_shape[DSC_MAX_DIMS];
+    for (int i = 0; i < DSC_MAX_DIMS; ++i)
+        out_shape[i] = i != axis_idx ? x->shape[i] : m;
+
+    dsc_dtype out_dtype = x->dtype;
+    if (x->dtype == F32) {
+        out_dtype = C32;
+    } else if (x->dtype == F64) {
+        out_dtype = C64;
+    }
+
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &out_shape[DSC_MAX_DIMS - x->n_dim], out_dtype);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, out->shape, DSC_MAX_DIMS * sizeof(out->shape[0])) == 0);
+    }
+
+    DSC_LOG_DEBUG("computing the CZT of %d points on x=[%d %d %d %d] over axis %d",
+                  m, x->shape[0], x->shape[1], x->shape[2], x->shape[3], axis_idx);
+
+    const dsc_czt_plan *czt = dsc_get_czt_plan(ctx, n, m, w, a, out_dtype);
+
+    switch (x->dtype) {
+        case F32:
+            dsc_internal_czt<f32, c32>(ctx, czt, x, out, axis_idx);
+            break;
+        case F64:
+            dsc_internal_czt<f64, c64>(ctx, czt, x, out, axis_idx);
+            break;
+        case C32:
+            dsc_internal_czt<c32, c32>(ctx, czt, x, out, axis_idx);
+            break;
+        case C64:
+            dsc_internal_czt<c64, c64>(ctx, czt, x, out, axis_idx);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    }
+
+    return out;
+}
+
+dsc_tensor *dsc_zoom_fft(dsc_ctx *ctx,
+                         const dsc_tensor *DSC_RESTRICT x,
+                         int m,
+                         const f64 f0,
+                         const f64 f1,
+                         const f64 fs,
+                         dsc_tensor *DSC_RESTRICT out,
+                         const int axis) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(fs > 0);
+
+    if (m <= 0) m = x->shape[dsc_tensor_dim(x, axis)];
+
+    // M points from f0 to f1 excluded on the unit circle
+    const f64 step = (-2. * dsc_pi<f64>() * (f1 - f0)) / ((f64) m * fs);
+    const f64 start = (2. * dsc_pi<f64>() * f0) / fs;
+    const c64 w = dsc_complex(c64, cos_op()(step), sin_op()(step));
+    const c64 a = dsc_complex(c64, cos_op()(start), sin_op()(start));
+
+    return dsc_czt(ctx, x, m, w, a, out, axis);
+}
+
+// ============================================================
+// Spectral Density
+//
+// Welch's method: the segments are gathered straight from the input, detrended and windowed while
+// they are copied to the FFT buffer, and |X|^2 (or conj(X) * Y) is accumulated in double precision.
+// Even segments use the packed RFFT of order N/2, odd ones are transformed two at a time with the
+// two-for-one RFFT: two consecutive segments for dsc_welch, the segments of x and y for dsc_csd.
+
+// Segments accumulated by a unit of work. The partial sums of the units of a line are added in
+// order so the result doesn't depend on the number of threads.
+static constexpr int DSC_WELCH_UNIT_SEGMENTS = 32;
+
+// Copy segment seg_start of the line to dst (with stride dst_stride), removing its mean if detrend
+// is true and multiplying it by the window
+template<typename T>
+static DSC_INLINE void dsc_welch_gather(const T *DSC_RESTRICT line, const int x_stride,
+                                        const T *DSC_RESTRICT window, const int n,
+                                        const bool detrend, T *DSC_RESTRICT dst,
+                                        const int dst_stride) noexcept {
+    static_assert(dsc_is_real<T>(), "T must be real");
+
+    T mean = dsc_zero<T>();
+    if (detrend) {
+        f64 sum = 0;
+        for (int j = 0; j < n; ++j) sum += (f64) line[j * x_stride];
+        mean = (T) (sum / (f64) n);
+    }
+    for (int j = 0; j < n; ++j) dst[j * dst_stride] = (line[j * x_stride] - mean) * window[j];
+}
+
+// |a|^2 in double precision
+template<typename C>
+static DSC_INLINE f64 dsc_welch_power(const C a) noexcept {
+    const f64 re = a.real, im = a.imag;
+    return re * re + im * im;
+}
+
+// conj(a) * b in double precision
+template<typename C>
+static DSC_INLINE void dsc_welch_cross(const C a, const C b, c64 *DSC_RESTRICT acc) noexcept {
+    const f64 a_re = a.real, a_im = a.imag, b_re = b.real, b_im = b.imag;
+    acc->real += a_re * b_re + a_im * b_im;
+    acc->imag += a_re * b_im - a_im * b_re;
+}
+
+template<typename C, bool cross>
+static DSC_INLINE void dsc_internal_welch(dsc_ctx *ctx,
+                                          const dsc_tensor *DSC_RESTRICT x,
+                                          const dsc_tensor *DSC_RESTRICT y,
+                                          const dsc_tensor *DSC_RESTRICT window,
+                                          dsc_tensor *DSC_RESTRICT out,
+                                          const int nperseg, const int step,
+                                          const f64 fs, const dsc_psd_scaling scaling,
+                                          const bool detrend, const int axis) noexcept {
+    using T = real<C>;
+    // The accumulator of each bin: |X|^2 or conj(X) * Y
+    using A = dsc_conv_type<c64, !cross>;
+    using R = dsc_conv_type<C, !cross>;
+    constexpr dsc_dtype dtype = dsc_type_mapping<T>::value;
+    constexpr dsc_dtype fft_dtype = dsc_type_mapping<C>::value;
+    constexpr dsc_dtype acc_dtype = dsc_type_mapping<A>::value;
+
+    const bool even = (nperseg & 1) == 0;
+    const int n_bins = (nperseg >> 1) + 1;
+    const int n_seg = (x->shape[axis] - nperseg) / step + 1;
+    const int unit_seg = DSC_MIN(n_seg, DSC_WELCH_UNIT_SEGMENTS);
+    const int line_units = (n_seg + unit_seg - 1) / unit_seg;
+    const int lines = x->ne / x->shape[axis];
+    const int units = lines * line_units;
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const int n_workers = DSC_MAX(1, DSC_MIN(DSC_MIN(ctx->n_threads, units),
+                                             (int) (((i64) lines * n_seg * nperseg) / DSC_FFT_MIN_WORK_PER_THREAD)));
+
+    dsc_fft_plan *plan = dsc_plan_rfft(ctx, nperseg, fft_dtype);
+    // Two buffers if x and y are transformed separately
+    const int buff_n = dsc_rfft_line_n(nperseg) * (cross && even ? 2 : 1);
+    const int work_n = dsc_fft_work_size(plan->n, plan->algorithm);
+
+    DSC_LOG_DEBUG("%s of %d segments of %d samples with step %d", cross ? "CSD" : "Welch PSD", n_seg, nperseg, step);
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *win = dsc_tensor_1d(ctx, dtype, nperseg);
+    dsc_tensor *partial = dsc_tensor_1d(ctx, acc_dtype, units * n_bins);
+    dsc_tensor *buff = dsc_tensor_1d(ctx, fft_dtype, buff_n * n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, fft_dtype, work_n * n_workers);
+    dsc_init_window<T>(window, nperseg, (T *) win->data);
+
+    f64 win_sum = 0, win_sum2 = 0;
+    for (int j = 0; j < nperseg; ++j) {
+        const f64 w = (f64) ((T *) win->data)[j];
+        win_sum += w;
+        win_sum2 += w * w;
+    }
+    const f64 scale = (scaling == DENSITY ? 1. / (fs * win_sum2) : 1. / (win_sum * win_sum)) / (f64) n_seg;
+
+    dsc_parallel(ctx->thread_pool, n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(T, x);
+        const T *DSC_RESTRICT y_data = cross ? (const T *) y->data : nullptr;
+        const T *DSC_RESTRICT w = (const T *) win->data;
+        C *DSC_RESTRICT buff_data = &((C *) buff->data)[buff_n * worker];
+        C *DSC_RESTRICT fft_work_data = &((C *) fft_work->data)[work_n * worker];
+        T *DSC_RESTRICT buff_real = (T *) buff_data;
+
+        const int unit_start = units * worker / n_threads;
+        const int unit_stop = units * (worker + 1) / n_threads;
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            const int line = unit / line_units;
+            const int seg_start = (unit % line_units) * unit_seg;
+            const int seg_stop = DSC_MIN(n_seg, seg_start + unit_seg);
+            const int line_offset = dsc_line_iterator(x, axis, line).index();
+            const T *DSC_RESTRICT line_x = &x_data[line_offset];
+            const T *DSC_RESTRICT line_y = cross ? &y_data[line_offset] : nullptr;
+
+            A *DSC_RESTRICT acc = &((A *) partial->data)[unit * n_bins];
+            for (int k = 0; k < n_bins; ++k) acc[k] = dsc_zero<A>();
+
+            for (int seg = seg_start; seg < seg_stop;) {
+                const i64 seg_offset = (i64) seg * step * x_stride;
+                if (even) {
+                    dsc_welch_gather(&line_x[seg_offset], x_stride, w, nperseg, detrend, buff_real, 1);
+                    dsc_real_fft<C, true>(plan, buff_data, fft_work_data);
+                    if constexpr (cross) {
+                        C *DSC_RESTRICT buff_y = &buff_data[n_bins];
+                        dsc_welch_gather(&line_y[seg_offset], x_stride, w, nperseg, detrend, (T *) buff_y, 1);
+                        dsc_real_fft<C, true>(plan, buff_y, fft_work_data);
+                        for (int k = 0; k < n_bins; ++k) dsc_welch_cross(buff_data[k], buff_y[k], &acc[k]);
+                    } else {
+                        for (int k = 0; k < n_bins; ++k) acc[k] += dsc_welch_power(buff_data[k]);
+                    }
+                    seg += 1;
+                } else if constexpr (cross) {
+                    // x in the real part and y in the imaginary part
+                    dsc_welch_gather(&line_x[seg_offset], x_stride, w, nperseg, detrend, buff_real, 2);
+                    dsc_welch_gather(&line_y[seg_offset], x_stride, w, nperseg, detrend, &buff_real[1], 2);
+                    dsc_real_fft_pair<C, true>(plan, buff_data, fft_work_data, 1);
+                    for (int k = 0; k < n_bins; ++k)
+                        dsc_welch_cross(buff_data[k], buff_data[k == 0 ? nperseg : nperseg - k], &acc[k]);
+                    seg += 1;
+                } else {
+                    // Segments seg and seg + 1, the second one is zero if seg is the last segment of the unit
+                    const bool pair = seg + 1 < seg_stop;
+                    dsc_welch_gather(&line_x[seg_offset], x_stride, w, nperseg, detrend, buff_real, 2);
+                    if (pair) {
+                        dsc_welch_gather(&line_x[seg_offset + (i64) step * x_stride], x_stride, w, nperseg,
+                                         detrend, &buff_real[1], 2);
+                    } else {
+                        for (int j = 0; j < nperseg; ++j) buff_real[2 * j + 1] = dsc_zero<T>();
+                    }
+                    dsc_real_fft_pair<C, true>(plan, buff_data, fft_work_data, 1);
+                    for (int k = 0; k < n_bins; ++k) {
+                        acc[k] += dsc_welch_power(buff_data[k]);
+                        if (pair) acc[k] += dsc_welch_power(buff_data[k == 0 ? nperseg : nperseg - k]);
+                    }
+                    seg += pair ? 2 : 1;
+                }
+            }
+        }
+    });
+
+    dsc_parallel(ctx->thread_pool, DSC_MIN(n_workers, lines), [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(R, out);
+        const A *DSC_RESTRICT partial_data = (const A *) partial->data;
+
+        const int line_start = lines * worker / n_threads;
+        const int line_stop = lines * (worker + 1) / n_threads;
+        dsc_line_iterator out_it(out, axis, line_start);
+        for (int line = line_start; line < line_stop; ++line) {
+            R *DSC_RESTRICT line_out = &out_data[out_it.index()];
+            for (int k = 0; k < n_bins; ++k) {
+                A sum = dsc_zero<A>();
+                for (int u = 0; u < line_units; ++u) {
+                    if constexpr (cross) {
+                        sum.real += partial_data[(line * line_units + u) * n_bins + k].real;
+                        sum.imag += partial_data[(line * line_units + u) * n_bins + k].imag;
+                    } else {
+                        sum += partial_data[(line * line_units + u) * n_bins + k];
+                    }
+                }
+                // One-sided spectrum: the negative frequencies are folded on the positive ones
+                // except for DC and Nyquist
+                const f64 k_scale = (k == 0 || (even && k == n_bins - 1)) ? scale : 2. * scale;
+                if constexpr (cross) line_out[k * out_stride] = dsc_complex(R, (T) (sum.real * k_scale), (T) (sum.imag * k_scale));
+                else line_out[k * out_stride] = (R) (sum * k_scale);
+            }
+            out_it.next();
+        }
+    });
+    DSC_CTX_POP(ctx);
+}
+
+template<bool cross>
+static dsc_tensor *dsc_spectral_density(dsc_ctx *ctx,
+                                        const dsc_tensor *DSC_RESTRICT x,
+                                        const dsc_tensor *DSC_RESTRICT y,
+                                        const int nperseg,
+                                        int noverlap,
+                                        const dsc_tensor *DSC_RESTRICT window,
+                                        const f64 fs,
+                                        const dsc_psd_scaling scaling,
+                                        const bool detrend,
+                                        dsc_tensor *DSC_RESTRICT out,
+                                        const int axis) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(x->dtype == F32 || x->dtype == F64);
+    DSC_ASSERT(fs > 0);
+    DSC_ASSERT(scaling == DENSITY || scaling == SPECTRUM);
+    if constexpr (cross) {
+        DSC_ASSERT(y != nullptr);
+        DSC_ASSERT(y->dtype == x->dtype);
+        DSC_ASSERT(y->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(x->shape, y->shape, DSC_MAX_DIMS * sizeof(x->shape[0])) == 0);
+        DSC_ASSERT(memcmp(x->stride, y->stride, DSC_MAX_DIMS * sizeof(x->stride[0])) == 0);
+    }
+
+    const int axis_idx = dsc_tensor_dim(x, axis);
+    DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
+
+    if (noverlap < 0) noverlap = nperseg >> 1;
+    DSC_ASSERT(nperseg > 0 && nperseg <= x->shape[axis_idx]);
+    DSC_ASSERT(noverlap < nperseg);
+
+    if (window != nullptr) {
+        DSC_ASSERT(window->ne == nperseg);
+        DSC_ASSERT(window->dtype == F32 || window->dtype == F64);
+    }
+
+    DSC_TRACE_FFT_OP(x, out, nperseg, axis, dsc_fft_type::REAL, true);
+
+    const int n_bins = (nperseg >> 1) + 1;
+    int out_shape[DSC_MAX_DIMS];
+    for (int i = 0; i < DSC_MAX_DIMS; ++i)
+        out_shape[i] = i != axis_idx ? x->shape[i] : n_bins;
+
+    dsc_dtype out_dtype = x->dtype;
+    if (cross) out_dtype = x->dtype == F32 ? C32 : C64;
+
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &out_shape[DSC_MAX_DIMS - x->n_dim], out_dtype);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, out->shape, DSC_MAX_DIMS * sizeof(out->shape[0])) == 0);
+    }
+
+    DSC_LOG_DEBUG("computing the %s with nperseg=%d noverlap=%d on x=[%d %d %d %d] over axis %d",
+                  cross ? "CSD" : "PSD", nperseg, noverlap, x->shape[0], x->shape[1], x->shape[2], x->shape[3], axis_idx);
+
+    switch (x->dtype) {
+        case F32:
+            dsc_internal_welch<c32, cross>(ctx, x, y, window, out, nperseg, nperseg - noverlap, fs, scaling, detrend, axis_idx);
+            break;
+        case F64:
+            dsc_internal_welch<c64, cross>(ctx, x, y, window, out, nperseg, nperseg - noverlap, fs, scaling, detrend, axis_idx);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    }
+
+    return out;
+}
+
+dsc_tensor *dsc_welch(dsc_ctx *ctx,
+                      const dsc_tensor *DSC_RESTRICT x,
+                      const int nperseg,
+                      const int noverlap,
+                      const dsc_tensor *DSC_RESTRICT window,
+                      const f64 fs,
+                      const dsc_psd_scaling scaling,
+                      const bool detrend,
+                      dsc_tensor *DSC_RESTRICT out,
+                      const int axis) noexcept {
+    return dsc_spectral_density<false>(ctx, x, nullptr, nperseg, noverlap, window, fs, scaling, detrend, out, axis);
+}
+
+dsc_tensor *dsc_csd(dsc_ctx *ctx,
+                    const dsc_tensor *DSC_RESTRICT x,
+                    const dsc_tensor *DSC_RESTRICT y,
+                    const int nperseg,
+                    const int noverlap,
+                    const dsc_tensor *DSC_RESTRICT window,
+                    const f64 fs,
+                    const dsc_psd_scaling scaling,
+                    const bool detrend,
+                    dsc_tensor *DSC_RESTRICT out,
+                    const int axis) noexcept {
+    return dsc_spectral_density<true>(ctx, x, y, nperseg, noverlap, window, fs, scaling, detrend, out, axis);
+}
+
+// ============================================================
+// Hilbert Transform
+//
+// Each line is transformed in a single buffer: forward FFT, the spectrum is multiplied by
+// h[k] / N where h is 1 for DC (and Nyquist if N is even), 2 for the positive frequencies and 0 for
+// the negative ones, then the inverse FFT without its own 1/N scaling.
+
+template<typename T, typename C>
+static DSC_INLINE void dsc_internal_hilbert(dsc_ctx *ctx,
+                                            const dsc_fft_job &job,
+                                            const dsc_tensor *DSC_RESTRICT x,
+                                            dsc_tensor *DSC_RESTRICT out,
+                                            dsc_tensor *DSC_RESTRICT envelope,
+                                            dsc_tensor *DSC_RESTRICT phase,
+                                            const int n, const int axis) noexcept {
+    dsc_fft_plan *plan = job.plan;
+    const dsc_fft_units &units = job.units;
+    const int copy_n = DSC_MIN(x->shape[axis], n);
+    const int x_stride = x->stride[axis];
+    const int out_stride = out->stride[axis];
+    const int envelope_stride = envelope != nullptr ? envelope->stride[axis] : 0;
+    const int phase_stride = phase != nullptr ? phase->stride[axis] : 0;
+    // Bins [1, pos_stop) are doubled, [neg_start, n) are zeroed
+    const int pos_stop = (n + 1) >> 1;
+    const int neg_start = (n >> 1) + 1;
+    const T dc_scale = (T) 1 / (T) n;
+    const T pos_scale = (T) 2 / (T) n;
+    constexpr dsc_dtype dtype = dsc_type_mapping<C>::value;
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *buff = dsc_tensor_1d(ctx, dtype, job.buff_n * job.n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, dtype, job.work_n * job.n_workers);
+
+    dsc_parallel(ctx->thread_pool, job.n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(T, x);
+        DSC_TENSOR_DATA(C, out);
+        T *DSC_RESTRICT envelope_data = envelope != nullptr ? (T *) envelope->data : nullptr;
+        T *DSC_RESTRICT phase_data = phase != nullptr ? (T *) phase->data : nullptr;
+        C *DSC_RESTRICT buff_data = &((C *) buff->data)[job.buff_n * worker];
+        C *DSC_RESTRICT fft_work_data = &((C *) fft_work->data)[job.work_n * worker];
+
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        dsc_line_iterator x_it(x, axis, units.line(unit_start));
+        dsc_line_iterator out_it(out, axis, units.line(unit_start));
+        // If envelope or phase are not needed their iterators just follow out
+        dsc_line_iterator envelope_it(envelope != nullptr ? envelope : out, axis, units.line(unit_start));
+        dsc_line_iterator phase_it(phase != nullptr ? phase : out, axis, units.line(unit_start));
+        int x_offset[DSC_FFT_MAX_BATCH], out_offset[DSC_FFT_MAX_BATCH];
+        int envelope_offset[DSC_FFT_MAX_BATCH], phase_offset[DSC_FFT_MAX_BATCH];
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            const int b_n = units.size(unit);
+            for (int b = 0; b < b_n; ++b) {
+                x_offset[b] = x_it.index();
+                out_offset[b] = out_it.index();
+                envelope_offset[b] = envelope_it.index();
+                phase_offset[b] = phase_it.index();
+                x_it.next();
+                out_it.next();
+                envelope_it.next();
+                phase_it.next();
+            }
+
+            for (int i = 0; i < copy_n; ++i) {
+                for (int b = 0; b < b_n; ++b)
+                    buff_data[i * b_n + b] = dsc_complex(C, x_data[x_offset[b] + i * x_stride], dsc_zero<T>());
+            }
+            for (int i = copy_n * b_n; i < n * b_n; ++i) buff_data[i] = dsc_zero<C>();
+
+            if (b_n == 1) dsc_fft_exec<C, true>(plan, buff_data, fft_work_data);
+            else dsc_fft_stockham_batch<C, true>(plan, buff_data, fft_work_data, b_n);
+
+            for (int b = 0; b < b_n; ++b) {
+                buff_data[b].real *= dc_scale;
+                buff_data[b].imag *= dc_scale;
+            }
+            for (int i = b_n; i < pos_stop * b_n; ++i) {
+                buff_data[i].real *= pos_scale;
+                buff_data[i].imag *= pos_scale;
+            }
+            // Nyquist, only if N is even
+            for (int i = pos_stop * b_n; i < neg_start * b_n; ++i) {
+                buff_data[i].real *= dc_scale;
+                buff_data[i].imag *= dc_scale;
+            }
+            for (int i = neg_start * b_n; i < n * b_n; ++i) buff_data[i] = dsc_zero<C>();
+
+            if (b_n == 1) dsc_fft_exec<C, false>(plan, buff_data, fft_work_data);
+            else dsc_fft_stockham_batch<C, false>(plan, buff_data, fft_work_data, b_n);
+
+            if (b_n == 1 && out_stride == 1) {
+                memcpy(&out_data[out_offset[0]], buff_data, n * sizeof(C));
+            } else {
+                for (int i = 0; i < n; ++i) {
+                    for (int b = 0; b < b_n; ++b)
+                        out_data[out_offset[b] + i * out_stride] = buff_data[i * b_n + b];
+                }
+            }
+            if (envelope_data != nullptr) {
+                for (int i = 0; i < n; ++i) {
+                    for (int b = 0; b < b_n; ++b)
+                        envelope_data[envelope_offset[b] + i * envelope_stride] = abs_op()(buff_data[i * b_n + b]);
+                }
+            }
+            if (phase_data != nullptr) {
+                for (int i = 0; i < n; ++i) {
+                    for (int b = 0; b < b_n; ++b)
+                        phase_data[phase_offset[b] + i * phase_stride] = atan2_op()(buff_data[i * b_n + b]);
+                }
+            }
+        }
+    });
+    DSC_CTX_POP(ctx);
+}
+
+dsc_tensor *dsc_hilbert(dsc_ctx *ctx,
+                        const dsc_tensor *DSC_RESTRICT x,
+                        dsc_tensor *DSC_RESTRICT out,
+                        int n,
+                        const int axis,
+                        dsc_tensor *DSC_RESTRICT envelope,
+                        dsc_tensor *DSC_RESTRICT phase) noexcept {
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(x->dtype == F32 || x->dtype == F64);
+
+    DSC_TRACE_FFT_OP(x, out, n, axis, dsc_fft_type::COMPLEX, true);
+
+    const int axis_idx = dsc_tensor_dim(x, axis);
+    DSC_ASSERT(axis_idx < DSC_MAX_DIMS);
+
+    if (n <= 0) n = x->shape[axis_idx];
+
+    int out_shape[DSC_MAX_DIMS];
+    for (int i = 0; i < DSC_MAX_DIMS; ++i)
+        out_shape[i] = i != axis_idx ? x->shape[i] : n;
+
+    const dsc_dtype out_dtype = x->dtype == F32 ? C32 : C64;
+
+    if (out == nullptr) {
+        out = dsc_new_tensor(ctx, x->n_dim, &out_shape[DSC_MAX_DIMS - x->n_dim], out_dtype);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, out->shape, DSC_MAX_DIMS * sizeof(out->shape[0])) == 0);
+    }
+
+    if (envelope != nullptr) {
+        DSC_ASSERT(envelope->dtype == x->dtype);
+        DSC_ASSERT(envelope->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, envelope->shape, DSC_MAX_DIMS * sizeof(envelope->shape[0])) == 0);
+    }
+    if (phase != nullptr) {
+        DSC_ASSERT(phase->dtype == x->dtype);
+        DSC_ASSERT(phase->n_dim == x->n_dim);
+        DSC_ASSERT(memcmp(out_shape, phase->shape, DSC_MAX_DIMS * sizeof(phase->shape[0])) == 0);
+    }
+
+    DSC_LOG_DEBUG("computing the analytic signal with N=%d on x=[%d %d %d %d] over axis %d",
+                  n, x->shape[0], x->shape[1], x->shape[2], x->shape[3], axis_idx);
+
+    dsc_fft_plan *plan = dsc_plan_fft(ctx, n, COMPLEX, out_dtype);
+    const dsc_fft_job job = dsc_fft_job_init(ctx, plan, x, out, axis_idx, n, n);
+
+    switch (x->dtype) {
+        case F32:
+            dsc_internal_hilbert<f32, c32>(ctx, job, x, out, envelope, phase, n, axis_idx);
+            break;
+        case F64:
+            dsc_internal_hilbert<f64, c64>(ctx, job, x, out, envelope, phase, n, axis_idx);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", x->dtype);
+    }
+
+    return out;
+}
+
+// ============================================================
+// Channelizer
+//
+// The output of channel k at the last sample of block m is
+//   y[k, m] = sum_s e^(-i2πks/M) sum_p h[pM + M - 1 - s] * x[(m - p)M + s]
+// so each block goes through the M branches of the commutator (the inner sum, P taps per branch)
+// and the branch outputs are transformed with an FFT of order M.
+
+struct dsc_channelizer {
+    // The plan is owned by the channelizer like the plan of dsc_stft
+    dsc_fft_plan *plan;
+    // Branch filters as taps[P][M], branch s is in column s. With complex data each tap is repeated
+    // twice, once for the real and once for the imaginary part, so the branches are a real dot product.
+    dsc_tensor *taps;
+    // The last P - 1 blocks pushed, the oldest first
+    dsc_tensor *tail;
+    int channels, branch_taps;
+    dsc_dtype dtype;
+};
+
+template<typename C, bool real_data>
+static DSC_INLINE void dsc_channelizer_push_samples(dsc_ctx *ctx,
+                                                    dsc_channelizer *channelizer,
+                                                    const dsc_tensor *DSC_RESTRICT x,
+                                                    dsc_tensor *DSC_RESTRICT out) noexcept {
+    using T = dsc_conv_type<C, real_data>;
+    using R = real<C>;
+    constexpr dsc_dtype fft_dtype = dsc_type_mapping<C>::value;
+    // Number of reals in each sample
+    constexpr int width = real_data ? 1 : 2;
+
+    dsc_fft_plan *plan = channelizer->plan;
+    const int m = channelizer->channels, p_n = channelizer->branch_taps;
+    const int blocks = x->ne / m;
+    const int tail_blocks = p_n - 1;
+
+    // The blocks are batched in the FFT like the lines of a strided transform: the channels of a block
+    // are a column of out so the bins of consecutive blocks are contiguous.
+    const dsc_fft_units units(blocks, dsc_fft_batch_size(plan, blocks, false));
+    const int n_workers = DSC_MAX(1, DSC_MIN(DSC_MIN(ctx->n_threads, units.count),
+                                             (int) (((i64) blocks * m * p_n) / DSC_FFT_MIN_WORK_PER_THREAD)));
+    // The FFT buffer and the branch outputs of the block being filtered
+    const int buff_n = m * (units.batch + 1);
+    const int work_n = dsc_fft_work_size(m, plan->algorithm) * units.batch;
+
+    DSC_CTX_PUSH(ctx);
+    dsc_tensor *buff = dsc_tensor_1d(ctx, fft_dtype, buff_n * n_workers);
+    dsc_tensor *fft_work = dsc_tensor_1d(ctx, fft_dtype, work_n * n_workers);
+
+    dsc_parallel(ctx->thread_pool, n_workers, [&](const int worker, const int n_threads) noexcept {
+        DSC_TENSOR_DATA(C, out);
+        const R *DSC_RESTRICT x_data = (const R *) x->data;
+        const R *DSC_RESTRICT tail = (const R *) channelizer->tail->data;
+        const R *DSC_RESTRICT taps = (const R *) channelizer->taps->data;
+        C *DSC_RESTRICT buff_data = &((C *) buff->data)[buff_n * worker];
+        C *DSC_RESTRICT fft_work_data = &((C *) fft_work->data)[work_n * worker];
+        C *DSC_RESTRICT branches = &buff_data[m * units.batch];
+
+        const int unit_start = units.count * worker / n_threads;
+        const int unit_stop = units.count * (worker + 1) / n_threads;
+
+        for (int unit = unit_start; unit < unit_stop; ++unit) {
+            const int block_start = units.line(unit);
+            const int b_n = units.size(unit);
+
+            for (int b = 0; b < b_n; ++b) {
+                // Complex samples are filtered straight into the FFT buffer if the blocks are not batched
+                R *DSC_RESTRICT acc = !real_data && b_n == 1 ? (R *) buff_data : (R *) branches;
+                for (int p = 0; p < p_n; ++p) {
+                    // Block j < 0 is one of the blocks of the previous pushes
+                    const int j = block_start + b - p;
+                    const R *DSC_RESTRICT src = j >= 0 ? &x_data[(i64) j * m * width] :
+                                                         &tail[(i64) (tail_blocks + j) * m * width];
+                    const R *DSC_RESTRICT h = &taps[(i64) p * m * width];
+                    if (p == 0) {
+                        for (int i = 0; i < m * width; ++i) acc[i] = h[i] * src[i];
+                    } else {
+                        for (int i = 0; i < m * width; ++i) acc[i] += h[i] * src[i];
+                    }
+                }
+
+                if constexpr (real_data) {
+                    for (int s = 0; s < m; ++s) buff_data[s * b_n + b] = dsc_complex(C, acc[s], dsc_zero<R>());
+                } else if (b_n > 1) {
+                    for (int s = 0; s < m; ++s) buff_data[s * b_n + b] = branches[s];
+                }
+            }
+
+            if (b_n == 1) dsc_complex_fft<C, true>(plan, buff_data, fft_work_data);
+            else dsc_complex_fft_batch<C, true>(plan, buff_data, fft_work_data, b_n);
+
+            for (int k = 0; k < m; ++k)
+                memcpy(&out_data[(i64) k * blocks + block_start], &buff_data[k * b_n], b_n * sizeof(C));
+        }
+    });
+    DSC_CTX_POP(ctx);
+
+    // Keep the last P - 1 blocks of the stream
+    const int tail_n = tail_blocks * m;
+    if (tail_n > 0) {
+        T *DSC_RESTRICT tail = (T *) channelizer->tail->data;
+        const T *DSC_RESTRICT x_data = (const T *) x->data;
+        const int n = x->ne;
+        if (n >= tail_n) {
+            memcpy(tail, &x_data[n - tail_n], tail_n * sizeof(T));
+        } else {
+            memmove(tail, &tail[n], (tail_n - n) * sizeof(T));
+            memcpy(&tail[tail_n - n], x_data, n * sizeof(T));
+        }
+    }
+}
+
+template<typename R>
+static DSC_INLINE void dsc_channelizer_init_taps(dsc_channelizer *channelizer, const dsc_tensor *h,
+                                                 const int width) noexcept {
+    const int m = channelizer->channels, p_n = channelizer->branch_taps;
+    R *DSC_RESTRICT taps = (R *) channelizer->taps->data;
+
+    for (int p = 0; p < p_n; ++p) {
+        for (int s = 0; s < m; ++s) {
+            const int j = p * m + m - 1 - s;
+            f64 tap = 0;
+            if (j < h->ne) tap = h->dtype == F32 ? (f64) ((const f32 *) h->data)[j] : ((const f64 *) h->data)[j];
+            for (int w = 0; w < width; ++w) taps[(p * m + s) * width + w] = (R) tap;
+        }
+    }
+}
+
+dsc_channelizer *dsc_channelizer_init(dsc_ctx *ctx,
+                                      const int channels,
+                                      const dsc_tensor *DSC_RESTRICT h,
+                                      const dsc_dtype dtype) noexcept {
+    DSC_ASSERT(channels > 0);
+    DSC_ASSERT(h != nullptr);
+    DSC_ASSERT(h->n_dim == 1);
+    DSC_ASSERT(h->dtype == F32 || h->dtype == F64);
+
+    const dsc_dtype real_dtype = as_real(dtype);
+    const int width = dsc_conv_is_real(dtype) ? 1 : 2;
+    const int p_n = (h->ne + channels - 1) / channels;
+
+    dsc_channelizer *channelizer = (dsc_channelizer *) dsc_obj_alloc(ctx->main_allocator, sizeof(dsc_channelizer));
+    channelizer->plan = dsc_alloc_plan(ctx, channels, COMPLEX, real_dtype, dsc_fft_choose_algorithm(channels));
+    channelizer->taps = dsc_tensor_1d(ctx, real_dtype, p_n * channels * width);
+    // Keep at least one element so the tail is never empty
+    channelizer->tail = dsc_tensor_1d(ctx, dtype, DSC_MAX(1, (p_n - 1) * channels));
+    channelizer->channels = channels;
+    channelizer->branch_taps = p_n;
+    channelizer->dtype = dtype;
+    dsc_channelizer_reset(channelizer);
+
+    if (real_dtype == F32) dsc_channelizer_init_taps<f32>(channelizer, h, width);
+    else dsc_channelizer_init_taps<f64>(channelizer, h, width);
+
+    DSC_LOG_DEBUG("created channelizer with M=%d P=%d dtype=%s", channels, p_n, DSC_DTYPE_NAMES[dtype]);
+
+    return channelizer;
+}
+
+dsc_tensor *dsc_channelizer_push(dsc_ctx *ctx,
+                                 dsc_channelizer *channelizer,
+                                 const dsc_tensor *DSC_RESTRICT x,
+                                 dsc_tensor *DSC_RESTRICT out) noexcept {
+    DSC_ASSERT(channelizer != nullptr);
+    DSC_ASSERT(x != nullptr);
+    DSC_ASSERT(x->n_dim == 1);
+
+    const dsc_dtype dtype = channelizer->dtype;
+    const int m = channelizer->channels;
+    DSC_ASSERT(x->dtype == dtype);
+    DSC_ASSERT(x->ne % m == 0);
+
+    DSC_TRACE_UNARY_OP(x, out);
+
+    const dsc_dtype out_dtype = as_real(dtype) == F32 ? C32 : C64;
+    if (out == nullptr) {
+        out = dsc_tensor_2d(ctx, out_dtype, m, x->ne / m);
+    } else {
+        DSC_ASSERT(out->dtype == out_dtype);
+        DSC_ASSERT(out->n_dim == 2);
+        DSC_ASSERT(out->shape[DSC_MAX_DIMS - 2] == m && out->shape[DSC_MAX_DIMS - 1] == x->ne / m);
+    }
+
+    switch (dtype) {
+        case F32:
+            dsc_channelizer_push_samples<c32, true>(ctx, channelizer, x, out);
+            break;
+        case F64:
+            dsc_channelizer_push_samples<c64, true>(ctx, channelizer, x, out);
+            break;
+        case C32:
+            dsc_channelizer_push_samples<c32, false>(ctx, channelizer, x, out);
+            break;
+        case C64:
+            dsc_channelizer_push_samples<c64, false>(ctx, channelizer, x, out);
+            break;
+        DSC_INVALID_CASE("unknown dtype=%d", dtype);
+    }
+
+    return out;
+}
+
+void dsc_channelizer_reset(dsc_channelizer *channelizer) noexcept {
+    memset(channelizer->tail->data, 0, channelizer->tail->ne * DSC_DTYPE_SIZE[channelizer->dtype]);
+}
+
+void dsc_channelizer_free(dsc_ctx *ctx, dsc_channelizer *channelizer) noexcept {
+    if (channelizer == nullptr) return;
+
+    dsc_free_plan(ctx, channelizer->plan);
+    dsc_tensor_free(ctx, channelizer->taps);
+    dsc_tensor_free(ctx, channelizer->tail);
+    dsc_obj_free(ctx->main_allocator, channelizer);
+}
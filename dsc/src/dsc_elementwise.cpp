@@ -0,0 +1,362 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#include <bit>
+#include "dsc_elementwise.h"
+
+#if defined(DSC_SIMD_X86)
+#   include <immintrin.h>
+#endif
+
+// Same approach as dsc_fft.cpp: the kernels for each instruction set are generated by including
+// dsc_elementwise_kernels.h with a different implementation of the real vector operations.
+// On top of the arithmetic, ops provides what is needed to work on interleaved complex values:
+// swap exchanges the real and imaginary part of each pair, dup_real and dup_imag broadcast one of
+// them to the whole pair and neg_real and neg_imag flip the sign of one of them.
+// The elementary functions of dsc_math_kernels.h also need fma, min and max (that return the second operand
+// if one is NaN, like the x86 instructions), bitwise operations, shifts of the lanes as unsigned integers of
+// the same size and comparisons that return a mask to be used by select.
+
+// GCC reports false positives on the undefined vectors used internally by the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+namespace dsc_elementwise_scalar {
+template<typename R>
+struct ops {
+    static constexpr int width = 1;
+};
+#define DSC_ELEMENTWISE_KERNELS_ISA SCALAR
+#include "dsc_elementwise_kernels.h"
+#undef DSC_ELEMENTWISE_KERNELS_ISA
+}
+
+#if defined(DSC_SIMD_X86)
+
+// ============================================================
+// SSE2
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace dsc_elementwise_sse2 {
+template<typename R>
+struct ops;
+
+template<>
+struct ops<f32> {
+    using vec = __m128;
+    using mask = __m128;
+    static constexpr int width = 4;
+
+    static DSC_INLINE vec load(const f32 *x) noexcept { return _mm_loadu_ps(x); }
+    static DSC_INLINE void store(f32 *x, const vec v) noexcept { _mm_storeu_ps(x, v); }
+    static DSC_INLINE vec set1(const f32 x) noexcept { return _mm_set1_ps(x); }
+    static DSC_INLINE vec set2(const f32 re, const f32 im) noexcept { return _mm_setr_ps(re, im, re, im); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm_sub_ps(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm_mul_ps(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm_div_ps(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 0, 0)); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 1, 1)); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return _mm_xor_ps(a, _mm_setr_ps(-0.f, 0.f, -0.f, 0.f)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return _mm_xor_ps(a, _mm_setr_ps(0.f, -0.f, 0.f, -0.f)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept {
+        return _mm_add_ps(_mm_mul_ps(a, b), c);
+    }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm_min_ps(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm_max_ps(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return _mm_and_ps(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return _mm_or_ps(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return _mm_xor_ps(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm_castsi128_ps(_mm_srli_epi32(_mm_castps_si128(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm_cmplt_ps(a, b); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm_cmpeq_ps(a, b); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept {
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+    static DSC_INLINE bool any(const mask m) noexcept { return _mm_movemask_ps(m) != 0; }
+    static DSC_INLINE mask real_lanes() noexcept { return _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0)); }
+};
+
+template<>
+struct ops<f64> {
+    using vec = __m128d;
+    using mask = __m128d;
+    static constexpr int width = 2;
+
+    static DSC_INLINE vec load(const f64 *x) noexcept { return _mm_loadu_pd(x); }
+    static DSC_INLINE void store(f64 *x, const vec v) noexcept { _mm_storeu_pd(x, v); }
+    static DSC_INLINE vec set1(const f64 x) noexcept { return _mm_set1_pd(x); }
+    static DSC_INLINE vec set2(const f64 re, const f64 im) noexcept { return _mm_setr_pd(re, im); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm_sub_pd(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm_mul_pd(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm_div_pd(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm_shuffle_pd(a, a, 1); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm_unpacklo_pd(a, a); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm_unpackhi_pd(a, a); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return _mm_xor_pd(a, _mm_setr_pd(-0., 0.)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return _mm_xor_pd(a, _mm_setr_pd(0., -0.)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept {
+        return _mm_add_pd(_mm_mul_pd(a, b), c);
+    }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm_min_pd(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm_max_pd(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return _mm_and_pd(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return _mm_or_pd(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return _mm_xor_pd(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm_cmplt_pd(a, b); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm_cmpeq_pd(a, b); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept {
+        return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+    }
+    static DSC_INLINE bool any(const mask m) noexcept { return _mm_movemask_pd(m) != 0; }
+    static DSC_INLINE mask real_lanes() noexcept { return _mm_castsi128_pd(_mm_set_epi64x(0, -1)); }
+};
+
+#define DSC_ELEMENTWISE_KERNELS_ISA SSE2
+#include "dsc_elementwise_kernels.h"
+#undef DSC_ELEMENTWISE_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+// ============================================================
+// AVX2
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace dsc_elementwise_avx2 {
+template<typename R>
+struct ops;
+
+template<>
+struct ops<f32> {
+    using vec = __m256;
+    using mask = __m256;
+    static constexpr int width = 8;
+
+    static DSC_INLINE vec load(const f32 *x) noexcept { return _mm256_loadu_ps(x); }
+    static DSC_INLINE void store(f32 *x, const vec v) noexcept { _mm256_storeu_ps(x, v); }
+    static DSC_INLINE vec set1(const f32 x) noexcept { return _mm256_set1_ps(x); }
+    static DSC_INLINE vec set2(const f32 re, const f32 im) noexcept {
+        return _mm256_setr_ps(re, im, re, im, re, im, re, im);
+    }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm256_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm256_sub_ps(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm256_mul_ps(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm256_div_ps(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm256_moveldup_ps(a); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm256_movehdup_ps(a); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return _mm256_xor_ps(a, set2(-0.f, 0.f)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return _mm256_xor_ps(a, set2(0.f, -0.f)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm256_min_ps(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm256_max_ps(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return _mm256_and_ps(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return _mm256_or_ps(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return _mm256_xor_ps(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm256_castsi256_ps(_mm256_srli_epi32(_mm256_castps_si256(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept { return _mm256_blendv_ps(b, a, m); }
+    static DSC_INLINE bool any(const mask m) noexcept { return _mm256_movemask_ps(m) != 0; }
+    static DSC_INLINE mask real_lanes() noexcept {
+        return _mm256_castsi256_ps(_mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0));
+    }
+};
+
+template<>
+struct ops<f64> {
+    using vec = __m256d;
+    using mask = __m256d;
+    static constexpr int width = 4;
+
+    static DSC_INLINE vec load(const f64 *x) noexcept { return _mm256_loadu_pd(x); }
+    static DSC_INLINE void store(f64 *x, const vec v) noexcept { _mm256_storeu_pd(x, v); }
+    static DSC_INLINE vec set1(const f64 x) noexcept { return _mm256_set1_pd(x); }
+    static DSC_INLINE vec set2(const f64 re, const f64 im) noexcept { return _mm256_setr_pd(re, im, re, im); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm256_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm256_sub_pd(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm256_mul_pd(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm256_div_pd(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm256_permute_pd(a, 0b0101); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm256_movedup_pd(a); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm256_permute_pd(a, 0b1111); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return _mm256_xor_pd(a, set2(-0., 0.)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return _mm256_xor_pd(a, set2(0., -0.)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm256_min_pd(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm256_max_pd(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return _mm256_and_pd(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return _mm256_or_pd(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return _mm256_xor_pd(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept { return _mm256_blendv_pd(b, a, m); }
+    static DSC_INLINE bool any(const mask m) noexcept { return _mm256_movemask_pd(m) != 0; }
+    static DSC_INLINE mask real_lanes() noexcept { return _mm256_castsi256_pd(_mm256_setr_epi64x(-1, 0, -1, 0)); }
+};
+
+#define DSC_ELEMENTWISE_KERNELS_ISA AVX2
+#include "dsc_elementwise_kernels.h"
+#undef DSC_ELEMENTWISE_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+// ============================================================
+// AVX-512
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace dsc_elementwise_avx512 {
+// The floating point logical operations are part of AVX-512DQ, use the integer ones so only AVX-512F is required
+#define DSC_AVX512_LOGICAL_OP(name, op)                                                                 \
+    static DSC_INLINE __m512 dsc_##name##_ps(const __m512 a, const __m512 b) noexcept {                 \
+        return _mm512_castsi512_ps(op(_mm512_castps_si512(a), _mm512_castps_si512(b)));                \
+    }                                                                                                   \
+    static DSC_INLINE __m512d dsc_##name##_pd(const __m512d a, const __m512d b) noexcept {              \
+        return _mm512_castsi512_pd(op(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));                \
+    }
+
+DSC_AVX512_LOGICAL_OP(and, _mm512_and_si512)
+DSC_AVX512_LOGICAL_OP(or, _mm512_or_si512)
+DSC_AVX512_LOGICAL_OP(xor, _mm512_xor_si512)
+
+#undef DSC_AVX512_LOGICAL_OP
+
+template<typename R>
+struct ops;
+
+template<>
+struct ops<f32> {
+    using vec = __m512;
+    using mask = __mmask16;
+    static constexpr int width = 16;
+
+    static DSC_INLINE vec load(const f32 *x) noexcept { return _mm512_loadu_ps(x); }
+    static DSC_INLINE void store(f32 *x, const vec v) noexcept { _mm512_storeu_ps(x, v); }
+    static DSC_INLINE vec set1(const f32 x) noexcept { return _mm512_set1_ps(x); }
+    static DSC_INLINE vec set2(const f32 re, const f32 im) noexcept { return _mm512_setr4_ps(re, im, re, im); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm512_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm512_sub_ps(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm512_mul_ps(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm512_div_ps(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm512_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm512_moveldup_ps(a); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm512_movehdup_ps(a); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return dsc_xor_ps(a, set2(-0.f, 0.f)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return dsc_xor_ps(a, set2(0.f, -0.f)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm512_min_ps(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm512_max_ps(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return dsc_and_ps(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return dsc_or_ps(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return dsc_xor_ps(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_castps_si512(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm512_castsi512_ps(_mm512_srli_epi32(_mm512_castps_si512(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept {
+        return _mm512_mask_blend_ps(m, b, a);
+    }
+    static DSC_INLINE bool any(const mask m) noexcept { return m != 0; }
+    static DSC_INLINE mask real_lanes() noexcept { return 0x5555; }
+};
+
+template<>
+struct ops<f64> {
+    using vec = __m512d;
+    using mask = __mmask8;
+    static constexpr int width = 8;
+
+    static DSC_INLINE vec load(const f64 *x) noexcept { return _mm512_loadu_pd(x); }
+    static DSC_INLINE void store(f64 *x, const vec v) noexcept { _mm512_storeu_pd(x, v); }
+    static DSC_INLINE vec set1(const f64 x) noexcept { return _mm512_set1_pd(x); }
+    static DSC_INLINE vec set2(const f64 re, const f64 im) noexcept { return _mm512_setr4_pd(re, im, re, im); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm512_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm512_sub_pd(a, b); }
+    static DSC_INLINE vec mul(const vec a, const vec b) noexcept { return _mm512_mul_pd(a, b); }
+    static DSC_INLINE vec div(const vec a, const vec b) noexcept { return _mm512_div_pd(a, b); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm512_permute_pd(a, 0x55); }
+    static DSC_INLINE vec dup_real(const vec a) noexcept { return _mm512_movedup_pd(a); }
+    static DSC_INLINE vec dup_imag(const vec a) noexcept { return _mm512_permute_pd(a, 0xFF); }
+    static DSC_INLINE vec neg_real(const vec a) noexcept { return dsc_xor_pd(a, set2(-0., 0.)); }
+    static DSC_INLINE vec neg_imag(const vec a) noexcept { return dsc_xor_pd(a, set2(0., -0.)); }
+    static DSC_INLINE vec fma(const vec a, const vec b, const vec c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+    static DSC_INLINE vec min(const vec a, const vec b) noexcept { return _mm512_min_pd(a, b); }
+    static DSC_INLINE vec max(const vec a, const vec b) noexcept { return _mm512_max_pd(a, b); }
+    static DSC_INLINE vec bit_and(const vec a, const vec b) noexcept { return dsc_and_pd(a, b); }
+    static DSC_INLINE vec bit_or(const vec a, const vec b) noexcept { return dsc_or_pd(a, b); }
+    static DSC_INLINE vec bit_xor(const vec a, const vec b) noexcept { return dsc_xor_pd(a, b); }
+    static DSC_INLINE vec shl(const vec a, const int n) noexcept {
+        return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(a), n));
+    }
+    static DSC_INLINE vec shr(const vec a, const int n) noexcept {
+        return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(a), n));
+    }
+    static DSC_INLINE mask lt(const vec a, const vec b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static DSC_INLINE mask eq(const vec a, const vec b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static DSC_INLINE vec select(const mask m, const vec a, const vec b) noexcept {
+        return _mm512_mask_blend_pd(m, b, a);
+    }
+    static DSC_INLINE bool any(const mask m) noexcept { return m != 0; }
+    static DSC_INLINE mask real_lanes() noexcept { return 0x55; }
+};
+
+#define DSC_ELEMENTWISE_KERNELS_ISA AVX512
+#include "dsc_elementwise_kernels.h"
+#undef DSC_ELEMENTWISE_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+#endif // DSC_SIMD_X86
+
+#pragma GCC diagnostic pop
+
+const dsc_elementwise_kernels *dsc_elementwise_get_kernels(const dsc_simd_isa isa) noexcept {
+    static const dsc_simd_isa cpu_isa = dsc_simd_detect();
+
+    switch (DSC_MIN(isa, cpu_isa)) {
+#if defined(DSC_SIMD_X86)
+        case AVX512:
+            return &dsc_elementwise_avx512::kernels;
+        case AVX2:
+            return &dsc_elementwise_avx2::kernels;
+        case SSE2:
+            return &dsc_elementwise_sse2::kernels;
+#endif
+        default:
+            return &dsc_elementwise_scalar::kernels;
+    }
+}
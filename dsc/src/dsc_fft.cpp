@@ -0,0 +1,375 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#include "dsc_fft.h"
+
+#if defined(DSC_SIMD_X86)
+#   include <immintrin.h>
+#endif
+
+// The kernels for each instruction set are generated by including dsc_fft_kernels.h with a
+// different implementation of the complex vector operations. The SIMD versions are compiled
+// with the appropriate target options so the rest of the library can be built for a generic
+// x86-64 CPU and still use AVX2/AVX-512 when available.
+// Complex numbers are always stored interleaved as [real, imag].
+
+// GCC reports false positives on the fixed-size butterfly arrays and on the undefined
+// vectors used internally by the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+namespace dsc_fft_scalar {
+using ops_c32 = dsc_fft_scalar_ops<c32>;
+using ops_c64 = dsc_fft_scalar_ops<c64>;
+#define DSC_FFT_KERNELS_ISA SCALAR
+#include "dsc_fft_kernels.h"
+#undef DSC_FFT_KERNELS_ISA
+}
+
+#if defined(DSC_SIMD_X86)
+
+// ============================================================
+// SSE2
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+namespace dsc_fft_sse2 {
+struct ops_c32 {
+    using type = c32;
+    using vec = __m128;
+    static constexpr int width = 2;
+
+    static DSC_INLINE vec load(const c32 *x) noexcept { return _mm_loadu_ps((const f32 *) x); }
+    static DSC_INLINE vec load_strided(const c32 *x, const int stride) noexcept {
+        const vec lo = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) x);
+        return _mm_loadh_pi(lo, (const __m64 *) &x[stride]);
+    }
+    static DSC_INLINE void store(c32 *x, const vec v) noexcept { _mm_storeu_ps((f32 *) x, v); }
+    static DSC_INLINE void store_strided(c32 *x, const int stride, const vec v) noexcept {
+        _mm_storel_pi((__m64 *) x, v);
+        _mm_storeh_pi((__m64 *) &x[stride], v);
+    }
+    static DSC_INLINE vec broadcast(const c32 x) noexcept { return _mm_setr_ps(x.real, x.imag, x.real, x.imag); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm_sub_ps(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f32 s) noexcept { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f32 s) noexcept {
+        return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(s)));
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept {
+        return _mm_add_ps(acc, _mm_mul_ps(a, b));
+    }
+    static DSC_INLINE vec conj(const vec a) noexcept { return _mm_xor_ps(a, _mm_setr_ps(0.f, -0.f, 0.f, -0.f)); }
+    static DSC_INLINE vec reverse(const vec a) noexcept { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return _mm_xor_ps(swap(a), _mm_setr_ps(0.f, -0.f, 0.f, -0.f));
+        else return _mm_xor_ps(swap(a), _mm_setr_ps(-0.f, 0.f, -0.f, 0.f));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+        const vec wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+        const vec t = _mm_mul_ps(swap(a), wi);
+        if constexpr (forward) return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(t, _mm_setr_ps(-0.f, 0.f, -0.f, 0.f)));
+        else return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(t, _mm_setr_ps(0.f, -0.f, 0.f, -0.f)));
+    }
+};
+
+struct ops_c64 {
+    using type = c64;
+    using vec = __m128d;
+    static constexpr int width = 1;
+
+    static DSC_INLINE vec load(const c64 *x) noexcept { return _mm_loadu_pd((const f64 *) x); }
+    static DSC_INLINE vec load_strided(const c64 *x, const int) noexcept { return load(x); }
+    static DSC_INLINE void store(c64 *x, const vec v) noexcept { _mm_storeu_pd((f64 *) x, v); }
+    static DSC_INLINE void store_strided(c64 *x, const int, const vec v) noexcept { store(x, v); }
+    static DSC_INLINE vec broadcast(const c64 x) noexcept { return _mm_setr_pd(x.real, x.imag); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm_sub_pd(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f64 s) noexcept { return _mm_mul_pd(a, _mm_set1_pd(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f64 s) noexcept {
+        return _mm_add_pd(acc, _mm_mul_pd(a, _mm_set1_pd(s)));
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept {
+        return _mm_add_pd(acc, _mm_mul_pd(a, b));
+    }
+    static DSC_INLINE vec conj(const vec a) noexcept { return _mm_xor_pd(a, _mm_setr_pd(0., -0.)); }
+    static DSC_INLINE vec reverse(const vec a) noexcept { return a; }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm_shuffle_pd(a, a, 1); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return _mm_xor_pd(swap(a), _mm_setr_pd(0., -0.));
+        else return _mm_xor_pd(swap(a), _mm_setr_pd(-0., 0.));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec wr = _mm_unpacklo_pd(w, w);
+        const vec wi = _mm_unpackhi_pd(w, w);
+        const vec t = _mm_mul_pd(swap(a), wi);
+        if constexpr (forward) return _mm_add_pd(_mm_mul_pd(a, wr), _mm_xor_pd(t, _mm_setr_pd(-0., 0.)));
+        else return _mm_add_pd(_mm_mul_pd(a, wr), _mm_xor_pd(t, _mm_setr_pd(0., -0.)));
+    }
+};
+
+#define DSC_FFT_KERNELS_ISA SSE2
+#include "dsc_fft_kernels.h"
+#undef DSC_FFT_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+// ============================================================
+// AVX2 + FMA
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace dsc_fft_avx2 {
+struct ops_c32 {
+    using type = c32;
+    using vec = __m256;
+    static constexpr int width = 4;
+
+    static DSC_INLINE vec load(const c32 *x) noexcept { return _mm256_loadu_ps((const f32 *) x); }
+    static DSC_INLINE vec load_strided(const c32 *x, const int stride) noexcept {
+        // Each complex is gathered as a single 64-bit element
+        const __m128i idx = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(stride));
+        return _mm256_castpd_ps(_mm256_i32gather_pd((const f64 *) x, idx, 8));
+    }
+    static DSC_INLINE void store(c32 *x, const vec v) noexcept { _mm256_storeu_ps((f32 *) x, v); }
+    static DSC_INLINE void store_strided(c32 *x, const int stride, const vec v) noexcept {
+        const __m128 lo = _mm256_castps256_ps128(v);
+        const __m128 hi = _mm256_extractf128_ps(v, 1);
+        _mm_storel_pi((__m64 *) x, lo);
+        _mm_storeh_pi((__m64 *) &x[stride], lo);
+        _mm_storel_pi((__m64 *) &x[2 * stride], hi);
+        _mm_storeh_pi((__m64 *) &x[3 * stride], hi);
+    }
+    static DSC_INLINE vec broadcast(const c32 x) noexcept {
+        return _mm256_setr_ps(x.real, x.imag, x.real, x.imag, x.real, x.imag, x.real, x.imag);
+    }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm256_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm256_sub_ps(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f32 s) noexcept { return _mm256_mul_ps(a, _mm256_set1_ps(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f32 s) noexcept {
+        return _mm256_fmadd_ps(a, _mm256_set1_ps(s), acc);
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept { return _mm256_fmadd_ps(a, b, acc); }
+    static DSC_INLINE vec conj(const vec a) noexcept {
+        return _mm256_xor_ps(a, _mm256_setr_ps(0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f));
+    }
+    static DSC_INLINE vec reverse(const vec a) noexcept {
+        return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return conj(swap(a));
+        else return _mm256_xor_ps(swap(a), _mm256_setr_ps(-0.f, 0.f, -0.f, 0.f, -0.f, 0.f, -0.f, 0.f));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec t = _mm256_mul_ps(swap(a), _mm256_movehdup_ps(w));
+        if constexpr (forward) return _mm256_fmaddsub_ps(a, _mm256_moveldup_ps(w), t);
+        else return _mm256_fmsubadd_ps(a, _mm256_moveldup_ps(w), t);
+    }
+};
+
+struct ops_c64 {
+    using type = c64;
+    using vec = __m256d;
+    static constexpr int width = 2;
+
+    static DSC_INLINE vec load(const c64 *x) noexcept { return _mm256_loadu_pd((const f64 *) x); }
+    static DSC_INLINE vec load_strided(const c64 *x, const int stride) noexcept {
+        return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const f64 *) x)),
+                                    _mm_loadu_pd((const f64 *) &x[stride]), 1);
+    }
+    static DSC_INLINE void store(c64 *x, const vec v) noexcept { _mm256_storeu_pd((f64 *) x, v); }
+    static DSC_INLINE void store_strided(c64 *x, const int stride, const vec v) noexcept {
+        _mm_storeu_pd((f64 *) x, _mm256_castpd256_pd128(v));
+        _mm_storeu_pd((f64 *) &x[stride], _mm256_extractf128_pd(v, 1));
+    }
+    static DSC_INLINE vec broadcast(const c64 x) noexcept { return _mm256_setr_pd(x.real, x.imag, x.real, x.imag); }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm256_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm256_sub_pd(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f64 s) noexcept { return _mm256_mul_pd(a, _mm256_set1_pd(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f64 s) noexcept {
+        return _mm256_fmadd_pd(a, _mm256_set1_pd(s), acc);
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept { return _mm256_fmadd_pd(a, b, acc); }
+    static DSC_INLINE vec conj(const vec a) noexcept { return _mm256_xor_pd(a, _mm256_setr_pd(0., -0., 0., -0.)); }
+    static DSC_INLINE vec reverse(const vec a) noexcept { return _mm256_permute2f128_pd(a, a, 1); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm256_permute_pd(a, 0b0101); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return conj(swap(a));
+        else return _mm256_xor_pd(swap(a), _mm256_setr_pd(-0., 0., -0., 0.));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec t = _mm256_mul_pd(swap(a), _mm256_permute_pd(w, 0b1111));
+        if constexpr (forward) return _mm256_fmaddsub_pd(a, _mm256_movedup_pd(w), t);
+        else return _mm256_fmsubadd_pd(a, _mm256_movedup_pd(w), t);
+    }
+};
+
+#define DSC_FFT_KERNELS_ISA AVX2
+#include "dsc_fft_kernels.h"
+#undef DSC_FFT_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+// ============================================================
+// AVX-512
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace dsc_fft_avx512 {
+// Only AVX-512F is required so the sign flips are done using integer XORs
+static DSC_INLINE __m512 dsc_xor_ps(const __m512 a, const __m512 b) noexcept {
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+static DSC_INLINE __m512d dsc_xor_pd(const __m512d a, const __m512d b) noexcept {
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)));
+}
+
+struct ops_c32 {
+    using type = c32;
+    using vec = __m512;
+    static constexpr int width = 8;
+
+    static DSC_INLINE __m256i strided_idx(const int stride) noexcept {
+        return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    }
+    static DSC_INLINE vec load(const c32 *x) noexcept { return _mm512_loadu_ps((const f32 *) x); }
+    static DSC_INLINE vec load_strided(const c32 *x, const int stride) noexcept {
+        return _mm512_castpd_ps(_mm512_i32gather_pd(strided_idx(stride), (const f64 *) x, 8));
+    }
+    static DSC_INLINE void store(c32 *x, const vec v) noexcept { _mm512_storeu_ps((f32 *) x, v); }
+    static DSC_INLINE void store_strided(c32 *x, const int stride, const vec v) noexcept {
+        // Scatters are slow, extract 128-bit lanes instead
+        const __m128 l0 = _mm512_extractf32x4_ps(v, 0);
+        const __m128 l1 = _mm512_extractf32x4_ps(v, 1);
+        const __m128 l2 = _mm512_extractf32x4_ps(v, 2);
+        const __m128 l3 = _mm512_extractf32x4_ps(v, 3);
+        _mm_storel_pi((__m64 *) x, l0);
+        _mm_storeh_pi((__m64 *) &x[stride], l0);
+        _mm_storel_pi((__m64 *) &x[2 * stride], l1);
+        _mm_storeh_pi((__m64 *) &x[3 * stride], l1);
+        _mm_storel_pi((__m64 *) &x[4 * stride], l2);
+        _mm_storeh_pi((__m64 *) &x[5 * stride], l2);
+        _mm_storel_pi((__m64 *) &x[6 * stride], l3);
+        _mm_storeh_pi((__m64 *) &x[7 * stride], l3);
+    }
+    static DSC_INLINE vec broadcast(const c32 x) noexcept {
+        return _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_setr_ps(x.real, x.imag, 0.f, 0.f)))));
+    }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm512_add_ps(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm512_sub_ps(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f32 s) noexcept { return _mm512_mul_ps(a, _mm512_set1_ps(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f32 s) noexcept {
+        return _mm512_fmadd_ps(a, _mm512_set1_ps(s), acc);
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept { return _mm512_fmadd_ps(a, b, acc); }
+    static DSC_INLINE vec conj(const vec a) noexcept {
+        return dsc_xor_ps(a, _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_setr_ps(0.f, -0.f, 0.f, 0.f))))));
+    }
+    static DSC_INLINE vec reverse(const vec a) noexcept {
+        return _mm512_castpd_ps(_mm512_permutexvar_pd(_mm512_setr_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_castps_pd(a)));
+    }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm512_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return conj(swap(a));
+        else return dsc_xor_ps(swap(a), _mm512_castpd_ps(_mm512_set1_pd(_mm_cvtsd_f64(_mm_castps_pd(_mm_setr_ps(-0.f, 0.f, 0.f, 0.f))))));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec t = _mm512_mul_ps(swap(a), _mm512_movehdup_ps(w));
+        if constexpr (forward) return _mm512_fmaddsub_ps(a, _mm512_moveldup_ps(w), t);
+        else return _mm512_fmsubadd_ps(a, _mm512_moveldup_ps(w), t);
+    }
+};
+
+struct ops_c64 {
+    using type = c64;
+    using vec = __m512d;
+    static constexpr int width = 4;
+
+    static DSC_INLINE vec load(const c64 *x) noexcept { return _mm512_loadu_pd((const f64 *) x); }
+    static DSC_INLINE vec load_strided(const c64 *x, const int stride) noexcept {
+        const __m256d lo = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const f64 *) x)),
+                                                _mm_loadu_pd((const f64 *) &x[stride]), 1);
+        const __m256d hi = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const f64 *) &x[2 * stride])),
+                                                _mm_loadu_pd((const f64 *) &x[3 * stride]), 1);
+        return _mm512_insertf64x4(_mm512_castpd256_pd512(lo), hi, 1);
+    }
+    static DSC_INLINE void store(c64 *x, const vec v) noexcept { _mm512_storeu_pd((f64 *) x, v); }
+    static DSC_INLINE void store_strided(c64 *x, const int stride, const vec v) noexcept {
+        const __m256d lo = _mm512_castpd512_pd256(v);
+        const __m256d hi = _mm512_extractf64x4_pd(v, 1);
+        _mm_storeu_pd((f64 *) x, _mm256_castpd256_pd128(lo));
+        _mm_storeu_pd((f64 *) &x[stride], _mm256_extractf128_pd(lo, 1));
+        _mm_storeu_pd((f64 *) &x[2 * stride], _mm256_castpd256_pd128(hi));
+        _mm_storeu_pd((f64 *) &x[3 * stride], _mm256_extractf128_pd(hi, 1));
+    }
+    static DSC_INLINE vec broadcast(const c64 x) noexcept {
+        return _mm512_setr_pd(x.real, x.imag, x.real, x.imag, x.real, x.imag, x.real, x.imag);
+    }
+    static DSC_INLINE vec add(const vec a, const vec b) noexcept { return _mm512_add_pd(a, b); }
+    static DSC_INLINE vec sub(const vec a, const vec b) noexcept { return _mm512_sub_pd(a, b); }
+    static DSC_INLINE vec scale(const vec a, const f64 s) noexcept { return _mm512_mul_pd(a, _mm512_set1_pd(s)); }
+    static DSC_INLINE vec fmadd(const vec acc, const vec a, const f64 s) noexcept {
+        return _mm512_fmadd_pd(a, _mm512_set1_pd(s), acc);
+    }
+    static DSC_INLINE vec madd(const vec acc, const vec a, const vec b) noexcept { return _mm512_fmadd_pd(a, b, acc); }
+    static DSC_INLINE vec conj(const vec a) noexcept {
+        return dsc_xor_pd(a, _mm512_setr_pd(0., -0., 0., -0., 0., -0., 0., -0.));
+    }
+    static DSC_INLINE vec reverse(const vec a) noexcept { return _mm512_shuffle_f64x2(a, a, _MM_SHUFFLE(0, 1, 2, 3)); }
+    static DSC_INLINE vec swap(const vec a) noexcept { return _mm512_permute_pd(a, 0x55); }
+    template<bool forward>
+    static DSC_INLINE vec rot90(const vec a) noexcept {
+        if constexpr (forward) return conj(swap(a));
+        else return dsc_xor_pd(swap(a), _mm512_setr_pd(-0., 0., -0., 0., -0., 0., -0., 0.));
+    }
+    template<bool forward>
+    static DSC_INLINE vec cmul(const vec a, const vec w) noexcept {
+        const vec t = _mm512_mul_pd(swap(a), _mm512_permute_pd(w, 0xFF));
+        if constexpr (forward) return _mm512_fmaddsub_pd(a, _mm512_movedup_pd(w), t);
+        else return _mm512_fmsubadd_pd(a, _mm512_movedup_pd(w), t);
+    }
+};
+
+#define DSC_FFT_KERNELS_ISA AVX512
+#include "dsc_fft_kernels.h"
+#undef DSC_FFT_KERNELS_ISA
+}
+#pragma GCC pop_options
+
+#endif // DSC_SIMD_X86
+
+#pragma GCC diagnostic pop
+
+const dsc_fft_kernels *dsc_fft_get_kernels(const dsc_simd_isa isa) noexcept {
+    static const dsc_simd_isa cpu_isa = dsc_simd_detect();
+
+    switch (DSC_MIN(isa, cpu_isa)) {
+#if defined(DSC_SIMD_X86)
+        case AVX512:
+            return &dsc_fft_avx512::kernels;
+        case AVX2:
+            return &dsc_fft_avx2::kernels;
+        case SSE2:
+            return &dsc_fft_sse2::kernels;
+#endif
+        default:
+            return &dsc_fft_scalar::kernels;
+    }
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+#include "dsc_thread.h"
+#include <pthread.h>
+#include <unistd.h>     // sysconf()
+
+struct dsc_worker {
+    dsc_thread_pool *pool;
+    pthread_t thread;
+    int id;
+};
+
+struct dsc_thread_pool {
+    dsc_worker *workers;
+    pthread_mutex_t mtx;
+    // Signaled when a new job is submitted or when the pool is freed
+    pthread_cond_t job_cond;
+    // Signaled when the last worker of the current job is done
+    pthread_cond_t done_cond;
+    dsc_thread_fn fn;
+    void *args;
+    int n_threads;
+    // Number of workers that take part in the current job
+    int n_workers;
+    // Number of workers that are still running the current job
+    int pending;
+    // Incremented each time a new job is submitted
+    u64 job_id;
+    bool stop;
+};
+
+// Set while the thread is running a job, jobs submitted from inside another job are executed inline
+static thread_local bool in_job = false;
+
+static void *dsc_worker_loop(void *args) noexcept {
+    dsc_worker *worker = (dsc_worker *) args;
+    dsc_thread_pool *pool = worker->pool;
+
+    u64 last_job = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->mtx);
+        while (!pool->stop && pool->job_id == last_job)
+            pthread_cond_wait(&pool->job_cond, &pool->mtx);
+
+        if (pool->stop) {
+            pthread_mutex_unlock(&pool->mtx);
+            break;
+        }
+
+        last_job = pool->job_id;
+        if (worker->id >= pool->n_workers) {
+            // Not needed for this job
+            pthread_mutex_unlock(&pool->mtx);
+            continue;
+        }
+
+        const dsc_thread_fn fn = pool->fn;
+        void *fn_args = pool->args;
+        const int n_workers = pool->n_workers;
+        pthread_mutex_unlock(&pool->mtx);
+
+        in_job = true;
+        fn(fn_args, worker->id, n_workers);
+        in_job = false;
+
+        pthread_mutex_lock(&pool->mtx);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done_cond);
+        pthread_mutex_unlock(&pool->mtx);
+    }
+
+    return nullptr;
+}
+
+// ============================================================
+// Thread Pool
+
+dsc_thread_pool *dsc_thread_pool_init(const int n_threads) noexcept {
+    DSC_ASSERT(n_threads > 0);
+
+    dsc_thread_pool *pool = (dsc_thread_pool *) calloc(1, sizeof(dsc_thread_pool));
+    DSC_ASSERT(pool != nullptr);
+
+    pool->n_threads = n_threads;
+    pthread_mutex_init(&pool->mtx, nullptr);
+    pthread_cond_init(&pool->job_cond, nullptr);
+    pthread_cond_init(&pool->done_cond, nullptr);
+
+    // Worker 0 is the thread that submits the job
+    pool->workers = (dsc_worker *) calloc(n_threads, sizeof(dsc_worker));
+    DSC_ASSERT(pool->workers != nullptr);
+    for (int i = 1; i < n_threads; ++i) {
+        dsc_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->id = i;
+        const int res = pthread_create(&worker->thread, nullptr, dsc_worker_loop, worker);
+        if (res != 0) DSC_LOG_FATAL("error creating worker thread %d: %d", i, res);
+    }
+
+    return pool;
+}
+
+void dsc_thread_pool_free(dsc_thread_pool *pool) noexcept {
+    if (pool == nullptr) return;
+
+    pthread_mutex_lock(&pool->mtx);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->mtx);
+
+    for (int i = 1; i < pool->n_threads; ++i)
+        pthread_join(pool->workers[i].thread, nullptr);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->job_cond);
+    pthread_mutex_destroy(&pool->mtx);
+
+    free(pool->workers);
+    free(pool);
+}
+
+int dsc_thread_pool_size(const dsc_thread_pool *pool) noexcept {
+    return pool == nullptr ? 1 : pool->n_threads;
+}
+
+void dsc_thread_pool_run(dsc_thread_pool *pool, const int n_workers,
+                         const dsc_thread_fn fn, void *args) noexcept {
+    DSC_ASSERT(n_workers > 0 && n_workers <= pool->n_threads);
+
+    if (n_workers == 1 || in_job) {
+        fn(args, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mtx);
+    pool->fn = fn;
+    pool->args = args;
+    pool->n_workers = n_workers;
+    pool->pending = n_workers - 1;
+    pool->job_id++;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->mtx);
+
+    in_job = true;
+    fn(args, 0, n_workers);
+    in_job = false;
+
+    pthread_mutex_lock(&pool->mtx);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->mtx);
+    pthread_mutex_unlock(&pool->mtx);
+}
+
+// ============================================================
+// Utilities
+
+int dsc_cpu_count() noexcept {
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
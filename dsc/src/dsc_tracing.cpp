@@ -19,6 +19,7 @@
 #   include "dsc_fft.h"         // dsc_fft_type
 #   pragma GCC diagnostic pop
 
+static_assert(DSC_TRACE_MAX_FACTORS == DSC_FFT_MAX_FACTORS, "DSC_TRACE_MAX_FACTORS must be equal to DSC_FFT_MAX_FACTORS");
 
 dsc_trace_ctx *g_trace_ctx = nullptr;
 
@@ -165,6 +166,17 @@ static DSC_INLINE void dump_trace_args(FILE *f, const dsc_trace *t) noexcept {
                     DSC_DTYPE_NAMES[args->dtype]);
             break;
         }
+        case DSC_PLAN_FFT_MEASURE: {
+            const dsc_plan_measure_args *args = &t->plan_measure;
+            fprintf(f, R"(, "args": {"type": "%s", "order": %d, "dtype": "%s", "lines": %d, "algorithm": "%s", "kernels": "%s", "passes": )",
+                    args->type == dsc_fft_type::COMPLEX ? "FFT" : "RFFT",
+                    args->n, DSC_DTYPE_NAMES[args->dtype], args->lines,
+                    DSC_FFT_ALGORITHM_NAMES[args->algorithm], DSC_SIMD_ISA_NAMES[args->isa]);
+            if (args->n_factors > 0) dump_indexes(f, args->factors, args->n_factors);
+            else fprintf(f, R"("[]")");
+            fprintf(f, R"(, "ns": %.1f, "selected": "%s"})", args->ns, args->selected ? "True" : "False");
+            break;
+        }
         case DSC_GET_IDX: {
             const dsc_get_idx_args *args = &t->get_idx;
             fprintf(f, R"(, "args": {"x": )");
@@ -0,0 +1,108 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+// Check that the expressions recorded in lazy mode by the C++ API give the same result of the eager operators.
+// Usage: make test_api DSC_FAST=1 && ./test_api
+
+#include "dsc_api.h"
+#include <cmath>
+
+static constexpr f64 tolerance = 1e-12;
+static constexpr f64 tolerance_f32 = 1e-6;
+
+template<typename T>
+static T scalar(const real<T> x) noexcept {
+    if constexpr (dsc_is_complex<T>()) {
+        return dsc_complex(T, x, 0);
+    } else {
+        return x;
+    }
+}
+
+template<typename T>
+static void fill_random(dsc::tensor<T> &x, const int ne) noexcept {
+    real<T> *data = (real<T> *) x.data();
+    const int n = dsc_is_complex<T>() ? 2 * ne : ne;
+    for (int i = 0; i < n; ++i)
+        data[i] = (real<T>) (rand() / (RAND_MAX + 1.0) - 0.5);
+}
+
+template<typename T>
+static f64 max_diff(const dsc::tensor<T> &a, const dsc::tensor<T> &b, const int ne) noexcept {
+    const real<T> *a_data = (const real<T> *) a.data();
+    const real<T> *b_data = (const real<T> *) b.data();
+    const int n = dsc_is_complex<T>() ? 2 * ne : ne;
+    f64 diff = 0;
+    for (int i = 0; i < n; ++i) {
+        const f64 this_diff = std::abs((f64) a_data[i] - (f64) b_data[i]);
+        diff = this_diff > diff ? this_diff : diff;
+    }
+    return diff;
+}
+
+template<typename T>
+static bool test_lazy(const int rows, const int cols) noexcept {
+    const int ne = rows * cols;
+    dsc::tensor<T> a({rows, cols}, scalar<T>(0)), b({rows, cols}, scalar<T>(0));
+    dsc::tensor<T> w({1, cols}, scalar<T>(0)), c({rows, 1}, scalar<T>(0));
+    fill_random(a, ne);
+    fill_random(b, ne);
+    fill_random(w, cols);
+    fill_random(c, rows);
+
+    const auto expr = [&]() noexcept {
+        // 12 operations with shared sub-expressions, broadcast inputs and scalars
+        const dsc::tensor<T> norm = dsc::sqrt(a * a + b * b);
+        return (norm * w - scalar<T>(1.5) * c) / (norm + scalar<T>(2)) + dsc::sinc(a - c).pow(2);
+    };
+
+    const dsc::tensor<T> eager = expr();
+    dsc::tensor<T> lazy;
+    {
+        dsc::lazy_scope scope;
+        lazy = expr();
+    }
+    const f64 diff = max_diff(eager, lazy, ne);
+
+    // Longer than DSC_MAX_FUSED_OPS, computed in more dsc_fused calls. The input goes out of scope
+    // before the expression is computed.
+    dsc::tensor<T> chain, target;
+    {
+        dsc::tensor<T> x({rows, cols}, scalar<T>(0));
+        fill_random(x, ne);
+        target = x * scalar<T>(1);
+        for (int i = 0; i < 40; ++i) target = target * scalar<T>(0.5) + x;
+
+        dsc::lazy_scope scope;
+        chain = x * scalar<T>(1);
+        for (int i = 0; i < 40; ++i) chain = chain * scalar<T>(0.5) + x;
+    }
+    const f64 chain_diff = max_diff(chain, target, ne);
+
+    const f64 tol = (dsc_is_type<real<T>, f32>() ? tolerance_f32 : tolerance);
+    const bool ok = diff < tol && chain_diff < tol;
+    printf("%8s | %5d x %-5d | %9.2e %9.2e | %s\n", DSC_DTYPE_NAMES[dsc_type_mapping<T>::value], rows, cols,
+           diff, chain_diff, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main() {
+    dsc::init(DSC_MB(512), DSC_MB(256));
+    bool ok = true;
+
+    printf("Lazy expressions vs eager operators\n");
+    printf("%8s | %13s | %9s %9s |\n", "dtype", "shape", "err expr", "err chain");
+    for (const int cols : {1, 33, 1000}) {
+        ok &= test_lazy<f32>(60, cols);
+        ok &= test_lazy<f64>(60, cols);
+        ok &= test_lazy<c32>(60, cols);
+        ok &= test_lazy<c64>(60, cols);
+    }
+
+    dsc_ctx_free(dsc::ctx);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,13 +1,32 @@
+// Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+// All rights reserved.
+//
+// This code is licensed under the terms of the 3-clause BSD license
+// (https://opensource.org/license/bsd-3-clause).
+
+// Compare the FFT kernels of dsc against pocketfft both in terms of accuracy and speed.
+// Usage: make test_fft DSC_FAST=1 && ./test_fft
+
 #include "dsc.h"
+#include "dsc_fft.h"
 #include "pocketfft.h"
+#include <chrono>
 #include <cstring>
+#include <limits>
 
-#define N 64
+#define MIN_LOG2_N  3
+#define MAX_LOG2_N  20
+// Run each kernel for at least this long when measuring its speed
+#define MIN_TIME_MS 100.
 
+static constexpr f64 tolerance = 1e-9;
+// Tolerance for single precision, relative to the largest output value
+static constexpr f64 tolerance_c32 = 1e-5;
 
-static void fill_random(f64 *x, const int n) noexcept {
+template<typename T>
+static void fill_random(T *x, const int n) noexcept {
     for (int i = 0; i < n; ++i)
-        x[i] = (f64) (rand() / (RAND_MAX + 1.0) - 0.5);
+        x[i] = (T) (rand() / (RAND_MAX + 1.0) - 0.5);
 }
 
 static f64 max_diff(const f64 *A, const f64 *B, const int n) noexcept {
@@ -23,34 +42,563 @@ static f64 max_diff(const f64 *A, const f64 *B, const int n) noexcept {
     return diff;
 }
 
-int main() {
-    dsc_ctx *ctx = dsc_ctx_init(1024 * 1024);
-    dsc_plan_fft(ctx, N);
+// Measure the speed of a forward + backward transform in MFLOPS using the
+// usual 5 * N * log2(N) estimate for the number of operations of a complex FFT.
+template<typename F>
+static f64 mflops(const int n, F &&fft) noexcept {
+    int reps = 0;
+    f64 elapsed_ms = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    do {
+        fft();
+        reps++;
+        elapsed_ms = std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    } while (elapsed_ms < MIN_TIME_MS);
 
-    dsc_tensor *x = dsc_tensor_1d(ctx, C64, N);
+    const f64 flop = 2. * 5. * n * std::log2((f64) n);
+    return (flop * reps) / (elapsed_ms * 1e3);
+}
 
-    cfft_plan pocket_plan = make_cfft_plan(N);
+static dsc_fft_plan *make_plan(const int n, const dsc_fft_type fft_type,
+                               const dsc_fft_algorithm algorithm,
+                               const dsc_dtype dtype = F64) noexcept {
+    dsc_fft_plan *plan = (dsc_fft_plan *) malloc(sizeof(dsc_fft_plan) +
+                                                 dsc_fft_storage(n, dtype, fft_type, algorithm));
+    plan->twiddles = (plan + 1);
+    c64 *work = (c64 *) malloc(dsc_fft_work_size(n, algorithm) * sizeof(c64));
+    dsc_init_plan(plan, n, dtype, fft_type, algorithm, work);
+    free(work);
+    return plan;
+}
 
-    c64 x_pocket[N];
-    c64 my_x[N];
+// Run the same plan using the kernels of each instruction set supported by this CPU
+static bool test_simd(const int n) noexcept {
+    const dsc_simd_isa cpu_isa = dsc_simd_detect();
+    const dsc_fft_algorithm algorithm = dsc_fft_choose_algorithm(n);
+    dsc_fft_plan *plan_c32 = make_plan(n, COMPLEX, algorithm, F32);
+    dsc_fft_plan *plan_c64 = make_plan(n, COMPLEX, algorithm, F64);
+    cfft_plan pocket_plan = make_cfft_plan(n);
 
-    fill_random((f64 *) x_pocket, 2 * N);
+    c64 *x = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_pocket = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_c64 = (c64 *) malloc(n * sizeof(c64));
+    c32 *x_c32 = (c32 *) malloc(n * sizeof(c32));
+    c64 *work = (c64 *) malloc(dsc_fft_work_size(n, algorithm) * sizeof(c64));
 
-    memcpy(x->data, x_pocket, N * sizeof(c64));
-    memcpy(my_x, x_pocket, N * sizeof(c64));
+    fill_random((f64 *) x, 2 * n);
+    memcpy(x_pocket, x, n * sizeof(c64));
+    cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
 
-    dsc_tensor *x_fft;
-    {
-        x_fft = dsc_fft(ctx, x);
+    f64 max_abs = 0;
+    for (int i = 0; i < 2 * n; ++i) max_abs = DSC_MAX(max_abs, std::abs(((f64 *) x_pocket)[i]));
+
+    bool ok = true;
+    f64 mflops_c32[AVX512 + 1]{}, mflops_c64[AVX512 + 1]{};
+    f64 err_c32 = 0, err_c64 = 0;
+    for (int isa = SCALAR; isa <= cpu_isa; ++isa) {
+        plan_c32->kernels = dsc_fft_get_kernels((dsc_simd_isa) isa);
+        plan_c64->kernels = dsc_fft_get_kernels((dsc_simd_isa) isa);
+
+        memcpy(x_c64, x, n * sizeof(c64));
+        for (int i = 0; i < n; ++i) x_c32[i] = {(f32) x[i].real, (f32) x[i].imag};
+
+        dsc_complex_fft<c64, true>(plan_c64, x_c64, work);
+        dsc_complex_fft<c32, true>(plan_c32, x_c32, (c32 *) work);
+
+        err_c64 = DSC_MAX(err_c64, max_diff((f64 *) x_c64, (f64 *) x_pocket, 2 * n));
+        for (int i = 0; i < n; ++i) {
+            err_c32 = DSC_MAX(err_c32, std::abs((f64) x_c32[i].real - x_pocket[i].real) / max_abs);
+            err_c32 = DSC_MAX(err_c32, std::abs((f64) x_c32[i].imag - x_pocket[i].imag) / max_abs);
+        }
+
+        mflops_c32[isa] = mflops(n, [&]() {
+            dsc_complex_fft<c32, true>(plan_c32, x_c32, (c32 *) work);
+            dsc_complex_fft<c32, false>(plan_c32, x_c32, (c32 *) work);
+        });
+        mflops_c64[isa] = mflops(n, [&]() {
+            dsc_complex_fft<c64, true>(plan_c64, x_c64, work);
+            dsc_complex_fft<c64, false>(plan_c64, x_c64, work);
+        });
     }
+    ok &= err_c32 < tolerance_c32 && err_c64 < tolerance;
 
-    {
+    printf("%8d | %9.2e %9.2e |", n, err_c32, err_c64);
+    for (int isa = SCALAR; isa <= AVX512; ++isa) printf(" %8.0f", mflops_c32[isa]);
+    printf(" |");
+    for (int isa = SCALAR; isa <= AVX512; ++isa) printf(" %8.0f", mflops_c64[isa]);
+    printf(" %s\n", ok ? "" : "FAILED");
+
+    free(x);
+    free(x_pocket);
+    free(x_c64);
+    free(x_c32);
+    free(work);
+    destroy_cfft_plan(pocket_plan);
+    free(plan_c32);
+    free(plan_c64);
+
+    return ok;
+}
+
+// Arbitrary length FFT using the algorithm selected by the planner
+static bool test_any_fft(const int n) noexcept {
+    const dsc_fft_algorithm algorithm = dsc_fft_choose_algorithm(n);
+    dsc_fft_plan *plan = make_plan(n, COMPLEX, algorithm);
+    cfft_plan pocket_plan = make_cfft_plan(n);
+
+    c64 *x = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_pocket = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_dsc = (c64 *) malloc(n * sizeof(c64));
+    c64 *work = (c64 *) malloc(dsc_fft_work_size(n, algorithm) * sizeof(c64));
+
+    fill_random((f64 *) x, 2 * n);
+    memcpy(x_pocket, x, n * sizeof(c64));
+    memcpy(x_dsc, x, n * sizeof(c64));
+
+    cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
+    dsc_complex_fft<c64, true>(plan, x_dsc, work);
+    const f64 diff = max_diff((f64 *) x_dsc, (f64 *) x_pocket, 2 * n);
+
+    dsc_complex_fft<c64, false>(plan, x_dsc, work);
+    const f64 diff_inverse = max_diff((f64 *) x_dsc, (f64 *) x, 2 * n);
+
+    const f64 mflops_pocket = mflops(n, [&]() {
+        cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
+        cfft_backward(pocket_plan, (f64 *) x_pocket, 1. / n);
+    });
+    const f64 mflops_dsc = mflops(n, [&]() {
+        dsc_complex_fft<c64, true>(plan, x_dsc, work);
+        dsc_complex_fft<c64, false>(plan, x_dsc, work);
+    });
+
+    const bool ok = diff < tolerance && diff_inverse < tolerance;
+    printf("%8d | %9s | %9.2e %9.2e | %10.0f %10.0f %s\n",
+           n, DSC_FFT_ALGORITHM_NAMES[algorithm], diff, diff_inverse,
+           mflops_pocket, mflops_dsc, ok ? "" : "FAILED");
+
+    free(x);
+    free(x_pocket);
+    free(x_dsc);
+    free(work);
+    destroy_cfft_plan(pocket_plan);
+    free(plan);
+
+    return ok;
+}
+
+static bool test_fft(const int n) noexcept {
+    dsc_fft_plan *recursive = make_plan(n, COMPLEX, RECURSIVE_RADIX2);
+    dsc_fft_plan *stockham = make_plan(n, COMPLEX, STOCKHAM);
+    cfft_plan pocket_plan = make_cfft_plan(n);
+
+    c64 *x = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_pocket = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_recursive = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_stockham = (c64 *) malloc(n * sizeof(c64));
+    c64 *work = (c64 *) malloc(n * sizeof(c64));
+
+    fill_random((f64 *) x, 2 * n);
+    memcpy(x_pocket, x, n * sizeof(c64));
+    memcpy(x_recursive, x, n * sizeof(c64));
+    memcpy(x_stockham, x, n * sizeof(c64));
+
+    cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
+    dsc_complex_fft<c64, true>(recursive, x_recursive, work);
+    dsc_complex_fft<c64, true>(stockham, x_stockham, work);
+
+    const f64 diff_recursive = max_diff((f64 *) x_recursive, (f64 *) x_pocket, 2 * n);
+    const f64 diff_stockham = max_diff((f64 *) x_stockham, (f64 *) x_pocket, 2 * n);
+
+    // Round trip
+    dsc_complex_fft<c64, false>(stockham, x_stockham, work);
+    const f64 diff_inverse = max_diff((f64 *) x_stockham, (f64 *) x, 2 * n);
+
+    const f64 mflops_pocket = mflops(n, [&]() {
         cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
+        cfft_backward(pocket_plan, (f64 *) x_pocket, 1. / n);
+    });
+    const f64 mflops_recursive = mflops(n, [&]() {
+        dsc_complex_fft<c64, true>(recursive, x_recursive, work);
+        dsc_complex_fft<c64, false>(recursive, x_recursive, work);
+    });
+    const f64 mflops_stockham = mflops(n, [&]() {
+        dsc_complex_fft<c64, true>(stockham, x_stockham, work);
+        dsc_complex_fft<c64, false>(stockham, x_stockham, work);
+    });
+
+    const bool ok = diff_recursive < tolerance && diff_stockham < tolerance && diff_inverse < tolerance;
+
+    printf("%8d | %9.2e %9.2e %9.2e | %10.0f %10.0f %10.0f | %5.2fx %s\n",
+           n, diff_recursive, diff_stockham, diff_inverse,
+           mflops_pocket, mflops_recursive, mflops_stockham,
+           mflops_stockham / mflops_recursive, ok ? "" : "FAILED");
+
+    free(x);
+    free(x_pocket);
+    free(x_recursive);
+    free(x_stockham);
+    free(work);
+    destroy_cfft_plan(pocket_plan);
+    free(recursive);
+    free(stockham);
+
+    return ok;
+}
+
+// FFTs bigger than the cache: a single Stockham FFT vs the four-step FFT, both using the best kernels
+// for this CPU. With the four-step algorithm the GFLOPS should stay roughly flat as N grows.
+template<typename T>
+static bool test_large(const int n) noexcept {
+    const dsc_dtype dtype = dsc_is_type<T, c32>() ? F32 : F64;
+    dsc_fft_plan *stockham = make_plan(n, COMPLEX, STOCKHAM, dtype);
+    dsc_fft_plan *four_step = make_plan(n, COMPLEX, FOUR_STEP, dtype);
+    cfft_plan pocket_plan = make_cfft_plan(n);
+
+    c64 *x = (c64 *) malloc(n * sizeof(c64));
+    c64 *x_pocket = (c64 *) malloc(n * sizeof(c64));
+    T *x_stockham = (T *) malloc(n * sizeof(T));
+    T *x_four_step = (T *) malloc(n * sizeof(T));
+    T *work = (T *) malloc(dsc_fft_work_size(n, FOUR_STEP) * sizeof(T));
+
+    fill_random((f64 *) x, 2 * n);
+    memcpy(x_pocket, x, n * sizeof(c64));
+    cfft_forward(pocket_plan, (f64 *) x_pocket, 1.);
+    for (int i = 0; i < n; ++i) {
+        x_stockham[i] = x_four_step[i] = dsc_complex(T, (real<T>) x[i].real, (real<T>) x[i].imag);
     }
 
-    const f64 diff = max_diff((f64 *) x_fft->data, (f64 *) x_pocket, 2 * N);
-    printf("diff= %.2e\n", diff);
+    dsc_complex_fft<T, true>(stockham, x_stockham, work);
+    dsc_complex_fft<T, true>(four_step, x_four_step, work);
 
+    // The error is relative to the largest output value
+    f64 max_abs = 0, err_stockham = 0, err_four_step = 0;
+    for (int i = 0; i < 2 * n; ++i) max_abs = DSC_MAX(max_abs, std::abs(((f64 *) x_pocket)[i]));
+    for (int i = 0; i < 2 * n; ++i) {
+        const f64 target = ((f64 *) x_pocket)[i];
+        err_stockham = DSC_MAX(err_stockham, std::abs((f64) ((real<T> *) x_stockham)[i] - target) / max_abs);
+        err_four_step = DSC_MAX(err_four_step, std::abs((f64) ((real<T> *) x_four_step)[i] - target) / max_abs);
+    }
+
+    dsc_complex_fft<T, false>(four_step, x_four_step, work);
+    f64 err_inverse = 0;
+    for (int i = 0; i < n; ++i) {
+        err_inverse = DSC_MAX(err_inverse, std::abs((f64) x_four_step[i].real - x[i].real));
+        err_inverse = DSC_MAX(err_inverse, std::abs((f64) x_four_step[i].imag - x[i].imag));
+    }
+
+    const f64 gflops_stockham = mflops(n, [&]() {
+        dsc_complex_fft<T, true>(stockham, x_stockham, work);
+        dsc_complex_fft<T, false>(stockham, x_stockham, work);
+    }) / 1e3;
+    const f64 gflops_four_step = mflops(n, [&]() {
+        dsc_complex_fft<T, true>(four_step, x_four_step, work);
+        dsc_complex_fft<T, false>(four_step, x_four_step, work);
+    }) / 1e3;
+
+    const f64 tol = dsc_is_type<T, c32>() ? tolerance_c32 : tolerance;
+    const bool ok = err_stockham < tol && err_four_step < tol && err_inverse < tol;
+    printf("%8d | %5d x %5d | %9.2e %9.2e %9.2e | %8.2f %8.2f | %5.2fx %s\n",
+           n, four_step->sub_plan->n, four_step->row_plan->n, err_stockham, err_four_step, err_inverse,
+           gflops_stockham, gflops_four_step, gflops_four_step / gflops_stockham, ok ? "" : "FAILED");
+
+    free(x);
+    free(x_pocket);
+    free(x_stockham);
+    free(x_four_step);
+    free(work);
     destroy_cfft_plan(pocket_plan);
+    free(stockham);
+    free(four_step);
+
+    return ok;
+}
+
+// Transform batch lines of length n stored as x[n][batch] (like an FFT over the first axis of a tensor)
+// one line at a time and using the batched kernels. Both include the copy in and out of x.
+template<typename T>
+static bool test_batch(const int n, const int batch) noexcept {
+    const dsc_dtype dtype = dsc_is_type<T, c32>() ? F32 : F64;
+    dsc_fft_plan *plan = make_plan(n, COMPLEX, STOCKHAM, dtype);
+
+    T *x = (T *) malloc(n * batch * sizeof(T));
+    T *x_line = (T *) malloc(n * batch * sizeof(T));
+    T *x_batch = (T *) malloc(n * batch * sizeof(T));
+    T *buff = (T *) malloc(n * batch * sizeof(T));
+    T *work = (T *) malloc(n * batch * sizeof(T));
+
+    fill_random((real<T> *) x, 2 * n * batch);
+
+    const auto per_line = [&]() {
+        for (int b = 0; b < batch; ++b) {
+            for (int i = 0; i < n; ++i) buff[i] = x_line[i * batch + b];
+            dsc_complex_fft<T, true>(plan, buff, work);
+            for (int i = 0; i < n; ++i) x_line[i * batch + b] = buff[i];
+        }
+    };
+    const auto batched = [&]() {
+        memcpy(buff, x_batch, n * batch * sizeof(T));
+        dsc_complex_fft_batch<T, true>(plan, buff, work, batch);
+        memcpy(x_batch, buff, n * batch * sizeof(T));
+    };
+
+    memcpy(x_line, x, n * batch * sizeof(T));
+    memcpy(x_batch, x, n * batch * sizeof(T));
+    per_line();
+    batched();
+    f64 diff = 0;
+    for (int i = 0; i < n * batch; ++i) {
+        diff = DSC_MAX(diff, std::abs((f64) (x_line[i].real - x_batch[i].real)));
+        diff = DSC_MAX(diff, std::abs((f64) (x_line[i].imag - x_batch[i].imag)));
+    }
+
+    // Only the forward transform is measured, reset the input so the values don't grow too much
+    const f64 mflops_line = mflops(n, [&]() {
+        memcpy(x_line, x, n * batch * sizeof(T));
+        per_line();
+    }) * batch / 2;
+    const f64 mflops_batch = mflops(n, [&]() {
+        memcpy(x_batch, x, n * batch * sizeof(T));
+        batched();
+    }) * batch / 2;
+
+    const bool ok = diff < (dsc_is_type<T, c32>() ? 1e-4 : tolerance);
+    printf("%8d | %5d | %9.2e | %10.0f %10.0f | %5.2fx %s\n",
+           n, batch, diff, mflops_line, mflops_batch, mflops_batch / mflops_line, ok ? "" : "FAILED");
+
+    free(x);
+    free(x_line);
+    free(x_batch);
+    free(buff);
+    free(work);
+    free(plan);
+
+    return ok;
+}
+
+// Throughput in millions of bins per second of f, which computes bins bins
+template<typename F>
+static f64 mbins(const i64 bins, F &&f) noexcept {
+    int reps = 0;
+    f64 elapsed_ms = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    do {
+        f();
+        reps++;
+        elapsed_ms = std::chrono::duration<f64, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    } while (elapsed_ms < MIN_TIME_MS);
+
+    return ((f64) bins * reps) / (elapsed_ms * 1e3);
+}
+
+// RFFT of lines real signals of odd order N: one complex FFT of order N for each line, which is how
+// exec_rfft transformed odd orders, vs one for each pair of lines with dsc_real_fft_pair.
+// Short transforms are batched in both cases.
+template<typename T>
+static bool test_rfft_pairs(const int n, const int lines) noexcept {
+    const dsc_dtype dtype = dsc_is_type<T, c32>() ? F32 : F64;
+    const dsc_fft_algorithm algorithm = dsc_fft_choose_algorithm(n);
+    dsc_fft_plan *plan = make_plan(n, COMPLEX, algorithm, dtype);
+    const int n_bins = (n >> 1) + 1;
+    const int pairs = lines >> 1;
+    const bool batched = algorithm == STOCKHAM && n <= DSC_FFT_BATCH_MAX_N;
+
+    real<T> *x = (real<T> *) malloc(n * lines * sizeof(real<T>));
+    T *y_line = (T *) malloc(n_bins * lines * sizeof(T));
+    T *y_pair = (T *) malloc(n_bins * lines * sizeof(T));
+    T *buff = (T *) malloc((n + 1) * lines * sizeof(T));
+    T *work = (T *) malloc(dsc_fft_work_size(n, algorithm) * lines * sizeof(T));
+
+    fill_random(x, n * lines);
+
+    const auto per_line = [&]() {
+        const int batch = batched ? lines : 1;
+        for (int l0 = 0; l0 < lines; l0 += batch) {
+            for (int i = 0; i < n; ++i) {
+                for (int b = 0; b < batch; ++b) buff[i * batch + b] = dsc_complex(T, x[(l0 + b) * n + i], 0);
+            }
+            if (batch == 1) dsc_complex_fft<T, true>(plan, buff, work);
+            else dsc_complex_fft_batch<T, true>(plan, buff, work, batch);
+            for (int k = 0; k < n_bins; ++k) {
+                for (int b = 0; b < batch; ++b) y_line[(l0 + b) * n_bins + k] = buff[k * batch + b];
+            }
+        }
+    };
+    const auto paired = [&]() {
+        const int batch = batched ? pairs : 1;
+        for (int p0 = 0; p0 < pairs; p0 += batch) {
+            for (int i = 0; i < n; ++i) {
+                for (int b = 0; b < batch; ++b)
+                    buff[i * batch + b] = dsc_complex(T, x[2 * (p0 + b) * n + i], x[(2 * (p0 + b) + 1) * n + i]);
+            }
+            dsc_real_fft_pair<T, true>(plan, buff, work, batch);
+            for (int k = 0; k < n_bins; ++k) {
+                for (int b = 0; b < batch; ++b) {
+                    y_pair[2 * (p0 + b) * n_bins + k] = buff[k * batch + b];
+                    y_pair[(2 * (p0 + b) + 1) * n_bins + k] = buff[(n - k) * batch + b];
+                }
+            }
+        }
+    };
+
+    per_line();
+    paired();
+    f64 diff = 0, max_abs = 0;
+    for (int i = 0; i < n_bins * lines; ++i) {
+        diff = DSC_MAX(diff, std::abs((f64) (y_line[i].real - y_pair[i].real)));
+        diff = DSC_MAX(diff, std::abs((f64) (y_line[i].imag - y_pair[i].imag)));
+        max_abs = DSC_MAX(max_abs, std::abs((f64) y_line[i].real));
+    }
+    diff /= max_abs;
+
+    const f64 mbins_line = mbins((i64) n_bins * lines, per_line);
+    const f64 mbins_pair = mbins((i64) n_bins * lines, paired);
+
+    const bool ok = diff < (dsc_is_type<T, c32>() ? tolerance_c32 : tolerance);
+    printf("%8d | %5d | %9s | %9.2e | %10.0f %10.0f | %5.2fx %s\n",
+           n, lines, DSC_FFT_ALGORITHM_NAMES[algorithm], diff, mbins_line, mbins_pair, mbins_pair / mbins_line, ok ? "" : "FAILED");
+
+    free(x);
+    free(y_line);
+    free(y_pair);
+    free(buff);
+    free(work);
+    free(plan);
+
+    return ok;
+}
+
+static bool test_rfft(const int n, const bool four_step = false) noexcept {
+    // n is the number of real samples, the RFFT plan has order n/2
+    const dsc_fft_algorithm algorithm = four_step ? FOUR_STEP : dsc_fft_choose_algorithm(n >> 1);
+    dsc_fft_plan *plan = make_plan(n >> 1, REAL, algorithm);
+    rfft_plan pocket_plan = make_rfft_plan(n);
+
+    f64 *x = (f64 *) malloc(n * sizeof(f64));
+    f64 *x_pocket = (f64 *) malloc(n * sizeof(f64));
+    c64 *x_dsc = (c64 *) malloc(((n >> 1) + 1) * sizeof(c64));
+    c64 *work = (c64 *) malloc(dsc_fft_work_size(n >> 1, algorithm) * sizeof(c64));
+
+    fill_random(x, n);
+    memcpy(x_pocket, x, n * sizeof(f64));
+    rfft_forward(pocket_plan, x_pocket, 1.);
+
+    f64 diff = 0, diff_inverse = 0;
+    for (int isa = SCALAR; isa <= dsc_simd_detect(); ++isa) {
+        plan->kernels = dsc_fft_get_kernels((dsc_simd_isa) isa);
+
+        memcpy(x_dsc, x, n * sizeof(f64));
+        dsc_real_fft<c64, true>(plan, x_dsc, work);
+
+        // pocketfft output is [r0, r1, i1, ..., r(n/2)]
+        diff = DSC_MAX(diff, std::abs(x_dsc[0].real - x_pocket[0]));
+        for (int k = 1; k < (n >> 1); ++k) {
+            diff = DSC_MAX(diff, std::abs(x_dsc[k].real - x_pocket[2 * k - 1]));
+            diff = DSC_MAX(diff, std::abs(x_dsc[k].imag - x_pocket[2 * k]));
+        }
+        diff = DSC_MAX(diff, std::abs(x_dsc[n >> 1].real - x_pocket[n - 1]));
+
+        dsc_real_fft<c64, false>(plan, x_dsc, work);
+        diff_inverse = DSC_MAX(diff_inverse, max_diff((f64 *) x_dsc, x, n));
+    }
+
+    const bool ok = diff < tolerance && diff_inverse < tolerance;
+    printf("%8d | %9s | %9.2e %9.2e %s\n", n, DSC_FFT_ALGORITHM_NAMES[algorithm], diff, diff_inverse, ok ? "" : "FAILED");
+
+    free(x);
+    free(x_pocket);
+    free(x_dsc);
+    free(work);
+    destroy_rfft_plan(pocket_plan);
+    free(plan);
+
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+
+    printf("Complex FFT (c64) - MFLOPS of a forward + backward transform\n");
+    printf("%8s | %9s %9s %9s | %10s %10s %10s | %s\n",
+           "N", "err rec", "err stock", "err inv", "pocketfft", "recursive", "stockham", "stockham/recursive");
+    for (int log2_n = MIN_LOG2_N; log2_n <= MAX_LOG2_N; ++log2_n)
+        ok &= test_fft(1 << log2_n);
+
+    printf("\nComplex FFT (c64) - arbitrary N\n");
+    printf("%8s | %9s | %9s %9s | %10s %10s\n", "N", "algorithm", "err", "err inv", "pocketfft", "dsc");
+    static constexpr int any_n[] = {3, 5, 7, 11, 12, 60, 100, 105, 243, 1000, 1009, 3000, 4099, 30030, 100000, 1000003};
+    for (const int n : any_n)
+        ok &= test_any_fft(n);
+
+    printf("\nComplex FFT - c32 | c64 MFLOPS of a forward + backward transform for each instruction set (CPU: %s)\n",
+           DSC_SIMD_ISA_NAMES[dsc_simd_detect()]);
+    printf("%8s | %9s %9s |", "N", "err c32", "err c64");
+    for (int isa = SCALAR; isa <= AVX512; ++isa) printf(" %8s", DSC_SIMD_ISA_NAMES[isa]);
+    printf(" |");
+    for (int isa = SCALAR; isa <= AVX512; ++isa) printf(" %8s", DSC_SIMD_ISA_NAMES[isa]);
+    printf("\n");
+    static constexpr int simd_n[] = {8, 64, 1024, 4096, 16384, 65536, 60, 105, 1000, 3003, 1009, 1 << 18};
+    for (const int n : simd_n)
+        ok &= test_simd(n);
+
+    printf("\nLarge FFT - GFLOPS of a forward + backward transform, Stockham vs four-step\n");
+    for (const dsc_dtype dtype : {C32, C64}) {
+        printf("%s\n", DSC_DTYPE_NAMES[dtype]);
+        printf("%8s | %13s | %9s %9s %9s | %8s %8s | %s\n",
+               "N", "N1 x N2", "err stock", "err 4step", "err inv", "stockham", "4-step", "4-step/stockham");
+        static constexpr int large_n[] = {1 << 16, 1 << 18, 1 << 20, 1 << 22, 1 << 24, 3 << 20, 1594323, 10000000};
+        for (const int n : large_n) {
+            if (dtype == C32) ok &= test_large<c32>(n);
+            else ok &= test_large<c64>(n);
+        }
+    }
+
+    printf("\nBatched FFT - MFLOPS of a forward transform of batch interleaved lines, one line at a time vs batched\n");
+    for (const dsc_dtype dtype : {C32, C64}) {
+        printf("%s\n", DSC_DTYPE_NAMES[dtype]);
+        printf("%8s | %5s | %9s | %10s %10s | %s\n", "N", "batch", "err", "per-line", "batched", "batched/per-line");
+        for (const int n : {16, 64, 256, 512, 1024, 2048, 60, 240}) {
+            for (const int batch : {2, 4, 8, 16, 32}) {
+                if (dtype == C32) ok &= test_batch<c32>(n, batch);
+                else ok &= test_batch<c64>(n, batch);
+            }
+        }
+    }
+
+    printf("\nReal FFT (f64)\n");
+    printf("%8s | %9s | %9s %9s\n", "N", "algorithm", "err", "err inv");
+    for (int log2_n = MIN_LOG2_N; log2_n <= MAX_LOG2_N; ++log2_n)
+        ok &= test_rfft(1 << log2_n);
+    // Even N with an odd N/2
+    static constexpr int rfft_n[] = {6, 30, 2000, 2 * 1009};
+    for (const int n : rfft_n)
+        ok &= test_rfft(n);
+    static constexpr int rfft_four_step_n[] = {1 << 18, 3 << 17, 2 * 15625};
+    for (const int n : rfft_four_step_n)
+        ok &= test_rfft(n, true);
+
+    printf("\nTwo-for-one RFFT - millions of bins per second of the RFFT of odd order, one FFT per line vs per pair of lines\n");
+    for (const dsc_dtype dtype : {C32, C64}) {
+        printf("%s\n", DSC_DTYPE_NAMES[dtype]);
+        printf("%8s | %5s | %9s | %9s | %10s %10s | %s\n", "N", "lines", "algorithm", "err", "per-line", "pairs", "pairs/per-line");
+        for (const int n : {15, 63, 255, 1001, 4095, 10007, 65535}) {
+            if (dtype == C32) ok &= test_rfft_pairs<c32>(n, 32);
+            else ok &= test_rfft_pairs<c64>(n, 32);
+        }
+    }
+
+    // Make sure the public API works as well
+    dsc_ctx *ctx = dsc_ctx_init(DSC_MB(64), DSC_MB(64));
+    {
+        constexpr int n = 1024;
+        dsc_tensor *x = dsc_tensor_1d(ctx, C64, n);
+        fill_random((f64 *) x->data, 2 * n);
+        dsc_tensor *x_fft = dsc_fft(ctx, x);
+        dsc_tensor *x_ifft = dsc_ifft(ctx, x_fft);
+        const f64 diff = max_diff((f64 *) x_ifft->data, (f64 *) x->data, 2 * n);
+        printf("\ndsc_ifft(dsc_fft(x)) diff= %.2e\n", diff);
+        ok &= diff < tolerance;
+    }
     dsc_ctx_free(ctx);
-}
\ No newline at end of file
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -4,7 +4,18 @@
 # This code is licensed under the terms of the 3-clause BSD license
 # (https://opensource.org/license/bsd-3-clause).
 
-from dsc.context import init, clear
+from dsc.context import (
+    init,
+    clear,
+    set_threads,
+    get_threads,
+    set_math_precision,
+    get_math_precision,
+    lazy,
+    fft_cache_stats,
+    export_wisdom,
+    import_wisdom,
+)
 from dsc.tensor import (
     Tensor,
     from_numpy,
@@ -31,8 +42,24 @@ from dsc.tensor import (
     ifft,
     rfft,
     irfft,
+    fftn,
+    ifftn,
+    rfftn,
+    irfftn,
+    fft2,
+    ifft2,
+    rfft2,
+    irfft2,
     fftfreq,
     rfftfreq,
+    convolve,
+    correlate,
+    goertzel,
+    czt,
+    zoom_fft,
+    welch,
+    csd,
+    hilbert,
     add,
     sub,
     mul,
@@ -53,5 +80,9 @@ from dsc.tensor import (
     empty,
     empty_like,
 )
+from dsc.stft import STFT, ISTFT
+from dsc.conv import ConvStream
+from dsc.sdft import SlidingDFT
+from dsc.channelizer import Channelizer
 from dsc.dtype import Dtype
 from dsc.profiler import profile, start_recording, stop_recording
@@ -11,6 +11,7 @@ from ctypes import (
     c_char_p,
     c_int,
     c_uint8,
+    c_uint64,
     c_size_t,
     c_float,
     c_double,
@@ -24,8 +25,30 @@ from .dtype import Dtype
 
 _DSC_MAX_DIMS = 4
 _DSC_VALUE_NONE = 2**31 - 1
+# Values of dsc_fft_type
+_DSC_FFT_REAL = 0
+_DSC_FFT_COMPLEX = 1
+# Values of dsc_plan_mode
+_DSC_PLAN_ESTIMATE = 0
+_DSC_PLAN_MEASURE = 1
+# Values of dsc_conv_mode
+_DSC_CONV_MODES = {'full': 0, 'same': 1, 'valid': 2}
+_DSC_PSD_SCALINGS = {'density': 0, 'spectrum': 1}
+# Values of dsc_math_precision
+_DSC_MATH_PRECISIONS = {'accurate': 0, 'fast': 1}
+# Values of dsc_fused_op_type
+_DSC_FUSED_OPS = {
+    'add': 0, 'sub': 1, 'mul': 2, 'div': 3, 'pow': 4,
+    'cos': 5, 'sin': 6, 'sinc': 7, 'logn': 8, 'log2': 9, 'log10': 10, 'exp': 11, 'sqrt': 12,
+}
+_DSC_MAX_FUSED_INPUTS = 8
+_DSC_MAX_FUSED_OPS = 16
 
 _DscCtx = c_void_p
+_DscStft_p = c_void_p
+_DscConvStream_p = c_void_p
+_DscSdft_p = c_void_p
+_DscChannelizer_p = c_void_p
 
 # Todo: make this more flexible
 _lib_file = f'{os.path.dirname(__file__)}/libdsc.so'
@@ -73,23 +96,62 @@ class _DscSlice(Structure):
     _fields_ = [('start', c_int), ('stop', c_int), ('step', c_int)]
 
 
-# extern dsc_ctx *dsc_ctx_init(usize main_mem, usize scratch_mem) noexcept;
-def _dsc_ctx_init(main_mem: int, scratch_mem: int) -> _DscCtx:
-    return _lib.dsc_ctx_init(c_size_t(main_mem), c_size_t(scratch_mem))
+class _DscFusedOp(Structure):
+    _fields_ = [('type', c_uint8), ('a', c_int), ('b', c_int)]
 
 
-_lib.dsc_ctx_init.argtypes = [c_size_t, c_size_t]
+class _DscFftCacheStats(Structure):
+    _fields_ = [
+        ('hits', c_uint64),
+        ('misses', c_uint64),
+        ('evictions', c_uint64),
+        ('size', c_int),
+        ('capacity', c_int),
+        ('twiddle_sets', c_int),
+        ('twiddle_bytes', c_size_t),
+    ]
+
+
+# extern dsc_ctx *dsc_ctx_init(usize main_mem, usize scratch_mem,
+#                              int max_fft_plans = -1, int n_threads = 1) noexcept;
+def _dsc_ctx_init(main_mem: int, scratch_mem: int, max_fft_plans: int = -1, n_threads: int = 1) -> _DscCtx:
+    return _lib.dsc_ctx_init(c_size_t(main_mem), c_size_t(scratch_mem), c_int(max_fft_plans), c_int(n_threads))
+
+
+_lib.dsc_ctx_init.argtypes = [c_size_t, c_size_t, c_int, c_int]
 _lib.dsc_ctx_init.restype = _DscCtx
 
 
+# extern bool dsc_export_wisdom(dsc_ctx *ctx, const char *filename) noexcept;
+def _dsc_export_wisdom(ctx: _DscCtx, filename: str) -> bool:
+    return _lib.dsc_export_wisdom(ctx, c_char_p(filename.encode('utf-8')))
+
+
+_lib.dsc_export_wisdom.argtypes = [_DscCtx, c_char_p]
+_lib.dsc_export_wisdom.restype = c_bool
+
+
+# extern bool dsc_import_wisdom(dsc_ctx *ctx, const char *filename) noexcept;
+def _dsc_import_wisdom(ctx: _DscCtx, filename: str) -> bool:
+    return _lib.dsc_import_wisdom(ctx, c_char_p(filename.encode('utf-8')))
+
+
+_lib.dsc_import_wisdom.argtypes = [_DscCtx, c_char_p]
+_lib.dsc_import_wisdom.restype = c_bool
+
+
 # extern dsc_fft_plan *dsc_plan_fft(dsc_ctx *ctx,
-#                                   const int n,
-#                                   const dsc_dtype dtype) noexcept;
-def _dsc_plan_fft(ctx: _DscCtx, n: int, dtype: Dtype):
-    return _lib.dsc_plan_fft(ctx, c_int(n), c_uint8(dtype.value))
+#                                   int n,
+#                                   dsc_fft_type fft_type,
+#                                   dsc_dtype dtype,
+#                                   dsc_plan_mode mode,
+#                                   int batch) noexcept;
+def _dsc_plan_fft(ctx: _DscCtx, n: int, fft_type: int, dtype: Dtype, mode: int = _DSC_PLAN_ESTIMATE,
+                  batch: int = 1):
+    return _lib.dsc_plan_fft(ctx, c_int(n), c_uint8(fft_type), c_uint8(dtype.value), c_uint8(mode), c_int(batch))
 
 
-_lib.dsc_plan_fft.argtypes = [_DscCtx, c_int, c_uint8]
+_lib.dsc_plan_fft.argtypes = [_DscCtx, c_int, c_uint8, c_uint8, c_uint8, c_int]
 _lib.dsc_plan_fft.restype = c_void_p
 
 
@@ -138,6 +200,51 @@ _lib.dsc_print_mem_usage.argtypes = [_DscCtx]
 _lib.dsc_print_mem_usage.restype = None
 
 
+# extern void dsc_set_threads(dsc_ctx *ctx, int n_threads) noexcept;
+def _dsc_set_threads(ctx: _DscCtx, n_threads: int):
+    _lib.dsc_set_threads(ctx, c_int(n_threads))
+
+
+_lib.dsc_set_threads.argtypes = [_DscCtx, c_int]
+_lib.dsc_set_threads.restype = None
+
+
+# extern int dsc_get_threads(dsc_ctx *ctx) noexcept;
+def _dsc_get_threads(ctx: _DscCtx) -> int:
+    return _lib.dsc_get_threads(ctx)
+
+
+_lib.dsc_get_threads.argtypes = [_DscCtx]
+_lib.dsc_get_threads.restype = c_int
+
+
+# extern void dsc_set_math_precision(dsc_ctx *ctx, dsc_math_precision precision) noexcept;
+def _dsc_set_math_precision(ctx: _DscCtx, precision: int):
+    _lib.dsc_set_math_precision(ctx, c_uint8(precision))
+
+
+_lib.dsc_set_math_precision.argtypes = [_DscCtx, c_uint8]
+_lib.dsc_set_math_precision.restype = None
+
+
+# extern dsc_math_precision dsc_get_math_precision(dsc_ctx *ctx) noexcept;
+def _dsc_get_math_precision(ctx: _DscCtx) -> int:
+    return _lib.dsc_get_math_precision(ctx)
+
+
+_lib.dsc_get_math_precision.argtypes = [_DscCtx]
+_lib.dsc_get_math_precision.restype = c_uint8
+
+
+# extern dsc_fft_cache_stats dsc_get_fft_cache_stats(dsc_ctx *ctx) noexcept;
+def _dsc_get_fft_cache_stats(ctx: _DscCtx) -> _DscFftCacheStats:
+    return _lib.dsc_get_fft_cache_stats(ctx)
+
+
+_lib.dsc_get_fft_cache_stats.argtypes = [_DscCtx]
+_lib.dsc_get_fft_cache_stats.restype = _DscFftCacheStats
+
+
 # extern void dsc_traces_record(dsc_ctx *ctx, bool record) noexcept;
 def _dsc_traces_record(ctx: _DscCtx, record: bool):
     _lib.dsc_traces_record(ctx, c_bool(record))
@@ -547,6 +654,24 @@ _lib.dsc_sqrt.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p]
 _lib.dsc_sqrt.restype = _DscTensor_p
 
 
+# extern dsc_tensor *dsc_fused(dsc_ctx *ctx,
+#                              int n_inputs,
+#                              dsc_tensor **inputs,
+#                              int n_ops,
+#                              const dsc_fused_op *ops,
+#                              dsc_tensor *out = nullptr) noexcept;
+def _dsc_fused(
+    ctx: _DscCtx, inputs: list[_DscTensor_p], ops: list[tuple[int, int, int]], out: _OptionalTensor
+) -> _DscTensor_p:
+    inputs_arr = (_DscTensor_p * len(inputs))(*inputs)
+    ops_arr = (_DscFusedOp * len(ops))(*[_DscFusedOp(op_type, a, b) for op_type, a, b in ops])
+    return _lib.dsc_fused(ctx, c_int(len(inputs)), inputs_arr, c_int(len(ops)), ops_arr, out)
+
+
+_lib.dsc_fused.argtypes = [_DscCtx, c_int, POINTER(_DscTensor_p), c_int, POINTER(_DscFusedOp), _DscTensor_p]
+_lib.dsc_fused.restype = _DscTensor_p
+
+
 # extern dsc_tensor *dsc_abs(dsc_ctx *,
 #                             const dsc_tensor *__restrict x,
 #                             dsc_tensor *__restrict out = nullptr) noexcept;
@@ -687,14 +812,24 @@ _lib.dsc_min.restype = _DscTensor_p
 #                            const dsc_tensor *DSC_RESTRICT x,
 #                            dsc_tensor *DSC_RESTRICT out,
 #                            int n = -1,
-#                            int axis = -1) noexcept;
+#                            int axis = -1,
+#                            int bin_start = 0,
+#                            int bin_stop = -1) noexcept;
 def _dsc_fft(
-    ctx: _DscCtx, x: _DscTensor_p, out: _OptionalTensor, n: int, axis: int
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: int,
+    axis: int,
+    bin_start: int = 0,
+    bin_stop: int = -1,
 ) -> _DscTensor_p:
-    return _lib.dsc_fft(ctx, x, out, c_int(n), c_int(axis))
+    return _lib.dsc_fft(
+        ctx, x, out, c_int(n), c_int(axis), c_int(bin_start), c_int(bin_stop)
+    )
 
 
-_lib.dsc_fft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int]
+_lib.dsc_fft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int, c_int, c_int]
 _lib.dsc_fft.restype = _DscTensor_p
 
 
@@ -702,14 +837,24 @@ _lib.dsc_fft.restype = _DscTensor_p
 #                             const dsc_tensor *DSC_RESTRICT x,
 #                             dsc_tensor *DSC_RESTRICT out,
 #                             int n = -1,
-#                             int axis = -1) noexcept;
+#                             int axis = -1,
+#                             int bin_start = 0,
+#                             int bin_stop = -1) noexcept;
 def _dsc_ifft(
-    ctx: _DscCtx, x: _DscTensor_p, out: _OptionalTensor, n: int, axis: int
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: int,
+    axis: int,
+    bin_start: int = 0,
+    bin_stop: int = -1,
 ) -> _DscTensor_p:
-    return _lib.dsc_ifft(ctx, x, out, c_int(n), c_int(axis))
+    return _lib.dsc_ifft(
+        ctx, x, out, c_int(n), c_int(axis), c_int(bin_start), c_int(bin_stop)
+    )
 
 
-_lib.dsc_ifft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int]
+_lib.dsc_ifft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int, c_int, c_int]
 _lib.dsc_ifft.restype = _DscTensor_p
 
 
@@ -717,14 +862,24 @@ _lib.dsc_ifft.restype = _DscTensor_p
 #                             const dsc_tensor *DSC_RESTRICT x,
 #                             dsc_tensor *DSC_RESTRICT out,
 #                             int n = -1,
-#                             int axis = -1) noexcept;
+#                             int axis = -1,
+#                             int bin_start = 0,
+#                             int bin_stop = -1) noexcept;
 def _dsc_rfft(
-    ctx: _DscCtx, x: _DscTensor_p, out: _OptionalTensor, n: int, axis: int
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: int,
+    axis: int,
+    bin_start: int = 0,
+    bin_stop: int = -1,
 ) -> _DscTensor_p:
-    return _lib.dsc_rfft(ctx, x, out, c_int(n), c_int(axis))
+    return _lib.dsc_rfft(
+        ctx, x, out, c_int(n), c_int(axis), c_int(bin_start), c_int(bin_stop)
+    )
 
 
-_lib.dsc_rfft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int]
+_lib.dsc_rfft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int, c_int, c_int]
 _lib.dsc_rfft.restype = _DscTensor_p
 
 
@@ -743,6 +898,96 @@ _lib.dsc_irfft.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, c_int]
 _lib.dsc_irfft.restype = _DscTensor_p
 
 
+def _fftn_args(n: Union[tuple[int, ...], None], axes: Union[tuple[int, ...], None]):
+    # Like NumPy: if only n is given the transform is over the last len(n) axes
+    if n is not None and axes is not None and len(n) != len(axes):
+        raise ValueError('n and axes must have the same length')
+    n_axes = len(axes) if axes is not None else (len(n) if n is not None else -1)
+    n_arr = (c_int * len(n))(*n) if n is not None else None
+    axes_arr = (c_int * len(axes))(*axes) if axes is not None else None
+    return c_int(n_axes), n_arr, axes_arr
+
+
+# extern dsc_tensor *dsc_fftn(dsc_ctx *ctx,
+#                             const dsc_tensor *DSC_RESTRICT x,
+#                             dsc_tensor *DSC_RESTRICT out = nullptr,
+#                             int n_axes = -1,
+#                             const int *n = nullptr,
+#                             const int *axes = nullptr) noexcept;
+def _dsc_fftn(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: Union[tuple[int, ...], None],
+    axes: Union[tuple[int, ...], None],
+) -> _DscTensor_p:
+    return _lib.dsc_fftn(ctx, x, out, *_fftn_args(n, axes))
+
+
+_lib.dsc_fftn.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, POINTER(c_int), POINTER(c_int)]
+_lib.dsc_fftn.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_ifftn(dsc_ctx *ctx,
+#                              const dsc_tensor *DSC_RESTRICT x,
+#                              dsc_tensor *DSC_RESTRICT out = nullptr,
+#                              int n_axes = -1,
+#                              const int *n = nullptr,
+#                              const int *axes = nullptr) noexcept;
+def _dsc_ifftn(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: Union[tuple[int, ...], None],
+    axes: Union[tuple[int, ...], None],
+) -> _DscTensor_p:
+    return _lib.dsc_ifftn(ctx, x, out, *_fftn_args(n, axes))
+
+
+_lib.dsc_ifftn.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, POINTER(c_int), POINTER(c_int)]
+_lib.dsc_ifftn.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_rfftn(dsc_ctx *ctx,
+#                              const dsc_tensor *DSC_RESTRICT x,
+#                              dsc_tensor *DSC_RESTRICT out = nullptr,
+#                              int n_axes = -1,
+#                              const int *n = nullptr,
+#                              const int *axes = nullptr) noexcept;
+def _dsc_rfftn(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: Union[tuple[int, ...], None],
+    axes: Union[tuple[int, ...], None],
+) -> _DscTensor_p:
+    return _lib.dsc_rfftn(ctx, x, out, *_fftn_args(n, axes))
+
+
+_lib.dsc_rfftn.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, POINTER(c_int), POINTER(c_int)]
+_lib.dsc_rfftn.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_irfftn(dsc_ctx *ctx,
+#                               const dsc_tensor *DSC_RESTRICT x,
+#                               dsc_tensor *DSC_RESTRICT out = nullptr,
+#                               int n_axes = -1,
+#                               const int *n = nullptr,
+#                               const int *axes = nullptr) noexcept;
+def _dsc_irfftn(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: Union[tuple[int, ...], None],
+    axes: Union[tuple[int, ...], None],
+) -> _DscTensor_p:
+    return _lib.dsc_irfftn(ctx, x, out, *_fftn_args(n, axes))
+
+
+_lib.dsc_irfftn.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, c_int, POINTER(c_int), POINTER(c_int)]
+_lib.dsc_irfftn.restype = _DscTensor_p
+
+
 # extern dsc_tensor *dsc_fftfreq(dsc_ctx *ctx,
 #                                int n,
 #                                f64 d = 1.,
@@ -765,3 +1010,490 @@ def _dsc_rfftfreq(ctx: _DscCtx, n: int, d: float, dtype: Dtype) -> _DscTensor_p:
 
 _lib.dsc_rfftfreq.argtypes = [_DscCtx, c_int, c_double, c_uint8]
 _lib.dsc_rfftfreq.restype = _DscTensor_p
+
+
+# extern dsc_stft *dsc_stft_init(dsc_ctx *ctx,
+#                                int n_fft,
+#                                int hop,
+#                                int ring_n,
+#                                const dsc_tensor *DSC_RESTRICT window = nullptr,
+#                                dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+def _dsc_stft_init(
+    ctx: _DscCtx,
+    n_fft: int,
+    hop: int,
+    ring_n: int,
+    window: _OptionalTensor,
+    dtype: Dtype,
+) -> _DscStft_p:
+    return _lib.dsc_stft_init(
+        ctx, c_int(n_fft), c_int(hop), c_int(ring_n), window, c_uint8(dtype.value)
+    )
+
+
+_lib.dsc_stft_init.argtypes = [_DscCtx, c_int, c_int, c_int, _DscTensor_p, c_uint8]
+_lib.dsc_stft_init.restype = _DscStft_p
+
+
+# extern dsc_stft *dsc_istft_init(dsc_ctx *ctx,
+#                                 int n_fft,
+#                                 int hop,
+#                                 int ring_n,
+#                                 const dsc_tensor *DSC_RESTRICT window = nullptr,
+#                                 dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+def _dsc_istft_init(
+    ctx: _DscCtx,
+    n_fft: int,
+    hop: int,
+    ring_n: int,
+    window: _OptionalTensor,
+    dtype: Dtype,
+) -> _DscStft_p:
+    return _lib.dsc_istft_init(
+        ctx, c_int(n_fft), c_int(hop), c_int(ring_n), window, c_uint8(dtype.value)
+    )
+
+
+_lib.dsc_istft_init.argtypes = [_DscCtx, c_int, c_int, c_int, _DscTensor_p, c_uint8]
+_lib.dsc_istft_init.restype = _DscStft_p
+
+
+# extern int dsc_stft_push(dsc_ctx *ctx,
+#                          dsc_stft *stft,
+#                          const dsc_tensor *DSC_RESTRICT x) noexcept;
+def _dsc_stft_push(ctx: _DscCtx, stft: _DscStft_p, x: _DscTensor_p) -> int:
+    return _lib.dsc_stft_push(ctx, stft, x)
+
+
+_lib.dsc_stft_push.argtypes = [_DscCtx, _DscStft_p, _DscTensor_p]
+_lib.dsc_stft_push.restype = c_int
+
+
+# extern dsc_tensor *dsc_stft_ring(dsc_stft *stft) noexcept;
+def _dsc_stft_ring(stft: _DscStft_p) -> _DscTensor_p:
+    return _lib.dsc_stft_ring(stft)
+
+
+_lib.dsc_stft_ring.argtypes = [_DscStft_p]
+_lib.dsc_stft_ring.restype = _DscTensor_p
+
+
+# extern u64 dsc_stft_count(const dsc_stft *stft) noexcept;
+def _dsc_stft_count(stft: _DscStft_p) -> int:
+    return _lib.dsc_stft_count(stft)
+
+
+_lib.dsc_stft_count.argtypes = [_DscStft_p]
+_lib.dsc_stft_count.restype = c_uint64
+
+
+# extern void dsc_stft_reset(dsc_stft *stft) noexcept;
+def _dsc_stft_reset(stft: _DscStft_p):
+    _lib.dsc_stft_reset(stft)
+
+
+_lib.dsc_stft_reset.argtypes = [_DscStft_p]
+_lib.dsc_stft_reset.restype = None
+
+
+# extern void dsc_stft_free(dsc_ctx *ctx, dsc_stft *stft) noexcept;
+def _dsc_stft_free(ctx: _DscCtx, stft: _DscStft_p):
+    _lib.dsc_stft_free(ctx, stft)
+
+
+_lib.dsc_stft_free.argtypes = [_DscCtx, _DscStft_p]
+_lib.dsc_stft_free.restype = None
+
+
+# extern dsc_tensor *dsc_convolve(dsc_ctx *ctx,
+#                                 const dsc_tensor *DSC_RESTRICT x,
+#                                 const dsc_tensor *DSC_RESTRICT h,
+#                                 dsc_tensor *DSC_RESTRICT out = nullptr,
+#                                 dsc_conv_mode mode = FULL) noexcept;
+def _dsc_convolve(
+    ctx: _DscCtx, x: _DscTensor_p, h: _DscTensor_p, out: _OptionalTensor, mode: int
+) -> _DscTensor_p:
+    return _lib.dsc_convolve(ctx, x, h, out, c_uint8(mode))
+
+
+_lib.dsc_convolve.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, _DscTensor_p, c_uint8]
+_lib.dsc_convolve.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_correlate(dsc_ctx *ctx,
+#                                  const dsc_tensor *DSC_RESTRICT x,
+#                                  const dsc_tensor *DSC_RESTRICT h,
+#                                  dsc_tensor *DSC_RESTRICT out = nullptr,
+#                                  dsc_conv_mode mode = VALID) noexcept;
+def _dsc_correlate(
+    ctx: _DscCtx, x: _DscTensor_p, h: _DscTensor_p, out: _OptionalTensor, mode: int
+) -> _DscTensor_p:
+    return _lib.dsc_correlate(ctx, x, h, out, c_uint8(mode))
+
+
+_lib.dsc_correlate.argtypes = [_DscCtx, _DscTensor_p, _DscTensor_p, _DscTensor_p, c_uint8]
+_lib.dsc_correlate.restype = _DscTensor_p
+
+
+# extern dsc_conv_stream *dsc_conv_stream_init(dsc_ctx *ctx,
+#                                              const dsc_tensor *DSC_RESTRICT h,
+#                                              bool correlate = false) noexcept;
+def _dsc_conv_stream_init(
+    ctx: _DscCtx, h: _DscTensor_p, correlate: bool
+) -> _DscConvStream_p:
+    return _lib.dsc_conv_stream_init(ctx, h, c_bool(correlate))
+
+
+_lib.dsc_conv_stream_init.argtypes = [_DscCtx, _DscTensor_p, c_bool]
+_lib.dsc_conv_stream_init.restype = _DscConvStream_p
+
+
+# extern dsc_tensor *dsc_conv_stream_push(dsc_ctx *ctx,
+#                                         dsc_conv_stream *stream,
+#                                         const dsc_tensor *DSC_RESTRICT x,
+#                                         dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+def _dsc_conv_stream_push(
+    ctx: _DscCtx, stream: _DscConvStream_p, x: _DscTensor_p, out: _OptionalTensor
+) -> _DscTensor_p:
+    return _lib.dsc_conv_stream_push(ctx, stream, x, out)
+
+
+_lib.dsc_conv_stream_push.argtypes = [_DscCtx, _DscConvStream_p, _DscTensor_p, _DscTensor_p]
+_lib.dsc_conv_stream_push.restype = _DscTensor_p
+
+
+# extern void dsc_conv_stream_reset(dsc_conv_stream *stream) noexcept;
+def _dsc_conv_stream_reset(stream: _DscConvStream_p):
+    _lib.dsc_conv_stream_reset(stream)
+
+
+_lib.dsc_conv_stream_reset.argtypes = [_DscConvStream_p]
+_lib.dsc_conv_stream_reset.restype = None
+
+
+# extern void dsc_conv_stream_free(dsc_ctx *ctx, dsc_conv_stream *stream) noexcept;
+def _dsc_conv_stream_free(ctx: _DscCtx, stream: _DscConvStream_p):
+    _lib.dsc_conv_stream_free(ctx, stream)
+
+
+_lib.dsc_conv_stream_free.argtypes = [_DscCtx, _DscConvStream_p]
+_lib.dsc_conv_stream_free.restype = None
+
+
+# extern dsc_tensor *dsc_goertzel(dsc_ctx *ctx,
+#                                 const dsc_tensor *DSC_RESTRICT x,
+#                                 const int *bins,
+#                                 int n_bins,
+#                                 dsc_tensor *DSC_RESTRICT out = nullptr,
+#                                 int n = -1,
+#                                 int axis = -1) noexcept;
+def _dsc_goertzel(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    bins: tuple[int, ...],
+    out: _OptionalTensor,
+    n: int,
+    axis: int,
+) -> _DscTensor_p:
+    bins_arr = (c_int * len(bins))(*bins)
+    return _lib.dsc_goertzel(ctx, x, bins_arr, c_int(len(bins)), out, c_int(n), c_int(axis))
+
+
+_lib.dsc_goertzel.argtypes = [_DscCtx, _DscTensor_p, POINTER(c_int), c_int, _DscTensor_p, c_int, c_int]
+_lib.dsc_goertzel.restype = _DscTensor_p
+
+
+# extern dsc_sdft *dsc_sdft_init(dsc_ctx *ctx,
+#                                int n,
+#                                const int *bins,
+#                                int n_bins,
+#                                dsc_dtype dtype = DSC_DEFAULT_TYPE) noexcept;
+def _dsc_sdft_init(ctx: _DscCtx, n: int, bins: tuple[int, ...], dtype: Dtype) -> _DscSdft_p:
+    bins_arr = (c_int * len(bins))(*bins)
+    return _lib.dsc_sdft_init(ctx, c_int(n), bins_arr, c_int(len(bins)), c_uint8(dtype.value))
+
+
+_lib.dsc_sdft_init.argtypes = [_DscCtx, c_int, POINTER(c_int), c_int, c_uint8]
+_lib.dsc_sdft_init.restype = _DscSdft_p
+
+
+# extern dsc_tensor *dsc_sdft_push(dsc_ctx *ctx,
+#                                  dsc_sdft *sdft,
+#                                  const dsc_tensor *DSC_RESTRICT x,
+#                                  dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+def _dsc_sdft_push(
+    ctx: _DscCtx, sdft: _DscSdft_p, x: _DscTensor_p, out: _OptionalTensor
+) -> _DscTensor_p:
+    return _lib.dsc_sdft_push(ctx, sdft, x, out)
+
+
+_lib.dsc_sdft_push.argtypes = [_DscCtx, _DscSdft_p, _DscTensor_p, _DscTensor_p]
+_lib.dsc_sdft_push.restype = _DscTensor_p
+
+
+# extern void dsc_sdft_reset(dsc_sdft *sdft) noexcept;
+def _dsc_sdft_reset(sdft: _DscSdft_p):
+    _lib.dsc_sdft_reset(sdft)
+
+
+_lib.dsc_sdft_reset.argtypes = [_DscSdft_p]
+_lib.dsc_sdft_reset.restype = None
+
+
+# extern void dsc_sdft_free(dsc_ctx *ctx, dsc_sdft *sdft) noexcept;
+def _dsc_sdft_free(ctx: _DscCtx, sdft: _DscSdft_p):
+    _lib.dsc_sdft_free(ctx, sdft)
+
+
+_lib.dsc_sdft_free.argtypes = [_DscCtx, _DscSdft_p]
+_lib.dsc_sdft_free.restype = None
+
+
+# extern dsc_tensor *dsc_czt(dsc_ctx *ctx,
+#                            const dsc_tensor *DSC_RESTRICT x,
+#                            int m,
+#                            c64 w,
+#                            c64 a,
+#                            dsc_tensor *DSC_RESTRICT out = nullptr,
+#                            int axis = -1) noexcept;
+def _dsc_czt(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    m: int,
+    w: complex,
+    a: complex,
+    out: _OptionalTensor,
+    axis: int,
+) -> _DscTensor_p:
+    return _lib.dsc_czt(
+        ctx,
+        x,
+        c_int(m),
+        _C64(c_double(w.real), c_double(w.imag)),
+        _C64(c_double(a.real), c_double(a.imag)),
+        out,
+        c_int(axis),
+    )
+
+
+_lib.dsc_czt.argtypes = [_DscCtx, _DscTensor_p, c_int, _C64, _C64, _DscTensor_p, c_int]
+_lib.dsc_czt.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_zoom_fft(dsc_ctx *ctx,
+#                                 const dsc_tensor *DSC_RESTRICT x,
+#                                 int m,
+#                                 f64 f0,
+#                                 f64 f1,
+#                                 f64 fs = 2.,
+#                                 dsc_tensor *DSC_RESTRICT out = nullptr,
+#                                 int axis = -1) noexcept;
+def _dsc_zoom_fft(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    m: int,
+    f0: float,
+    f1: float,
+    fs: float,
+    out: _OptionalTensor,
+    axis: int,
+) -> _DscTensor_p:
+    return _lib.dsc_zoom_fft(
+        ctx, x, c_int(m), c_double(f0), c_double(f1), c_double(fs), out, c_int(axis)
+    )
+
+
+_lib.dsc_zoom_fft.argtypes = [
+    _DscCtx,
+    _DscTensor_p,
+    c_int,
+    c_double,
+    c_double,
+    c_double,
+    _DscTensor_p,
+    c_int,
+]
+_lib.dsc_zoom_fft.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_welch(dsc_ctx *ctx,
+#                              const dsc_tensor *DSC_RESTRICT x,
+#                              int nperseg,
+#                              int noverlap = -1,
+#                              const dsc_tensor *DSC_RESTRICT window = nullptr,
+#                              f64 fs = 1.,
+#                              dsc_psd_scaling scaling = DENSITY,
+#                              bool detrend = true,
+#                              dsc_tensor *DSC_RESTRICT out = nullptr,
+#                              int axis = -1) noexcept;
+def _dsc_welch(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    nperseg: int,
+    noverlap: int,
+    window: _OptionalTensor,
+    fs: float,
+    scaling: int,
+    detrend: bool,
+    out: _OptionalTensor,
+    axis: int,
+) -> _DscTensor_p:
+    return _lib.dsc_welch(
+        ctx,
+        x,
+        c_int(nperseg),
+        c_int(noverlap),
+        window,
+        c_double(fs),
+        c_uint8(scaling),
+        c_bool(detrend),
+        out,
+        c_int(axis),
+    )
+
+
+_lib.dsc_welch.argtypes = [
+    _DscCtx,
+    _DscTensor_p,
+    c_int,
+    c_int,
+    _DscTensor_p,
+    c_double,
+    c_uint8,
+    c_bool,
+    _DscTensor_p,
+    c_int,
+]
+_lib.dsc_welch.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_csd(dsc_ctx *ctx,
+#                            const dsc_tensor *DSC_RESTRICT x,
+#                            const dsc_tensor *DSC_RESTRICT y,
+#                            int nperseg,
+#                            int noverlap = -1,
+#                            const dsc_tensor *DSC_RESTRICT window = nullptr,
+#                            f64 fs = 1.,
+#                            dsc_psd_scaling scaling = DENSITY,
+#                            bool detrend = true,
+#                            dsc_tensor *DSC_RESTRICT out = nullptr,
+#                            int axis = -1) noexcept;
+def _dsc_csd(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    y: _DscTensor_p,
+    nperseg: int,
+    noverlap: int,
+    window: _OptionalTensor,
+    fs: float,
+    scaling: int,
+    detrend: bool,
+    out: _OptionalTensor,
+    axis: int,
+) -> _DscTensor_p:
+    return _lib.dsc_csd(
+        ctx,
+        x,
+        y,
+        c_int(nperseg),
+        c_int(noverlap),
+        window,
+        c_double(fs),
+        c_uint8(scaling),
+        c_bool(detrend),
+        out,
+        c_int(axis),
+    )
+
+
+_lib.dsc_csd.argtypes = [
+    _DscCtx,
+    _DscTensor_p,
+    _DscTensor_p,
+    c_int,
+    c_int,
+    _DscTensor_p,
+    c_double,
+    c_uint8,
+    c_bool,
+    _DscTensor_p,
+    c_int,
+]
+_lib.dsc_csd.restype = _DscTensor_p
+
+
+# extern dsc_tensor *dsc_hilbert(dsc_ctx *ctx,
+#                                const dsc_tensor *DSC_RESTRICT x,
+#                                dsc_tensor *DSC_RESTRICT out = nullptr,
+#                                int n = -1,
+#                                int axis = -1,
+#                                dsc_tensor *DSC_RESTRICT envelope = nullptr,
+#                                dsc_tensor *DSC_RESTRICT phase = nullptr) noexcept;
+def _dsc_hilbert(
+    ctx: _DscCtx,
+    x: _DscTensor_p,
+    out: _OptionalTensor,
+    n: int,
+    axis: int,
+    envelope: _OptionalTensor,
+    phase: _OptionalTensor,
+) -> _DscTensor_p:
+    return _lib.dsc_hilbert(ctx, x, out, c_int(n), c_int(axis), envelope, phase)
+
+
+_lib.dsc_hilbert.argtypes = [
+    _DscCtx,
+    _DscTensor_p,
+    _DscTensor_p,
+    c_int,
+    c_int,
+    _DscTensor_p,
+    _DscTensor_p,
+]
+_lib.dsc_hilbert.restype = _DscTensor_p
+
+
+# extern dsc_channelizer *dsc_channelizer_init(dsc_ctx *ctx,
+#                                              int channels,
+#                                              const dsc_tensor *DSC_RESTRICT h,
+#                                              dsc_dtype dtype = C32) noexcept;
+def _dsc_channelizer_init(
+    ctx: _DscCtx, channels: int, h: _DscTensor_p, dtype: Dtype
+) -> _DscChannelizer_p:
+    return _lib.dsc_channelizer_init(ctx, c_int(channels), h, c_uint8(dtype.value))
+
+
+_lib.dsc_channelizer_init.argtypes = [_DscCtx, c_int, _DscTensor_p, c_uint8]
+_lib.dsc_channelizer_init.restype = _DscChannelizer_p
+
+
+# extern dsc_tensor *dsc_channelizer_push(dsc_ctx *ctx,
+#                                         dsc_channelizer *channelizer,
+#                                         const dsc_tensor *DSC_RESTRICT x,
+#                                         dsc_tensor *DSC_RESTRICT out = nullptr) noexcept;
+def _dsc_channelizer_push(
+    ctx: _DscCtx, channelizer: _DscChannelizer_p, x: _DscTensor_p, out: _OptionalTensor
+) -> _DscTensor_p:
+    return _lib.dsc_channelizer_push(ctx, channelizer, x, out)
+
+
+_lib.dsc_channelizer_push.argtypes = [_DscCtx, _DscChannelizer_p, _DscTensor_p, _DscTensor_p]
+_lib.dsc_channelizer_push.restype = _DscTensor_p
+
+
+# extern void dsc_channelizer_reset(dsc_channelizer *channelizer) noexcept;
+def _dsc_channelizer_reset(channelizer: _DscChannelizer_p):
+    _lib.dsc_channelizer_reset(channelizer)
+
+
+_lib.dsc_channelizer_reset.argtypes = [_DscChannelizer_p]
+_lib.dsc_channelizer_reset.restype = None
+
+
+# extern void dsc_channelizer_free(dsc_ctx *ctx, dsc_channelizer *channelizer) noexcept;
+def _dsc_channelizer_free(ctx: _DscCtx, channelizer: _DscChannelizer_p):
+    _lib.dsc_channelizer_free(ctx, channelizer)
+
+
+_lib.dsc_channelizer_free.argtypes = [_DscCtx, _DscChannelizer_p]
+_lib.dsc_channelizer_free.restype = None
@@ -0,0 +1,41 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+from ._bindings import (
+    _dsc_channelizer_init,
+    _dsc_channelizer_push,
+    _dsc_channelizer_reset,
+    _dsc_channelizer_free,
+)
+from .context import _get_ctx
+from .dtype import Dtype
+from .tensor import Tensor, _c_ptr, _c_ptr_or_none, _has_out
+from typing import Union
+
+
+class Channelizer:
+    """
+    Polyphase filter bank that splits a stream in `channels` uniformly spaced channels using the real
+    prototype lowpass filter h. Channel k is centered at k * fs / channels (the same order of the FFT bins)
+    and decimated by `channels`. `push` takes a 1-dimensional tensor of the given dtype with a multiple of
+    `channels` samples and returns a complex [channels, len(x) // channels] tensor.
+    The filter state is kept between pushes, the stream starts with zeros.
+    """
+
+    def __init__(self, channels: int, h: Tensor, dtype: Dtype = Dtype.C32):
+        self._c_ptr = _dsc_channelizer_init(_get_ctx(), channels, _c_ptr(h), dtype)
+
+    def __del__(self):
+        _dsc_channelizer_free(_get_ctx(), self._c_ptr)
+
+    def push(self, x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+        return Tensor(
+            _dsc_channelizer_push(_get_ctx(), self._c_ptr, _c_ptr(x), _c_ptr_or_none(out)),
+            _has_out(out),
+        )
+
+    def reset(self):
+        _dsc_channelizer_reset(self._c_ptr)
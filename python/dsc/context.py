@@ -4,8 +4,22 @@
 # This code is licensed under the terms of the 3-clause BSD license
 # (https://opensource.org/license/bsd-3-clause).
 
-from ._bindings import _dsc_ctx_init, _dsc_ctx_clear, _dsc_ctx_free
+from ._bindings import (
+    _dsc_ctx_init,
+    _dsc_ctx_clear,
+    _dsc_ctx_free,
+    _dsc_set_threads,
+    _dsc_get_threads,
+    _dsc_set_math_precision,
+    _dsc_get_math_precision,
+    _DSC_MATH_PRECISIONS,
+    _dsc_get_fft_cache_stats,
+    _dsc_export_wisdom,
+    _dsc_import_wisdom,
+)
 import psutil
+from contextlib import contextmanager
+from typing import Union
 
 _ctx_instance = None
 
@@ -26,10 +40,13 @@ def _get_ctx():
     return _ctx_instance._ctx
 
 
-def init(main_mem: int, scratch_mem: int):
+def init(main_mem: int, scratch_mem: int, max_fft_plans: int = -1, wisdom: Union[str, None] = None,
+         n_threads: int = 1):
     global _ctx_instance
     if _ctx_instance is None:
-        _ctx_instance = _DscContext(main_mem, scratch_mem)
+        _ctx_instance = _DscContext(main_mem, scratch_mem, max_fft_plans, n_threads)
+        if wisdom is not None:
+            import_wisdom(wisdom)
     else:
         raise RuntimeWarning('Context already initialized')
 
@@ -40,9 +57,73 @@ def clear():
         _ctx_instance.clear()
 
 
+def set_threads(n_threads: int):
+    # Number of threads used by the FFTs, elementwise operations, reductions and copies,
+    # if n_threads <= 0 all the available CPUs are used
+    _dsc_set_threads(_get_ctx(), n_threads)
+
+
+def get_threads() -> int:
+    return _dsc_get_threads(_get_ctx())
+
+
+def set_math_precision(precision: str):
+    # 'accurate' computes cos, sin, sinc, exp and the logarithms with libm (default), 'fast' uses
+    # the SIMD implementations that are within 2.5 ULP of the correctly rounded result
+    _dsc_set_math_precision(_get_ctx(), _DSC_MATH_PRECISIONS[precision])
+
+
+def get_math_precision() -> str:
+    precision = _dsc_get_math_precision(_get_ctx())
+    return next(name for name, value in _DSC_MATH_PRECISIONS.items() if value == precision)
+
+
+@contextmanager
+def lazy():
+    # Inside this block add, sub, mul, true_div, power, cos, sin, sinc, logn, log2, log10, exp and sqrt
+    # (without out) only record the operation and return a Tensor that is computed the first time its data
+    # is used. A chain of these operations is then computed by dsc_fused in a single pass without allocating
+    # the intermediate results. The inputs must not be modified until the result has been used.
+    _get_ctx()
+    _ctx_instance.lazy += 1
+    try:
+        yield
+    finally:
+        _ctx_instance.lazy -= 1
+
+
+def _is_lazy() -> bool:
+    return _ctx_instance is not None and _ctx_instance.lazy > 0
+
+
+def export_wisdom(filename: str):
+    if not _dsc_export_wisdom(_get_ctx(), filename):
+        raise RuntimeError(f'error exporting FFT wisdom to "{filename}"')
+
+
+def import_wisdom(filename: str):
+    if not _dsc_import_wisdom(_get_ctx(), filename):
+        raise RuntimeError(f'error importing FFT wisdom from "{filename}"')
+
+
+def fft_cache_stats() -> dict:
+    stats = _dsc_get_fft_cache_stats(_get_ctx())
+    return {
+        'hits': stats.hits,
+        'misses': stats.misses,
+        'evictions': stats.evictions,
+        'size': stats.size,
+        'capacity': stats.capacity,
+        'twiddle_sets': stats.twiddle_sets,
+        'twiddle_bytes': stats.twiddle_bytes,
+    }
+
+
 class _DscContext:
-    def __init__(self, main_mem: int, scratch_mem: int):
-        self._ctx = _dsc_ctx_init(main_mem, scratch_mem)
+    def __init__(self, main_mem: int, scratch_mem: int, max_fft_plans: int = -1, n_threads: int = 1):
+        self._ctx = _dsc_ctx_init(main_mem, scratch_mem, max_fft_plans, n_threads)
+        # Depth of nested lazy() blocks
+        self.lazy = 0
 
     def __del__(self):
         _dsc_ctx_free(self._ctx)
@@ -0,0 +1,39 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+from ._bindings import (
+    _dsc_conv_stream_init,
+    _dsc_conv_stream_push,
+    _dsc_conv_stream_reset,
+    _dsc_conv_stream_free,
+)
+from .context import _get_ctx
+from .tensor import Tensor, _c_ptr, _c_ptr_or_none, _has_out
+from typing import Union
+
+
+class ConvStream:
+    """
+    Streaming convolution (or correlation if `correlate` is True) with the 1-dimensional kernel h.
+    The last len(h) - 1 samples of each push are kept so the outputs are the same as those of
+    a full convolution of the whole stream. `push` returns as many outputs as the samples pushed,
+    the samples must have the same dtype of h.
+    """
+
+    def __init__(self, h: Tensor, correlate: bool = False):
+        self._c_ptr = _dsc_conv_stream_init(_get_ctx(), _c_ptr(h), correlate)
+
+    def __del__(self):
+        _dsc_conv_stream_free(_get_ctx(), self._c_ptr)
+
+    def push(self, x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+        return Tensor(
+            _dsc_conv_stream_push(_get_ctx(), self._c_ptr, _c_ptr(x), _c_ptr_or_none(out)),
+            _has_out(out),
+        )
+
+    def reset(self):
+        _dsc_conv_stream_reset(self._c_ptr)
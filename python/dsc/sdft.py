@@ -0,0 +1,41 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+from ._bindings import (
+    _dsc_sdft_init,
+    _dsc_sdft_push,
+    _dsc_sdft_reset,
+    _dsc_sdft_free,
+)
+from .context import _get_ctx
+from .dtype import Dtype
+from .tensor import Tensor, _c_ptr, _c_ptr_or_none, _has_out
+from typing import Tuple, Union
+
+
+class SlidingDFT:
+    """
+    Sliding DFT of the last n samples of a stream, only the given bins are computed and each one is
+    updated in O(1) per sample. `push` takes a 1-dimensional tensor of L samples of the given dtype and
+    returns a complex [L, len(bins)] tensor, row i holds the bins of the window that ends with sample i.
+    The stream starts with n zeros.
+    """
+
+    def __init__(self, n: int, bins: Union[int, Tuple[int, ...]], dtype: Dtype = Dtype.F32):
+        bins = (bins,) if isinstance(bins, int) else tuple(bins)
+        self._c_ptr = _dsc_sdft_init(_get_ctx(), n, bins, dtype)
+
+    def __del__(self):
+        _dsc_sdft_free(_get_ctx(), self._c_ptr)
+
+    def push(self, x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+        return Tensor(
+            _dsc_sdft_push(_get_ctx(), self._c_ptr, _c_ptr(x), _c_ptr_or_none(out)),
+            _has_out(out),
+        )
+
+    def reset(self):
+        _dsc_sdft_reset(self._c_ptr)
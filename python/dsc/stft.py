@@ -0,0 +1,86 @@
+# Copyright (c) 2024, Christian Gilli <christian.gilli@dspcraft.com>
+# All rights reserved.
+#
+# This code is licensed under the terms of the 3-clause BSD license
+# (https://opensource.org/license/bsd-3-clause).
+
+from ._bindings import (
+    _dsc_stft_init,
+    _dsc_istft_init,
+    _dsc_stft_push,
+    _dsc_stft_ring,
+    _dsc_stft_count,
+    _dsc_stft_reset,
+    _dsc_stft_free,
+)
+from .context import _get_ctx
+from .dtype import Dtype
+from .tensor import Tensor, _c_ptr, _c_ptr_or_none
+from typing import Union
+
+
+class _StreamingTransform:
+    def __init__(self, c_ptr):
+        self._c_ptr = c_ptr
+        # The ring is owned by the transform, this is a view of it so it stays valid
+        # as long as it's referenced
+        self._ring = Tensor(_dsc_stft_ring(c_ptr), view=True)
+
+    def __del__(self):
+        _dsc_stft_free(_get_ctx(), self._c_ptr)
+
+    @property
+    def ring(self) -> Tensor:
+        return self._ring
+
+    @property
+    def count(self) -> int:
+        return _dsc_stft_count(self._c_ptr)
+
+    def push(self, x: Tensor) -> int:
+        return _dsc_stft_push(_get_ctx(), self._c_ptr, _c_ptr(x))
+
+    def reset(self):
+        _dsc_stft_reset(self._c_ptr)
+
+
+class STFT(_StreamingTransform):
+    """
+    Streaming STFT of frames of n_fft samples that start hop samples apart. Samples are pushed
+    as 1-dimensional tensors of any length, each complete frame is multiplied by the window (a periodic
+    Hann window if not specified) and its RFFT is written to the next row of `ring`, a [ring_n, n_fft // 2 + 1]
+    complex tensor. `push` returns the number of new frames, frame i is in row i % ring_n.
+    """
+
+    def __init__(
+        self,
+        n_fft: int,
+        hop: int,
+        ring_n: int,
+        window: Union[Tensor, None] = None,
+        dtype: Dtype = Dtype.F32,
+    ):
+        super().__init__(
+            _dsc_stft_init(_get_ctx(), n_fft, hop, ring_n, _c_ptr_or_none(window), dtype)
+        )
+
+
+class ISTFT(_StreamingTransform):
+    """
+    Streaming ISTFT with weighted overlap-add. Frames of n_fft // 2 + 1 bins are pushed either one
+    at a time or as [frames, n_fft // 2 + 1] tensors, for each frame hop samples are written to `ring`,
+    a 1-dimensional tensor of ring_n real samples. `push` returns the number of new samples,
+    sample i is in element i % ring_n.
+    """
+
+    def __init__(
+        self,
+        n_fft: int,
+        hop: int,
+        ring_n: int,
+        window: Union[Tensor, None] = None,
+        dtype: Dtype = Dtype.F32,
+    ):
+        super().__init__(
+            _dsc_istft_init(_get_ctx(), n_fft, hop, ring_n, _c_ptr_or_none(window), dtype)
+        )
@@ -9,6 +9,14 @@ from ._bindings import (
     _OptionalTensor,
     _DSC_MAX_DIMS,
     _DSC_VALUE_NONE,
+    _DSC_FFT_COMPLEX,
+    _DSC_CONV_MODES,
+    _DSC_PSD_SCALINGS,
+    _DSC_PLAN_ESTIMATE,
+    _DSC_PLAN_MEASURE,
+    _DSC_FUSED_OPS,
+    _DSC_MAX_FUSED_INPUTS,
+    _DSC_MAX_FUSED_OPS,
     _DscSlice,
     _dsc_cast,
     _dsc_reshape,
@@ -40,8 +48,20 @@ from ._bindings import (
     _dsc_ifft,
     _dsc_rfft,
     _dsc_irfft,
+    _dsc_fftn,
+    _dsc_ifftn,
+    _dsc_rfftn,
+    _dsc_irfftn,
     _dsc_fftfreq,
     _dsc_rfftfreq,
+    _dsc_convolve,
+    _dsc_correlate,
+    _dsc_goertzel,
+    _dsc_czt,
+    _dsc_zoom_fft,
+    _dsc_welch,
+    _dsc_csd,
+    _dsc_hilbert,
     _dsc_arange,
     _dsc_randn,
     _dsc_cos,
@@ -52,6 +72,7 @@ from ._bindings import (
     _dsc_log10,
     _dsc_exp,
     _dsc_sqrt,
+    _dsc_fused,
     _dsc_abs,
     _dsc_angle,
     _dsc_conj,
@@ -71,10 +92,12 @@ from .dtype import (
     ScalarType,
 )
 import numpy as np
-from .context import _get_ctx
+from .context import _get_ctx, _is_lazy
 import ctypes
+import builtins
+import cmath
 import sys
-from typing import Union, Tuple, List
+from typing import Union, Tuple, List, Sequence
 
 
 TensorType = Union['Tensor', np.ndarray]
@@ -334,6 +357,90 @@ class Tensor:
         return reshape(self, *shape)
 
 
+class _LazyTensor(Tensor):
+    # The result of an elementwise operation recorded in lazy mode, its operands can be lazy too. The first time
+    # the data is needed the whole expression is computed with a single call to dsc_fused.
+    def __init__(self, op: str, *operands: Tensor):
+        self._ptr = None
+        shape = np.broadcast_shapes(*(x.shape for x in operands))
+        self._dtype = _result_dtype(*operands)
+        self._n_dim = len(shape)
+        self._shape = [1] * (_DSC_MAX_DIMS - self._n_dim) + list(shape)
+        self._ne = int(np.prod(shape))
+
+        # Upper bounds of the size of the expression, if it doesn't fit in a dsc_fused call compute the operands first
+        n_ops = 1 + builtins.sum(x._n_ops for x in operands if _is_pending(x))
+        n_inputs = builtins.sum(x._n_inputs if _is_pending(x) else 1 for x in operands)
+        if n_ops > _DSC_MAX_FUSED_OPS or n_inputs > _DSC_MAX_FUSED_INPUTS:
+            for x in operands:
+                if _is_pending(x):
+                    x._eval()
+            n_ops, n_inputs = 1, len(operands)
+
+        self._op = op
+        self._operands = operands
+        self._n_ops = n_ops
+        self._n_inputs = n_inputs
+
+    def __del__(self):
+        if self._ptr is not None:
+            _dsc_tensor_free(_get_ctx(), self._ptr)
+
+    @property
+    def _c_ptr(self) -> _DscTensor_p:
+        if self._ptr is None:
+            self._eval()
+        return self._ptr
+
+    def _eval(self):
+        # Number the values of the expression in topological order, a Tensor used more than once
+        # (eg. x * x) is a single input and a shared sub-expression is computed once. Until the number of inputs
+        # is known they are numbered -1, -2...
+        inputs = []
+        ops = []
+        values = {}
+
+        def _value(x: Tensor) -> int:
+            if id(x) not in values:
+                if _is_pending(x):
+                    operands = [_value(o) for o in x._operands]
+                    ops.append((_DSC_FUSED_OPS[x._op], operands))
+                    values[id(x)] = len(ops) - 1
+                else:
+                    inputs.append(x)
+                    values[id(x)] = -len(inputs)
+            return values[id(x)]
+
+        def _index(v: int) -> int:
+            return -v - 1 if v < 0 else len(inputs) + v
+
+        _value(self)
+        fused_ops = [(op_type, _index(operands[0]), _index(operands[-1])) for op_type, operands in ops]
+        self._ptr = _dsc_fused(_get_ctx(), [_c_ptr(x) for x in inputs], fused_ops, None)
+        self._operands = None
+
+
+def _is_pending(x: Tensor) -> bool:
+    return isinstance(x, _LazyTensor) and x._ptr is None
+
+
+def _result_dtype(*operands: Tensor) -> Dtype:
+    dtype = operands[0].dtype
+    for x in operands[1:]:
+        dtype = DTYPE_CONVERSION_TABLES[dtype.value][x.dtype.value]
+    return dtype
+
+
+def _defer(out: Union[Tensor, None], *operands: Tensor) -> bool:
+    # Record the operation instead of computing it. dsc_fused casts the inputs and computes all the operations
+    # in their common dtype: to get the same result of the eager operations an operand with a different dtype
+    # must be an input, not an operation (eg. the sqrt of a negative f32 added to a c32).
+    if out is not None or not _is_lazy():
+        return False
+    dtype = _result_dtype(*operands)
+    return all(x.dtype == dtype or not _is_pending(x) for x in operands)
+
+
 def _create_tensor(dtype: Dtype, *dims: int) -> Tensor:
     n_dims = len(dims)
     if n_dims > _DSC_MAX_DIMS or n_dims < 1:
@@ -423,6 +530,8 @@ def _has_out(out: Union[Tensor, None]) -> bool:
 def _tensor_op(
     xa: Tensor, xb: Tensor, out: Union[Tensor, None], op_name: str
 ) -> Tensor:
+    if _defer(out, xa, xb):
+        return _LazyTensor(op_name.removeprefix('_dsc_'), xa, xb)
     if hasattr(sys.modules[__name__], op_name):
         op = getattr(sys.modules[__name__], op_name)
         return Tensor(
@@ -502,34 +611,50 @@ def power(
 
 
 def cos(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('cos', x)
     return Tensor(_dsc_cos(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def sin(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('sin', x)
     return Tensor(_dsc_sin(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def sinc(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('sinc', x)
     return Tensor(_dsc_sinc(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def logn(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('logn', x)
     return Tensor(_dsc_logn(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def log2(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('log2', x)
     return Tensor(_dsc_log2(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def log10(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('log10', x)
     return Tensor(_dsc_log10(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def exp(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('exp', x)
     return Tensor(_dsc_exp(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
 def sqrt(x: Tensor, out: Union[Tensor, None] = None) -> Tensor:
+    if _defer(out, x):
+        return _LazyTensor('sqrt', x)
     return Tensor(_dsc_sqrt(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out)), _has_out(out))
 
 
@@ -681,38 +806,83 @@ def empty_like(x: TensorType, dtype: Union[Dtype, None] = None) -> Tensor:
     return empty(shape, dtype=dtype)
 
 
-def plan_fft(n: int, dtype: Dtype = Dtype.F64):
+def plan_fft(n: int, dtype: Dtype = Dtype.F64, measure: bool = False, batch: int = 1):
     """
     Create the plan for a one-dimensional FFT/IFFT of size N using dtype for the twiddle factors.
+    N can be any positive integer, there is no need to pad it to a power of 2.
     If this function is not executed before calling either `dsc.fft` or `dsc.ifft` then it will be
     called automatically before doing the first transform causing a slowdown.
+    If measure is True the candidate algorithms are timed on batch lines and the fastest one is
+    used by the following transforms of size N, whatever their number of lines. The plan is not
+    measured again for a different batch.
     """
-    return _dsc_plan_fft(_get_ctx(), n, dtype)
+    return _dsc_plan_fft(
+        _get_ctx(), n, _DSC_FFT_COMPLEX, dtype, _DSC_PLAN_MEASURE if measure else _DSC_PLAN_ESTIMATE, batch
+    )
 
 
 def fft(
-    x: Tensor, out: Union[Tensor, None] = None, n: int = -1, axis: int = -1
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    n: int = -1,
+    axis: int = -1,
+    bins: Union[Tuple[int, int], None] = None,
 ) -> Tensor:
+    bin_start, bin_stop = bins if bins is not None else (0, -1)
     return Tensor(
-        _dsc_fft(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out), n=n, axis=axis),
+        _dsc_fft(
+            _get_ctx(),
+            _c_ptr(x),
+            _c_ptr_or_none(out),
+            n=n,
+            axis=axis,
+            bin_start=bin_start,
+            bin_stop=bin_stop,
+        ),
         _has_out(out),
     )
 
 
 def ifft(
-    x: Tensor, out: Union[Tensor, None] = None, n: int = -1, axis: int = -1
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    n: int = -1,
+    axis: int = -1,
+    bins: Union[Tuple[int, int], None] = None,
 ) -> Tensor:
+    bin_start, bin_stop = bins if bins is not None else (0, -1)
     return Tensor(
-        _dsc_ifft(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out), n=n, axis=axis),
+        _dsc_ifft(
+            _get_ctx(),
+            _c_ptr(x),
+            _c_ptr_or_none(out),
+            n=n,
+            axis=axis,
+            bin_start=bin_start,
+            bin_stop=bin_stop,
+        ),
         _has_out(out),
     )
 
 
 def rfft(
-    x: Tensor, out: Union[Tensor, None] = None, n: int = -1, axis: int = -1
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    n: int = -1,
+    axis: int = -1,
+    bins: Union[Tuple[int, int], None] = None,
 ) -> Tensor:
+    bin_start, bin_stop = bins if bins is not None else (0, -1)
     return Tensor(
-        _dsc_rfft(_get_ctx(), _c_ptr(x), _c_ptr_or_none(out), n=n, axis=axis),
+        _dsc_rfft(
+            _get_ctx(),
+            _c_ptr(x),
+            _c_ptr_or_none(out),
+            n=n,
+            axis=axis,
+            bin_start=bin_start,
+            bin_stop=bin_stop,
+        ),
         _has_out(out),
     )
 
@@ -726,9 +896,268 @@ def irfft(
     )
 
 
+def fftn(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Union[Sequence[int], None] = None,
+) -> Tensor:
+    return Tensor(
+        _dsc_fftn(
+            _get_ctx(), _c_ptr(x), _c_ptr_or_none(out),
+            n=tuple(s) if s is not None else None,
+            axes=tuple(axes) if axes is not None else None,
+        ),
+        _has_out(out),
+    )
+
+
+def ifftn(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Union[Sequence[int], None] = None,
+) -> Tensor:
+    return Tensor(
+        _dsc_ifftn(
+            _get_ctx(), _c_ptr(x), _c_ptr_or_none(out),
+            n=tuple(s) if s is not None else None,
+            axes=tuple(axes) if axes is not None else None,
+        ),
+        _has_out(out),
+    )
+
+
+def rfftn(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Union[Sequence[int], None] = None,
+) -> Tensor:
+    return Tensor(
+        _dsc_rfftn(
+            _get_ctx(), _c_ptr(x), _c_ptr_or_none(out),
+            n=tuple(s) if s is not None else None,
+            axes=tuple(axes) if axes is not None else None,
+        ),
+        _has_out(out),
+    )
+
+
+def irfftn(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Union[Sequence[int], None] = None,
+) -> Tensor:
+    return Tensor(
+        _dsc_irfftn(
+            _get_ctx(), _c_ptr(x), _c_ptr_or_none(out),
+            n=tuple(s) if s is not None else None,
+            axes=tuple(axes) if axes is not None else None,
+        ),
+        _has_out(out),
+    )
+
+
+def fft2(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Sequence[int] = (-2, -1),
+) -> Tensor:
+    return fftn(x, out=out, s=s, axes=axes)
+
+
+def ifft2(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Sequence[int] = (-2, -1),
+) -> Tensor:
+    return ifftn(x, out=out, s=s, axes=axes)
+
+
+def rfft2(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Sequence[int] = (-2, -1),
+) -> Tensor:
+    return rfftn(x, out=out, s=s, axes=axes)
+
+
+def irfft2(
+    x: Tensor,
+    out: Union[Tensor, None] = None,
+    s: Union[Sequence[int], None] = None,
+    axes: Sequence[int] = (-2, -1),
+) -> Tensor:
+    return irfftn(x, out=out, s=s, axes=axes)
+
+
 def fftfreq(n: int, d: float = 1.0, dtype: Dtype = Dtype.F32) -> Tensor:
     return Tensor(_dsc_fftfreq(_get_ctx(), n, d, dtype))
 
 
 def rfftfreq(n: int, d: float = 1.0, dtype: Dtype = Dtype.F32) -> Tensor:
     return Tensor(_dsc_rfftfreq(_get_ctx(), n, d, dtype))
+
+
+def convolve(
+    x: Tensor, h: Tensor, mode: str = 'full', out: Union[Tensor, None] = None
+) -> Tensor:
+    return Tensor(
+        _dsc_convolve(_get_ctx(), _c_ptr(x), _c_ptr(h), _c_ptr_or_none(out), _DSC_CONV_MODES[mode]),
+        _has_out(out),
+    )
+
+
+def correlate(
+    x: Tensor, h: Tensor, mode: str = 'valid', out: Union[Tensor, None] = None
+) -> Tensor:
+    return Tensor(
+        _dsc_correlate(_get_ctx(), _c_ptr(x), _c_ptr(h), _c_ptr_or_none(out), _DSC_CONV_MODES[mode]),
+        _has_out(out),
+    )
+
+
+def goertzel(
+    x: Tensor,
+    bins: Union[int, Tuple[int, ...]],
+    n: int = -1,
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+) -> Tensor:
+    bins = (bins,) if isinstance(bins, int) else tuple(bins)
+    return Tensor(
+        _dsc_goertzel(_get_ctx(), _c_ptr(x), bins, _c_ptr_or_none(out), n, axis),
+        _has_out(out),
+    )
+
+
+def czt(
+    x: Tensor,
+    m: int = -1,
+    w: Union[complex, None] = None,
+    a: complex = 1,
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+) -> Tensor:
+    if m <= 0:
+        m = x.shape[axis]
+    if w is None:
+        # By default the CZT is the DFT of m points
+        w = cmath.exp(-2j * cmath.pi / m)
+    return Tensor(
+        _dsc_czt(_get_ctx(), _c_ptr(x), m, complex(w), complex(a), _c_ptr_or_none(out), axis),
+        _has_out(out),
+    )
+
+
+def zoom_fft(
+    x: Tensor,
+    fn: Union[float, Tuple[float, float]],
+    m: int = -1,
+    fs: float = 2.0,
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+) -> Tensor:
+    f0, f1 = (0.0, fn) if isinstance(fn, (int, float)) else fn
+    return Tensor(
+        _dsc_zoom_fft(_get_ctx(), _c_ptr(x), m, f0, f1, fs, _c_ptr_or_none(out), axis),
+        _has_out(out),
+    )
+
+
+def _psd_detrend(detrend: Union[str, bool]) -> bool:
+    # Like scipy, True is the same as 'constant'. Only the mean of each segment can be removed.
+    if detrend is True or detrend == 'constant':
+        return True
+    if detrend is False:
+        return False
+    raise ValueError(f'unsupported detrend {detrend!r}, must be one of \'constant\', True or False')
+
+
+def welch(
+    x: Tensor,
+    fs: float = 1.0,
+    window: Union[Tensor, None] = None,
+    nperseg: int = 256,
+    noverlap: Union[int, None] = None,
+    detrend: Union[str, bool] = 'constant',
+    scaling: str = 'density',
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+) -> Tensor:
+    # Like scipy, nperseg can't be longer than the signal. The frequency of each bin is rfftfreq(nperseg, 1 / fs).
+    nperseg = nperseg if nperseg <= x.shape[axis] else x.shape[axis]
+    return Tensor(
+        _dsc_welch(
+            _get_ctx(),
+            _c_ptr(x),
+            nperseg,
+            -1 if noverlap is None else noverlap,
+            _c_ptr_or_none(window),
+            fs,
+            _DSC_PSD_SCALINGS[scaling],
+            _psd_detrend(detrend),
+            _c_ptr_or_none(out),
+            axis,
+        ),
+        _has_out(out),
+    )
+
+
+def csd(
+    x: Tensor,
+    y: Tensor,
+    fs: float = 1.0,
+    window: Union[Tensor, None] = None,
+    nperseg: int = 256,
+    noverlap: Union[int, None] = None,
+    detrend: Union[str, bool] = 'constant',
+    scaling: str = 'density',
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+) -> Tensor:
+    nperseg = nperseg if nperseg <= x.shape[axis] else x.shape[axis]
+    return Tensor(
+        _dsc_csd(
+            _get_ctx(),
+            _c_ptr(x),
+            _c_ptr(y),
+            nperseg,
+            -1 if noverlap is None else noverlap,
+            _c_ptr_or_none(window),
+            fs,
+            _DSC_PSD_SCALINGS[scaling],
+            _psd_detrend(detrend),
+            _c_ptr_or_none(out),
+            axis,
+        ),
+        _has_out(out),
+    )
+
+
+def hilbert(
+    x: Tensor,
+    n: int = -1,
+    axis: int = -1,
+    out: Union[Tensor, None] = None,
+    envelope: Union[Tensor, None] = None,
+    phase: Union[Tensor, None] = None,
+) -> Tensor:
+    # If given, envelope and phase are filled with the amplitude and phase of the analytic signal
+    return Tensor(
+        _dsc_hilbert(
+            _get_ctx(),
+            _c_ptr(x),
+            _c_ptr_or_none(out),
+            n,
+            axis,
+            _c_ptr_or_none(envelope),
+            _c_ptr_or_none(phase),
+        ),
+        _has_out(out),
+    )
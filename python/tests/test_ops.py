@@ -105,6 +105,20 @@ class TestOps:
                 assert all_close(res_dsc_s.numpy(), res_np_s)
                 assert all_close(r_res_dsc_s.numpy(), r_res_np_s)
 
+    def test_binary_rows(self):
+        # Rows long enough to go through the vector kernels plus a remainder, broadcasting either
+        # along the last dimension (column) or along the others (row)
+        ops = [(np.add, dsc.add), (np.subtract, dsc.sub), (np.multiply, dsc.mul), (np.true_divide, dsc.true_div)]
+        for np_op, dsc_op in ops:
+            for dtype in DTYPES:
+                x = random_nd([3, 5, 67], dtype=dtype)
+                x_dsc = dsc.from_numpy(x)
+                for y_shape in [[5, 67], [3, 1, 67], [3, 5, 1], [5, 1]]:
+                    y = random_nd(y_shape, dtype=dtype)
+                    y_dsc = dsc.from_numpy(y)
+                    assert all_close(dsc_op(x_dsc, y_dsc).numpy(), np_op(x, y))
+                    assert all_close(dsc_op(y_dsc, x_dsc).numpy(), np_op(y, x))
+
     def test_unary(self):
         ops = {
             'sin': (np.sin, dsc.sin),
@@ -460,33 +474,642 @@ def test_fft():
         'fft': ((np.fft.fft, np.fft.ifft), (dsc.fft, dsc.ifft)),
         'rfft': ((np.fft.rfft, np.fft.irfft), (dsc.rfft, dsc.irfft)),
     }
-    n_ = random.randint(3, 10)
-    n = 2**n_
+    # Power-of-2, mixed-radix and prime (Bluestein) lengths
+    lengths = [
+        2 ** random.randint(3, 10),
+        random.choice([12, 60, 105, 243, 1000]),
+        random.choice([97, 211, 1009]),
+    ]
+
+    for n in lengths:
+        for axis in range(4):
+            shape = [8] * 4
+            shape[axis] = n
+            for n_change in range(-1, 2):
+                for op_name in ops.keys():
+                    # n_change=-1 -> cropping
+                    # n_change=0  -> copy
+                    # n_change=+1 -> padding
+                    fft_n = n + n_change
+                    print(f'Testing {op_name} with N={fft_n}')
+                    np_fft_op, np_ifft_op = ops[op_name][0]
+                    dsc_fft_op, dsc_ifft_op = ops[op_name][1]
+                    x = random_nd(shape)
+                    x_dsc = dsc.from_numpy(x)
 
-    for axis in range(4):
-        shape = [8] * 4
-        shape[axis] = n
-        for n_change in range(-1, 2):
-            for op_name in ops.keys():
-                # n_change=-1 -> cropping
-                # n_change=0  -> copy
-                # n_change=+1 -> padding
-                fft_n = 2 ** (n_ + n_change)
-                print(f'Testing {op_name} with N={fft_n}')
-                np_fft_op, np_ifft_op = ops[op_name][0]
-                dsc_fft_op, dsc_ifft_op = ops[op_name][1]
-                x = random_nd(shape)
-                x_dsc = dsc.from_numpy(x)
+                    x_np_fft = np_fft_op(x, n=fft_n, axis=axis)
+                    x_dsc_fft = dsc_fft_op(x_dsc, n=fft_n, axis=axis)
+
+                    assert all_close(x_dsc_fft.numpy(), x_np_fft)
+
+                    x_np_ifft = np_ifft_op(x_np_fft, axis=axis)
+                    x_dsc_ifft = dsc_ifft_op(x_dsc_fft, axis=axis)
+
+                    assert all_close(x_dsc_ifft.numpy(), x_np_ifft)
 
-                x_np_fft = np_fft_op(x, n=fft_n, axis=axis)
-                x_dsc_fft = dsc_fft_op(x_dsc, n=fft_n, axis=axis)
+                    x_np_ifft = np_ifft_op(x_np_fft, n=fft_n, axis=axis)
+                    x_dsc_ifft = dsc_ifft_op(x_dsc_fft, n=fft_n, axis=axis)
 
-                assert all_close(x_dsc_fft.numpy(), x_np_fft)
+                    assert all_close(x_dsc_ifft.numpy(), x_np_ifft)
 
-                x_np_ifft = np_ifft_op(x_np_fft, axis=axis)
-                x_dsc_ifft = dsc_ifft_op(x_dsc_fft, axis=axis)
 
-                assert all_close(x_dsc_ifft.numpy(), x_np_ifft)
+def test_fft_batched():
+    # Many short FFTs over [channels, frames, n] tensors, the number of lines is not
+    # a multiple of the batch size so both the batched and the single line kernels are used.
+    # Real lines of odd length are transformed in pairs, the last line is left without a pair.
+    ops = {
+        'fft': ((np.fft.fft, np.fft.ifft), (dsc.fft, dsc.ifft)),
+        'rfft': ((np.fft.rfft, np.fft.irfft), (dsc.rfft, dsc.irfft)),
+    }
+    for n in [16, 45, 60, 256, 1001, 2048]:
+        for axis in [-1, 0, 1]:
+            shape = [3, 37]
+            shape.insert(len(shape) + 1 + axis if axis < 0 else axis, n)
+            for dtype in [np.float32, np.float64]:
+                for op_name in ops.keys():
+                    print(f'Testing batched {op_name} with N={n} shape={shape} dtype={dtype.__name__}')
+                    np_fft_op, np_ifft_op = ops[op_name][0]
+                    dsc_fft_op, dsc_ifft_op = ops[op_name][1]
+                    x = random_nd(shape, dtype=dtype)
+                    eps = 1e-5 if dtype == np.float64 else 1e-3
+
+                    x_np_fft = np_fft_op(x, axis=axis)
+                    x_dsc_fft = dsc_fft_op(dsc.from_numpy(x), axis=axis)
+                    assert all_close(x_dsc_fft.numpy(), x_np_fft, eps)
+
+                    x_np_ifft = np_ifft_op(x_np_fft, n=n, axis=axis)
+                    x_dsc_ifft = dsc_ifft_op(x_dsc_fft, n=n, axis=axis)
+                    assert all_close(x_dsc_ifft.numpy(), x_np_ifft, eps)
+
+
+def test_fft_pruned():
+    # Short inputs zero-padded to a long FFT use input pruning, a few bins of a long FFT use
+    # output pruning. The sizes are large enough to use both the batched and the single line
+    # sub-transforms.
+    for dtype in [np.float32, np.float64]:
+        eps = 1e-5 if dtype == np.float64 else 1e-3
+        for x_n, n in [(100, 1600), (17, 4096), (512, 32768), (1024, 131072)]:
+            print(f'Testing pruned FFTs with N={n} x_n={x_n} dtype={dtype.__name__}')
+            x = random_nd([x_n], dtype=dtype)
+            x_c = x + 1j * random_nd([x_n], dtype=dtype)
+            assert all_close(dsc.fft(dsc.from_numpy(x_c), n=n).numpy(), np.fft.fft(x_c, n=n), eps)
+            assert all_close(dsc.ifft(dsc.from_numpy(x_c), n=n).numpy(), np.fft.ifft(x_c, n=n), eps)
+            assert all_close(dsc.rfft(dsc.from_numpy(x), n=n).numpy(), np.fft.rfft(x, n=n), eps)
+
+        for n, bins in [(4096, (0, 8)), (65536, (1000, 1128)), (262144, (7, 23)), (131072, (65473, 65537))]:
+            print(f'Testing pruned FFTs with N={n} bins={bins} dtype={dtype.__name__}')
+            start, stop = bins
+            x = random_nd([n], dtype=dtype)
+            x_c = x + 1j * random_nd([n], dtype=dtype)
+            assert all_close(dsc.fft(dsc.from_numpy(x_c), bins=bins).numpy(), np.fft.fft(x_c)[start:stop], eps)
+            assert all_close(dsc.ifft(dsc.from_numpy(x_c), bins=bins).numpy(), np.fft.ifft(x_c)[start:stop], eps)
+            assert all_close(dsc.rfft(dsc.from_numpy(x), bins=bins).numpy(), np.fft.rfft(x)[start:stop], eps)
+
+    # Bins over a non-contiguous axis
+    x = random_nd([5, 300, 3])
+    assert all_close(dsc.rfft(dsc.from_numpy(x), n=4800, axis=1, bins=(10, 20)).numpy(),
+                     np.fft.rfft(x, n=4800, axis=1)[:, 10:20])
+
+
+def test_fftn():
+    ops = {
+        'fftn': ((np.fft.fftn, np.fft.ifftn), (dsc.fftn, dsc.ifftn)),
+        'rfftn': ((np.fft.rfftn, np.fft.irfftn), (dsc.rfftn, dsc.irfftn)),
+    }
+    for shape in [(32, 64), (7, 60, 33), (3, 5, 8, 12)]:
+        # Default, subset of the axes in a different order and padding/cropping of some axes
+        params = [(None, None), (None, (-1, 0)), ((shape[0] + 3, shape[-1] - 2), (0, -1))]
+        for dtype in [np.float32, np.float64]:
+            for op_name in ops.keys():
+                np_fft_op, np_ifft_op = ops[op_name][0]
+                dsc_fft_op, dsc_ifft_op = ops[op_name][1]
+                for s, axes in params:
+                    print(f'Testing {op_name} with shape={shape} s={s} axes={axes} dtype={dtype.__name__}')
+                    x = random_nd(list(shape), dtype=dtype)
+                    eps = 1e-5 if dtype == np.float64 else 1e-3
+
+                    x_np_fft = np_fft_op(x, s=s, axes=axes)
+                    x_dsc_fft = dsc_fft_op(dsc.from_numpy(x), s=s, axes=axes)
+                    assert all_close(x_dsc_fft.numpy(), x_np_fft, eps)
+
+                    x_np_ifft = np_ifft_op(x_np_fft, s=s, axes=axes)
+                    x_dsc_ifft = dsc_ifft_op(x_dsc_fft, s=s, axes=axes)
+                    assert all_close(x_dsc_ifft.numpy(), x_np_ifft, eps)
+
+    x = random_nd([20, 30], dtype=np.float64)
+    assert all_close(dsc.fft2(dsc.from_numpy(x)).numpy(), np.fft.fft2(x))
+    assert all_close(dsc.rfft2(dsc.from_numpy(x)).numpy(), np.fft.rfft2(x))
+
+
+def test_fft_threads():
+    # The result must be exactly the same regardless of the number of threads
+    ops = [(dsc.fft, dsc.ifft), (dsc.rfft, dsc.irfft)]
+    for n in [64, 1000, 2048]:
+        for axis in [-1, 0]:
+            shape = [8, 37]
+            shape.insert(len(shape) + 1 + axis if axis < 0 else axis, n)
+            for dtype in [np.float32, np.float64]:
+                x = random_nd(shape, dtype=dtype)
+                for dsc_fft_op, dsc_ifft_op in ops:
+                    print(f'Testing {dsc_fft_op.__name__} with N={n} shape={shape} dtype={dtype.__name__} using 4 threads')
+                    res = []
+                    for n_threads in [1, 4]:
+                        dsc.set_threads(n_threads)
+                        assert dsc.get_threads() == n_threads
+                        x_fft = dsc_fft_op(dsc.from_numpy(x), axis=axis)
+                        x_ifft = dsc_ifft_op(x_fft, n=n, axis=axis)
+                        # numpy() is a view of the tensor data, copy it before the tensor is freed
+                        res.append((x_fft.numpy().copy(), x_ifft.numpy().copy()))
+
+                    dsc.set_threads(1)
+                    assert np.array_equal(res[0][0], res[1][0])
+                    assert np.array_equal(res[0][1], res[1][1])
+
+
+def test_elementwise_threads():
+    # Big enough to be split among the threads, the result must be the same as with a single thread
+    shape = [150, 1001]
+    for dtype in DTYPES:
+        x_np = random_nd(shape, dtype=dtype)
+        y_np = random_nd([1, shape[1]], dtype=dtype)
+        print(f'Testing elementwise ops with shape={shape} dtype={dtype.__name__} using 4 threads')
+        res = []
+        for n_threads in [1, 4]:
+            dsc.set_threads(n_threads)
+            x, y = dsc.from_numpy(x_np), dsc.from_numpy(y_np)
+            outs = [
+                x * y, y - x, dsc.exp(x), x.cast(dsc.Dtype.C64), dsc.transpose(x), x[::3, 1:],
+                dsc.concat([x, x, x], axis=0), dsc.concat([x, y], axis=0),
+                dsc.sum(x, axis=0), dsc.sum(x, axis=1), dsc.max(x, axis=0),
+            ]
+            res.append([out.numpy().copy() for out in outs])
+
+        dsc.set_threads(1)
+        for single, multi in zip(res[0], res[1]):
+            assert np.array_equal(single, multi)
+
+        x = dsc.from_numpy(x_np)
+        assert all_close(dsc.concat([x, x], axis=1).numpy(), np.concatenate([x_np, x_np], axis=1))
+        assert all_close(dsc.sum(x, axis=0).numpy(), np.sum(x_np, axis=0))
+
+
+def test_fast_math():
+    ops = {
+        'sin': (np.sin, dsc.sin),
+        'sinc': (np.sinc, dsc.sinc),
+        'cos': (np.cos, dsc.cos),
+        'logn': (np.log, dsc.logn),
+        'log2': (np.log2, dsc.log2),
+        'log10': (np.log10, dsc.log10),
+        'exp': (np.exp, dsc.exp),
+    }
+    specials = [0, -0., 1, -1, np.inf, -np.inf, np.nan, 1e-40, 1e-310, 88.8, -103, 709.9, -745, 8191, 1e6]
+    dsc.set_math_precision('fast')
+    assert dsc.get_math_precision() == 'fast'
+    for op_name in ops.keys():
+        np_op, dsc_op = ops[op_name]
+        for dtype in DTYPES:
+            print(f'Testing fast {op_name} with {dtype.__name__}')
+            eps = 8 * np.finfo(dtype).eps
+            # Random values of very different magnitudes, the size is not a multiple of the vector width.
+            # Complex values are kept small enough for exp, cosh and sinh not to overflow.
+            max_exp = 10 if dtype in (np.float32, np.float64) else 3
+            x = (random_nd([1001], dtype=dtype) * np.exp2(np.random.randint(-8, max_exp, 1001))).astype(dtype)
+            if op_name.startswith('log') and np.isrealobj(x):
+                x = np.abs(x)
+            if np.isrealobj(x):
+                x = np.concatenate([x, np.array(specials, dtype=dtype)])
+            with np.errstate(all='ignore'):
+                res_np = np_op(x)
+            res_dsc = dsc_op(dsc.from_numpy(x)).numpy()
+            assert np.allclose(res_dsc, res_np, rtol=eps, atol=eps, equal_nan=True)
+
+    dsc.set_math_precision('accurate')
+    assert dsc.get_math_precision() == 'accurate'
+
+
+def test_lazy_fusion():
+    shape = [150, 1001]
+    for dtype in DTYPES:
+        a_np = np.abs(random_nd(shape, dtype=dtype)) + 0.1
+        b_np = random_nd(shape, dtype=dtype)
+        row_np = random_nd([1, shape[1]], dtype=dtype)
+        col_np = random_nd([shape[0], 1], dtype=dtype)
+        a, b, row, col = (dsc.from_numpy(x) for x in (a_np, b_np, row_np, col_np))
+        for precision in ['accurate', 'fast']:
+            print(f'Testing lazy fusion with shape={shape} dtype={dtype.__name__} precision={precision}')
+            dsc.set_math_precision(precision)
+            # The fast kernels give exactly the same result of the eager operations, libm may be vectorized
+            # differently depending on where a loop starts
+            exprs = [
+                lambda: dsc.sqrt(a * a + b * b) * row,
+                lambda: dsc.exp(col) / 2.0 - dsc.log10(a) * (b + row),
+                lambda: dsc.sin(b * 3.0) + dsc.cos(a) ** 2 + dsc.sinc(col),
+            ]
+            for expr in exprs:
+                eager = expr()
+                with dsc.lazy():
+                    lazy = expr()
+                assert isinstance(lazy, dsc.tensor._LazyTensor)
+                assert lazy.shape == eager.shape and lazy.dtype == eager.dtype
+                if precision == 'fast':
+                    assert np.array_equal(lazy.numpy(), eager.numpy())
+                else:
+                    assert all_close(lazy.numpy(), eager.numpy())
+
+    dsc.set_math_precision('accurate')
+    a_np = random_nd(shape, dtype=np.float32)
+    a = dsc.from_numpy(a_np)
+    with dsc.lazy():
+        # Longer than DSC_MAX_FUSED_OPS
+        x = a
+        for _ in range(40):
+            x = x * 0.5 + a
+        # Inputs are cast to the common dtype but an operation with a different dtype is computed first
+        y = a + dsc.from_numpy(a_np.astype(np.complex64))
+        z = dsc.sqrt(a) + dsc.from_numpy(a_np.astype(np.complex64))
+    assert isinstance(y, dsc.tensor._LazyTensor) and y.dtype == dsc.Dtype.C32
+    assert not isinstance(z, dsc.tensor._LazyTensor)
+    assert all_close(y.numpy(), a_np + a_np.astype(np.complex64))
+    with np.errstate(invalid='ignore'):
+        assert all_close(z.numpy(), np.sqrt(a_np) + a_np.astype(np.complex64))
+    target = a_np
+    for _ in range(40):
+        target = target * np.float32(0.5) + a_np
+    assert all_close(x.numpy(), target)
+
+
+def test_fft_cache():
+    x = dsc.from_numpy(random_nd([100], dtype=np.float64))
+    dsc.fft(x, n=97)
+    before = dsc.fft_cache_stats()
+    dsc.fft(x, n=97)
+    after = dsc.fft_cache_stats()
+    assert after['hits'] == before['hits'] + 1
+    assert after['misses'] == before['misses']
+
+    # Going over the capacity evicts the least recently used plans
+    capacity = after['capacity']
+    for n in range(1, capacity + 11):
+        dsc.fft(x, n=n + 1000)
+    stats = dsc.fft_cache_stats()
+    assert stats['size'] == capacity
+    assert stats['evictions'] >= after['evictions'] + 10
+    dsc.fft(x, n=capacity + 1010)
+    assert dsc.fft_cache_stats()['hits'] == stats['hits'] + 1
+
+
+def test_fft_clear():
+    x = random_nd([4, 1000], dtype=np.complex128)
+    ops = [
+        (lambda t: dsc.fft(t, n=1000), lambda a: np.fft.fft(a, n=1000)),
+        (lambda t: dsc.fft(t, n=997), lambda a: np.fft.fft(a, n=997)),
+        (lambda t: dsc.czt(t), lambda a: np.fft.fft(a)),
+    ]
+    for dsc_op, np_op in ops:
+        assert all_close(dsc_op(dsc.from_numpy(x)).numpy(), np_op(x))
+
+    # The cached plans and their twiddles are gone after clear, the FFTs must create them again
+    dsc.clear()
+    stats = dsc.fft_cache_stats()
+    assert stats['size'] == 0 and stats['twiddle_sets'] == 0 and stats['twiddle_bytes'] == 0
+    assert stats['hits'] == 0 and stats['misses'] == 0 and stats['evictions'] == 0
+    for dsc_op, np_op in ops:
+        assert all_close(dsc_op(dsc.from_numpy(x)).numpy(), np_op(x))
+    assert dsc.fft_cache_stats()['misses'] == 2
+
+
+def test_fft_twiddle_pool():
+    x = random_nd([12288], dtype=np.complex64)
+    dsc.fft(dsc.from_numpy(x))
+    before = dsc.fft_cache_stats()
+    # All the passes of N=1536 are shared with N=12288 and the RFFT of order 3072 uses the same
+    # passes as the FFT of order 1536 so it only needs its own RFFT twiddles. Other plans may be
+    # evicted in the meantime so the pool can only get smaller than that.
+    res = dsc.fft(dsc.from_numpy(x), n=1536).numpy()
+    assert all_close(res, np.fft.fft(x, n=1536), 1e-3)
+    dsc.rfft(dsc.from_numpy(x.real.copy()), n=3072)
+    after = dsc.fft_cache_stats()
+    assert after['misses'] == before['misses'] + 2
+    assert after['twiddle_sets'] <= before['twiddle_sets'] + 1
+    assert after['twiddle_bytes'] <= before['twiddle_bytes'] + 768 * 8
+
+
+def test_fft_wisdom(tmp_path):
+    x = random_nd([3, 1009], dtype=np.float64)
+    # Stockham, Bluestein and real plans
+    ops = [
+        (lambda t: dsc.fft(t, n=1000), lambda a: np.fft.fft(a, n=1000)),
+        (lambda t: dsc.fft(t), lambda a: np.fft.fft(a)),
+        (lambda t: dsc.rfft(t, n=998), lambda a: np.fft.rfft(a, n=998)),
+    ]
+    for dsc_op, _ in ops:
+        dsc_op(dsc.from_numpy(x))
+
+    wisdom = str(tmp_path / 'wisdom.dsc')
+    dsc.export_wisdom(wisdom)
+
+    # Evict all the plans, after the import they must be found in the cache
+    capacity = dsc.fft_cache_stats()['capacity']
+    for n in range(capacity):
+        dsc.fft(dsc.from_numpy(x), n=n + 2000)
+
+    dsc.import_wisdom(wisdom)
+    before = dsc.fft_cache_stats()
+    for dsc_op, np_op in ops:
+        assert all_close(dsc_op(dsc.from_numpy(x)).numpy(), np_op(x))
+    after = dsc.fft_cache_stats()
+    assert after['misses'] == before['misses']
+    assert after['hits'] == before['hits'] + len(ops)
+
+    invalid = tmp_path / 'invalid.dsc'
+    invalid.write_bytes(b'not a wisdom file')
+    with pytest.raises(RuntimeError):
+        dsc.import_wisdom(str(invalid))
+
+
+def test_fft_measure(tmp_path):
+    # Stockham with several radix orders, Bluestein and a plan small enough to use the batched kernels
+    sizes = [1000, 97 * 89, 48]
+    for dtype in [np.complex64, np.complex128]:
+        x = random_nd([8, 9000], dtype=dtype)
+        dsc_dtype = dsc.Dtype.F32 if dtype == np.complex64 else dsc.Dtype.F64
+        for n in sizes:
+            dsc.plan_fft(n, dsc_dtype, measure=True, batch=8)
+            # The measured plan replaces the estimated one so the FFT doesn't create a new plan
+            before = dsc.fft_cache_stats()
+            res = dsc.fft(dsc.from_numpy(x), n=n).numpy()
+            assert dsc.fft_cache_stats()['misses'] == before['misses']
+            assert all_close(res, np.fft.fft(x, n=n), 1e-3 if dtype == np.complex64 else 1e-8)
+
+    # Measured plans are exported with the choices that were made, measuring them again is a cache hit
+    wisdom = str(tmp_path / 'wisdom.dsc')
+    dsc.export_wisdom(wisdom)
+    capacity = dsc.fft_cache_stats()['capacity']
+    for n in range(capacity):
+        dsc.fft(dsc.from_numpy(random_nd([100], dtype=np.float64)), n=n + 2000)
+    dsc.import_wisdom(wisdom)
+    before = dsc.fft_cache_stats()
+    for n in sizes:
+        dsc.plan_fft(n, dsc.Dtype.F64, measure=True)
+    after = dsc.fft_cache_stats()
+    assert after['misses'] == before['misses']
+    assert after['hits'] == before['hits'] + len(sizes)
+
+
+def test_stft():
+    # The samples are pushed in chunks of random length, the result must be the same as the
+    # STFT of the whole signal. The ISTFT of the frames must give back the original signal
+    # except for the first n_fft - hop samples that are not covered by enough frames.
+    for n_fft, hop in [(512, 128), (400, 160), (255, 100)]:
+        for dtype, np_dtype in [(dsc.Dtype.F32, np.float32), (dsc.Dtype.F64, np.float64)]:
+            print(f'Testing STFT with N={n_fft} hop={hop} dtype={np_dtype.__name__}')
+            eps = 1e-5 if np_dtype == np.float64 else 1e-3
+            x = random_nd([6000], dtype=np_dtype)
+            window = np.hamming(n_fft)
+            n_frames = (len(x) - n_fft) // hop + 1
+            target = np.stack([np.fft.rfft(x[i * hop:i * hop + n_fft] * window) for i in range(n_frames)])
+
+            ring_n = 32
+            stft = dsc.STFT(n_fft, hop, ring_n, window=dsc.from_numpy(window), dtype=dtype)
+            frames = []
+            start = 0
+            while start < len(x):
+                stop = start + random.randint(1, 1000)
+                new_frames = stft.push(dsc.from_numpy(x[start:stop]))
+                assert new_frames <= ring_n
+                ring = stft.ring.numpy()
+                frames.extend(ring[i % ring_n].copy() for i in range(stft.count - new_frames, stft.count))
+                start = stop
+            assert stft.count == n_frames
+            assert all_close(np.stack(frames), target, eps)
+
+            istft = dsc.ISTFT(n_fft, hop, len(x), window=dsc.from_numpy(window), dtype=dtype)
+            spectrum = target.astype(np.complex64 if np_dtype == np.float32 else np.complex128)
+            for i in range(0, n_frames, 7):
+                istft.push(dsc.from_numpy(spectrum[i:i + 7]))
+            assert istft.count == n_frames * hop
+            assert all_close(istft.ring.numpy()[n_fft - hop:istft.count], x[n_fft - hop:istft.count], eps)
+
+
+def test_convolve():
+    # Short kernels use the direct kernel, long ones overlap-save
+    for dtype in DTYPES:
+        eps = 1e-4 if dtype == np.float32 or dtype == np.complex64 else 1e-8
+        # Even signals shorter than the kernel move the centre of correlate in SAME mode
+        for n, m in [(1, 1), (7, 3), (3, 7), (1000, 31), (5000, 300), (777, 2000),
+                     (2, 5), (16, 40), (100, 301), (1000, 2000)]:
+            x = random_nd([3, n], dtype=dtype)
+            h = random_nd([m], dtype=dtype)
+            for mode in ['full', 'same', 'valid']:
+                print(f'Testing convolve with N={n} M={m} mode={mode} dtype={dtype.__name__}')
+                res = dsc.convolve(dsc.from_numpy(x), dsc.from_numpy(h), mode).numpy()
+                target = np.stack([np.convolve(line, h, mode) for line in x])
+                assert all_close(res, target, eps * m)
+
+                res = dsc.correlate(dsc.from_numpy(x), dsc.from_numpy(h), mode).numpy()
+                target = np.stack([np.correlate(line, h, mode) for line in x])
+                assert all_close(res, target, eps * m)
+
+        # The samples are pushed in chunks of random length, the result must be the same as
+        # the convolution of the whole signal
+        for m in [5, 700]:
+            x = random_nd([20_000], dtype=dtype)
+            h = random_nd([m], dtype=dtype)
+            stream = dsc.ConvStream(dsc.from_numpy(h))
+            outputs = []
+            start = 0
+            while start < len(x):
+                stop = start + random.randint(1, 3000)
+                outputs.append(stream.push(dsc.from_numpy(x[start:stop])).numpy().copy())
+                start = stop
+            assert all_close(np.concatenate(outputs), np.convolve(x, h)[:len(x)], eps * m)
+
+
+
+def test_goertzel_sdft():
+    for dtype in DTYPES:
+        eps = 1e-4 if dtype == np.float32 or dtype == np.complex64 else 1e-8
+        # The bins are a subset of those of the FFT, x is zero-padded or truncated like in fft
+        for n, fft_n in [(1, 1), (100, 100), (1000, 1500), (5000, 4096), (10_000, 10_000)]:
+            for axis in [-1, 0]:
+                x = random_nd([n, 3] if axis == 0 else [3, n], dtype=dtype)
+                bins = [random.randrange(fft_n) for _ in range(random.randint(1, 40))]
+                print(f'Testing goertzel with N={n} n={fft_n} bins={len(bins)} axis={axis} dtype={dtype.__name__}')
+                res = dsc.goertzel(dsc.from_numpy(x), bins, n=fft_n, axis=axis).numpy()
+                target = np.take(np.fft.fft(x, n=fft_n, axis=axis), bins, axis=axis)
+                assert all_close(res, target, eps * np.sqrt(fft_n))
+
+        # Each row of the sliding DFT is the DFT of the window that ends with that sample
+        n = 256
+        bins = [0, 1, 17, 128, 255]
+        x = random_nd([3000], dtype=dtype)
+        sdft = dsc.SlidingDFT(n, bins, dtype=DSC_DTYPES[dtype])
+        outputs = []
+        start = 0
+        while start < len(x):
+            stop = start + random.randint(1, 700)
+            outputs.append(sdft.push(dsc.from_numpy(x[start:stop])).numpy().copy())
+            start = stop
+        padded = np.concatenate([np.zeros(n - 1, dtype=dtype), x])
+        windows = np.lib.stride_tricks.sliding_window_view(padded, n)
+        target = np.fft.fft(windows, axis=-1)[:, bins]
+        assert all_close(np.concatenate(outputs), target, eps * np.sqrt(n))
+
+
+def test_czt():
+    for dtype in DTYPES:
+        eps = 1e-4 if dtype == np.float32 or dtype == np.complex64 else 1e-8
+        for n, m in [(1, 1), (64, 64), (100, 37), (37, 300), (1000, 777)]:
+            for axis in [-1, 0]:
+                x = random_nd([n, 3] if axis == 0 else [3, n], dtype=dtype)
+                # Points on a spiral that slowly moves away from the unit circle
+                w = (1 + 1 / (n * m)) * np.exp(-2j * np.pi * random.random() / m)
+                a = (1 - 0.5 / n) * np.exp(2j * np.pi * random.random())
+                print(f'Testing czt with N={n} M={m} axis={axis} dtype={dtype.__name__}')
+                res = dsc.czt(dsc.from_numpy(x), m, w, a, axis=axis).numpy()
+                j, k = np.arange(n), np.arange(m)
+                xt = x if axis == -1 else x.T
+                target = (xt * a ** -j.astype(np.float64)) @ (w ** np.outer(j, k).astype(np.float64))
+                if axis == 0:
+                    target = target.T
+                scale = np.max(np.abs(target))
+                assert all_close(res / scale, target / scale, eps * np.sqrt(n))
+
+                # The default CZT is the DFT
+                res = dsc.czt(dsc.from_numpy(x), axis=axis).numpy()
+                assert all_close(res, np.fft.fft(x, axis=axis), eps * np.sqrt(n))
+
+        # M bins evenly spaced in [f0, f1) of a signal sampled at fs
+        n, m, fs = 1000, 250, 8000.0
+        f0, f1 = 1000.0, 1500.0
+        x = random_nd([2, n], dtype=dtype)
+        res = dsc.zoom_fft(dsc.from_numpy(x), (f0, f1), m, fs=fs).numpy()
+        freqs = f0 + (f1 - f0) * np.arange(m) / m
+        target = x @ np.exp(-2j * np.pi * np.outer(np.arange(n), freqs) / fs)
+        assert all_close(res, target, eps * np.sqrt(n))
+
+
+def _np_csd(x, y, nperseg, noverlap, window, fs, scaling, detrend):
+    # Same as scipy.signal.csd with a one-sided spectrum and mean averaging
+    step = nperseg - noverlap
+    n_seg = (x.shape[-1] - nperseg) // step + 1
+    idx = np.arange(nperseg)[None, :] + step * np.arange(n_seg)[:, None]
+    xs, ys = x[..., idx].astype(np.float64), y[..., idx].astype(np.float64)
+    if detrend:
+        xs = xs - xs.mean(axis=-1, keepdims=True)
+        ys = ys - ys.mean(axis=-1, keepdims=True)
+    p = np.conj(np.fft.rfft(xs * window, axis=-1)) * np.fft.rfft(ys * window, axis=-1)
+    p = p.mean(axis=-2)
+    p *= 1 / (fs * np.sum(window**2)) if scaling == 'density' else 1 / np.sum(window) ** 2
+    p[..., 1 : (None if nperseg % 2 else -1)] *= 2
+    return p
+
+
+def test_welch():
+    for dtype in [np.float32, np.float64]:
+        eps = 1e-4 if dtype == np.float32 else 1e-9
+        for n, nperseg, noverlap in [(16, 16, 0), (1000, 256, None), (1000, 255, 100), (20_000, 100, 99), (5001, 77, 10)]:
+            for axis in [-1, 0]:
+                x = random_nd([n, 3] if axis == 0 else [3, n], dtype=dtype) + 0.5
+                y = random_nd([n, 3] if axis == 0 else [3, n], dtype=dtype)
+                xt, yt = (x, y) if axis == -1 else (x.T, y.T)
+                overlap = nperseg // 2 if noverlap is None else noverlap
+                hann = 0.5 - 0.5 * np.cos(2 * np.pi * np.arange(nperseg) / nperseg)
+                print(f'Testing welch with N={n} nperseg={nperseg} noverlap={overlap} axis={axis} dtype={dtype.__name__}')
+
+                res = dsc.welch(dsc.from_numpy(x), nperseg=nperseg, noverlap=noverlap, axis=axis).numpy()
+                target = _np_csd(xt, xt, nperseg, overlap, hann, 1.0, 'density', True).real
+                if axis == 0:
+                    target = target.T
+                assert all_close(res / np.max(target), target / np.max(target), eps)
+
+                win = np.random.rand(nperseg).astype(dtype)
+                res = dsc.csd(
+                    dsc.from_numpy(x),
+                    dsc.from_numpy(y),
+                    fs=100.0,
+                    window=dsc.from_numpy(win),
+                    nperseg=nperseg,
+                    noverlap=noverlap,
+                    detrend=False,
+                    scaling='spectrum',
+                    axis=axis,
+                ).numpy()
+                target = _np_csd(xt, yt, nperseg, overlap, win.astype(np.float64), 100.0, 'spectrum', False)
+                if axis == 0:
+                    target = target.T
+                scale = np.max(np.abs(target))
+                assert all_close(res / scale, target / scale, eps)
+
+    # detrend=True is the same as 'constant', anything else than True, False or 'constant' is an error
+    x = dsc.from_numpy(random_nd([1000], dtype=np.float64) + 0.5)
+    assert all_close(dsc.welch(x, detrend=True).numpy(), dsc.welch(x, detrend='constant').numpy())
+    assert not all_close(dsc.welch(x, detrend=True).numpy(), dsc.welch(x, detrend=False).numpy())
+    for detrend in ['linear', 'Constant', None]:
+        with pytest.raises(ValueError):
+            dsc.welch(x, detrend=detrend)
+        with pytest.raises(ValueError):
+            dsc.csd(x, x, detrend=detrend)
+
+
+def test_hilbert():
+    for dtype in [np.float32, np.float64]:
+        eps = 1e-4 if dtype == np.float32 else 1e-9
+        for n, fft_n in [(1, -1), (2, -1), (16, -1), (1000, -1), (777, -1), (1000, 1024), (300, 255)]:
+            for axis in [-1, 0]:
+                x = random_nd([n, 5] if axis == 0 else [5, n], dtype=dtype)
+                print(f'Testing hilbert with N={n} n={fft_n} axis={axis} dtype={dtype.__name__}')
+                # Same as scipy.signal.hilbert
+                m = n if fft_n <= 0 else fft_n
+                h = np.zeros(m)
+                h[0] = 1
+                h[1 : (m + 1) // 2] = 2
+                if m % 2 == 0:
+                    h[m // 2] = 1
+                h = h if axis == -1 else h[:, None]
+                target = np.fft.ifft(np.fft.fft(x.astype(np.float64), m, axis=axis) * h, axis=axis)
+
+                out_shape = list(x.shape)
+                out_shape[axis] = m
+                envelope = dsc.empty(out_shape, dtype=dsc.Dtype.F32 if dtype == np.float32 else dsc.Dtype.F64)
+                phase = dsc.empty_like(envelope)
+                res = dsc.hilbert(dsc.from_numpy(x), fft_n, axis=axis, envelope=envelope, phase=phase).numpy()
+                assert all_close(res, target, eps)
+                assert all_close(envelope.numpy(), np.abs(res), eps)
+                # Compare the phases on the unit circle so that -π and π are the same angle
+                assert all_close(np.exp(1j * phase.numpy()), np.exp(1j * np.angle(res)), eps)
+
+
+def test_channelizer():
+    for dtype in DTYPES:
+        eps = 1e-4 if dtype == np.float32 or dtype == np.complex64 else 1e-9
+        for channels, taps in [(1, 5), (4, 3), (8, 64), (64, 640), (100, 1001), (1024, 4096)]:
+            print(f'Testing channelizer with M={channels} taps={taps} dtype={dtype.__name__}')
+            h = np.sinc(np.arange(taps) / channels - taps / (2 * channels)) * np.hanning(taps) / channels
+            x = random_nd([channels * 30], dtype=dtype)
+            channelizer = dsc.Channelizer(channels, dsc.from_numpy(h), dtype=DSC_DTYPES[dtype])
+            outputs = []
+            start = 0
+            while start < len(x):
+                stop = start + channels * random.randint(1, 10)
+                outputs.append(channelizer.push(dsc.from_numpy(x[start:stop])).numpy().copy())
+                start = stop
+            res = np.concatenate(outputs, axis=1)
+
+            # Channel k at sample n is sum_j h[j] * x[n - j] * e^(-i2πk(n - j)/M), with n the last sample of each block
+            last = np.arange(channels - 1, len(x), channels)
+            padded = np.concatenate([np.zeros(taps - 1, dtype=dtype), x])
+            windows = padded[last[:, None] + taps - 1 - np.arange(taps)[None, :]]
+            shift = np.exp(-2j * np.pi * np.outer((channels - 1 - np.arange(taps)) % channels, np.arange(channels)) / channels)
+            target = ((windows * h) @ shift).T
+            scale = np.max(np.abs(target))
+            assert all_close(res / scale, target / scale, eps)
+
+            # Same outputs after a reset
+            channelizer.reset()
+            res = channelizer.push(dsc.from_numpy(x)).numpy()
+            assert all_close(res / scale, target / scale, eps)
 
 
 def test_fftfreq():